@@ -0,0 +1,215 @@
+#include "iostream"
+#include "iomanip"
+#include "sstream"
+#include "chrono"
+#include "boost/python.hpp"
+
+#include "data/cache_main.h"
+#include "data/project.h"
+#include "data/python/pyutils.h"
+#include "source/plugins/render/offscreen_renderer.h"
+#include "source/plugins/datatypes/Object/object.h"
+
+#include "headless.h"
+
+namespace BPy = boost::python;
+using namespace MindTree;
+
+namespace {
+    struct RenderSettings {
+        std::string project;
+        std::string node;
+        std::string camera;
+        std::string output = "render.####.png";
+        int start = 1;
+        int end = 1;
+        int width = 1280;
+        int height = 720;
+        bool forward = false;
+    };
+
+    bool parseRenderArguments(const std::vector<std::string> &arguments, RenderSettings &settings)
+    {
+        for(size_t i = 0; i < arguments.size(); ++i) {
+            const std::string &arg = arguments[i];
+            bool hasValue = i + 1 < arguments.size();
+            if(arg == "--forward") {
+                settings.forward = true;
+                continue;
+            }
+            if(arg != "--render" && arg != "--node" && arg != "--camera"
+               && arg != "--frames" && arg != "--size" && arg != "--output")
+                continue;
+
+            if(!hasValue) {
+                std::cout << arg << " needs a value" << std::endl;
+                return false;
+            }
+            std::string value = arguments[++i];
+
+            if(arg == "--render") settings.project = value;
+            else if(arg == "--node") settings.node = value;
+            else if(arg == "--camera") settings.camera = value;
+            else if(arg == "--output") settings.output = value;
+            else if(arg == "--frames") {
+                char sep = 0;
+                std::istringstream stream(value);
+                stream >> settings.start;
+                settings.end = settings.start;
+                if(stream >> sep) stream >> settings.end;
+                if(stream.fail() || settings.end < settings.start) {
+                    std::cout << "invalid frame range: " << value << std::endl;
+                    return false;
+                }
+            }
+            else if(arg == "--size") {
+                char sep = 0;
+                std::istringstream stream(value);
+                stream >> settings.width >> sep >> settings.height;
+                if(stream.fail() || settings.width <= 0 || settings.height <= 0) {
+                    std::cout << "invalid size: " << value << std::endl;
+                    return false;
+                }
+            }
+        }
+        return settings.project != "";
+    }
+
+    //replaces the last run of # with the zero padded frame number, if there
+    //is none the frame is inserted before the extension
+    std::string framePath(std::string pattern, int frame)
+    {
+        auto last = pattern.find_last_of('#');
+        if(last == std::string::npos) {
+            auto dot = pattern.find_last_of('.');
+            auto slash = pattern.find_last_of('/');
+            if(dot == std::string::npos || (slash != std::string::npos && dot < slash))
+                dot = pattern.size();
+            pattern.insert(dot, ".####");
+            last = pattern.find_last_of('#');
+        }
+        auto first = pattern.find_last_not_of('#', last);
+        first = first == std::string::npos ? 0 : first + 1;
+
+        std::ostringstream number;
+        number << std::setw(last - first + 1) << std::setfill('0') << frame;
+        return pattern.replace(first, last - first + 1, number.str());
+    }
+
+    DoutSocket* findSceneOutput(DNSpace *space, const std::string &name)
+    {
+        for(const auto &node : space->getNodes()) {
+            if(name != "" && node->getNodeName() != name) continue;
+            for(auto *socket : node->getOutSockets()) {
+                if(socket->getType() == "GROUPDATA" || socket->getType() == "TRANSFORMABLE")
+                    return socket;
+            }
+        }
+        return nullptr;
+    }
+
+    GroupPtr evaluateScene(DoutSocket *socket)
+    {
+        DataCache cache;
+        Property data = cache.getOutput(socket);
+
+        if(data.getType() == "GROUPDATA")
+            return data.getData<GroupPtr>();
+
+        if(data.getType() == "TRANSFORMABLE") {
+            auto grp = std::make_shared<Group>();
+            grp->addMember(data.getData<AbstractTransformablePtr>());
+            return grp;
+        }
+        return nullptr;
+    }
+
+    //the timeline lives in a python plugin, so the frame is set through MT
+    bool setFrame(int frame, const RenderSettings &settings)
+    {
+        Python::GILLocker locker;
+        try {
+            auto timeline = BPy::import("MT").attr("timeline");
+            timeline.attr("setStart")(settings.start);
+            timeline.attr("setEnd")(settings.end);
+            timeline.attr("setFrame")(frame);
+        } catch(BPy::error_already_set&) {
+            PyErr_Clear();
+            return false;
+        }
+        return true;
+    }
+}
+
+int MindTree::renderHeadless(std::vector<std::string> arguments)
+{
+    RenderSettings settings;
+    if(!parseRenderArguments(arguments, settings)) {
+        std::cout << "usage: --render <project> [--node <name>] [--camera <name>] "
+                  << "[--frames <start>[-<end>]] [--size <width>x<height>] "
+                  << "[--output <path>] [--forward]" << std::endl;
+        return 1;
+    }
+
+    Project *project = Project::load(settings.project);
+    if(!project) {
+        std::cout << "could not open project: " << settings.project << std::endl;
+        return 1;
+    }
+
+    DoutSocket *socket = findSceneOutput(project->getRootSpace(), settings.node);
+    if(!socket) {
+        std::cout << "no node with scene output found" << std::endl;
+        return 1;
+    }
+
+    GL::OffscreenRenderer renderer(settings.width,
+                                   settings.height,
+                                   settings.forward ? GL::OffscreenRenderer::FORWARD
+                                                    : GL::OffscreenRenderer::DEFERRED);
+    if(!renderer.isValid()) return 1;
+
+    renderer.setProperty("GL:showgrid", false);
+    renderer.setProperty("GL:showcoordsystem", false);
+
+    bool warnedTimeline = false;
+    auto startTime = std::chrono::steady_clock::now();
+    for(int frame = settings.start; frame <= settings.end; ++frame) {
+        if(!setFrame(frame, settings) && !warnedTimeline) {
+            std::cout << "timeline not available, rendering a still" << std::endl;
+            warnedTimeline = true;
+        }
+
+        GroupPtr grp = evaluateScene(socket);
+        if(!grp) {
+            std::cout << "frame " << frame << ": scene could not be evaluated" << std::endl;
+            continue;
+        }
+
+        //use the scene lights if there are any
+        grp->setProperty("GL:defaultLighting", grp->getLights().empty());
+
+        bool foundCamera = false;
+        for(const auto &camera : grp->getCameras()) {
+            if(settings.camera == "" || camera->getName() == settings.camera) {
+                renderer.setCamera(camera);
+                foundCamera = true;
+                break;
+            }
+        }
+        if(!foundCamera && settings.camera != "")
+            std::cout << "frame " << frame << ": camera not found: " << settings.camera << std::endl;
+
+        renderer.setGeometry(grp);
+        std::string path = framePath(settings.output, frame);
+        renderer.renderFrame(path);
+        std::cout << "rendered frame " << frame << ": " << path << std::endl;
+    }
+
+    bool success = renderer.finish();
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - startTime;
+    int frames = settings.end - settings.start + 1;
+    std::cout << "rendered " << frames << " frames in " << duration.count() << "s ("
+              << frames / duration.count() << " fps)" << std::endl;
+    return success ? 0 : 1;
+}
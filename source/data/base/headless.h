@@ -0,0 +1,17 @@
+#ifndef HEADLESS_H_K2ZQ7RWD
+
+#define HEADLESS_H_K2ZQ7RWD
+
+#include "string"
+#include "vector"
+
+namespace MindTree
+{
+    //renders a frame range of a project without any window:
+    //--render <project> [--node <name>] [--camera <name>] [--frames <start>[-<end>]]
+    //[--size <width>x<height>] [--output <path, # is replaced by the frame>] [--forward]
+    int renderHeadless(std::vector<std::string> arguments);
+
+} /* MindTree */
+
+#endif /* end of include guard: HEADLESS_H_K2ZQ7RWD */
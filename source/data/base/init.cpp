@@ -3,14 +3,18 @@
 #include "data/cache_main.h"
 #include "data/python/pyutils.h"
 #include "data/project.h"
+#include "data/autosave.h"
 #include "data/properties.h"
 #include "data/reloadable.h"
+#include "data/thread_pool.h"
 #include "graphics/viewer.h"
+#include "headless.h"
 
 #include "init.h"
 
 namespace {
     bool nogui = false;
+    int exitCode = 0;
     std::string loadFile = "";
 }
 
@@ -29,10 +33,13 @@ void MindTree::initApp(int argc, char *argv[])
 void MindTree::initGui()
 {
     MindTree::Python::loadSettings();
+    MindTree::Autosave::start();
 }
 
 void MindTree::finalizeApp()
 {
+    MindTree::Autosave::stop();
+    MindTree::ThreadPool::stop();
     MindTree::Python::finalize();
     MindTree::HotProcessorManager::stop();
     MindTree::WorkerThread::stop();
@@ -55,6 +62,12 @@ void MindTree::parseArguments(int argc, char* argv[])
                 break;
             }
 
+            if (*it == "--render"){
+                exitCode = renderHeadless(arguments);
+                nogui = true;
+                return;
+            }
+
             if (*it == "--open" || *it == "-o"){
                 if((it+1) == end(arguments)) {
                     std::cout << "you have to specify a filename" << std::endl;
@@ -72,6 +85,20 @@ void MindTree::parseArguments(int argc, char* argv[])
 				return;
             }
 
+            if (*it == "--recover"){
+                if((it+1) == end(arguments)) {
+                    std::cout << "you have to specify a filename" << std::endl;
+                    nogui = true;
+                    return;
+                }
+
+                loadFile = *(it + 1);
+                std::cout<<"recover project: " << loadFile << std::endl;
+                if(!Project::recover(loadFile))
+                    Project::load(loadFile);
+                return;
+            }
+
         }
         if(testmode) runTests(std::vector<std::string>(arguments.begin() + 2, arguments.end()));
         nogui = true;
@@ -124,3 +151,8 @@ bool MindTree::noGui()
 {
     return nogui;
 }
+
+int MindTree::getExitCode()
+{
+    return exitCode;
+}
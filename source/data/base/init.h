@@ -12,6 +12,7 @@ namespace MindTree
     void runTests(std::vector<std::string> testlist);
 
     bool noGui();
+    int getExitCode();
 
 } /* MindTree */
 
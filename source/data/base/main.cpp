@@ -36,7 +36,7 @@ int main(int argc, char *argv[])
 
     if(MindTree::noGui()) {
         MindTree::finalizeApp();
-        return 0;
+        return MindTree::getExitCode();
     }
 
     QApplication a(argc, argv);
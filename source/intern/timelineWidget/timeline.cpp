@@ -270,7 +270,9 @@ BOOST_PYTHON_MODULE(mttimeline) {
     MindTree::NodeDataBase::registerNodeType(std::move(timelineNodeDecorator));
 
     auto frameProc = [](MindTree::DataCache* cache) {
-        cache->pushData(Timeline::frame());
+        //bakes evaluate frames without moving the timeline
+        const auto *evaluation = MindTree::FrameEvaluation::current();
+        cache->pushData(evaluation ? evaluation->getFrame() : Timeline::frame());
     };
 
     MindTree::DataCache::addProcessor(new MindTree::CacheProcessor("INTEGER",
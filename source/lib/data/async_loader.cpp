@@ -0,0 +1,209 @@
+#include "mutex"
+#include "deque"
+#include "unordered_map"
+#include "atomic"
+#include "algorithm"
+#include "sstream"
+
+#include "QCoreApplication"
+#include "QEvent"
+
+#include "data/signal.h"
+#include "data/cache_main.h"
+#include "data/nodes/data_node.h"
+#include "data/thread_pool.h"
+
+#include "async_loader.h"
+
+using namespace MindTree;
+
+namespace {
+    //loads are bound by the disk, more threads only make them compete for it
+    const size_t MAX_IO_THREADS = 4;
+
+    struct Entry {
+        std::string key;
+        Property data;
+        bool done{false};
+        uint64_t ticket{0};
+    };
+
+    struct Pool {
+        //guards everything but deliverMutex
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+        std::unordered_map<const DNode*, Entry> entries;
+        uint64_t nextTicket{0};
+        size_t workers{0};
+        size_t running{0};
+
+        //held while a finished load is announced, so its node can not be
+        //dropped in between
+        std::mutex deliverMutex;
+
+        //lives on the ui thread, guarded by deliverMutex
+        QObject *deliverer{nullptr};
+    };
+
+    //never destroyed, loads may still be running at exit
+    Pool& pool()
+    {
+        static Pool *p = new Pool;
+        return *p;
+    }
+
+    //runs loads on a thread of the shared pool until there are none left
+    void work()
+    {
+        Pool &p = pool();
+        for(;;) {
+            std::function<void()> job;
+            {
+                std::lock_guard<std::mutex> lock(p.mutex);
+                if(p.jobs.empty()) {
+                    --p.workers;
+                    return;
+                }
+                job = std::move(p.jobs.front());
+                p.jobs.pop_front();
+                ++p.running;
+            }
+            job();
+            std::lock_guard<std::mutex> lock(p.mutex);
+            --p.running;
+        }
+    }
+
+    //expects the pool mutex to be held, only a few threads of the shared
+    //pool work on loads at a time
+    void enqueue(std::function<void()> job)
+    {
+        Pool &p = pool();
+        p.jobs.push_back(std::move(job));
+        if(p.workers < MAX_IO_THREADS) {
+            ++p.workers;
+            ThreadPool::enqueue(work);
+        }
+    }
+
+    //makes a finished load visible and reports its node as changed
+    void announce(const DNode *node, std::string key, uint64_t ticket, Property data)
+    {
+        Pool &p = pool();
+        {
+            std::lock_guard<std::mutex> lock(p.mutex);
+            auto it = p.entries.find(node);
+            if(it == p.entries.end() || it->second.ticket != ticket)
+                return;
+
+            it->second.data = data;
+            it->second.done = true;
+        }
+
+        //a cook that is running right now may still cache its placeholder
+        //after this, the viewers invalidate the node again on their worker
+        //thread once that cook is through
+        DataCache::invalidate(node);
+        MT_CUSTOM_SIGNAL_EMITTER("STATUSUPDATE", std::string("done loading ") + key);
+        MT_CUSTOM_SIGNAL_EMITTER("nodeChanged", const_cast<DNode*>(node));
+    }
+
+    class DeliverEvent : public QEvent
+    {
+    public:
+        DeliverEvent(std::function<void()> fn) : QEvent(QEvent::User), fn(fn) {}
+        std::function<void()> fn;
+    };
+
+    //runs finished loads on the ui thread, where the graph is edited, so
+    //invalidating does not walk the sockets while they change
+    class Deliverer : public QObject
+    {
+    public:
+        ~Deliverer()
+        {
+            Pool &p = pool();
+            std::lock_guard<std::mutex> lock(p.deliverMutex);
+            p.deliverer = nullptr;
+        }
+
+    protected:
+        void customEvent(QEvent *event) override
+        {
+            static_cast<DeliverEvent*>(event)->fn();
+        }
+    };
+
+    void createDeliverer()
+    {
+        Pool &p = pool();
+        std::lock_guard<std::mutex> lock(p.deliverMutex);
+        p.deliverer = new Deliverer;
+        p.deliverer->setParent(QCoreApplication::instance());
+    }
+
+    void deliver(const DNode *node, std::string key, uint64_t ticket, Property data)
+    {
+        Pool &p = pool();
+        std::lock_guard<std::mutex> deliverLock(p.deliverMutex);
+        if(p.deliverer) {
+            QCoreApplication::postEvent(p.deliverer, new DeliverEvent([node, key, ticket, data] {
+                announce(node, key, ticket, data);
+            }));
+            return;
+        }
+
+        //without an application there is no ui thread to hand over to
+        announce(node, key, ticket, data);
+    }
+}
+
+Q_COREAPP_STARTUP_FUNCTION(createDeliverer)
+
+Property AsyncLoader::request(const DNode *node, std::string key, LoadFunction load)
+{
+    Pool &p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+
+    auto &entry = p.entries[node];
+    if(entry.ticket && entry.key == key)
+        return entry.done ? entry.data : Property();
+
+    entry = Entry();
+    entry.key = key;
+    entry.ticket = ++p.nextTicket;
+
+    uint64_t ticket = entry.ticket;
+    enqueue([node, key, ticket, load] {
+        //only whole percents are reported, the status bar can not keep up
+        //with more
+        auto reported = std::make_shared<std::atomic<int>>(-1);
+        Progress progress = [key, reported] (float done) {
+            int percent = static_cast<int>(std::max(0.f, std::min(1.f, done)) * 100);
+            if(reported->exchange(percent) == percent) return;
+
+            std::stringstream ss;
+            ss << "loading " << key << " " << percent << "%";
+            MT_CUSTOM_SIGNAL_EMITTER("STATUSUPDATE", ss.str());
+        };
+
+        progress(0);
+        deliver(node, key, ticket, load(progress));
+    });
+    return Property();
+}
+
+void AsyncLoader::drop(const DNode *node)
+{
+    Pool &p = pool();
+    std::lock_guard<std::mutex> deliverLock(p.deliverMutex);
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.entries.erase(node);
+}
+
+size_t AsyncLoader::pending()
+{
+    Pool &p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    return p.jobs.size() + p.running;
+}
@@ -0,0 +1,41 @@
+#ifndef MT_ASYNC_LOADER_H
+#define MT_ASYNC_LOADER_H
+
+#include "string"
+#include "functional"
+#include "data/properties.h"
+
+namespace MindTree
+{
+class DNode;
+
+//runs slow loads like file imports on a small pool of I/O threads, so the
+//thread that cooks the node graph never waits for the disk. A processor
+//requests the data of its node and pushes a placeholder as long as the load
+//is running. When the data arrives it is handed to the ui thread, which
+//invalidates the node and reports it as changed through the "nodeChanged"
+//signal. The viewers that depend on it invalidate it once more on their
+//worker thread, after a cook that still ran with the placeholder, and the
+//next cook picks the data up
+class AsyncLoader
+{
+public:
+    //fraction of the load that is done, between 0 and 1
+    typedef std::function<void(float)> Progress;
+    typedef std::function<Property(const Progress&)> LoadFunction;
+
+    //returns what load returned for this node and key, or an invalid
+    //property while it is still loading. A key different from the last one
+    //requested for the node, like a new file path, starts a new load and
+    //discards the running one
+    static Property request(const DNode *node, std::string key, LoadFunction load);
+
+    //forgets the data of a node, a running load is discarded when it ends
+    static void drop(const DNode *node);
+
+    //how many loads are queued or running
+    static size_t pending();
+};
+}
+
+#endif
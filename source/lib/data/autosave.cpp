@@ -0,0 +1,716 @@
+#include "thread"
+#include "mutex"
+#include "condition_variable"
+#include "deque"
+#include "atomic"
+#include "algorithm"
+#include "cstring"
+#include "cstdio"
+#include "cerrno"
+
+#include "fcntl.h"
+#include "unistd.h"
+
+#include "QCoreApplication"
+#include "QTimer"
+
+#include "data/signal.h"
+#include "data/io.h"
+#include "data/project.h"
+#include "data/dnspace.h"
+#include "data/nodes/data_node.h"
+#include "data/nodes/containernode.h"
+#include "data/nodes/node_db.h"
+
+#include "autosave.h"
+
+using namespace MindTree;
+
+namespace {
+    const char JOURNAL_MAGIC[] = "MTJOURNAL";
+
+    //the journal is replaced by a snapshot once it has this many records or
+    //bytes
+    const size_t COMPACT_RECORDS = 2000;
+    const size_t COMPACT_SIZE = 16 << 20;
+    //a long journal is only compacted after this many milliseconds without
+    //an edit
+    const int IDLE_INTERVAL = 2000;
+
+    enum RecordType : int {
+        //the snapshot the journal starts from, always the first record
+        BASE,
+        ADD_NODE,
+        REMOVE_NODE,
+        LINK,
+        PROPERTY
+    };
+
+    //every record starts with the size and a checksum of its data, a record
+    //that was not written completely ends the journal
+    struct RecordHeader {
+        uint32_t size;
+        uint32_t checksum;
+    };
+
+    uint32_t checksum(const char *data, size_t size)
+    {
+        uint32_t hash = 2166136261u;
+        for(size_t i = 0; i < size; ++i)
+            hash = (hash ^ static_cast<uint8_t>(data[i])) * 16777619u;
+        return hash;
+    }
+
+    void frame(const std::vector<char> &record, std::vector<char> &out)
+    {
+        RecordHeader header{static_cast<uint32_t>(record.size()),
+                            checksum(record.data(), record.size())};
+        const char *bytes = reinterpret_cast<const char*>(&header);
+        out.insert(out.end(), bytes, bytes + sizeof(header));
+        out.insert(out.end(), record.begin(), record.end());
+    }
+
+    std::string snapshotPath(const std::string &journal, int index)
+    {
+        return journal + ".snapshot" + std::to_string(index);
+    }
+
+    struct Job {
+        enum Type {
+            //appends records to the journal
+            APPEND,
+            //starts a new journal on base or on the snapshot
+            RESTART,
+            //moves the journal to a new path
+            MOVE
+        };
+
+        Type type;
+        std::string journal;
+        std::string base;
+        std::vector<char> data;
+        std::shared_ptr<IO::ProjectSnapshot> snapshot;
+    };
+
+    struct State {
+        //guards everything but callbacks
+        std::mutex mutex;
+        std::condition_variable wakeup, idle;
+        std::deque<Job> jobs;
+        bool writing{false};
+        bool stopping{false};
+        std::thread thread;
+
+        //the project that is recorded, null while none is open
+        std::atomic<Project*> project{nullptr};
+        std::string journal;
+        //what went into the journal since its snapshot
+        size_t records{0}, size{0};
+        //whether anything was recorded since the idle timer last fired
+        bool edited{false};
+        //the last space that was recovered, it is not in any file yet
+        DNSpace *recovered{nullptr};
+
+        Signal::CallbackVector callbacks;
+        //lives on the ui thread
+        QTimer *idleTimer{nullptr};
+    };
+
+    //never destroyed, the writer may still run at exit
+    State& state()
+    {
+        static State *s = new State;
+        return *s;
+    }
+
+    bool writeAll(int fd, const char *data, size_t size)
+    {
+        while(size) {
+            ssize_t written = ::write(fd, data, size);
+            if(written < 0) {
+                if(errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    //the old file stays intact until the new one is complete
+    bool replaceFile(const std::string &path, const std::vector<char> &data)
+    {
+        std::string tmpname = path + ".tmp";
+        int fd = open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) return false;
+
+        bool written = writeAll(fd, data.data(), data.size()) && fsync(fd) == 0;
+        close(fd);
+        return written && std::rename(tmpname.c_str(), path.c_str()) == 0;
+    }
+
+    //everything that touches the files, only used by the writer thread
+    class Writer
+    {
+    public:
+        Writer() : _fd(-1), _ownsBase(false) {}
+        ~Writer() { if(_fd >= 0) close(_fd); }
+
+        void run(const Job &job)
+        {
+            switch(job.type) {
+                case Job::APPEND:
+                    if(_fd >= 0 && !writeAll(_fd, job.data.data(), job.data.size()))
+                        std::cout << "could not write to " << _journal << std::endl;
+                    break;
+                case Job::RESTART:
+                    restart(job);
+                    break;
+                case Job::MOVE:
+                    move(job.journal);
+                    break;
+            }
+        }
+
+        void sync()
+        {
+            if(_fd >= 0) fsync(_fd);
+        }
+
+    private:
+        void restart(const Job &job)
+        {
+            //snapshots alternate between two files, so the one the current
+            //journal starts from is still there if this one fails
+            std::string base = job.base;
+            if(job.snapshot) {
+                IO::OutStream stream;
+                stream.writeProject(*job.snapshot);
+                base = snapshotPath(job.journal, _base == snapshotPath(job.journal, 0));
+                if(!replaceFile(base, stream.data())) {
+                    //the records keep going to the old journal
+                    std::cout << "could not write snapshot " << base << std::endl;
+                    return;
+                }
+            }
+
+            IO::OutStream record;
+            record << static_cast<int>(BASE) << base;
+            std::vector<char> data(JOURNAL_MAGIC, JOURNAL_MAGIC + sizeof(JOURNAL_MAGIC));
+            frame(record.data(), data);
+            if(!replaceFile(job.journal, data)) {
+                std::cout << "could not start journal " << job.journal << std::endl;
+                return;
+            }
+
+            //including those left behind by a journal that was moved
+            if(_ownsBase && _base != base)
+                std::remove(_base.c_str());
+            for(int i = 0; i < 2; ++i)
+                if(snapshotPath(job.journal, i) != base)
+                    std::remove(snapshotPath(job.journal, i).c_str());
+
+            _base = base;
+            _ownsBase = job.snapshot != nullptr;
+            open(job.journal);
+        }
+
+        void move(const std::string &journal)
+        {
+            if(_fd < 0 || journal == _journal) return;
+            if(std::rename(_journal.c_str(), journal.c_str()) != 0) {
+                std::cout << "could not move " << _journal << " to " << journal << std::endl;
+                return;
+            }
+            open(journal);
+        }
+
+        void open(const std::string &journal)
+        {
+            if(_fd >= 0) close(_fd);
+            _journal = journal;
+            _fd = ::open(journal.c_str(), O_WRONLY | O_APPEND);
+            if(_fd < 0) std::cout << "could not open " << journal << std::endl;
+        }
+
+        int _fd;
+        std::string _journal;
+        std::string _base;
+        //whether the base is a snapshot that was written here
+        bool _ownsBase;
+    };
+
+    void work()
+    {
+        State &s = state();
+        Writer writer;
+        std::unique_lock<std::mutex> lock(s.mutex);
+        for(;;) {
+            s.wakeup.wait(lock, [&s] { return !s.jobs.empty() || s.stopping; });
+            if(s.jobs.empty()) return;
+
+            std::deque<Job> jobs;
+            jobs.swap(s.jobs);
+            s.writing = true;
+            lock.unlock();
+
+            for(const auto &job : jobs)
+                writer.run(job);
+            writer.sync();
+
+            lock.lock();
+            s.writing = false;
+            s.idle.notify_all();
+        }
+    }
+
+    void enqueue(Job job)
+    {
+        State &s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if(job.type == Job::RESTART) {
+            s.records = 0;
+            s.size = 0;
+        }
+        else if(job.type == Job::APPEND) {
+            s.edited = true;
+            ++s.records;
+            s.size += job.data.size();
+
+            //records that come in while the writer is busy go out in one piece
+            if(!s.jobs.empty() && s.jobs.back().type == Job::APPEND) {
+                auto &data = s.jobs.back().data;
+                data.insert(data.end(), job.data.begin(), job.data.end());
+                return;
+            }
+        }
+        s.jobs.push_back(std::move(job));
+        s.wakeup.notify_one();
+    }
+
+    void append(const IO::OutStream &record)
+    {
+        Job job{Job::APPEND, "", "", {}};
+        frame(record.data(), job.data);
+        enqueue(std::move(job));
+    }
+
+    //runs on the ui thread from the idle timer, never while edits come in
+    void compactWhenIdle()
+    {
+        State &s = state();
+        Project *project = s.project;
+        bool compact;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            compact = !s.edited && (s.records >= COMPACT_RECORDS || s.size >= COMPACT_SIZE);
+            s.edited = false;
+        }
+        if(compact && project) Autosave::compact();
+    }
+
+    template<typename T>
+    int indexOf(const std::vector<T> &list, const void *item)
+    {
+        auto it = std::find(list.begin(), list.end(), item);
+        return it != list.end() ? static_cast<int>(it - list.begin()) : -1;
+    }
+
+    //positions of the containers around the node and of the node itself,
+    //starting at the root space. Empty if the node is not part of the
+    //recorded project
+    std::vector<int> nodePath(const DNode *node)
+    {
+        Project *project = state().project;
+        std::vector<int> path;
+        while(project && node) {
+            DNSpace *space = node->getSpace();
+            if(!space) break;
+
+            NodeList nodes = space->getNodes();
+            auto it = std::find_if(nodes.begin(), nodes.end(),
+                                   [node] (const NodePtr &n) { return n.get() == node; });
+            if(it == nodes.end()) break;
+
+            path.insert(path.begin(), static_cast<int>(it - nodes.begin()));
+            if(space == project->getRootSpace()) return path;
+            if(!space->isContainerSpace()) break;
+            node = space->toContainer()->getContainer();
+        }
+        return std::vector<int>();
+    }
+
+    void recordLink(DinSocket *in, bool removed)
+    {
+        std::vector<int> inPath = nodePath(in->getNode());
+        if(inPath.empty()) return;
+
+        std::vector<int> outPath;
+        int outIndex = -1;
+        if(!removed) {
+            DoutSocket *out = in->getCntdSocket();
+            if(!out) return;
+            outPath = nodePath(out->getNode());
+            outIndex = indexOf(out->getNode()->getOutSockets(), out);
+            if(outPath.empty() || outIndex < 0) return;
+        }
+
+        IO::OutStream record;
+        record << static_cast<int>(LINK)
+            << inPath << indexOf(in->getNode()->getInSockets(), in)
+            << outPath << outIndex;
+        append(record);
+    }
+
+    void nodeAdded(NodePtr node)
+    {
+        //nodes of container spaces that are read when they are first needed
+        if(IO::InStream::isReading()) return;
+
+        std::vector<int> path = nodePath(node.get());
+        if(path.empty()) return;
+
+        IO::OutStream record;
+        record << static_cast<int>(ADD_NODE) << std::vector<int>(path.begin(), path.end() - 1);
+        record << *node;
+        append(record);
+
+        //copies come with their links
+        for(DinSocket *in : node->getInSockets())
+            if(in->getCntdSocket()) recordLink(in, false);
+    }
+
+    //emitted before the node is taken out of its space
+    void nodeRemoved(DNode *node)
+    {
+        std::vector<int> path = nodePath(node);
+        if(path.empty()) return;
+
+        IO::OutStream record;
+        record << static_cast<int>(REMOVE_NODE) << path;
+        append(record);
+    }
+
+    void linkCreated(DinSocket *in)
+    {
+        if(IO::InStream::isReading()) return;
+        recordLink(in, false);
+    }
+
+    //emitted before the link is cleared
+    void linkRemoved(DinSocket *in)
+    {
+        recordLink(in, true);
+    }
+
+    void socketChanged(DinSocket *socket)
+    {
+        if(!socket || IO::InStream::isReading()) return;
+
+        std::vector<int> path = nodePath(socket->getNode());
+        if(path.empty()) return;
+
+        IO::OutStream record;
+        record << static_cast<int>(PROPERTY)
+            << path << indexOf(socket->getNode()->getInSockets(), socket)
+            << socket->getProperty();
+        append(record);
+    }
+
+    void projectOpened(Project *project)
+    {
+        State &s = state();
+        bool recovered;
+        std::string journal = Autosave::journalPath(project->getFilename());
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.project = project;
+            s.journal = journal;
+            recovered = project->getRootSpace() == s.recovered;
+            s.recovered = nullptr;
+        }
+
+        //the file does not have the recovered edits
+        if(recovered) Autosave::compact();
+        else enqueue(Job{Job::RESTART, journal, project->getFilename(), {}});
+    }
+
+    void projectClosed(Project *project)
+    {
+        Project *expected = project;
+        state().project.compare_exchange_strong(expected, nullptr);
+    }
+
+    //what was edited so far is in the file now
+    void projectSaved(Project *project)
+    {
+        State &s = state();
+        if(project != s.project) return;
+
+        std::string journal = Autosave::journalPath(project->getFilename());
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.journal = journal;
+        }
+        enqueue(Job{Job::RESTART, journal, project->getFilename(), {}});
+    }
+
+    void filenameChanged(std::string filename)
+    {
+        State &s = state();
+        if(!s.project) return;
+
+        std::string journal = Autosave::journalPath(filename);
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if(journal == s.journal) return;
+            s.journal = journal;
+        }
+        enqueue(Job{Job::MOVE, journal, "", {}});
+    }
+
+    DNode* findNode(DNSpace *root, const std::vector<int> &path)
+    {
+        DNSpace *space = root;
+        DNode *node = nullptr;
+        for(size_t i = 0; i < path.size(); ++i) {
+            if(!space) return nullptr;
+            NodeList nodes = space->getNodes();
+            if(path[i] < 0 || size_t(path[i]) >= nodes.size()) return nullptr;
+            node = nodes[path[i]].get();
+
+            auto *container = dynamic_cast<ContainerNode*>(node);
+            space = container && i + 1 < path.size() ? container->getContainerData() : nullptr;
+        }
+        return node;
+    }
+
+    DNSpace* findSpace(DNSpace *root, const std::vector<int> &path)
+    {
+        if(path.empty()) return root;
+        auto *container = dynamic_cast<ContainerNode*>(findNode(root, path));
+        return container ? container->getContainerData() : nullptr;
+    }
+
+    template<typename T>
+    T* socketAt(const std::vector<T*> &sockets, int index)
+    {
+        return index >= 0 && size_t(index) < sockets.size() ? sockets[index] : nullptr;
+    }
+
+    bool replay(IO::InStream &stream, DNSpace *root)
+    {
+        int type = -1;
+        stream >> type;
+        switch(type) {
+            case ADD_NODE: {
+                std::vector<int> spacePath;
+                stream >> spacePath;
+
+                NodeType nodeType;
+                stream.beginBlock("DNode");
+                stream >> nodeType;
+                auto node = NodeDataBase::createNodeByType(nodeType);
+                if(node) stream >> *node;
+                stream.endBlock("DNode");
+
+                DNSpace *space = findSpace(root, spacePath);
+                if(!node || !space) return false;
+
+                //the ids of linked sockets are those of the recording
+                //session, the links follow as records of their own
+                for(DinSocket *in : node->getInSockets())
+                    in->setTempCntdID(0);
+                stream.linkSockets();
+
+                space->addNode(node);
+                return true;
+            }
+            case REMOVE_NODE: {
+                std::vector<int> path;
+                stream >> path;
+                DNode *node = findNode(root, path);
+                if(!node || !node->getSpace()) return false;
+                node->getSpace()->removeNode(node);
+                return true;
+            }
+            case LINK: {
+                std::vector<int> inPath, outPath;
+                int inIndex = -1, outIndex = -1;
+                stream >> inPath >> inIndex >> outPath >> outIndex;
+
+                DNode *inNode = findNode(root, inPath);
+                DinSocket *in = inNode ? socketAt(inNode->getInSockets(), inIndex) : nullptr;
+                if(!in) return false;
+
+                if(outIndex < 0) {
+                    if(in->getCntdSocket()) in->setCntdSocket(nullptr);
+                    return true;
+                }
+
+                DNode *outNode = findNode(root, outPath);
+                DoutSocket *out = outNode ? socketAt(outNode->getOutSockets(), outIndex) : nullptr;
+                if(!out) return false;
+                in->setCntdSocket(out);
+                return true;
+            }
+            case PROPERTY: {
+                std::vector<int> path;
+                int index = -1;
+                Property prop;
+                stream >> path >> index >> prop;
+
+                DNode *node = findNode(root, path);
+                DinSocket *socket = node ? socketAt(node->getInSockets(), index) : nullptr;
+                if(!socket) return false;
+                socket->setProperty(prop);
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+}
+
+void Autosave::start()
+{
+    State &s = state();
+    if(s.thread.joinable()) return;
+
+    s.stopping = false;
+    s.thread = std::thread(work);
+
+    s.callbacks.push_back(Signal::getHandler<Project*>().connect("newProject", projectOpened));
+    s.callbacks.push_back(Signal::getHandler<Project*>().connect("closeProject", projectClosed));
+    s.callbacks.push_back(Signal::getHandler<Project*>().connect("projectSaved", projectSaved));
+    s.callbacks.push_back(Signal::getHandler<std::string>().connect("filename_changed", filenameChanged));
+    s.callbacks.push_back(Signal::getHandler<NodePtr>().connect("addNode", nodeAdded));
+    s.callbacks.push_back(Signal::getHandler<DNode*>().connect("removeNode", nodeRemoved));
+    s.callbacks.push_back(Signal::getHandler<DinSocket*>().connect("createLink", linkCreated));
+    s.callbacks.push_back(Signal::getHandler<DinSocket*>().connect("removeLink", linkRemoved));
+    s.callbacks.push_back(Signal::getHandler<DinSocket*>().connect("socketChanged", socketChanged));
+
+    //without an application there is no idle time, compact is called
+    //directly then
+    if(QCoreApplication::instance()) {
+        s.idleTimer = new QTimer;
+        QObject::connect(s.idleTimer, &QTimer::timeout, compactWhenIdle);
+        s.idleTimer->start(IDLE_INTERVAL);
+    }
+
+    if(Project::instance()) projectOpened(Project::instance());
+}
+
+void Autosave::stop()
+{
+    State &s = state();
+    if(!s.thread.joinable()) return;
+
+    s.callbacks.clear();
+    delete s.idleTimer;
+    s.idleTimer = nullptr;
+    s.project = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.stopping = true;
+    }
+    s.wakeup.notify_one();
+    s.thread.join();
+}
+
+void Autosave::compact()
+{
+    State &s = state();
+    Project *project = s.project;
+    if(!project || !s.thread.joinable()) return;
+
+    //the graph can only be read here, so this only copies it into
+    //uncompressed sections. Storing them and copying the sections of the
+    //containers that were not loaded yet is left to the writer
+    auto snapshot = std::make_shared<IO::ProjectSnapshot>(*project->getRootSpace(), false);
+
+    std::string journal;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        journal = s.journal;
+    }
+    enqueue(Job{Job::RESTART, journal, "", {}, snapshot});
+}
+
+void Autosave::flush()
+{
+    State &s = state();
+    if(!s.thread.joinable()) return;
+
+    std::unique_lock<std::mutex> lock(s.mutex);
+    s.idle.wait(lock, [&s] { return s.jobs.empty() && !s.writing; });
+}
+
+DNSpace* Autosave::recover(std::string filename)
+{
+    std::string journal = journalPath(filename);
+    auto file = std::make_shared<IO::MappedFile>(journal);
+    if(!file->isOpen() || file->size() < sizeof(JOURNAL_MAGIC)
+       || std::memcmp(file->data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) {
+        std::cout << "nothing to recover for " << filename << std::endl;
+        return nullptr;
+    }
+
+    DNSpace *root = nullptr;
+    size_t pos = sizeof(JOURNAL_MAGIC);
+    size_t replayed = 0;
+    while(pos + sizeof(RecordHeader) <= file->size()) {
+        RecordHeader header;
+        std::memcpy(&header, file->data() + pos, sizeof(header));
+        size_t start = pos + sizeof(header);
+        if(header.size > file->size() - start
+           || checksum(file->data() + start, header.size) != header.checksum) {
+            std::cout << "the last edit in " << journal << " is incomplete" << std::endl;
+            break;
+        }
+        pos = start + header.size;
+
+        IO::InStream stream(file, start, header.size);
+        if(root) {
+            if(!replay(stream, root)) {
+                std::cout << "could not replay edit " << replayed + 1 << " of " << journal << std::endl;
+                break;
+            }
+            ++replayed;
+            continue;
+        }
+
+        int type = -1;
+        std::string base;
+        stream >> type >> base;
+        if(type != BASE) {
+            std::cout << journal << " does not start with a snapshot" << std::endl;
+            return nullptr;
+        }
+        if(base.empty()) {
+            root = new DNSpace();
+        }
+        else if(access(base.c_str(), R_OK) == 0) {
+            root = IO::InStream(base).readProject();
+        }
+        else {
+            std::cout << "the snapshot " << base << " is missing" << std::endl;
+            return nullptr;
+        }
+    }
+
+    if(!root) return nullptr;
+    std::cout << "recovered " << replayed << " edits from " << journal << std::endl;
+
+    State &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.recovered = root;
+    return root;
+}
+
+std::string Autosave::journalPath(std::string filename)
+{
+    if(filename.empty())
+        filename = std::string(P_tmpdir) + "/mindtree_untitled.mt";
+    return filename + ".journal";
+}
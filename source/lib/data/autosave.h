@@ -0,0 +1,46 @@
+#ifndef MT_AUTOSAVE_H
+#define MT_AUTOSAVE_H
+
+#include "string"
+
+namespace MindTree
+{
+class DNSpace;
+
+//keeps a journal of the edits to the open project next to its file, so a
+//session that crashed can be recovered. Added and removed nodes, links and
+//socket values are recorded as they happen and appended to the journal on a
+//thread of its own. Once the journal gets long, the whole graph is
+//serialized into a snapshot and a new journal is started on top of it, as
+//soon as there was no edit for a while.
+//
+//Nodes are addressed by their position in their space, which is the same
+//when the journal is replayed in order. Edits that are not signalled, like
+//moving or renaming a node, only end up in the next snapshot
+class Autosave
+{
+public:
+    //starts recording the project that is open and every project that is
+    //opened afterwards
+    static void start();
+    //writes what is left and stops recording
+    static void stop();
+
+    //serializes the project into a snapshot and starts a new journal on it
+    static void compact();
+
+    //blocks until everything that was recorded is on disk
+    static void flush();
+
+    //reads the journal of the project saved as filename, the snapshot it
+    //starts from and replays it. Returns null if there is nothing to
+    //recover, the caller owns the returned space
+    static DNSpace* recover(std::string filename);
+
+    //where the journal of a project with this filename is written, projects
+    //without a filename write to the temp directory
+    static std::string journalPath(std::string filename);
+};
+}
+
+#endif
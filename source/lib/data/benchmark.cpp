@@ -16,8 +16,13 @@ BenchmarkHandler::~BenchmarkHandler()
     if(!_benchmark.expired()) _benchmark.lock()->end();
 }
 
+std::atomic<bool> Benchmark::s_tracing{false};
+std::mutex Benchmark::s_rootsLock;
+std::vector<std::weak_ptr<Benchmark>> Benchmark::s_roots;
+
 Benchmark::Benchmark(std::string name) :
-    _name(name), _time(0), _num_calls(0), _parent(nullptr), _running(false), _children_called(0)
+    _name(name), _time(0), _num_calls(0), _parent(nullptr), _running(false), _children_called(0),
+    _gpuTime(0), _gpuSamples(0)
 {
 }
 
@@ -28,6 +33,7 @@ const Benchmark *Benchmark::parent() const
 
 std::vector<std::shared_ptr<Benchmark>> Benchmark::benchmarks() const
 {
+    std::lock_guard<std::recursive_mutex> lock(_benchmarkLock);
 	return _benchmarks;
 }
 
@@ -51,6 +57,16 @@ void Benchmark::addBenchmark(std::shared_ptr<Benchmark> benchmark)
     _benchmarks.push_back(benchmark);
 }
 
+void Benchmark::removeBenchmark(std::shared_ptr<Benchmark> benchmark)
+{
+    std::lock_guard<std::recursive_mutex> lock(_benchmarkLock);
+    auto it = std::find(_benchmarks.begin(), _benchmarks.end(), benchmark);
+    if(it == _benchmarks.end()) return;
+
+    benchmark->_parent = nullptr;
+    _benchmarks.erase(it);
+}
+
 double Benchmark::getTime() const
 {
     std::lock_guard<std::recursive_mutex> lock(_benchmarkLock);
@@ -80,6 +96,8 @@ void Benchmark::reset()
 
     _time = std::chrono::microseconds(0);
     _num_calls = 0;
+    _gpuTime = std::chrono::nanoseconds(0);
+    _gpuSamples = 0;
     _running = false;
     _children_called = 0;
 
@@ -106,6 +124,7 @@ void Benchmark::end()
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(_end - _start);
     _time += duration;
     _running = false;
+    if(s_tracing) addTraceEvent({_start, _end - _start, false});
 
     //if(_parent) {
     //    std::lock_guard<std::recursive_mutex> lock(_parent->_benchmarkLock);
@@ -116,6 +135,109 @@ void Benchmark::end()
     if(_callback) _callback(this);
 }
 
+void Benchmark::addGPUTime(std::chrono::steady_clock::time_point start, std::chrono::nanoseconds duration)
+{
+    std::lock_guard<std::recursive_mutex> lock(_benchmarkLock);
+    _gpuTime += duration;
+    ++_gpuSamples;
+    if(s_tracing) addTraceEvent({start, duration, true});
+}
+
+double Benchmark::getCPUTime() const
+{
+    std::lock_guard<std::recursive_mutex> lock(_benchmarkLock);
+    if(!_num_calls) return 0;
+    return getTime();
+}
+
+double Benchmark::getGPUTime() const
+{
+    std::lock_guard<std::recursive_mutex> lock(_benchmarkLock);
+    if(!_gpuSamples) return 0;
+    return _gpuTime.count() / 1000000.0 / _gpuSamples;
+}
+
+int Benchmark::getNumGPUSamples() const
+{
+    std::lock_guard<std::recursive_mutex> lock(_benchmarkLock);
+    return _gpuSamples;
+}
+
+void Benchmark::setTracing(bool enable)
+{
+    s_tracing = enable;
+}
+
+bool Benchmark::isTracing()
+{
+    return s_tracing;
+}
+
+void Benchmark::addTraceEvent(TraceEvent event)
+{
+    _traceEvents.push_back(event);
+    if(_traceEvents.size() > MAX_TRACE_EVENTS)
+        _traceEvents.pop_front();
+}
+
+void Benchmark::writeTrace(std::ostream &stream) const
+{
+    bool first = true;
+    stream << "{\"traceEvents\":[";
+    writeTraceEvents(stream, first);
+    stream << "\n]}" << std::endl;
+}
+
+void Benchmark::writeTrace(std::ostream &stream, const std::vector<std::shared_ptr<Benchmark>> &benchmarks)
+{
+    bool first = true;
+    stream << "{\"traceEvents\":[";
+    for(const auto &benchmark : benchmarks)
+        benchmark->writeTraceEvents(stream, first);
+    stream << "\n]}" << std::endl;
+}
+
+void Benchmark::writeTraceEvents(std::ostream &stream, bool &first) const
+{
+    std::lock_guard<std::recursive_mutex> lock(_benchmarkLock);
+    std::string name;
+    for(char c : _name) {
+        if(c == '"' || c == '\\') name += '\\';
+        if(static_cast<unsigned char>(c) >= 0x20) name += c;
+    }
+
+    for(const auto &event : _traceEvents) {
+        auto start = std::chrono::duration_cast<std::chrono::microseconds>(event.start.time_since_epoch());
+        double duration = event.duration.count() / 1000.0;
+        stream << (first ? "\n" : ",\n");
+        first = false;
+        stream << "{\"name\":\"" << name << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+               << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1)
+               << ",\"ts\":" << start.count() << ",\"dur\":" << duration << "}";
+    }
+
+    for(const auto &bench : _benchmarks)
+        bench->writeTraceEvents(stream, first);
+}
+
+void Benchmark::addRoot(std::shared_ptr<Benchmark> benchmark)
+{
+    std::lock_guard<std::mutex> lock(s_rootsLock);
+    s_roots.erase(std::remove_if(s_roots.begin(), s_roots.end(),
+                                 [](const std::weak_ptr<Benchmark> &root) { return root.expired(); }),
+                  s_roots.end());
+    s_roots.push_back(benchmark);
+}
+
+std::vector<std::shared_ptr<Benchmark>> Benchmark::getRoots()
+{
+    std::lock_guard<std::mutex> lock(s_rootsLock);
+    std::vector<std::shared_ptr<Benchmark>> roots;
+    for(const auto &root : s_roots)
+        if(auto benchmark = root.lock()) roots.push_back(benchmark);
+    return roots;
+}
+
 std::ostream& MindTree::operator<<(std::ostream &stream, const MindTree::Benchmark &benchmark)
 {
     std::lock_guard<std::recursive_mutex> lock(benchmark._benchmarkLock);
@@ -124,7 +246,10 @@ std::ostream& MindTree::operator<<(std::ostream &stream, const MindTree::Benchma
 
     auto calls = std::to_string(benchmark._num_calls);
     auto name = benchmark._name + "(" + calls + "):";
-    stream << std::setw(40) << std::left << name << std::right << std::fixed << std::setprecision(2) << benchmark.getTime() << std::endl;
+    stream << std::setw(40) << std::left << name << std::right << std::fixed << std::setprecision(2) << benchmark.getTime();
+    if(benchmark._gpuSamples)
+        stream << " gpu: " << benchmark.getGPUTime();
+    stream << std::endl;
 
     if(benchmark._benchmarks.size() > 1) {
         for(auto bench : benchmark._benchmarks) {
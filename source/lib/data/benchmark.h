@@ -7,6 +7,8 @@
 #include "vector"
 #include "ostream"
 #include "mutex"
+#include "atomic"
+#include "deque"
 #include "functional"
 
 namespace MindTree { class Benchmark; }
@@ -20,6 +22,7 @@ class Benchmark
 public:
     Benchmark(std::string name);
     void addBenchmark(std::shared_ptr<Benchmark> benchmark);
+    void removeBenchmark(std::shared_ptr<Benchmark> benchmark);
     std::string getName() const;
 	const Benchmark* parent() const;
 	std::vector<std::shared_ptr<Benchmark>> benchmarks() const;
@@ -30,7 +33,36 @@ public:
     double getTime() const;
 	void callback();
 
+    //cpu time is what it takes to submit the work, gpu time comes from timer
+    //queries and arrives a few frames later, start is on the cpu clock
+    void addGPUTime(std::chrono::steady_clock::time_point start, std::chrono::nanoseconds duration);
+    //average in ms
+    double getCPUTime() const;
+    double getGPUTime() const;
+    int getNumGPUSamples() const;
+
+    //keeps the last calls of every benchmark for writeTrace
+    static void setTracing(bool enable);
+    static bool isTracing();
+    //chrome trace event json of this benchmark and its children, cpu and
+    //gpu times end up in separate rows
+    void writeTrace(std::ostream &stream) const;
+    static void writeTrace(std::ostream &stream, const std::vector<std::shared_ptr<Benchmark>> &benchmarks);
+
+    //benchmarks that are not part of another one, e.g. one per render tree
+    static void addRoot(std::shared_ptr<Benchmark> benchmark);
+    static std::vector<std::shared_ptr<Benchmark>> getRoots();
+
 private:
+    struct TraceEvent {
+        std::chrono::steady_clock::time_point start;
+        std::chrono::nanoseconds duration;
+        bool gpu;
+    };
+    static const size_t MAX_TRACE_EVENTS = 512;
+    void addTraceEvent(TraceEvent event);
+    void writeTraceEvents(std::ostream &stream, bool &first) const;
+
     friend class BenchmarkHandler;
     friend std::ostream& operator<<(std::ostream &stream, const Benchmark &benchmark);
 
@@ -51,6 +83,14 @@ private:
     bool _running;
     std::chrono::time_point<std::chrono::steady_clock> _start;
     std::chrono::time_point<std::chrono::steady_clock> _end;
+
+    std::chrono::nanoseconds _gpuTime;
+    int _gpuSamples;
+    std::deque<TraceEvent> _traceEvents;
+
+    static std::atomic<bool> s_tracing;
+    static std::mutex s_rootsLock;
+    static std::vector<std::weak_ptr<Benchmark>> s_roots;
 };
 
 
@@ -22,6 +22,7 @@
 #include "data/nodes/containernode.h"
 #include "data/signal.h"
 #include "data/debuglog.h"
+#include "data/async_loader.h"
 
 #include "cache_main.h"
 
@@ -98,6 +99,31 @@ int LoopCache::getStep()const
     return stepValue;
 }
 
+namespace {
+    thread_local FrameEvaluation *currentEvaluation = nullptr;
+}
+
+FrameEvaluation::FrameEvaluation(int frame)
+    : _frame(frame), _outer(currentEvaluation)
+{
+    currentEvaluation = this;
+}
+
+FrameEvaluation::~FrameEvaluation()
+{
+    currentEvaluation = _outer;
+}
+
+int FrameEvaluation::getFrame() const
+{
+    return _frame;
+}
+
+const FrameEvaluation* FrameEvaluation::current()
+{
+    return currentEvaluation;
+}
+
 AbstractCacheProcessor::AbstractCacheProcessor(SocketType st, NodeType nt) :
     m_socketType(st), m_nodeType(nt)
 {
@@ -202,6 +228,7 @@ void DataCache::init()
 {
     Signal::getHandler<DNode*>().connect("nodeDeleted", [] (DNode* node) {
         DataCache::invalidate(node);
+        AsyncLoader::drop(node);
     }).detach();
 }
 
@@ -219,6 +246,11 @@ void DataCache::invalidateNode(const DNode *node)
 {
     if(!node) return;
 
+    if(currentEvaluation) {
+        currentEvaluation->_outputs.erase(node);
+        return;
+    }
+
     {
         std::lock_guard<std::recursive_mutex> lock(_cachedOutputsMutex);
         auto cacheIter = _cachedOutputs.find(node);
@@ -263,6 +295,11 @@ void DataCache::invalidate(const DNode *node)
 
 bool DataCache::isCached(const DNode *node)
 {
+    if(currentEvaluation) {
+        auto it = currentEvaluation->_outputs.find(node);
+        return it != end(currentEvaluation->_outputs) && !it->second.empty();
+    }
+
     std::lock_guard<std::recursive_mutex> lock(_cachedOutputsMutex);
     bool cached = (_cachedOutputs.find(node) != end(_cachedOutputs))
         && (!_cachedOutputs[node].empty());
@@ -297,8 +334,9 @@ std::vector<Property>& DataCache::_getCachedOutputs()
 Property DataCache::getCachedData(const DNode *node, int output)
 {
     std::lock_guard<std::recursive_mutex> lock(_cachedOutputsMutex);
-    auto it = _cachedOutputs.find(node);
-    if(it == end(_cachedOutputs)
+    auto &outputs = currentEvaluation ? currentEvaluation->_outputs : _cachedOutputs;
+    auto it = outputs.find(node);
+    if(it == end(outputs)
        || it->second.size() <= output)
         return Property();
     return it->second[output];
@@ -306,6 +344,8 @@ Property DataCache::getCachedData(const DNode *node, int output)
 
 std::vector<Property>& DataCache::getCachedOutputs(const DNode *node)
 {
+    if(currentEvaluation) return currentEvaluation->_outputs[node];
+
     std::lock_guard<std::recursive_mutex> lock(_cachedOutputsMutex);
     if(_cachedOutputs.find(node) == end(_cachedOutputs))
         _cachedOutputs.insert({node, std::vector<Property>()});
@@ -62,6 +62,28 @@ private:
     int stepValue, startValue, endValue;
 };
 
+//evaluates everything on this thread at a frame of its own while it is
+//around. Outputs are kept here instead of the shared cache, so what is shown
+//is neither read nor overwritten
+class FrameEvaluation
+{
+public:
+    FrameEvaluation(int frame);
+    FrameEvaluation(const FrameEvaluation&) = delete;
+    FrameEvaluation& operator=(const FrameEvaluation&) = delete;
+    ~FrameEvaluation();
+
+    int getFrame() const;
+    //the innermost evaluation on this thread, null if there is none
+    static const FrameEvaluation* current();
+
+private:
+    friend class DataCache;
+    int _frame;
+    FrameEvaluation *_outer;
+    std::unordered_map<const DNode*, std::vector<Property>> _outputs;
+};
+
 class AbstractCacheProcessor
 {
 public:
@@ -257,6 +257,7 @@ IO::InStream& MindTree::operator>>(IO::InStream &stream, DNSpace &space)
 
         space.addNode(node);
     }
+    stream.endBlock("Space");
     return stream;
 }
 
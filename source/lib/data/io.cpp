@@ -2,6 +2,20 @@
 #include "cstdint"
 #include "array"
 #include "cassert"
+#include "cstring"
+#include "algorithm"
+
+#include "sys/mman.h"
+#include "sys/stat.h"
+#include "fcntl.h"
+#include "unistd.h"
+
+#ifdef MT_WITH_LZ4
+#include "lz4.h"
+#endif
+#ifdef MT_WITH_ZSTD
+#include "zstd.h"
+#endif
 
 #include "data/dnspace.h"
 #include "data/datatypes.h"
@@ -15,11 +29,132 @@
 
 using namespace MindTree::IO;
 
+namespace {
+    //the buffer is written out once it grows beyond this
+    const size_t FLUSH_SIZE = 1 << 20;
+
+    //arrays smaller than this are not worth compressing
+    const size_t COMPRESS_SIZE = 1 << 16;
+
+    //how many projects and container spaces this thread is reading
+    thread_local int readDepth = 0;
+
+    struct ReadScope {
+        ReadScope() { ++readDepth; }
+        ~ReadScope() { --readDepth; }
+    };
+
+    enum Compression : int8_t {
+        NO_COMPRESSION = 0,
+        LZ4_COMPRESSION = 1,
+        ZSTD_COMPRESSION = 2
+    };
+
+    //compresses src into dst, returns the compressed size or 0 if the
+    //data could not be compressed to less than its original size
+    size_t compress(const char *src, size_t size, std::vector<char> &dst, Compression &method)
+    {
+#if defined(MT_WITH_LZ4)
+        method = LZ4_COMPRESSION;
+        dst.resize(LZ4_compressBound(size));
+        int compressed = LZ4_compress_default(src, dst.data(), size, dst.size());
+        return compressed > 0 && size_t(compressed) < size ? compressed : 0;
+#elif defined(MT_WITH_ZSTD)
+        method = ZSTD_COMPRESSION;
+        dst.resize(ZSTD_compressBound(size));
+        size_t compressed = ZSTD_compress(dst.data(), dst.size(), src, size, 1);
+        return !ZSTD_isError(compressed) && compressed < size ? compressed : 0;
+#else
+        method = NO_COMPRESSION;
+        return 0;
+#endif
+    }
+
+    bool decompress(const char *src, size_t size, char *dst, size_t dstSize, Compression method)
+    {
+        switch(method) {
+#ifdef MT_WITH_LZ4
+        case LZ4_COMPRESSION:
+            return LZ4_decompress_safe(src, dst, size, dstSize) == int(dstSize);
+#endif
+#ifdef MT_WITH_ZSTD
+        case ZSTD_COMPRESSION:
+            return ZSTD_decompress(dst, dstSize, src, size) == dstSize;
+#endif
+        default:
+            std::cout << "array compression " << int(method) << " is not supported" << std::endl;
+            return false;
+        }
+    }
+}
+
+const char MindTree::IO::PROJECT_MAGIC[] = "MTPROJECT";
+
+MappedFile::MappedFile(std::string filename)
+    : _data(nullptr), _size(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0) {
+        std::cout << "could not open " << filename << std::endl;
+        return;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) == 0 && info.st_size > 0) {
+        void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED) {
+            _data = static_cast<const char*>(data);
+            _size = info.st_size;
+        }
+        else {
+            std::cout << "could not map " << filename << std::endl;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if(_data) munmap(const_cast<char*>(_data), _size);
+}
+
+bool MappedFile::isOpen() const
+{
+    return _data;
+}
+
+const char* MappedFile::data() const
+{
+    return _data;
+}
+
+size_t MappedFile::size() const
+{
+    return _size;
+}
+
 MindTree::TypeDispatcher<MindTree::NodeType, std::function<void(OutStream&, const void*)>> 
     OutStream::_nodeStreamDispatcher;
 
 OutStream::OutStream(std::string filename)
-    : _stream(filename, std::ios::binary)
+    : _stream(filename, std::ios::binary),
+    _inMemory(false),
+    _flushed(0),
+    _snapshot(nullptr),
+    _compress(true)
+{
+    auto container = _nodeStreamDispatcher["CONTAINER"];
+    if(!container) {
+        _nodeStreamDispatcher["CONTAINER"] = dispatchedOutStreamer<ContainerNode>;
+    }
+    _buffer.reserve(FLUSH_SIZE);
+}
+
+OutStream::OutStream()
+    : _inMemory(true),
+    _flushed(0),
+    _snapshot(nullptr),
+    _compress(true)
 {
     auto container = _nodeStreamDispatcher["CONTAINER"];
     if(!container) {
@@ -29,59 +164,142 @@ OutStream::OutStream(std::string filename)
 
 OutStream::~OutStream()
 {
+    flush();
     _stream.close();
     assert(_blockStack.empty());
 }
 
+size_t OutStream::position() const
+{
+    return _flushed + _buffer.size();
+}
+
+void OutStream::flush()
+{
+    if(_inMemory || _buffer.empty()) return;
+    _stream.write(_buffer.data(), _buffer.size());
+    _flushed += _buffer.size();
+    _buffer.clear();
+}
+
 void OutStream::beginBlock(std::string blockName)
 {
 #ifdef DEBUG_IO
     std::string indent(_blockStack.size() * 2, ' ');
     std::cout << indent << "begin block: " << blockName << std::endl;
 #endif
-    _blockStack.push(std::vector<char>());
+    //the size is filled in by endBlock
+    _blockStack.push(position());
+    int32_t size = 0;
+    write(reinterpret_cast<const char*>(&size), sizeof(size));
     *this << std::string("BLOCK:") + blockName;
 }
 
 void OutStream::endBlock(std::string blockName)
 {
-    std::vector<char> currentBlock = _blockStack.top();
-
-    int32_t size = currentBlock.size() + 4;
-    auto sizeVec = std::vector<char>();
-    char* output = reinterpret_cast<char*>(&size);
-    for(size_t i = 0; i < sizeof(size); ++i) {
-        sizeVec.emplace_back(output[i]);
-    }
-    currentBlock.insert(begin(currentBlock), begin(sizeVec), end(sizeVec));
-
+    size_t start = _blockStack.top();
     _blockStack.pop();
+    int32_t size = position() - start;
 
 #ifdef DEBUG_IO
     std::string indent(_blockStack.size() * 2, ' ');
     std::cout << indent << "end block: " << blockName << "\n"
-              << indent << "block size: " << currentBlock.size() << std::endl;
+              << indent << "block size: " << size << std::endl;
 #endif
-    
-    if(!_blockStack.empty()) {
-        write(currentBlock.data(), currentBlock.size());
+
+    if(start >= _flushed) {
+        std::memcpy(&_buffer[start - _flushed], &size, sizeof(size));
     }
     else {
-        _stream.write(currentBlock.data(), currentBlock.size());
+        //the slot already went to the file
+        _stream.seekp(start);
+        _stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        _stream.seekp(_flushed);
+    }
+
+    if(_blockStack.empty()) flush();
+}
+
+const std::vector<char>& OutStream::data() const
+{
+    return _buffer;
+}
+
+void OutStream::writeProject(const DNSpace &root)
+{
+    ProjectSnapshot snapshot(root, _compress);
+    writeProject(snapshot);
+}
+
+void OutStream::writeProject(const ProjectSnapshot &snapshot)
+{
+    write(PROJECT_MAGIC, sizeof(PROJECT_MAGIC));
+    *this << PROJECT_VERSION;
+
+    std::vector<uint64_t> table;
+    auto writeSection = [this, &table](const char *data, size_t size) {
+        table.push_back(position());
+        table.push_back(size);
+        write(data, size);
+    };
+
+    const auto &sections = snapshot._sections;
+    writeSection(sections[0].data(), sections[0].size());
+    if(snapshot._copied) {
+        const auto &copied = *snapshot._copied;
+        for(size_t i = 1; i < copied.size(); ++i)
+            writeSection(snapshot._file->data() + copied[i].offset, copied[i].size);
     }
+    for(size_t i = 1; i < sections.size(); ++i)
+        writeSection(sections[i].data(), sections[i].size());
+
+    uint64_t tableStart = position();
+    beginBlock("Sections");
+    *this << table;
+    endBlock("Sections");
+    write(reinterpret_cast<const char*>(&tableStart), sizeof(tableStart));
+    flush();
 }
 
 void OutStream::write(const char* value, size_t size)
 {
-    auto& currentBlock = _blockStack.top();
-    for(size_t i = 0; i<size; ++i) {
-        currentBlock.emplace_back(value[i]);
+    if(_buffer.size() + size > FLUSH_SIZE) flush();
+
+    //large chunks skip the buffer
+    if(!_inMemory && size >= FLUSH_SIZE) {
+        _stream.write(value, size);
+        _flushed += size;
+        return;
     }
+    _buffer.insert(end(_buffer), value, value + size);
+}
+
+void OutStream::writeArray(const void *data, size_t count, size_t elementSize)
+{
+    if(!_inMemory && !_stream.is_open()) return;
+
+    const char *bytes = reinterpret_cast<const char*>(data);
+    size_t size = count * elementSize;
+
+    std::vector<char> compressed;
+    Compression method = NO_COMPRESSION;
+    size_t storedSize = 0;
+    if(_compress && size >= COMPRESS_SIZE)
+        storedSize = compress(bytes, size, compressed, method);
+    if(!storedSize) {
+        method = NO_COMPRESSION;
+        storedSize = size;
+    }
+
+    *this << static_cast<int>(count) << static_cast<int>(elementSize);
+    write(reinterpret_cast<const char*>(&method), sizeof(method));
+    *this << static_cast<int>(storedSize);
+    write(method == NO_COMPRESSION ? bytes : compressed.data(), storedSize);
 }
 
 OutStream& OutStream::operator<<(int number)
 {
-    if(!_stream.is_open()) {
+    if(!_inMemory && !_stream.is_open()) {
         std::cout << "file is not open" << std::endl;
         return *this;
     }
@@ -105,7 +323,7 @@ OutStream& OutStream::operator<<(unsigned short number)
 
 OutStream& OutStream::operator<<(bool value)
 {
-    if(!_stream.is_open()) {
+    if(!_inMemory && !_stream.is_open()) {
         std::cout << "file is not open" << std::endl;
         return *this;
     }
@@ -117,7 +335,7 @@ OutStream& OutStream::operator<<(bool value)
 
 OutStream& OutStream::operator<<(std::string str)
 {
-    if(!_stream.is_open())  return *this;
+    if(!_inMemory && !_stream.is_open())  return *this;
 
     write(str.c_str(), str.size() + 1);
     return *this;
@@ -125,7 +343,7 @@ OutStream& OutStream::operator<<(std::string str)
 
 OutStream& OutStream::operator<<(double value)
 {
-    if(!_stream.is_open()) return *this;
+    if(!_inMemory && !_stream.is_open()) return *this;
 
     write(reinterpret_cast<char*>(&value), sizeof(value));
     return *this;
@@ -206,16 +424,98 @@ OutStream& OutStream::operator<<(const DNode &node)
 
 OutStream& OutStream::operator<<(const ContainerNode &node)
 {
-    auto *space = node.getContainerData();
-    *this << static_cast<const DNSpace&>(*space);
+    if(_snapshot) {
+        *this << _snapshot->sectionID(node);
+        return *this;
+    }
+    *this << static_cast<const DNSpace&>(*node.getContainerData());
     return *this;
 }
 
+struct InStream::SectionLoader {
+    MappedFilePtr file;
+    SectionTable sections;
+    int id;
+
+    void operator()(ContainerNode *node) const
+    {
+        const auto &section = (*sections)[id];
+        InStream stream(file, section.offset, section.size, sections);
+        stream.readContainerSpace(*node);
+        stream.linkSockets();
+    }
+};
+
+ProjectSnapshot::ProjectSnapshot(const DNSpace &root, bool compress)
+    : _spaces{&root}
+{
+    findCopiedSections(root);
+
+    //writing a section adds the containers in it to the list
+    for(size_t i = 0; i < _spaces.size(); ++i) {
+        OutStream stream;
+        stream._snapshot = this;
+        stream._compress = compress;
+        stream << *_spaces[i];
+        _sections.push_back(stream.data());
+    }
+}
+
+bool ProjectSnapshot::findCopiedSections(const DNSpace &space)
+{
+    //copying every section of the file is less work than finding the ones
+    //that are still needed, which would mean reading them
+    for(const auto &node : space.getNodes()) {
+        const auto *container = dynamic_cast<const ContainerNode*>(node.get());
+        if(!container) continue;
+
+        if(!container->isSpaceLoaded()) {
+            auto loader = container->getSpaceLoader();
+            if(loader) {
+                const auto *unloaded = loader.target<InStream::SectionLoader>();
+                if(!unloaded) continue;
+                _file = unloaded->file;
+                _copied = unloaded->sections;
+                return true;
+            }
+        }
+        if(findCopiedSections(*container->getContainerData())) return true;
+    }
+    return false;
+}
+
+int ProjectSnapshot::sectionID(const ContainerNode &node)
+{
+    int copied = _copied ? static_cast<int>(_copied->size()) - 1 : 0;
+    if(!node.isSpaceLoaded() && _copied) {
+        auto loader = node.getSpaceLoader();
+        const auto *unloaded = loader.target<InStream::SectionLoader>();
+        if(unloaded && unloaded->sections == _copied) return unloaded->id;
+    }
+
+    _spaces.push_back(node.getContainerData());
+    return copied + static_cast<int>(_spaces.size()) - 1;
+}
+
 MindTree::TypeDispatcher<MindTree::NodeType, std::function<void(InStream&, void*)>> 
     InStream::_nodeStreamDispatcher;
 
 InStream::InStream(std::string filename)
-    : _stream(filename, std::ios::binary)
+    : _file(std::make_shared<MappedFile>(filename)),
+    _pos(0),
+    _end(_file->size())
+{
+    auto container = _nodeStreamDispatcher["CONTAINER"];
+    if(!container) {
+        _nodeStreamDispatcher["CONTAINER"] = dispatchedInStreamer<ContainerNode>;
+    }
+}
+
+InStream::InStream(MappedFilePtr file, size_t offset, size_t size, SectionTable sections)
+    : _file(file),
+    _pos(std::min(offset, file->size())),
+    _end(std::min(offset + size, file->size())),
+    _sections(sections)
 {
     auto container = _nodeStreamDispatcher["CONTAINER"];
     if(!container) {
@@ -223,11 +523,125 @@ InStream::InStream(std::string filename)
     }
 }
 
+bool InStream::isReading()
+{
+    return readDepth > 0;
+}
+
+MindTree::DNSpace* InStream::readProject()
+{
+    ReadScope reading;
+    auto *space = new DNSpace();
+    size_t headerSize = sizeof(PROJECT_MAGIC) + sizeof(int32_t);
+    bool sectioned = _end - _pos >= headerSize + sizeof(uint64_t)
+        && std::memcmp(_file->data() + _pos, PROJECT_MAGIC, sizeof(PROJECT_MAGIC)) == 0;
+
+    //older files are a single block with everything in it
+    if(!sectioned) {
+        *this >> *space;
+        linkSockets();
+        return space;
+    }
+
+    consume(sizeof(PROJECT_MAGIC));
+    int version = 0;
+    *this >> version;
+    if(version > PROJECT_VERSION) {
+        std::cout << "project was saved with a newer format version ("
+            << version << ")" << std::endl;
+        return space;
+    }
+
+    //a truncated or corrupt file is not read at all
+    size_t sectionsStart = _pos;
+    size_t tableEnd = _end - sizeof(uint64_t);
+    uint64_t tableStart;
+    std::memcpy(&tableStart, _file->data() + tableEnd, sizeof(tableStart));
+    if(tableStart < sectionsStart || tableStart > tableEnd) {
+        std::cout << "project has a broken section table" << std::endl;
+        return space;
+    }
+
+    InStream tableStream(_file, tableStart, tableEnd - tableStart);
+    std::vector<uint64_t> table;
+    tableStream.beginBlock("Sections");
+    tableStream >> table;
+    tableStream.endBlock("Sections");
+
+    auto sections = std::make_shared<std::vector<Section>>();
+    for(size_t i = 0; i + 1 < table.size(); i += 2) {
+        uint64_t offset = table[i], size = table[i + 1];
+        if(offset < sectionsStart || offset > tableStart || size > tableStart - offset) {
+            std::cout << "project section " << i / 2 << " lies outside of the file" << std::endl;
+            return space;
+        }
+        sections->push_back({offset, size});
+    }
+    if(sections->empty()) {
+        std::cout << "project has no sections" << std::endl;
+        return space;
+    }
+
+    const auto &root = sections->front();
+    InStream rootStream(_file, root.offset, root.size, sections);
+    rootStream >> *space;
+    rootStream.linkSockets();
+    return space;
+}
+
+void InStream::setSocketID(const DSocket *socket, unsigned short id)
+{
+    _socketIDs.insert({id, socket});
+}
+
+const MindTree::DSocket* InStream::getSocket(unsigned short id) const
+{
+    auto it = _socketIDs.find(id);
+    return it != end(_socketIDs) ? it->second : nullptr;
+}
+
+void InStream::linkSockets()
+{
+    for(const auto &pair : _socketIDs) {
+        const DSocket *socket = pair.second;
+        if(!socket || socket->getDir() != DSocket::IN) continue;
+
+        auto *in = const_cast<DSocket*>(socket)->toIn();
+        if(in->getTempCntdID() > 0)
+            in->cntdSocketFromID(getSocket(in->getTempCntdID()));
+    }
+    _socketIDs.clear();
+}
+
+const char* InStream::consume(size_t size)
+{
+    if(size > _end - _pos) {
+        std::cout << "trying to read " << size << " bytes where only "
+            << _end - _pos << " bytes are left" << std::endl;
+        _pos = _end;
+        return nullptr;
+    }
+    const char *data = _file->data() + _pos;
+    _pos += size;
+    return data;
+}
+
+std::shared_ptr<const char> InStream::map(size_t size)
+{
+    if(!_blocks.empty()) _blocks.top().pos += size;
+    const char *data = consume(size);
+    if(!data) return nullptr;
+
+    //shares ownership of the mapping
+    return std::shared_ptr<const char>(_file, data);
+}
+
 void InStream::beginBlock(std::string blockName)
 {
     _blocks.push(BlockInfo());
     auto &info = _blocks.top();
-    _stream.read(reinterpret_cast<char*>(&info.size), sizeof(info.size));
+    const char *size = consume(sizeof(info.size));
+    if(size) std::memcpy(&info.size, size, sizeof(info.size));
     info.pos += 4;
 
 #ifdef DEBUG_IO
@@ -259,14 +673,12 @@ void InStream::endBlock(std::string blockName)
 #endif
     int32_t remaining_bytes = currentBlock.size - currentBlock.pos;
 
-    auto block = std::vector<char>(remaining_bytes);
-    
     if(remaining_bytes) {
         std::cout << "corrupted block: " << currentBlock.name 
             << "; " << remaining_bytes 
             << " bytes were not read from this block" << std::endl;
     }
-    read(block.data(), remaining_bytes);
+    if(remaining_bytes > 0) map(remaining_bytes);
     finishBlock();
 }
 
@@ -291,7 +703,83 @@ void InStream::read(char* val, size_t size)
         }
         currentBlock.pos += size;
     }
-    _stream.read(val, size);
+    const char *data = consume(size);
+    if(data) std::memcpy(val, data, size);
+    else std::memset(val, 0, size);
+}
+
+int32_t InStream::peekArrayElementSize() const
+{
+    int32_t elementSize = 0;
+    if(_end - _pos >= 2 * sizeof(int32_t))
+        std::memcpy(&elementSize, _file->data() + _pos + sizeof(int32_t), sizeof(elementSize));
+    return elementSize;
+}
+
+bool InStream::readArrayHeader(ArrayHeader &header)
+{
+    *this >> header.count >> header.elementSize;
+    read(reinterpret_cast<char*>(&header.compression), sizeof(header.compression));
+    *this >> header.storedSize;
+
+    size_t left = _end - _pos;
+    if(!_blocks.empty())
+        left = std::min(left, size_t(std::max(0, _blocks.top().size - _blocks.top().pos)));
+
+    bool valid = header.count >= 0 && header.elementSize > 0 && header.storedSize >= 0
+        && size_t(header.storedSize) <= left;
+    if(valid) {
+        uint64_t size = uint64_t(header.count) * uint64_t(header.elementSize);
+        switch(header.compression) {
+            case NO_COMPRESSION:
+                valid = size == uint64_t(header.storedSize);
+                break;
+            case LZ4_COMPRESSION:
+                //lz4 can not shrink data by more than this
+                valid = size <= uint64_t(header.storedSize) * 255;
+                break;
+            case ZSTD_COMPRESSION:
+#ifdef MT_WITH_ZSTD
+                valid = ZSTD_getFrameContentSize(_file->data() + _pos, header.storedSize) == size;
+#else
+                valid = false;
+#endif
+                break;
+            default:
+                valid = false;
+        }
+    }
+
+    if(!valid) {
+        std::cout << "corrupt array of " << header.count << " elements of "
+            << header.elementSize << " bytes, skipping" << std::endl;
+    }
+    return valid;
+}
+
+void InStream::readArray(const ArrayHeader &header, void *data)
+{
+    size_t size = size_t(header.count) * header.elementSize;
+    auto method = static_cast<Compression>(header.compression);
+    if(data && method == NO_COMPRESSION) {
+        read(reinterpret_cast<char*>(data), size);
+        return;
+    }
+
+    //skipped arrays are not copied
+    if(!data) {
+        map(header.storedSize);
+        return;
+    }
+
+    std::vector<char> stored(header.storedSize);
+    read(stored.data(), stored.size());
+
+    if(!decompress(stored.data(), stored.size(), reinterpret_cast<char*>(data), size, method)) {
+        std::cout << "could not decompress array of " << header.count
+            << " elements" << std::endl;
+        std::memset(data, 0, size);
+    }
 }
 
 InStream& InStream::operator>>(int8_t &number)
@@ -358,12 +846,17 @@ InStream& InStream::operator>>(uint64_t &number)
 
 InStream& InStream::operator>>(std::string &str)
 {
-    char ch;
-    read(&ch, 1);
-    while(ch != '\0') {
-        str.push_back(ch);
-        read(&ch, 1);
+    const char *start = _file->data() + _pos;
+    const char *terminator = nullptr;
+    if(_pos < _end)
+        terminator = static_cast<const char*>(std::memchr(start, '\0', _end - _pos));
+    if(!terminator) {
+        std::cout << "string is not terminated" << std::endl;
+        map(_end - _pos);
+        return *this;
     }
+    str.append(start, terminator);
+    map(terminator - start + 1);
 
     //#ifdef DEBUG_IO
     //    std::string indent(_blocks.size() * 2, ' ');
@@ -480,6 +973,26 @@ InStream& InStream::operator>>(DNode &node)
 
 InStream& InStream::operator>>(ContainerNode &node)
 {
+    if(!_sections) {
+        readContainerSpace(node);
+        return *this;
+    }
+
+    int id = 0;
+    *this >> id;
+    if(id <= 0 || size_t(id) >= _sections->size()) {
+        std::cout << "container " << node.getNodeName()
+            << " refers to a missing section" << std::endl;
+        return *this;
+    }
+
+    node.setSpaceLoader(SectionLoader{_file, _sections, id});
+    return *this;
+}
+
+void InStream::readContainerSpace(ContainerNode &node)
+{
+    ReadScope reading;
     auto *space = node.getContainerData();
     space->setName(node.getNodeName());
 
@@ -491,6 +1004,5 @@ InStream& InStream::operator>>(ContainerNode &node)
     node.getContainerData()->addNode(out);
 
     *this >> static_cast<DNSpace&>(*space);
-    return *this;
 }
 
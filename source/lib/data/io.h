@@ -5,6 +5,9 @@
 #include "iostream"
 #include "vector"
 #include "stack"
+#include "unordered_map"
+#include "memory"
+#include "type_traits"
 #include "data/type.h"
 #include "functional"
 #include "data/nodes/nodetype.h"
@@ -16,13 +19,56 @@
 namespace MindTree {
 class DNode;
 class ContainerNode;
+class DNSpace;
+class DSocket;
 
 namespace IO {
+class ProjectSnapshot;
+
+//read only mapping of a whole file. Data read from it can point straight
+//into the mapping as long as it holds on to the file
+class MappedFile
+{
+public:
+    MappedFile(std::string filename);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    bool isOpen() const;
+    const char* data() const;
+    size_t size() const;
+
+private:
+    const char *_data;
+    size_t _size;
+};
+typedef std::shared_ptr<const MappedFile> MappedFilePtr;
+
+//project files start with this and the format version
+extern const char PROJECT_MAGIC[];
+const int PROJECT_VERSION = 1;
+
+//element types of vectors that are written and read as one chunk of memory
+template<typename T>
+struct isBulkSerializable {
+    static const bool value = std::is_trivially_copyable<T>::value
+        && !std::is_pointer<T>::value
+        && !std::is_same<T, bool>::value;
+};
+
+//not every glm version has trivial copy constructors
+template<> struct isBulkSerializable<glm::ivec2> { static const bool value = true; };
+template<> struct isBulkSerializable<glm::vec2> { static const bool value = true; };
+template<> struct isBulkSerializable<glm::vec3> { static const bool value = true; };
+template<> struct isBulkSerializable<glm::vec4> { static const bool value = true; };
 
 class OutStream 
 {
 public:
     OutStream(std::string filename);
+    //keeps everything in memory, see data()
+    OutStream();
     virtual ~OutStream();
 
     OutStream& operator<<(int number);
@@ -43,14 +89,49 @@ public:
     OutStream& operator<<(const DNode &node);
     OutStream& operator<<(const ContainerNode &node);
 
+    template<typename T,
+        typename std::enable_if<isBulkSerializable<T>::value>::type* = nullptr>
+    OutStream& operator<<(const std::vector<T> &vec)
+    {
+        writeArray(vec.data(), vec.size(), sizeof(T));
+        return *this;
+    }
+
+    //writes a header with the element count and size followed by the raw
+    //elements in one piece, compressed if that makes them smaller
+    void writeArray(const void *data, size_t count, size_t elementSize);
+
+    //writes the header, the root space and every container space as a
+    //section of its own followed by a table of the section offsets, so
+    //containers can be read when they are first needed
+    void writeProject(const DNSpace &root);
+    void writeProject(const ProjectSnapshot &snapshot);
+
     void beginBlock(std::string blockName="");
     void endBlock(std::string blockName="");
 
+    //what an in memory stream has written so far
+    const std::vector<char>& data() const;
+
 private:
+    friend class ProjectSnapshot;
+
     void write(const char* value, size_t size);
+    void flush();
+    size_t position() const;
 
     std::ofstream _stream;
-    std::stack<std::vector<char>> _blockStack;
+    bool _inMemory;
+    //everything is written into one buffer that goes to the file whenever
+    //it gets large, block sizes are patched in place when the block ends
+    std::vector<char> _buffer;
+    size_t _flushed;
+    //offsets of the size slots of the open blocks in the file
+    std::stack<size_t> _blockStack;
+    //hands out the section ids of containers, null outside of writeProject
+    ProjectSnapshot *_snapshot;
+    //whether large arrays are compressed
+    bool _compress;
 
     static TypeDispatcher<NodeType, std::function<void(OutStream&, const void*)>> 
         _nodeStreamDispatcher;
@@ -73,7 +154,14 @@ public:
         std::string name;
     };
 
+    struct Section {
+        uint64_t offset, size;
+    };
+    typedef std::shared_ptr<const std::vector<Section>> SectionTable;
+
     InStream(std::string filename);
+    //reads size bytes at offset of an already mapped file
+    InStream(MappedFilePtr file, size_t offset, size_t size, SectionTable sections=nullptr);
 
     InStream& operator>>(int8_t &number);
     InStream& operator>>(int16_t &number);
@@ -102,15 +190,82 @@ public:
     InStream& operator>>(DNode &node);
     InStream& operator>>(ContainerNode &node);
 
+    template<typename T,
+        typename std::enable_if<isBulkSerializable<T>::value>::type* = nullptr>
+    InStream& operator>>(std::vector<T> &vec)
+    {
+        ArrayHeader header;
+        if(!readArrayHeader(header)) {
+            vec.clear();
+            return *this;
+        }
+        if(header.elementSize != sizeof(T)) {
+            std::cout << "array elements have " << header.elementSize
+                << " bytes instead of " << sizeof(T) << ", skipping" << std::endl;
+            readArray(header, nullptr);
+            vec.clear();
+            return *this;
+        }
+        vec.resize(header.count);
+        readArray(header, vec.data());
+        return *this;
+    }
+
+    //element size of the array that comes next without reading it, 0 if
+    //the stream ends before
+    int32_t peekArrayElementSize() const;
+
+    //reads a project written by OutStream::writeProject or the older format
+    //that is a single space block. The caller owns the returned space
+    DNSpace* readProject();
+
+    //returns the next size bytes without copying them, the data stays valid
+    //as long as the returned pointer is around
+    std::shared_ptr<const char> map(size_t size);
+
+    //links are stored as the ids sockets had when they were saved, they
+    //are resolved within the stream that read them
+    void setSocketID(const DSocket *socket, unsigned short id);
+    const DSocket* getSocket(unsigned short id) const;
+    //connects the in sockets read so far to their out sockets
+    void linkSockets();
+
+    //whether a project or a container space is being read on this thread.
+    //Nodes that are added to a space meanwhile are not edits
+    static bool isReading();
+
     void beginBlock(std::string blockName="");
     void endBlock(std::string blockName="");
 
 private:
+    friend class ProjectSnapshot;
+    //reads a container space from its section when it is first accessed
+    struct SectionLoader;
+
+    struct ArrayHeader {
+        int32_t count, elementSize, storedSize;
+        int8_t compression;
+    };
+
+    //false if the header does not fit the data that is left, the array is
+    //not read then and the rest of the block is skipped when it ends
+    bool readArrayHeader(ArrayHeader &header);
+    //reads the elements written by OutStream::writeArray into data, which
+    //has to hold count * elementSize bytes. Skips them if data is null
+    void readArray(const ArrayHeader &header, void *data);
+
     void finishBlock();
     void read(char* val, size_t size);
-
-    std::ifstream _stream;
+    //advances by size bytes and returns where they start in the mapping or
+    //null if the stream ends before
+    const char* consume(size_t size);
+    void readContainerSpace(ContainerNode &node);
+
+    MappedFilePtr _file;
+    size_t _pos, _end;
+    SectionTable _sections;
     std::stack<BlockInfo> _blocks;
+    std::unordered_map<unsigned short, const DSocket*> _socketIDs;
 
     static TypeDispatcher<NodeType, std::function<void(InStream&, void*)>> 
         _nodeStreamDispatcher;
@@ -123,6 +278,39 @@ void dispatchedInStreamer(InStream &stream, void* data)
     stream >> *d;
 }
 
+//the sections of a project, written on one thread and stored on another.
+//Containers that were never loaded are not read for it, their sections are
+//taken from the file they come from when the snapshot is written
+class ProjectSnapshot
+{
+public:
+    //large arrays are only compressed if compress is set, which is most of
+    //the work of writing a project
+    ProjectSnapshot(const DNSpace &root, bool compress=true);
+
+private:
+    friend class OutStream;
+
+    //takes the sections of the first container that was not loaded yet
+    bool findCopiedSections(const DNSpace &space);
+    int sectionID(const ContainerNode &node);
+
+    //the root space first and then every container space that was loaded
+    std::vector<std::vector<char>> _sections;
+    std::vector<const DNSpace*> _spaces;
+    //unloaded containers keep their ids, the sections they can refer to
+    //are copied from their file after the root section
+    MappedFilePtr _file;
+    InStream::SectionTable _copied;
+};
+
+template<typename T>
+InStream& operator>>(InStream &stream, std::shared_ptr<std::vector<T>> &vec)
+{
+    vec = std::make_shared<std::vector<T>>();
+    return stream >> *vec;
+}
+
 }
 template<typename T>
 IO::OutStream& operator<<(IO::OutStream& stream, const T &data) 
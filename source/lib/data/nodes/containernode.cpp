@@ -7,7 +7,8 @@ ContainerNode::ContainerNode(std::string name, bool raw)
     : DNode(name), 
     containerData(nullptr), 
     inSocketNode(nullptr), 
-    outSocketNode(nullptr)
+    outSocketNode(nullptr),
+    spaceLoaded(true)
 {
     setBuildInType(CONTAINER);
     setType("CONTAINER");
@@ -26,7 +27,8 @@ ContainerNode::ContainerNode(std::string name, bool raw)
 }
 
 ContainerNode::ContainerNode(const ContainerNode &node)
-    : DNode(node)
+    : DNode(node),
+    spaceLoaded(true)
 {
     setBuildInType(CONTAINER);
     setType("CONTAINER");
@@ -127,11 +129,13 @@ void ContainerNode::addtolib()
 
 SocketNode *ContainerNode::getInputs() const
 {
+    loadSpace();
     return inSocketNode;
 }
 
 SocketNode *ContainerNode::getOutputs() const
 {
+    loadSpace();
     return outSocketNode;
 }
 
@@ -207,9 +211,43 @@ void ContainerNode::setName(std::string name)
 
 ContainerSpace* ContainerNode::getContainerData() const
 {
+    loadSpace();
     return containerData;
 }
 
+void ContainerNode::setSpaceLoader(SpaceLoader loader)
+{
+    std::lock_guard<std::recursive_mutex> lock(spaceLoaderLock);
+    spaceLoader = loader;
+    spaceLoaded = !loader;
+}
+
+bool ContainerNode::isSpaceLoaded() const
+{
+    return spaceLoaded;
+}
+
+ContainerNode::SpaceLoader ContainerNode::getSpaceLoader() const
+{
+    std::lock_guard<std::recursive_mutex> lock(spaceLoaderLock);
+    return spaceLoader;
+}
+
+void ContainerNode::loadSpace() const
+{
+    if(spaceLoaded) return;
+
+    //the loader accesses the space itself on the same thread, which is why
+    //the lock is recursive and the loader is taken out before it runs
+    std::lock_guard<std::recursive_mutex> lock(spaceLoaderLock);
+    if(!spaceLoader) return;
+
+    auto loader = std::move(spaceLoader);
+    spaceLoader = nullptr;
+    loader(const_cast<ContainerNode*>(this));
+    spaceLoaded = true;
+}
+
 void ContainerNode::setContainerData(ContainerSpace* value)
 {
     containerData = value;
@@ -219,7 +257,7 @@ void ContainerNode::setContainerData(ContainerSpace* value)
 bool ContainerNode::operator==(const DNode &node)const
 {
     if(!DNode::operator==(node)) return false;
-    if(*containerData != *node.getDerivedConst<ContainerNode>()->containerData)
+    if(*getContainerData() != *node.getDerivedConst<ContainerNode>()->getContainerData())
         return false;
     return true;
 }
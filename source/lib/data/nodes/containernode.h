@@ -1,6 +1,9 @@
 #ifndef CONTAINERNODE_H
 #define CONTAINERNODE_H
 
+#include "functional"
+#include "mutex"
+#include "atomic"
 #include "data_node.h"
 
 namespace MindTree { class ContainerSpace;
@@ -30,6 +33,15 @@ public:
     ContainerSpace* getContainerData() const;
     void setContainerData(ContainerSpace* value);
 
+    //fills the container space the first time it is accessed, on whichever
+    //thread that is. Others wait until the space is complete
+    typedef std::function<void(ContainerNode*)> SpaceLoader;
+    void setSpaceLoader(SpaceLoader loader);
+    //whether the space was filled, does not load it
+    bool isSpaceLoaded() const;
+    //empty once the space was filled
+    SpaceLoader getSpaceLoader() const;
+
     void addMappedSocket(DSocket *socket);
 
     SocketNode *getInputs() const;
@@ -49,7 +61,12 @@ protected:
     SocketNode *inSocketNode, *outSocketNode;
 
 private:
+    void loadSpace() const;
+
     ContainerSpace *containerData;
+    mutable SpaceLoader spaceLoader;
+    mutable std::atomic<bool> spaceLoaded;
+    mutable std::recursive_mutex spaceLoaderLock;
     std::unordered_map<const DSocket*, const DSocket*> socket_map;
 };
 
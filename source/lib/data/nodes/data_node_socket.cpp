@@ -29,40 +29,10 @@
 
 using namespace MindTree;
 
-std::unordered_map<unsigned short, const DSocket*>LoadSocketIDMapper::loadIDMapper;
 unsigned short DSocket::count = 0;
 std::unordered_map<DSocket*, DSocket*> CopySocketMapper::socketMap;
 std::unordered_map<unsigned short, DSocket*> DSocket::socketIDHash;
 
-unsigned short LoadSocketIDMapper::getID(const DSocket *socket)
-{
-    for(auto p : loadIDMapper)
-        if (p.second == socket) return p.first;
-    return -1;
-}
-
-void LoadSocketIDMapper::setID(const DSocket *socket, unsigned short ID)
-{
-    loadIDMapper.insert({ID, socket});
-}
-
-const DSocket * LoadSocketIDMapper::getSocket(unsigned short ID)
-{
-    return loadIDMapper[ID];
-}
-
-void LoadSocketIDMapper::remap()
-{
-    for(auto p : loadIDMapper) {
-        const DSocket *socket = p.second;
-        if(!socket) continue;
-        if(socket->getDir() == DSocket::IN)
-            if(socket->toIn()->getTempCntdID() > 0)
-                const_cast<DSocket*>(socket)->toIn()->cntdSocketFromID();
-        }
-    loadIDMapper.clear();
-}
-
 void CopySocketMapper::setSocketPair(DSocket *original, DSocket *copy)
 {
    socketMap.insert({original, copy});
@@ -118,7 +88,7 @@ IO::InStream& MindTree::operator>>(IO::InStream& stream, DSocket &socket)
     stream >> name >> id >> type >> variable;
     socket.name = name;
     socket.type = type;
-    LoadSocketIDMapper::setID(&socket, id);
+    stream.setSocketID(&socket, id);
     return stream;
 }
 
@@ -218,6 +188,7 @@ void DSocket::createLink(DSocket *socket1, DSocket *socket2)
 
 void DSocket::removeLink(DinSocket *in, DoutSocket *out)
 {
+    if(in->getCntdSocket()) MT_CUSTOM_SIGNAL_EMITTER("removeLink", in);
     in->clearLink();
 }
 
@@ -537,6 +508,8 @@ void DinSocket::setCntdSocket(DoutSocket *socket)
 {
     MT_CUSTOM_BOUND_SIGNAL_EMITTER(&_signalLiveTime, "linkChanged", socket);
     if(!socket) {
+        //emitted before a variable socket goes away with its link
+        if(cntdSocket) MT_CUSTOM_SIGNAL_EMITTER("removeLink", this);
         clearLink();
         return;
     }
@@ -555,9 +528,9 @@ void DinSocket::setCntdSocket(DoutSocket *socket)
     MT_CUSTOM_SIGNAL_EMITTER("createLink", this);
 }
 
-void DinSocket::cntdSocketFromID()
+void DinSocket::cntdSocketFromID(const DSocket *socket)
 {
-    cntdSocket = const_cast<DSocket*>(LoadSocketIDMapper::getSocket(getTempCntdID()))->toOut();
+    cntdSocket = socket ? const_cast<DSocket*>(socket)->toOut() : nullptr;
     if(cntdSocket) cntdSocket->pushSocket(this);
     setTempCntdID(0);
 }
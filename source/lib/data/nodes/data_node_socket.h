@@ -36,18 +36,6 @@ typedef std::vector<DinSocket*> DinSocketList;
 typedef std::vector<DoutSocket*> DoutSocketList;
 typedef std::vector<DSocket*> DSocketList;
 
-class LoadSocketIDMapper
-{
-public:
-    static unsigned short getID(const DSocket *socket);
-    static void setID(const DSocket *socket, unsigned short ID);
-    static const DSocket * getSocket(unsigned short ID);
-    static void remap();
-
-private:
-    static std::unordered_map<unsigned short, const DSocket*>loadIDMapper;
-};
-
 class CopySocketMapper
 {
 public:
@@ -172,7 +160,8 @@ public:
     DoutSocket* getCntdFunctionalSocket() const;
     DoutSocket* getCntdWorkSocket() const;
 	void setCntdSocket(DoutSocket *socket);
-    void cntdSocketFromID();
+    //socket is what the temporary id referred to in the loaded file
+    void cntdSocketFromID(const DSocket *socket);
     bool operator==(DinSocket &socket)const;
     bool operator!=(DinSocket &socket)const;
 	void setTempCntdID(unsigned short value);
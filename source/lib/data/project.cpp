@@ -1,6 +1,8 @@
 #include "fstream"
+#include "cstdio"
 #include "data/signal.h"
 #include "data/io.h"
+#include "data/autosave.h"
 #include "project.h"
 
 using namespace MindTree;
@@ -24,17 +26,24 @@ Project::Project(std::string filename) noexcept
     MT_CUSTOM_SIGNAL_EMITTER("newProject", this);
 }
 
+Project::Project(DNSpace *space, std::string filename) noexcept
+    : filename(filename)
+{
+    setRootSpace(space);
+    root_scene->setName("Root");
+    MT_CUSTOM_SIGNAL_EMITTER("newProject", this);
+}
+
 DNSpace* Project::fromFile(std::string filename)
 {
+    //container spaces are read once they are accessed
     IO::InStream stream(filename);
-    auto space = new DNSpace();
-    stream >> *space;
-    LoadSocketIDMapper::remap();
-    return space;
+    return stream.readProject();
 }
 
 Project::~Project()
 {
+    MT_CUSTOM_SIGNAL_EMITTER("closeProject", this);
     delete root_scene;
 }
 
@@ -53,6 +62,16 @@ Project* Project::load(std::string filename)
     return _project;
 }
 
+Project* Project::recover(std::string filename)
+{
+    DNSpace *space = Autosave::recover(filename);
+    if(!space) return nullptr;
+
+    if(_project) delete _project;
+    _project = new Project(space, filename);
+    return _project;
+}
+
 Project* Project::instance()    
 {
     return _project;
@@ -112,8 +131,18 @@ void Project::unregisterItem(std::string idname)
 
 void Project::save()
 {
-    IO::OutStream stream(filename);
-    stream << *root_scene;
+    //containers that were not loaded yet still read from the mapped old
+    //file, so it is replaced instead of written over
+    std::string tmpname = filename + ".tmp";
+    {
+        IO::OutStream stream(tmpname);
+        stream.writeProject(*root_scene);
+    }
+    if(std::rename(tmpname.c_str(), filename.c_str())) {
+        std::cout << "could not save " << filename << std::endl;
+        return;
+    }
+    MT_CUSTOM_SIGNAL_EMITTER("projectSaved", this);
 }
 
 std::string Project::getFilename()const
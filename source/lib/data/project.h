@@ -12,6 +12,7 @@ class DNode;
 class Project : public PyExposable
 {
 	Project(std::string filename="") noexcept;
+	Project(DNSpace *space, std::string filename) noexcept;
 
 public:
 	~Project();
@@ -19,6 +20,9 @@ public:
     static Project* instance();
     static Project* create();
     static Project* load(std::string filename);
+    //opens the autosaved state of the project saved as filename, returns
+    //null if there is none
+    static Project* recover(std::string filename);
 
     void save(); 
     void saveAs(); 
@@ -520,9 +520,45 @@ public:
 
         _readers[PropertyTypeInfo<T>::getType()] = reader;
     }
+
+    //lists whose element types share a DataType, like int and uint8_t, are
+    //told apart by the element size they were written with. The last list
+    //type skips the elements if no size matches
+    template<typename List, typename... Lists>
+    static void registerListReader()
+    {
+        auto reader = [](IO::InStream &stream) {
+            return readList<List, Lists...>(stream, stream.peekArrayElementSize());
+        };
+
+        _readers[PropertyTypeInfo<List>::getType()] = reader;
+    }
     static Property read(IO::InStream &stream) noexcept;
 
 private:
+    template<typename T> struct ListElement;
+    template<typename T> struct ListElement<std::vector<T>> { typedef T type; };
+    template<typename T> struct ListElement<std::shared_ptr<std::vector<T>>> { typedef T type; };
+
+    template<typename List>
+    static Property readList(IO::InStream &stream, int32_t)
+    {
+        List data;
+        stream >> data;
+        return Property(data);
+    }
+
+    template<typename List, typename Next, typename... Lists>
+    static Property readList(IO::InStream &stream, int32_t elementSize)
+    {
+        if(elementSize != sizeof(typename ListElement<List>::type))
+            return readList<Next, Lists...>(stream, elementSize);
+
+        List data;
+        stream >> data;
+        return Property(data);
+    }
+
     static ReaderList _readers;
 
 };
@@ -4,6 +4,9 @@
 #include "data/nodes/nodetype.h"
 #include "data/nodes/data_node_socket.h"
 #include "data/project.h"
+#include "data/benchmark.h"
+#include "fstream"
+#include "iostream"
 
 #include "boost/python/suite/indexing/vector_indexing_suite.hpp"
 #include "system.h"
@@ -25,6 +28,9 @@ void MindTree::Python::sys::wrap()
     BPy::def("attachToBoundSignal", MindTree::Python::sys::attachToBoundSignal);
     BPy::def("openProject", MindTree::Python::sys::open);
     BPy::def("newProject", MindTree::Python::sys::newProject);
+    BPy::def("benchmarks", MindTree::Python::sys::getBenchmarks);
+    BPy::def("setBenchmarkTracing", MindTree::Python::sys::setBenchmarkTracing);
+    BPy::def("writeBenchmarkTrace", MindTree::Python::sys::writeBenchmarkTrace);
 
     MindTree::Signal::getHandler<MindTree::Project*>().connect("newProject", [](MindTree::Project* prj) {
         GILLocker locker;
@@ -54,6 +60,46 @@ void MindTree::Python::sys::regNode(PyObject *nodeClass)
     }
 }
 
+namespace {
+    BPy::dict benchmarkToDict(const MindTree::Benchmark &benchmark)
+    {
+        BPy::dict dict;
+        dict["name"] = benchmark.getName();
+        dict["calls"] = benchmark.getNumCalls();
+        dict["cpuTime"] = benchmark.getCPUTime();
+        dict["gpuTime"] = benchmark.getGPUTime();
+        BPy::list children;
+        for(const auto &child : benchmark.benchmarks())
+            children.append(benchmarkToDict(*child));
+        dict["children"] = children;
+        return dict;
+    }
+}
+
+BPy::list MindTree::Python::sys::getBenchmarks()
+{
+    BPy::list benchmarks;
+    for(const auto &benchmark : Benchmark::getRoots())
+        benchmarks.append(benchmarkToDict(*benchmark));
+    return benchmarks;
+}
+
+void MindTree::Python::sys::setBenchmarkTracing(bool enable)
+{
+    Benchmark::setTracing(enable);
+}
+
+void MindTree::Python::sys::writeBenchmarkTrace(std::string filename)
+{
+    std::ofstream stream(filename);
+    if(!stream) {
+        std::cout << "could not write benchmark trace to " << filename << std::endl;
+        return;
+    }
+
+    Benchmark::writeTrace(stream, Benchmark::getRoots());
+}
+
 BPy::object MindTree::Python::sys::createNode(std::string name)    
 {
     GILReleaser releaser;
@@ -22,6 +22,9 @@ namespace sys {
     std::string __str__StringVector(std::vector<std::string> &self);
     std::string __repr__StringVector(std::vector<std::string> &self);
     std::vector<std::string> getSocketTypes();
+    BPy::list getBenchmarks();
+    void setBenchmarkTracing(bool enable);
+    void writeBenchmarkTrace(std::string filename);
 }
 }
 }
@@ -0,0 +1,76 @@
+#include "thread"
+#include "mutex"
+#include "condition_variable"
+#include "deque"
+#include "vector"
+#include "algorithm"
+
+#include "thread_pool.h"
+
+using namespace MindTree;
+
+namespace {
+    struct Pool {
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::deque<std::function<void()>> jobs;
+        std::vector<std::thread> threads;
+        size_t idle{0};
+        bool stopping{false};
+    };
+
+    //never destroyed, workers started during shutdown may still wait on it
+    //at exit
+    Pool& pool()
+    {
+        static Pool *p = new Pool;
+        return *p;
+    }
+
+    void work()
+    {
+        Pool &p = pool();
+        for(;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(p.mutex);
+                ++p.idle;
+                p.wakeup.wait(lock, [&p] { return !p.jobs.empty() || p.stopping; });
+                --p.idle;
+                if(p.jobs.empty()) return;
+                job = std::move(p.jobs.front());
+                p.jobs.pop_front();
+            }
+            job();
+        }
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+    Pool &p = pool();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.jobs.push_back(std::move(job));
+
+    unsigned maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    if(p.jobs.size() > p.idle && p.threads.size() < maxThreads)
+        p.threads.emplace_back(work);
+    p.wakeup.notify_one();
+}
+
+void ThreadPool::stop()
+{
+    Pool &p = pool();
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        p.stopping = true;
+        threads.swap(p.threads);
+    }
+    p.wakeup.notify_all();
+    for(auto &thread : threads)
+        thread.join();
+
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.stopping = false;
+}
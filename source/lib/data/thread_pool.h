@@ -0,0 +1,22 @@
+#ifndef MT_THREAD_POOL_H
+#define MT_THREAD_POOL_H
+
+#include "functional"
+
+namespace MindTree
+{
+//worker threads shared by everything that runs in the background, like
+//imports, texture decoding and index optimization. Threads are started as
+//jobs come in, up to one per core
+class ThreadPool
+{
+public:
+    static void enqueue(std::function<void()> job);
+
+    //runs the queued jobs to the end and joins the workers, jobs enqueued
+    //later start new ones
+    static void stop();
+};
+}
+
+#endif
@@ -131,7 +131,8 @@ class MaterialInstanceNodeDecorator(MT.pytypes.NodeDecorator):
             ("Diffuse Color", "COLOR", (1, 1, 1, 1)),
             ("Diffuse Intensity", "FLOAT", 0.8),
             ("Specular Intensity", "FLOAT", 0.8),
-            ("Specular Roughness", "FLOAT", 0.3)
+            ("Specular Roughness", "FLOAT", 0.3),
+            ("Diffuse Texture", "DIRECTORY")
             ]
     outsockets = [("Material", "MATERIAL")]
 
@@ -146,6 +147,28 @@ class SetMaterialInstanceNodeDecorator(MT.pytypes.NodeDecorator):
     outsockets = [("Object", "TRANSFORMABLE")]
 
 
+class MeshLODNodeDecorator(MT.pytypes.NodeDecorator):
+    label = "Objects.Mesh.Level of Detail"
+    type = "MESHLOD"
+
+    insockets = [
+            ("Data", "OBJECTDATA"),
+            ("Levels", "INTEGER", 4),
+            ("Ratio", "FLOAT", 0.5)
+            ]
+    outsockets = [("Data", "OBJECTDATA")]
+
+
+class MeshClustersNodeDecorator(MT.pytypes.NodeDecorator):
+    label = "Objects.Mesh.Clusters"
+    type = "MESHCLUSTERS"
+
+    insockets = [
+            ("Data", "OBJECTDATA"),
+            ("Max Triangles", "INTEGER", 128)
+            ]
+    outsockets = [("Data", "OBJECTDATA")]
+
 
 MT.registerNode(GroupObjectsNodeDecorator)
 MT.registerNode(TransformObjectNodeDecorator)
@@ -159,3 +182,5 @@ MT.registerNode(EmptyNodeDecortator)
 MT.registerNode(CameraNodeDecorator)
 MT.registerNode(ObjectNodeDecorator)
 MT.registerNode(CreateTransformationNodeDecorator)
+MT.registerNode(MeshLODNodeDecorator)
+MT.registerNode(MeshClustersNodeDecorator)
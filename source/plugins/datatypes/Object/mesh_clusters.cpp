@@ -0,0 +1,286 @@
+#include "algorithm"
+#include "cmath"
+#include "limits"
+
+#include "mesh_simplification.h"
+#include "mesh_clusters.h"
+
+using namespace MindTree;
+
+namespace {
+    //how much a normal deviating from the cluster counts against the
+    //distance to its center, relative to the cluster radius
+    const float NORMAL_WEIGHT = 2;
+
+    uint32_t spreadBits(uint32_t v)
+    {
+        v &= 0x3ff;
+        v = (v | (v << 16)) & 0x030000ff;
+        v = (v | (v << 8)) & 0x0300f00f;
+        v = (v | (v << 4)) & 0x030c30c3;
+        v = (v | (v << 2)) & 0x09249249;
+        return v;
+    }
+
+    MeshData::Cluster bounds(const VertexList &vertices,
+                             const std::vector<uint> &triangles,
+                             const std::vector<glm::vec3> &normals,
+                             uint first, uint count)
+    {
+        MeshData::Cluster cluster;
+        cluster.firstTriangle = first;
+        cluster.triangleCount = count;
+
+        glm::vec3 lower(std::numeric_limits<float>::max());
+        glm::vec3 upper(-std::numeric_limits<float>::max());
+        glm::vec3 normalSum(0);
+        for(uint t = first; t < first + count; ++t) {
+            for(int i = 0; i < 3; ++i) {
+                const auto &p = vertices[triangles[t * 3 + i]];
+                lower = glm::min(lower, p);
+                upper = glm::max(upper, p);
+            }
+            normalSum += normals[t];
+        }
+
+        cluster.center = (lower + upper) * .5f;
+        float radius = 0;
+        for(uint t = first; t < first + count; ++t)
+            for(int i = 0; i < 3; ++i)
+                radius = std::max(radius, glm::length(vertices[triangles[t * 3 + i]] - cluster.center));
+        cluster.radius = radius;
+
+        //normals cancel each other out, nothing to cull by orientation
+        float length = glm::length(normalSum);
+        if(length < 1e-6) {
+            cluster.coneAxis = glm::vec3(0, 0, 1);
+            cluster.coneCos = -1;
+            return cluster;
+        }
+
+        cluster.coneAxis = normalSum / length;
+        float coneCos = 1;
+        for(uint t = first; t < first + count; ++t) {
+            float normalLength = glm::length(normals[t]);
+            //degenerate triangles do not face anywhere
+            if(normalLength < 1e-12) continue;
+            coneCos = std::min(coneCos, glm::dot(cluster.coneAxis, normals[t] / normalLength));
+        }
+        cluster.coneCos = coneCos;
+        return cluster;
+    }
+}
+
+MeshData::Clusters MeshClusters::build(const VertexList &vertices,
+                                       const std::vector<uint> &triangles,
+                                       size_t maxTriangles)
+{
+    MeshData::Clusters result;
+    size_t triangleCount = triangles.size() / 3;
+    if(!triangleCount || !maxTriangles) return result;
+
+    //area weighted normals and centroids
+    std::vector<glm::vec3> normals(triangleCount);
+    std::vector<glm::vec3> centroids(triangleCount);
+    glm::vec3 lower(std::numeric_limits<float>::max());
+    glm::vec3 upper(-std::numeric_limits<float>::max());
+    for(size_t t = 0; t < triangleCount; ++t) {
+        const auto &a = vertices[triangles[t * 3]];
+        const auto &b = vertices[triangles[t * 3 + 1]];
+        const auto &c = vertices[triangles[t * 3 + 2]];
+        normals[t] = glm::cross(b - a, c - a) * .5f;
+        centroids[t] = (a + b + c) / 3.f;
+        lower = glm::min(lower, centroids[t]);
+        upper = glm::max(upper, centroids[t]);
+    }
+
+    //triangles per vertex
+    std::vector<uint> firstAdjacent(vertices.size() + 1, 0);
+    for(uint index : triangles) ++firstAdjacent[index + 1];
+    for(size_t i = 1; i < firstAdjacent.size(); ++i)
+        firstAdjacent[i] += firstAdjacent[i - 1];
+    std::vector<uint> adjacent(triangles.size());
+    {
+        auto fill = firstAdjacent;
+        for(size_t i = 0; i < triangles.size(); ++i)
+            adjacent[fill[triangles[i]]++] = i / 3;
+    }
+
+    //seeds are visited along a morton curve, so the clusters that are left
+    //over at the end of a region stay local as well
+    std::vector<uint> order(triangleCount);
+    {
+        std::vector<uint32_t> codes(triangleCount);
+        glm::vec3 extent = glm::max(upper - lower, glm::vec3(1e-12));
+        for(size_t t = 0; t < triangleCount; ++t) {
+            glm::vec3 cell = (centroids[t] - lower) / extent * 1023.f;
+            codes[t] = spreadBits(cell.x)
+                | (spreadBits(cell.y) << 1)
+                | (spreadBits(cell.z) << 2);
+            order[t] = t;
+        }
+        std::sort(begin(order), end(order), [&](uint a, uint b) {
+            return codes[a] < codes[b];
+        });
+    }
+
+    std::vector<uint> groupOf(triangleCount, std::numeric_limits<uint>::max());
+    std::vector<std::vector<uint>> groups;
+    //vertices a triangle shares with the current cluster, 0 while it is
+    //not part of the frontier
+    std::vector<unsigned char> links(triangleCount, 0);
+    std::vector<uint> frontier;
+
+    auto assigned = [&](uint t) {
+        return groupOf[t] != std::numeric_limits<uint>::max();
+    };
+
+    size_t cursor = 0;
+    int nextSeed = -1;
+    while(cursor < triangleCount) {
+        uint seed = nextSeed >= 0 ? nextSeed : order[cursor];
+        nextSeed = -1;
+        if(assigned(seed)) {
+            ++cursor;
+            continue;
+        }
+
+        groups.emplace_back();
+        auto &members = groups.back();
+        frontier.assign(1, seed);
+        links[seed] = 1;
+        glm::vec3 centroidSum(0);
+        glm::vec3 normalSum(0);
+        float radius = 0;
+
+        while(!frontier.empty() && members.size() < maxTriangles) {
+            glm::vec3 center = members.empty()
+                ? centroids[seed]
+                : centroidSum / float(members.size());
+            float normalLength = glm::length(normalSum);
+            glm::vec3 axis = normalLength > 0 ? normalSum / normalLength : glm::vec3(0);
+
+            //cheapest triangle at the border of the cluster
+            size_t best = 0;
+            float bestScore = std::numeric_limits<float>::max();
+            for(size_t i = 0; i < frontier.size(); ++i) {
+                uint t = frontier[i];
+                float distance = glm::length(centroids[t] - center);
+                float tLength = glm::length(normals[t]);
+                float deviation = tLength > 0
+                    ? 1 - glm::dot(axis, normals[t] / tLength)
+                    : 0;
+                float score = distance + deviation * NORMAL_WEIGHT * radius;
+                if(score < bestScore) {
+                    bestScore = score;
+                    best = i;
+                }
+            }
+
+            uint t = frontier[best];
+            frontier[best] = frontier.back();
+            frontier.pop_back();
+
+            groupOf[t] = groups.size() - 1;
+            members.push_back(t);
+            centroidSum += centroids[t];
+            normalSum += normals[t];
+            radius = std::max(radius, glm::length(centroids[t] - centroidSum / float(members.size())));
+
+            for(int i = 0; i < 3; ++i) {
+                uint v = triangles[t * 3 + i];
+                for(uint a = firstAdjacent[v]; a < firstAdjacent[v + 1]; ++a) {
+                    uint n = adjacent[a];
+                    if(assigned(n)) continue;
+                    if(!links[n]) frontier.push_back(n);
+                    if(links[n] < 255) ++links[n];
+                }
+            }
+        }
+
+        //the next cluster starts in the most enclosed corner of this one,
+        //which keeps the number of pockets between clusters low
+        for(uint t : frontier)
+            if(nextSeed < 0 || links[t] > links[nextSeed])
+                nextSeed = t;
+
+        //triangles that did not make it are free for the next cluster
+        for(uint t : frontier) links[t] = 0;
+    }
+
+    //pockets that were enclosed by other clusters end up as tiny clusters,
+    //they are merged into the closest neighbour that still has room
+    std::vector<glm::vec3> groupCenters(groups.size(), glm::vec3(0));
+    for(size_t g = 0; g < groups.size(); ++g) {
+        for(uint t : groups[g]) groupCenters[g] += centroids[t];
+        groupCenters[g] /= float(groups[g].size());
+    }
+    for(size_t g = 0; g < groups.size(); ++g) {
+        if(groups[g].empty() || groups[g].size() >= maxTriangles / 4) continue;
+
+        uint target = std::numeric_limits<uint>::max();
+        float targetDistance = std::numeric_limits<float>::max();
+        for(uint t : groups[g]) {
+            for(int i = 0; i < 3; ++i) {
+                uint v = triangles[t * 3 + i];
+                for(uint a = firstAdjacent[v]; a < firstAdjacent[v + 1]; ++a) {
+                    uint h = groupOf[adjacent[a]];
+                    if(h == g || groups[h].size() + groups[g].size() > maxTriangles) continue;
+                    float distance = glm::length(groupCenters[h] - groupCenters[g]);
+                    if(distance < targetDistance) {
+                        targetDistance = distance;
+                        target = h;
+                    }
+                }
+            }
+        }
+        if(target == std::numeric_limits<uint>::max()) continue;
+
+        auto &merged = groups[target];
+        groupCenters[target] = (groupCenters[target] * float(merged.size())
+                                + groupCenters[g] * float(groups[g].size()))
+            / float(merged.size() + groups[g].size());
+        for(uint t : groups[g]) {
+            groupOf[t] = target;
+            merged.push_back(t);
+        }
+        groups[g].clear();
+    }
+
+    result.triangles.reserve(triangles.size());
+    for(const auto &members : groups) {
+        if(members.empty()) continue;
+        uint first = result.triangles.size() / 3;
+        for(uint t : members) {
+            result.triangles.push_back(triangles[t * 3]);
+            result.triangles.push_back(triangles[t * 3 + 1]);
+            result.triangles.push_back(triangles[t * 3 + 2]);
+        }
+        result.clusters.push_back({first, uint(members.size())});
+    }
+
+    //bounds are computed on the reordered triangles
+    std::vector<glm::vec3> orderedNormals(triangleCount);
+    for(size_t t = 0; t < triangleCount; ++t) {
+        const auto &a = vertices[result.triangles[t * 3]];
+        const auto &b = vertices[result.triangles[t * 3 + 1]];
+        const auto &c = vertices[result.triangles[t * 3 + 2]];
+        orderedNormals[t] = glm::cross(b - a, c - a);
+    }
+    for(auto &cluster : result.clusters)
+        cluster = bounds(vertices, result.triangles, orderedNormals,
+                         cluster.firstTriangle, cluster.triangleCount);
+
+    return result;
+}
+
+void MeshClusters::generateClusters(MeshData *mesh, size_t maxTriangles)
+{
+    if(!mesh->hasProperty("P") || !mesh->hasProperty("polygon")) return;
+    auto vertices = mesh->getProperty("P").getData<VertexListPtr>();
+    auto polygons = mesh->getProperty("polygon").getData<PolygonListPtr>();
+    if(!vertices || !polygons) return;
+
+    auto triangles = MeshSimplification::triangulate(*polygons);
+    mesh->setClusters(std::make_shared<MeshData::Clusters>(build(*vertices, triangles, maxTriangles)));
+}
@@ -0,0 +1,28 @@
+#ifndef MT_MESH_CLUSTERS_H
+#define MT_MESH_CLUSTERS_H
+
+#include "vector"
+#include "object.h"
+
+namespace MindTree {
+
+//splits a mesh into small clusters of neighbouring triangles that can be
+//culled against the frustum and by their normal cone on their own
+namespace MeshClusters {
+
+const size_t MAX_TRIANGLES = 128;
+
+//clusters are started in morton order of the triangle centroids and grown
+//over shared vertices, preferring triangles that keep the cluster compact
+//and its normals close together
+MeshData::Clusters build(const VertexList &vertices,
+                         const std::vector<uint> &triangles,
+                         size_t maxTriangles=MAX_TRIANGLES);
+
+//stores the clusters of the triangulated polygons on the mesh
+void generateClusters(MeshData *mesh, size_t maxTriangles=MAX_TRIANGLES);
+
+}
+}
+
+#endif
@@ -0,0 +1,714 @@
+#include "algorithm"
+#include "atomic"
+#include "cmath"
+#include "cstring"
+#include "limits"
+#include "queue"
+#include "thread"
+#include "unordered_map"
+
+#include "mesh_simplification.h"
+
+using namespace MindTree;
+
+namespace {
+    //triangles per cell when large meshes are simplified in parallel
+    const size_t CELL_TRIANGLES = 1 << 16;
+    //borders and seams keep their shape a lot better than the surface
+    const double BORDER_WEIGHT = 10;
+
+    enum VertexKind : unsigned char {
+        MANIFOLD,
+        BORDER,
+        //shares its position with exactly one other vertex
+        SEAM,
+        LOCKED
+    };
+
+    struct Topology {
+        //first vertex with the same position
+        std::vector<uint> classes;
+        //next vertex with the same position, every class forms a cycle
+        std::vector<uint> wedges;
+        std::vector<VertexKind> kinds;
+    };
+
+    struct PositionKey {
+        uint32_t x, y, z;
+        bool operator==(const PositionKey &other) const
+        {
+            return x == other.x && y == other.y && z == other.z;
+        }
+    };
+
+    struct PositionHash {
+        size_t operator()(const PositionKey &key) const
+        {
+            uint64_t h = key.x;
+            h = h * 0x9e3779b97f4a7c15ull ^ key.y;
+            h = h * 0x9e3779b97f4a7c15ull ^ key.z;
+            h ^= h >> 29;
+            return h * 0xbf58476d1ce4e5b9ull;
+        }
+    };
+
+    PositionKey makeKey(const glm::vec3 &p)
+    {
+        //-0 and 0 are the same position
+        glm::vec3 v(p.x + 0.f, p.y + 0.f, p.z + 0.f);
+        PositionKey key;
+        std::memcpy(&key.x, &v.x, 4);
+        std::memcpy(&key.y, &v.y, 4);
+        std::memcpy(&key.z, &v.z, 4);
+        return key;
+    }
+
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0;
+        double b2 = 0, bc = 0, bd = 0;
+        double c2 = 0, cd = 0;
+        double d2 = 0;
+
+        void addPlane(const glm::vec3 &n, double d, double weight)
+        {
+            double a = n.x, b = n.y, c = n.z;
+            a2 += weight * a * a; ab += weight * a * b; ac += weight * a * c; ad += weight * a * d;
+            b2 += weight * b * b; bc += weight * b * c; bd += weight * b * d;
+            c2 += weight * c * c; cd += weight * c * d;
+            d2 += weight * d * d;
+        }
+
+        Quadric& operator+=(const Quadric &other)
+        {
+            a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+            b2 += other.b2; bc += other.bc; bd += other.bd;
+            c2 += other.c2; cd += other.cd;
+            d2 += other.d2;
+            return *this;
+        }
+
+        //sum of squared distances to all planes
+        double evaluate(const glm::vec3 &p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double result = a2 * x * x + b2 * y * y + c2 * z * z
+                + 2 * (ab * x * y + ac * x * z + bc * y * z)
+                + 2 * (ad * x + bd * y + cd * z)
+                + d2;
+            return std::max(result, 0.);
+        }
+    };
+
+    //triangles around every vertex
+    struct VertexTriangles {
+        std::vector<uint> offsets;
+        std::vector<uint> triangles;
+
+        VertexTriangles(size_t vertexCount, const std::vector<uint> &indices) :
+            offsets(vertexCount + 1, 0)
+        {
+            for(uint index : indices)
+                ++offsets[index + 1];
+            for(size_t i = 1; i < offsets.size(); ++i)
+                offsets[i] += offsets[i - 1];
+
+            triangles.resize(indices.size());
+            std::vector<uint> fill(offsets.begin(), offsets.end() - 1);
+            for(size_t i = 0; i < indices.size(); ++i)
+                triangles[fill[indices[i]]++] = i / 3;
+        }
+
+        //whether a triangle around from has the half edge from -> to
+        bool hasHalfEdge(const std::vector<uint> &indices, uint from, uint to) const
+        {
+            for(uint i = offsets[from]; i < offsets[from + 1]; ++i) {
+                const uint *tri = &indices[triangles[i] * 3];
+                for(int k = 0; k < 3; ++k)
+                    if(tri[k] == from && tri[(k + 1) % 3] == to) return true;
+            }
+            return false;
+        }
+
+        //whether a triangle around to has a half edge that ends in to and
+        //starts at the position of from
+        bool hasHalfEdgeFromClass(const std::vector<uint> &indices,
+                                  const std::vector<uint> &classes,
+                                  uint fromClass, uint to) const
+        {
+            for(uint i = offsets[to]; i < offsets[to + 1]; ++i) {
+                const uint *tri = &indices[triangles[i] * 3];
+                for(int k = 0; k < 3; ++k)
+                    if(tri[(k + 1) % 3] == to && classes[tri[k]] == fromClass) return true;
+            }
+            return false;
+        }
+    };
+
+    Topology classify(const VertexList &vertices, const std::vector<uint> &triangles)
+    {
+        size_t vertexCount = vertices.size();
+        Topology topology;
+        topology.classes.resize(vertexCount);
+        topology.wedges.resize(vertexCount);
+        topology.kinds.resize(vertexCount, LOCKED);
+
+        std::vector<uint> classSize(vertexCount, 0);
+        {
+            std::unordered_map<PositionKey, uint, PositionHash> positions;
+            positions.reserve(vertexCount);
+            for(uint v = 0; v < vertexCount; ++v) {
+                auto result = positions.emplace(makeKey(vertices[v]), v);
+                uint first = result.first->second;
+                topology.classes[v] = first;
+                topology.wedges[v] = v;
+                if(!result.second) {
+                    topology.wedges[v] = topology.wedges[first];
+                    topology.wedges[first] = v;
+                }
+                ++classSize[first];
+            }
+        }
+
+        VertexTriangles adjacency(vertexCount, triangles);
+
+        //a half edge without its opposite is a border in index space, which
+        //is either a real border or an attribute seam
+        std::vector<unsigned char> borderCount(vertexCount, 0);
+        for(size_t i = 0; i < triangles.size(); i += 3) {
+            for(int k = 0; k < 3; ++k) {
+                uint from = triangles[i + k];
+                uint to = triangles[i + (k + 1) % 3];
+                if(adjacency.hasHalfEdge(triangles, to, from)) continue;
+                if(borderCount[from] < 255) ++borderCount[from];
+                if(borderCount[to] < 255) ++borderCount[to];
+            }
+        }
+
+        //every border edge of a seam vertex continues on the other side of
+        //the seam, otherwise the seam runs into a real border
+        auto isClosedSeam = [&](uint v) {
+            uint twin = topology.wedges[v];
+            for(uint i = adjacency.offsets[v]; i < adjacency.offsets[v + 1]; ++i) {
+                const uint *tri = &triangles[adjacency.triangles[i] * 3];
+                for(int k = 0; k < 3; ++k) {
+                    uint from = tri[k];
+                    uint to = tri[(k + 1) % 3];
+                    if(from == v && !adjacency.hasHalfEdge(triangles, to, v)
+                       && !adjacency.hasHalfEdgeFromClass(triangles, topology.classes,
+                                                         topology.classes[to], twin))
+                        return false;
+                }
+            }
+            return true;
+        };
+
+        for(uint v = 0; v < vertexCount; ++v) {
+            switch(classSize[topology.classes[v]]) {
+                case 1:
+                    if(borderCount[v] == 0) topology.kinds[v] = MANIFOLD;
+                    else if(borderCount[v] == 2) topology.kinds[v] = BORDER;
+                    break;
+                case 2: {
+                    uint twin = topology.wedges[v];
+                    if(borderCount[v] == 2 && borderCount[twin] == 2
+                       && isClosedSeam(v) && isClosedSeam(twin))
+                        topology.kinds[v] = SEAM;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        return topology;
+    }
+
+    class Collapser
+    {
+    public:
+        Collapser(const VertexList &vertices,
+                  const std::vector<uint> &triangles,
+                  const Topology &topology,
+                  const std::vector<bool> *locked) :
+            _topology(topology),
+            _triangles(triangles.size()),
+            _aliveTriangles(triangles.size() / 3, true),
+            _triangleCount(triangles.size() / 3),
+            _maxCost(0)
+        {
+            std::unordered_map<uint, uint> local;
+            local.reserve(triangles.size() / 2);
+            for(size_t i = 0; i < triangles.size(); ++i) {
+                auto result = local.emplace(triangles[i], _global.size());
+                if(result.second) _global.push_back(triangles[i]);
+                _triangles[i] = result.first->second;
+            }
+
+            size_t vertexCount = _global.size();
+            _positions.resize(vertexCount);
+            _kinds.resize(vertexCount);
+            _wedges.resize(vertexCount);
+            _vertexTriangles.resize(vertexCount);
+            _quadrics.resize(vertexCount);
+            _versions.resize(vertexCount, 0);
+            _removed.resize(vertexCount, false);
+
+            for(uint v = 0; v < vertexCount; ++v) {
+                uint global = _global[v];
+                _positions[v] = vertices[global];
+                _kinds[v] = topology.kinds[global];
+                _wedges[v] = v;
+                if(locked && (*locked)[global]) _kinds[v] = LOCKED;
+                if(_kinds[v] == SEAM) {
+                    auto twin = local.find(topology.wedges[global]);
+                    if(twin == local.end()) _kinds[v] = LOCKED;
+                    else _wedges[v] = twin->second;
+                }
+            }
+
+            for(uint t = 0; t < _aliveTriangles.size(); ++t)
+                for(int k = 0; k < 3; ++k)
+                    _vertexTriangles[_triangles[t * 3 + k]].push_back(t);
+
+            initQuadrics();
+        }
+
+        void run(size_t targetCount)
+        {
+            for(uint v = 0; v < _positions.size(); ++v)
+                evaluate(v);
+
+            while(_triangleCount > targetCount && !_queue.empty()) {
+                Candidate candidate = _queue.top();
+                _queue.pop();
+                if(_removed[candidate.from] || _versions[candidate.from] != candidate.version)
+                    continue;
+
+                double cost;
+                uint twin, twinTarget;
+                if(!canCollapse(candidate.from, candidate.to, cost, twin, twinTarget)
+                   || !isValidCollapse(candidate.from, candidate.to, twin, twinTarget))
+                    continue;
+
+                std::vector<uint> &affected = _affected;
+                affected.clear();
+                collapse(candidate.from, candidate.to, affected);
+                if(twin != candidate.from)
+                    collapse(twin, twinTarget, affected);
+                _maxCost = std::max(_maxCost, cost);
+
+                std::sort(begin(affected), end(affected));
+                affected.erase(std::unique(begin(affected), end(affected)), end(affected));
+                for(uint v : affected) {
+                    ++_versions[v];
+                    evaluate(v);
+                }
+            }
+        }
+
+        std::vector<uint> result() const
+        {
+            std::vector<uint> triangles;
+            triangles.reserve(_triangleCount * 3);
+            for(uint t = 0; t < _aliveTriangles.size(); ++t) {
+                if(!_aliveTriangles[t]) continue;
+                for(int k = 0; k < 3; ++k)
+                    triangles.push_back(_global[_triangles[t * 3 + k]]);
+            }
+            return triangles;
+        }
+
+        float error() const
+        {
+            return std::sqrt(_maxCost);
+        }
+
+    private:
+        struct Candidate {
+            double cost;
+            uint from, to;
+            unsigned version;
+            bool operator<(const Candidate &other) const
+            {
+                return cost > other.cost;
+            }
+        };
+
+        glm::vec3 triangleNormal(uint t, uint replace, uint with) const
+        {
+            glm::vec3 p[3];
+            for(int k = 0; k < 3; ++k) {
+                uint v = _triangles[t * 3 + k];
+                p[k] = _positions[v == replace ? with : v];
+            }
+            return glm::cross(p[1] - p[0], p[2] - p[0]);
+        }
+
+        void initQuadrics()
+        {
+            for(uint t = 0; t < _aliveTriangles.size(); ++t) {
+                const uint *tri = &_triangles[t * 3];
+                glm::vec3 normal = triangleNormal(t, tri[0], tri[0]);
+                float length = glm::length(normal);
+                if(length == 0) continue;
+                normal /= length;
+
+                double d = -glm::dot(normal, _positions[tri[0]]);
+                for(int k = 0; k < 3; ++k)
+                    _quadrics[tri[k]].addPlane(normal, d, 1);
+
+                //planes through border and seam edges, perpendicular to the
+                //triangle, keep the outline in place
+                for(int k = 0; k < 3; ++k) {
+                    uint from = tri[k], to = tri[(k + 1) % 3];
+                    if(countTriangles(from, to) != 1) continue;
+                    glm::vec3 edge = _positions[to] - _positions[from];
+                    glm::vec3 borderNormal = glm::cross(edge, normal);
+                    float borderLength = glm::length(borderNormal);
+                    if(borderLength == 0) continue;
+                    borderNormal /= borderLength;
+                    double borderD = -glm::dot(borderNormal, _positions[from]);
+                    _quadrics[from].addPlane(borderNormal, borderD, BORDER_WEIGHT);
+                    _quadrics[to].addPlane(borderNormal, borderD, BORDER_WEIGHT);
+                }
+            }
+        }
+
+        //alive triangles that contain both vertices
+        int countTriangles(uint a, uint b) const
+        {
+            int count = 0;
+            for(uint t : _vertexTriangles[a]) {
+                if(!_aliveTriangles[t]) continue;
+                const uint *tri = &_triangles[t * 3];
+                if(tri[0] == b || tri[1] == b || tri[2] == b) ++count;
+            }
+            return count;
+        }
+
+        void neighbours(uint v, std::vector<uint> &result) const
+        {
+            result.clear();
+            for(uint t : _vertexTriangles[v]) {
+                if(!_aliveTriangles[t]) continue;
+                for(int k = 0; k < 3; ++k) {
+                    uint n = _triangles[t * 3 + k];
+                    if(n != v) result.push_back(n);
+                }
+            }
+            std::sort(begin(result), end(result));
+            result.erase(std::unique(begin(result), end(result)), end(result));
+        }
+
+        //the collapse keeps the surface manifold if the only common
+        //neighbours of both vertices are the ones opposite of their edge
+        bool keepsManifold(uint from, uint to) const
+        {
+            neighbours(from, _fromNeighbours);
+            neighbours(to, _toNeighbours);
+            size_t common = 0;
+            auto a = begin(_fromNeighbours), b = begin(_toNeighbours);
+            while(a != end(_fromNeighbours) && b != end(_toNeighbours)) {
+                if(*a < *b) ++a;
+                else if(*b < *a) ++b;
+                else { ++common; ++a; ++b; }
+            }
+            return common == static_cast<size_t>(countTriangles(from, to));
+        }
+
+        bool flipsTriangles(uint from, uint to) const
+        {
+            for(uint t : _vertexTriangles[from]) {
+                if(!_aliveTriangles[t]) continue;
+                const uint *tri = &_triangles[t * 3];
+                if(tri[0] == to || tri[1] == to || tri[2] == to) continue;
+
+                glm::vec3 before = triangleNormal(t, from, from);
+                glm::vec3 after = triangleNormal(t, from, to);
+                float lengths = glm::length(before) * glm::length(after);
+                if(lengths == 0 || glm::dot(before, after) < .25f * lengths)
+                    return true;
+            }
+            return false;
+        }
+
+        bool isBorderEdge(uint a, uint b) const
+        {
+            return countTriangles(a, b) == 1;
+        }
+
+        bool canCollapse(uint from, uint to, double &cost, uint &twin, uint &twinTarget) const
+        {
+            twin = from;
+            twinTarget = to;
+            VertexKind toKind = _kinds[to];
+            switch(_kinds[from]) {
+                case MANIFOLD:
+                    break;
+                case BORDER:
+                    if(toKind != BORDER && toKind != LOCKED) return false;
+                    if(!isBorderEdge(from, to)) return false;
+                    break;
+                case SEAM: {
+                    if(toKind != SEAM && toKind != LOCKED) return false;
+                    if(!isBorderEdge(from, to)) return false;
+
+                    //the twin has to follow along the other side of the seam
+                    twin = _wedges[from];
+                    twinTarget = to;
+                    uint toClass = _topology.classes[_global[to]];
+                    for(uint t : _vertexTriangles[twin]) {
+                        if(!_aliveTriangles[t]) continue;
+                        for(int k = 0; k < 3; ++k) {
+                            uint n = _triangles[t * 3 + k];
+                            if(n != to && n != twin
+                               && _topology.classes[_global[n]] == toClass
+                               && isBorderEdge(twin, n)) {
+                                twinTarget = n;
+                            }
+                        }
+                    }
+                    if(twinTarget == to) return false;
+                    break;
+                }
+                default:
+                    return false;
+            }
+
+            Quadric quadric = _quadrics[from];
+            quadric += _quadrics[to];
+            cost = quadric.evaluate(_positions[to]);
+
+            if(twin != from) {
+                Quadric twinQuadric = _quadrics[twin];
+                twinQuadric += _quadrics[twinTarget];
+                cost += twinQuadric.evaluate(_positions[twinTarget]);
+            }
+            return true;
+        }
+
+        //the expensive part of the checks, only done for the cheapest
+        //candidates
+        bool isValidCollapse(uint from, uint to, uint twin, uint twinTarget) const
+        {
+            if(!keepsManifold(from, to) || flipsTriangles(from, to)) return false;
+            if(twin != from
+               && (!keepsManifold(twin, twinTarget) || flipsTriangles(twin, twinTarget)))
+                return false;
+            return true;
+        }
+
+        void evaluate(uint v)
+        {
+            if(_removed[v] || _kinds[v] == LOCKED) return;
+
+            auto &triangles = _vertexTriangles[v];
+            triangles.erase(std::remove_if(begin(triangles), end(triangles),
+                                           [this](uint t) { return !_aliveTriangles[t]; }),
+                            end(triangles));
+
+            neighbours(v, _candidates);
+
+            _collapses.clear();
+            for(uint to : _candidates) {
+                double cost;
+                uint twin, twinTarget;
+                if(canCollapse(v, to, cost, twin, twinTarget))
+                    _collapses.push_back({cost, v, to, _versions[v]});
+            }
+
+            //the queue orders by descending cost
+            std::sort(begin(_collapses), end(_collapses),
+                      [](const Candidate &a, const Candidate &b) { return a.cost < b.cost; });
+            for(const auto &candidate : _collapses) {
+                double cost;
+                uint twin, twinTarget;
+                canCollapse(v, candidate.to, cost, twin, twinTarget);
+                if(isValidCollapse(v, candidate.to, twin, twinTarget)) {
+                    _queue.push(candidate);
+                    break;
+                }
+            }
+        }
+
+        void collapse(uint from, uint to, std::vector<uint> &affected)
+        {
+            _quadrics[to] += _quadrics[from];
+            for(uint t : _vertexTriangles[from]) {
+                if(!_aliveTriangles[t]) continue;
+                uint *tri = &_triangles[t * 3];
+                for(int k = 0; k < 3; ++k)
+                    affected.push_back(tri[k]);
+
+                if(tri[0] == to || tri[1] == to || tri[2] == to) {
+                    _aliveTriangles[t] = false;
+                    --_triangleCount;
+                    continue;
+                }
+                for(int k = 0; k < 3; ++k)
+                    if(tri[k] == from) tri[k] = to;
+                _vertexTriangles[to].push_back(t);
+            }
+            _vertexTriangles[from].clear();
+            _removed[from] = true;
+
+            //everything around the target changed its neighbourhood
+            neighbours(to, _around);
+            affected.insert(end(affected), begin(_around), end(_around));
+            affected.push_back(to);
+        }
+
+        const Topology &_topology;
+        std::vector<uint> _global;
+        std::vector<glm::vec3> _positions;
+        std::vector<VertexKind> _kinds;
+        std::vector<uint> _wedges;
+        std::vector<uint> _triangles;
+        std::vector<char> _aliveTriangles;
+        std::vector<std::vector<uint>> _vertexTriangles;
+        std::vector<Quadric> _quadrics;
+        std::vector<unsigned> _versions;
+        std::vector<char> _removed;
+        std::priority_queue<Candidate> _queue;
+        size_t _triangleCount;
+        double _maxCost;
+
+        //scratch space, the collapser runs millions of small queries
+        mutable std::vector<uint> _fromNeighbours, _toNeighbours;
+        std::vector<uint> _candidates, _around, _affected;
+        std::vector<Candidate> _collapses;
+    };
+}
+
+std::vector<uint> MeshSimplification::triangulate(const PolygonList &polygons)
+{
+    std::vector<uint> triangles;
+    for(const Polygon &poly : polygons) {
+        for(size_t i = 1; i + 1 < poly.size(); ++i) {
+            triangles.push_back(poly[0]);
+            triangles.push_back(poly[i]);
+            triangles.push_back(poly[i + 1]);
+        }
+    }
+    return triangles;
+}
+
+std::vector<uint> MeshSimplification::simplify(const VertexList &vertices,
+                                               const std::vector<uint> &triangles,
+                                               size_t targetCount,
+                                               float *error)
+{
+    if(error) *error = 0;
+    size_t triangleCount = triangles.size() / 3;
+    if(targetCount >= triangleCount) return triangles;
+
+    Topology topology = classify(vertices, triangles);
+
+    int cellsPerAxis = std::ceil(std::cbrt(double(triangleCount) / CELL_TRIANGLES));
+    if(cellsPerAxis <= 1) {
+        Collapser collapser(vertices, triangles, topology, nullptr);
+        collapser.run(targetCount);
+        if(error) *error = collapser.error();
+        return collapser.result();
+    }
+
+    glm::vec3 low(std::numeric_limits<float>::max());
+    glm::vec3 high(-std::numeric_limits<float>::max());
+    for(uint index : triangles) {
+        low = glm::min(low, vertices[index]);
+        high = glm::max(high, vertices[index]);
+    }
+    glm::vec3 cellSize = glm::max((high - low) / float(cellsPerAxis), glm::vec3(1e-20f));
+
+    //every triangle belongs to the cell of its center, positions used in
+    //more than one cell stay where they are until the cells are merged
+    std::vector<std::vector<uint>> cells(cellsPerAxis * cellsPerAxis * cellsPerAxis);
+    std::vector<int> classCells(vertices.size(), -1);
+    std::vector<bool> locked(vertices.size(), false);
+    for(size_t i = 0; i < triangles.size(); i += 3) {
+        glm::vec3 center = (vertices[triangles[i]]
+                            + vertices[triangles[i + 1]]
+                            + vertices[triangles[i + 2]]) / 3.f;
+        glm::ivec3 cell = glm::clamp(glm::ivec3((center - low) / cellSize),
+                                     glm::ivec3(0), glm::ivec3(cellsPerAxis - 1));
+        int cellIndex = (cell.z * cellsPerAxis + cell.y) * cellsPerAxis + cell.x;
+        for(int k = 0; k < 3; ++k) {
+            int &classCell = classCells[topology.classes[triangles[i + k]]];
+            if(classCell == -1) classCell = cellIndex;
+            else if(classCell != cellIndex) classCell = -2;
+        }
+        cells[cellIndex].insert(end(cells[cellIndex]), &triangles[i], &triangles[i] + 3);
+    }
+    for(size_t v = 0; v < vertices.size(); ++v)
+        locked[v] = classCells[topology.classes[v]] == -2;
+
+    std::vector<std::vector<uint>> results(cells.size());
+    std::vector<float> errors(cells.size(), 0);
+    std::atomic<size_t> nextCell(0);
+    auto work = [&] {
+        for(size_t c = nextCell++; c < cells.size(); c = nextCell++) {
+            if(cells[c].empty()) continue;
+            size_t cellTarget = (cells[c].size() / 3) * targetCount / triangleCount;
+            Collapser collapser(vertices, cells[c], topology, &locked);
+            collapser.run(cellTarget);
+            results[c] = collapser.result();
+            errors[c] = collapser.error();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    size_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    threadCount = std::min(threadCount, cells.size());
+    for(size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(work);
+    work();
+    for(auto &thread : threads)
+        thread.join();
+
+    std::vector<uint> merged;
+    merged.reserve(targetCount * 3);
+    float cellError = 0;
+    for(size_t c = 0; c < cells.size(); ++c) {
+        merged.insert(end(merged), begin(results[c]), end(results[c]));
+        cellError = std::max(cellError, errors[c]);
+    }
+    if(error) *error = cellError;
+
+    //the cell borders are all that is left to collapse
+    if(merged.size() / 3 > targetCount) {
+        Topology mergedTopology = classify(vertices, merged);
+        Collapser collapser(vertices, merged, mergedTopology, nullptr);
+        collapser.run(targetCount);
+        if(error) *error = std::max(cellError, collapser.error());
+        return collapser.result();
+    }
+    return merged;
+}
+
+void MeshSimplification::generateLODs(MeshData *mesh, int levels, float ratio, size_t minTriangles)
+{
+    if(!mesh->hasProperty("P") || !mesh->hasProperty("polygon")) return;
+    auto vertices = mesh->getProperty("P").getData<VertexListPtr>();
+    auto polygons = mesh->getProperty("polygon").getData<PolygonListPtr>();
+    if(!vertices || !polygons) return;
+
+    std::vector<MeshData::LOD> lods;
+    std::vector<uint> triangles = triangulate(*polygons);
+    float error = 0;
+    for(int i = 0; i < levels; ++i) {
+        size_t count = triangles.size() / 3;
+        size_t target = count * ratio;
+        if(target < minTriangles) break;
+
+        //every level starts from the previous one, so the errors add up
+        float levelError = 0;
+        auto simplified = simplify(*vertices, triangles, target, &levelError);
+
+        //not worth another level
+        if(simplified.size() > triangles.size() * .9) break;
+
+        error += levelError;
+        triangles = simplified;
+        lods.push_back({std::move(simplified), error});
+    }
+    mesh->setLODs(std::move(lods));
+}
@@ -0,0 +1,36 @@
+#ifndef MT_MESH_SIMPLIFICATION_H
+#define MT_MESH_SIMPLIFICATION_H
+
+#include "vector"
+#include "object.h"
+
+namespace MindTree {
+
+//quadric error edge collapse. Vertices are never moved, every collapse merges
+//a vertex into one of its neighbours, so all levels of detail share the
+//vertex attributes of the original mesh. Borders only collapse along the
+//border and vertices that share their position with others (attribute seams)
+//only collapse along the seam together with their twin
+namespace MeshSimplification {
+
+//fan triangulation of the polygons
+std::vector<uint> triangulate(const PolygonList &polygons);
+
+//collapses edges until at most targetCount triangles are left or nothing
+//can be collapsed anymore. Large meshes are split into spatial cells that
+//are simplified in parallel. error receives the estimated largest distance
+//of the result to the input in object space
+std::vector<uint> simplify(const VertexList &vertices,
+                           const std::vector<uint> &triangles,
+                           size_t targetCount,
+                           float *error=nullptr);
+
+//stores levels of detail on the mesh, each with ratio times the triangles
+//of the previous one. Stops early when a level would be smaller than
+//minTriangles or the mesh does not get any simpler
+void generateLODs(MeshData *mesh, int levels, float ratio, size_t minTriangles=64);
+
+}
+}
+
+#endif
@@ -41,8 +41,46 @@ PROPERTY_TYPE_INFO(CameraPtr, "TRANSFORMABLE");
 
 PROPERTY_TYPE_INFO(Polygon, "POLYGON");
 
+IO::OutStream& IO::operator<<(IO::OutStream &stream, const PolygonList &polygons)
+{
+    std::vector<uint> sizes;
+    sizes.reserve(polygons.size());
+    size_t indexCount = 0;
+    for(const auto &polygon : polygons) {
+        sizes.push_back(polygon.size());
+        indexCount += polygon.size();
+    }
+
+    std::vector<uint> indices;
+    indices.reserve(indexCount);
+    for(const auto &polygon : polygons)
+        indices.insert(end(indices), begin(polygon), end(polygon));
+
+    stream << sizes << indices;
+    return stream;
+}
+
+IO::InStream& IO::operator>>(IO::InStream &stream, PolygonList &polygons)
+{
+    std::vector<uint> sizes, indices;
+    stream >> sizes >> indices;
+
+    polygons.clear();
+    polygons.reserve(sizes.size());
+    auto it = begin(indices);
+    for(uint size : sizes) {
+        if(size > size_t(end(indices) - it)) {
+            std::cout << "polygon list is missing indices" << std::endl;
+            break;
+        }
+        polygons.emplace_back(it, it + size);
+        it += size;
+    }
+    return stream;
+}
+
 AbstractTransformable::AbstractTransformable(eObjType t)
-    : center(0, 0, 0), type(t), _parent(nullptr)
+    : center(0, 0, 0), type(t), _transformationVersion(0), _parent(nullptr)
 {
 }
 
@@ -52,11 +90,14 @@ AbstractTransformable::AbstractTransformable(const AbstractTransformable &other)
     _parent(other._parent),
     center(other.center),
     transformation(other.transformation),
+    _transformationVersion(0),
     _name(other._name)
 {
     //deep copy children
-    for (const auto &child : other._children)
+    for (const auto &child : other._children) {
         _children.push_back(child->clone());
+        _children.back()->_parent = this;
+    }
 }
 
 AbstractTransformable::~AbstractTransformable()
@@ -111,6 +152,7 @@ const AbstractTransformable* AbstractTransformable::getParent() const
 void AbstractTransformable::addChild(AbstractTransformablePtr obj)    
 {
     obj->_parent = this;
+    ++obj->_transformationVersion;
     _children.push_back(obj);
 }
 
@@ -150,6 +192,7 @@ void AbstractTransformable::setTransformation(glm::mat4 value)
 {
     std::lock_guard<std::mutex> lock(_transformationLock);
     transformation = value;
+    ++_transformationVersion;
 }
 
 glm::vec3 AbstractTransformable::getCenter()    
@@ -181,6 +224,7 @@ void AbstractTransformable::setPosition(glm::vec3 pos)
     {
         std::lock_guard<std::mutex> lock(_transformationLock);
         transformation[3] = glm::vec4(pos, 1);
+        ++_transformationVersion;
     }
 }
 
@@ -209,6 +253,7 @@ void AbstractTransformable::posAroundCenter(glm::vec3 newPos)
     {
         std::lock_guard<std::mutex> lock(_transformationLock);
         transformation = glm::inverse(mat);
+        ++_transformationVersion;
     }
 }
 
@@ -225,6 +270,7 @@ void AbstractTransformable::moveToCenter(double fac)
     {
         std::lock_guard<std::mutex> lock(_transformationLock);
         transformation = translation * transformation;
+        ++_transformationVersion;
     }
 }
 
@@ -242,6 +288,15 @@ void AbstractTransformable::applyTransform(glm::mat4 &transform)
 {
     std::lock_guard<std::mutex> lock(_transformationLock);
     transformation = transform * transformation;
+    ++_transformationVersion;
+}
+
+unsigned AbstractTransformable::getTransformationVersion() const
+{
+    //the counters only grow, so the sum changes with any of them
+    if(!_parent)
+        return _transformationVersion;
+    return _transformationVersion + _parent->getTransformationVersion();
 }
 
 glm::mat4 AbstractTransformable::getWorldTransformation() const
@@ -361,6 +416,30 @@ int MeshData::getPolygonCount() const
     return cnt;
 }
 
+void MeshData::setLODs(std::vector<LOD> lods)
+{
+    std::lock_guard<std::mutex> lock(_lodLock);
+    _lods = std::make_shared<const std::vector<LOD>>(std::move(lods));
+}
+
+std::shared_ptr<const std::vector<MeshData::LOD>> MeshData::getLODs() const
+{
+    std::lock_guard<std::mutex> lock(_lodLock);
+    return _lods;
+}
+
+void MeshData::setClusters(std::shared_ptr<const Clusters> clusters)
+{
+    std::lock_guard<std::mutex> lock(_lodLock);
+    _clusters = clusters;
+}
+
+std::shared_ptr<const MeshData::Clusters> MeshData::getClusters() const
+{
+    std::lock_guard<std::mutex> lock(_lodLock);
+    return _clusters;
+}
+
 GeoObject::GeoObject()
     : AbstractTransformable(GEO)
 {
@@ -494,7 +573,7 @@ void Group::setProperty(std::string name, Property prop)
 
 Camera::Camera()
     : AbstractTransformable(CAMERA), _fov(glm::radians(45.f)),
-    _near(.1), _far(10000), _width(0), _height(0), _aspect(1)
+    _near(.1), _far(10000), _orthoSize(0), _width(0), _height(0), _aspect(1)
 {
     setTransformation(glm::inverse(glm::lookAt(glm::vec3(0, 10, -10), glm::vec3(0), glm::vec3(0, 1, 0))));
 }
@@ -505,6 +584,7 @@ Camera::Camera(const Camera &other) :
     _aspect{other._aspect.load()},
     _near{other._near.load()},
     _far{other._far.load()},
+    _orthoSize{other._orthoSize.load()},
     _width{other._width.load()},
     _height{other._height.load()}
 
@@ -562,8 +642,33 @@ void Camera::setFar(double far)
     _far = far;
 }
 
+float Camera::getNear() const
+{
+    return _near;
+}
+
+float Camera::getFar() const
+{
+    return _far;
+}
+
+void Camera::setOrthographic(double size)
+{
+    _orthoSize = size;
+}
+
+bool Camera::isOrthographic() const
+{
+    return _orthoSize > 0;
+}
+
 glm::mat4 Camera::getProjection()
 {
+    float size = _orthoSize;
+    if(size > 0) {
+        float width = size * _aspect;
+        return glm::ortho(-width, width, -size, size, _near.load(), _far.load());
+    }
     return glm::perspective(_fov.load(), _aspect.load(), _near.load(), _far.load());
 }
 
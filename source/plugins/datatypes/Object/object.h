@@ -40,6 +40,14 @@ struct Polygon : public std::vector<uint> {
 typedef std::vector<Polygon> PolygonList;
 typedef std::shared_ptr<PolygonList> PolygonListPtr;
 
+namespace MindTree {
+namespace IO {
+//polygons are stored as an array of their sizes and one of all indices
+OutStream& operator<<(OutStream &stream, const PolygonList &polygons);
+InStream& operator>>(InStream &stream, PolygonList &polygons);
+}
+}
+
 class MeshData;
 class AbstractTransformable;
 typedef std::shared_ptr<AbstractTransformable> AbstractTransformablePtr;
@@ -64,6 +72,9 @@ public:
     glm::mat4 getTransformation();
     void setTransformation(glm::mat4 value);
     glm::mat4 getWorldTransformation() const;
+    //changes whenever the world transformation of this object may have
+    //changed, cheaper to compare than the matrices
+    unsigned getTransformationVersion() const;
     glm::vec3 getPosition();
     void setPosition(glm::vec3 pos);
     void setPosition(double x, double y, double z);
@@ -97,6 +108,7 @@ private:
 
     //cached for performance on deep hierarchies (skeletons)
     glm::mat4 worldTransform_;
+    std::atomic<unsigned> _transformationVersion;
     mutable std::mutex _transformationLock;
     std::mutex _centerLock;
 
@@ -168,8 +180,40 @@ public:
     int getVertexCount() const;
     int getPolygonCount() const;
 
+    //coarser versions of the mesh, ordered from fine to coarse. They index
+    //into the same vertices, error is the largest deviation from the full
+    //mesh in object space
+    struct LOD {
+        std::vector<uint> triangles;
+        float error;
+    };
+    void setLODs(std::vector<LOD> lods);
+    std::shared_ptr<const std::vector<LOD>> getLODs() const;
+
+    //small groups of neighbouring triangles that are culled on their own.
+    //The triangles of a cluster are consecutive in Clusters::triangles
+    struct Cluster {
+        uint firstTriangle;
+        uint triangleCount;
+        glm::vec3 center;
+        float radius;
+        //every triangle normal lies inside of the cone, a coneCos of 0 or
+        //less is too wide to ever face away from the camera
+        glm::vec3 coneAxis;
+        float coneCos;
+    };
+    struct Clusters {
+        std::vector<uint> triangles;
+        std::vector<Cluster> clusters;
+    };
+    void setClusters(std::shared_ptr<const Clusters> clusters);
+    std::shared_ptr<const Clusters> getClusters() const;
+
 private:
     std::string name;
+    std::shared_ptr<const std::vector<LOD>> _lods;
+    std::shared_ptr<const Clusters> _clusters;
+    mutable std::mutex _lodLock;
 };
 typedef std::shared_ptr<MeshData> MeshDataPtr;
 
@@ -249,9 +293,15 @@ public:
     void setAspect(double aspect);
     void setNear(double near);
     void setFar(double far);
+    float getNear() const;
+    float getFar() const;
     void setFov(double fov);
     float fov() const;
 
+    //half height of an orthographic view volume, 0 means perspective
+    void setOrthographic(double size);
+    bool isOrthographic() const;
+
     void setResolution(int width, int height);
     int getWidth() const;
     int getHeight() const;
@@ -262,6 +312,7 @@ private:
     std::atomic<float> _fov;
     std::atomic<float> _aspect;
     std::atomic<float> _near, _far;
+    std::atomic<float> _orthoSize;
 
     std::atomic<int> _width, _height;
 };
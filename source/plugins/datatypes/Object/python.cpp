@@ -5,6 +5,8 @@
 #include "data/properties.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "lights.h"
+#include "mesh_clusters.h"
+#include "mesh_simplification.h"
 #include "object.h"
 #include "skeleton.h"
 
@@ -251,11 +253,14 @@ void materialProcs()
         float diff_int = cache->getData(1).getData<double>();
         auto spec_int = cache->getData(2).getData<double>();
         auto spec_rough = cache->getData(3).getData<double>();
+        auto diff_tex = cache->getData(4).getData<std::string>();
 
         auto material = std::make_shared<DefaultMaterial>();
         material->setProperty("diffuse_color", diff_color * diff_int);
         material->setProperty("specular_intensity", spec_int);
         material->setProperty("specular_roughness", spec_rough);
+        if(!diff_tex.empty())
+            material->setProperty("diffuse_texture", diff_tex);
 
         cache->pushData(material);
     };
@@ -312,6 +317,48 @@ void objectProc(DataCache *cache)
     cache->pushData(obj);
 }
 
+void meshLODProc(DataCache *cache)
+{
+    auto data = cache->getData(0).getData<ObjectDataPtr>();
+    int levels = cache->getData(1).getData<int>();
+    double ratio = cache->getData(2).getData<double>();
+    if(!data || data->getType() != ObjectData::MESH) {
+        cache->pushData(data);
+        return;
+    }
+
+    //the input may be shared with other nodes, the vertex and polygon lists
+    //are shared with the copy
+    auto mesh = std::make_shared<MeshData>();
+    for(const auto &prop : data->getProperties())
+        mesh->setProperty(prop.first, prop.second);
+
+    mesh->setClusters(std::static_pointer_cast<MeshData>(data)->getClusters());
+
+    MeshSimplification::generateLODs(mesh.get(), levels, glm::clamp(ratio, .05, .95));
+    cache->pushData(std::static_pointer_cast<ObjectData>(mesh));
+}
+
+void meshClustersProc(DataCache *cache)
+{
+    auto data = cache->getData(0).getData<ObjectDataPtr>();
+    int maxTriangles = cache->getData(1).getData<int>();
+    if(!data || data->getType() != ObjectData::MESH) {
+        cache->pushData(data);
+        return;
+    }
+
+    auto source = std::static_pointer_cast<MeshData>(data);
+    auto mesh = std::make_shared<MeshData>();
+    for(const auto &prop : data->getProperties())
+        mesh->setProperty(prop.first, prop.second);
+    if(auto lods = source->getLODs())
+        mesh->setLODs(*lods);
+
+    MeshClusters::generateClusters(mesh.get(), glm::clamp(maxTriangles, 16, int(MeshClusters::MAX_TRIANGLES)));
+    cache->pushData(std::static_pointer_cast<ObjectData>(mesh));
+}
+
 void registerSkeleton()
 {
     auto jointProc = [](DataCache *cache) {
@@ -340,6 +387,11 @@ BOOST_PYTHON_MODULE(object){
     DataCache::addProcessor(new CacheProcessor("TRANSFORMABLE", "EMPTY",  emptyProc));
     DataCache::addProcessor(new CacheProcessor("TRANSFORMABLE", "CAMERA", cameraProc));
     DataCache::addProcessor(new CacheProcessor("TRANSFORMABLE", "OBJECTNODE", objectProc));
+    DataCache::addProcessor(new CacheProcessor("OBJECTDATA", "MESHLOD", meshLODProc));
+    DataCache::addProcessor(new CacheProcessor("OBJECTDATA", "MESHCLUSTERS", meshClustersProc));
+
+    IO::Input::registerReader<VertexListPtr>();
+    IO::Input::registerReader<PolygonListPtr>();
 
     NodeDataBase::setNotConvertible("TRANSFORMABLE");
 
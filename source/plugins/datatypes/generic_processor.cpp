@@ -26,6 +26,11 @@ BOOST_PYTHON_MODULE(generic_processor)
     IO::Input::registerReader<glm::vec2>();
     IO::Input::registerReader<glm::ivec2>();
     IO::Input::registerReader<glm::vec4>();
+    //int and uint8_t are both INTEGER, float and double are both FLOAT
+    IO::Input::registerListReader<std::vector<int>, std::vector<uint8_t>>();
+    IO::Input::registerListReader<std::vector<double>, std::shared_ptr<std::vector<float>>>();
+    IO::Input::registerReader<std::vector<glm::vec2>>();
+    IO::Input::registerReader<std::vector<glm::vec4>>();
 
     DataCache::addProcessor(new CacheProcessor("FLOAT", "FLOATVALUE", values));
     DataCache::addProcessor(new CacheProcessor("STRING", "STRINGVALUE", values));
@@ -16,6 +16,35 @@ class Export3D(MT.pytypes.NodeDecorator):
     insockets = [ ("Filepath", "SAVEFILE"), ("Scene", "TRANSFORMABLE") ]
     outsockets = [("Export", "ACTION")]
 
+class ImportPointCloud(MT.pytypes.NodeDecorator):
+    type="POINTCLOUDIMPORT"
+    label="Objects.Import Point Cloud"
+    insockets = [ ("Filepath", "DIRECTORY"),
+                  ("Transformation", "MAT4"),
+                  ("Stride", "INTEGER", 1),
+                  ("Voxel Size", "FLOAT", 0.0)]
+    outsockets = [("Point Cloud", "TRANSFORMABLE")]
+
+class BakeGeometryCache(MT.pytypes.NodeDecorator):
+    type="GEOCACHEWRITE"
+    label="Objects.Bake Geometry Cache"
+    insockets = [ ("Filepath", "SAVEFILE"),
+                  ("Scene", "TRANSFORMABLE"),
+                  ("Start", "INTEGER", 1),
+                  ("End", "INTEGER", 100)]
+    outsockets = [("Bake", "ACTION")]
+
+class ReadGeometryCache(MT.pytypes.NodeDecorator):
+    type="GEOCACHEREAD"
+    label="Objects.Read Geometry Cache"
+    insockets = [ ("Filepath", "DIRECTORY"),
+                  ("Frame", "INTEGER", 1),
+                  ("Transformation", "MAT4")]
+    outsockets = [("Scene", "TRANSFORMABLE")]
+
 MT.registerNode(Import3D)
 MT.registerNode(Export3D)
+MT.registerNode(ImportPointCloud)
+MT.registerNode(BakeGeometryCache)
+MT.registerNode(ReadGeometryCache)
     
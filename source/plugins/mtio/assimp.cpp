@@ -4,9 +4,29 @@
 
 using namespace MindTree;
 
+namespace {
+class ProgressReporter : public Assimp::ProgressHandler
+{
+public:
+    ProgressReporter(std::function<void(float)> progress) : progress_(progress) {}
+
+    //negative percentages mean assimp does not know
+    bool Update(float percentage) override
+    {
+        if(percentage >= 0) progress_(percentage);
+        return true;
+    }
+
+private:
+    std::function<void(float)> progress_;
+};
+}
+
 AbstractTransformablePtr AssimpImporter::import()
 {
 	Assimp::Importer importer;
+	//the importer owns the handler
+	if(progress_) importer.SetProgressHandler(new ProgressReporter(progress_));
 
 	auto flags = aiProcess_JoinIdenticalVertices
 		| aiProcess_GenSmoothNormals
@@ -15,6 +35,11 @@ AbstractTransformablePtr AssimpImporter::import()
 		| aiProcess_FindInstances;
 
 	auto *scene = importer.ReadFile(filename_, flags);
+	if(!scene) {
+		std::cout << "could not import " << filename_ << ": "
+			<< importer.GetErrorString() << std::endl;
+		return nullptr;
+	}
 
 	meshes_.reserve(scene->mNumMeshes);
 	for(int i = 0; i < scene->mNumMeshes; ++i) {
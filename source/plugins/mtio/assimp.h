@@ -4,12 +4,16 @@
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/ProgressHandler.hpp>
+#include <functional>
 
 namespace MindTree {
 class AssimpImporter
 {
 public:
-    AssimpImporter(std::string filename) : filename_(filename) {}
+    //progress is called with the fraction of the file that is read
+    AssimpImporter(std::string filename, std::function<void(float)> progress=nullptr)
+        : filename_(filename), progress_(progress) {}
 	AbstractTransformablePtr import();
 
 private:
@@ -37,6 +41,7 @@ private:
     };
 
     std::string filename_;
+    std::function<void(float)> progress_;
     std::vector<MeshInfo> meshes_;
     std::vector<MaterialPtr> materials_;
 };
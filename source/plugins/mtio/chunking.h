@@ -0,0 +1,69 @@
+#ifndef MT_CHUNKING_H
+#define MT_CHUNKING_H
+
+#include "thread"
+#include "atomic"
+#include "functional"
+#include "algorithm"
+#include "vector"
+
+#include "number_parsing.h"
+
+//splitting of mapped geometry files and meshes into ranges that are
+//decoded or encoded on a thread each
+namespace MindTree {
+namespace Chunking {
+
+//below this many bytes per chunk starting threads does not pay off
+const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+//how many chunks that many bytes are split into, at most one per core
+inline size_t countChunks(size_t bytes)
+{
+    return std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(),
+                                                 bytes / MIN_CHUNK_SIZE));
+}
+
+//returns the count + 1 bounds of chunks of about the same size, every chunk
+//but the first starts right after a line end
+inline std::vector<const char*> splitLines(const char *begin, const char *end, size_t count)
+{
+    std::vector<const char*> bounds{begin};
+    for(size_t i = 1; i < count; ++i)
+        bounds.push_back(std::max(NumberParsing::skipLine(begin + (end - begin) * i / count, end),
+                                  bounds.back()));
+    bounds.push_back(end);
+    return bounds;
+}
+
+//runs f(0) to f(count - 1) on a thread each
+template<typename F>
+void parallelFor(size_t count, F f)
+{
+    std::vector<std::thread> threads;
+    for(size_t i = 1; i < count; ++i) threads.emplace_back(f, i);
+    if(count) f(0);
+    for(auto &thread : threads) thread.join();
+}
+
+//runs the tasks on as many threads as there are cores
+inline void runParallel(const std::vector<std::function<void()>> &tasks)
+{
+    std::atomic<size_t> next{0};
+    auto work = [&] {
+        for(size_t i = next++; i < tasks.size(); i = next++)
+            tasks[i]();
+    };
+
+    size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u),
+                                          tasks.size());
+    std::vector<std::thread> threads;
+    for(size_t i = 1; i < threadCount; ++i) threads.emplace_back(work);
+    work();
+    for(auto &thread : threads) thread.join();
+}
+
+}
+}
+
+#endif
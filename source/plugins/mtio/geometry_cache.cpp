@@ -0,0 +1,456 @@
+#include "cstring"
+#include "cstdio"
+#include "list"
+#include "algorithm"
+
+#include "data/io.h"
+
+#include "geometry_cache.h"
+
+using namespace MindTree;
+
+namespace {
+    struct CachedMesh {
+        std::string name;
+        glm::mat4 transformation;
+        MeshDataPtr data;
+        VertexListPtr P;
+    };
+
+    void collect(const AbstractTransformablePtr &object, std::vector<CachedMesh> &meshes)
+    {
+        if(object->getType() == AbstractTransformable::GEO) {
+            auto obj = std::static_pointer_cast<GeoObject>(object);
+            auto data = std::dynamic_pointer_cast<MeshData>(obj->getData());
+            if(data && data->hasProperty("P")
+               && data->getProperty("P").getType() == PropertyTypeInfo<VertexListPtr>::getType()) {
+                meshes.push_back({obj->getName(),
+                                 obj->getWorldTransformation(),
+                                 data,
+                                 data->getProperty("P").getData<VertexListPtr>()});
+            }
+        }
+
+        for(const auto &child : object->getChildren())
+            collect(child, meshes);
+    }
+
+    //decides whether a column changed since the last frame, the data is
+    //mixed in eight bytes at a time
+    uint64_t hashBytes(const void *data, size_t size)
+    {
+        const char *bytes = static_cast<const char*>(data);
+        uint64_t hash = 0xcbf29ce484222325ull ^ size;
+        size_t i = 0;
+        for(; i + 8 <= size; i += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, 8);
+            hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+            hash ^= hash >> 32;
+        }
+        for(; i < size; ++i)
+            hash = (hash ^ static_cast<uint8_t>(bytes[i])) * 0x100000001b3ull;
+        return hash;
+    }
+
+    uint64_t align(uint64_t offset)
+    {
+        return (offset + MTMesh::ALIGNMENT - 1) / MTMesh::ALIGNMENT * MTMesh::ALIGNMENT;
+    }
+
+    size_t elementSize(MTMesh::ColumnType type)
+    {
+        return type == MTMesh::UINT8 ? 1 : 4;
+    }
+}
+
+GeometryCacheWriter::GeometryCacheWriter(std::string filename) :
+    _filename(filename),
+    _stream(filename, std::ios::binary | std::ios::trunc),
+    _offset(0),
+    _constantTopology(true),
+    _meshCount(0)
+{
+    if(!_stream) {
+        std::cout << "could not open " << filename << std::endl;
+        return;
+    }
+
+    //the header is written again with the index when the cache is closed
+    MTCache::FileHeader header{};
+    std::memcpy(header.magic, MTCache::MAGIC, sizeof(header.magic));
+    header.version = MTCache::VERSION;
+    write(&header, sizeof(header));
+}
+
+GeometryCacheWriter::~GeometryCacheWriter()
+{
+    close();
+}
+
+bool GeometryCacheWriter::isOpen() const
+{
+    return _stream.is_open() && _stream.good();
+}
+
+void GeometryCacheWriter::write(const void *data, size_t size)
+{
+    _stream.write(static_cast<const char*>(data), size);
+    _offset += size;
+}
+
+void GeometryCacheWriter::pad()
+{
+    static const char zeros[MTMesh::ALIGNMENT] = {};
+    write(zeros, align(_offset) - _offset);
+}
+
+bool GeometryCacheWriter::writeFrame(int frame, const AbstractTransformablePtr &object)
+{
+    if(!isOpen()) return false;
+
+    std::vector<CachedMesh> meshes;
+    if(object) collect(object, meshes);
+
+    //polygons and byte lists are only copies, lists keep them in place
+    std::list<std::vector<uint32_t>> polygonColumns;
+    std::list<std::vector<uint8_t>> byteColumns;
+    std::vector<std::vector<Column>> columns(meshes.size());
+    for(size_t m = 0; m < meshes.size(); ++m) {
+        for(const auto &property : meshes[m].data->getProperties()) {
+            const std::string &name = property.first;
+            const Property &prop = property.second;
+            if(prop.getType() == PropertyTypeInfo<VertexListPtr>::getType()) {
+                auto list = prop.getData<VertexListPtr>();
+                if(list) columns[m].push_back({name, MTMesh::FLOAT32, 3, list->size(),
+                                               list->data(), list->size() * sizeof(glm::vec3), 0});
+            }
+            else if(prop.getType() == PropertyTypeInfo<std::shared_ptr<std::vector<float>>>::getType()) {
+                auto list = prop.getData<std::shared_ptr<std::vector<float>>>();
+                if(list) columns[m].push_back({name, MTMesh::FLOAT32, 1, list->size(),
+                                               list->data(), list->size() * sizeof(float), 0});
+            }
+            else if(prop.getType() == PropertyTypeInfo<std::vector<uint8_t>>::getType()) {
+                byteColumns.push_back(prop.getData<std::vector<uint8_t>>());
+                const auto &list = byteColumns.back();
+                columns[m].push_back({name, MTMesh::UINT8, 1, list.size(), list.data(), list.size(), 0});
+            }
+            else if(name == "polygon" && prop.getType() == PropertyTypeInfo<PolygonListPtr>::getType()) {
+                auto polygons = prop.getData<PolygonListPtr>();
+                if(!polygons) continue;
+                polygonColumns.emplace_back();
+                auto &sizes = polygonColumns.back();
+                polygonColumns.emplace_back();
+                auto &indices = polygonColumns.back();
+                sizes.reserve(polygons->size());
+                for(const auto &polygon : *polygons) {
+                    sizes.push_back(polygon.size());
+                    indices.insert(indices.end(), polygon.begin(), polygon.end());
+                }
+                columns[m].push_back({"polygon.sizes", MTMesh::UINT32, 1, sizes.size(),
+                                      sizes.data(), sizes.size() * sizeof(uint32_t), 0});
+                columns[m].push_back({"polygon.indices", MTMesh::UINT32, 1, indices.size(),
+                                      indices.data(), indices.size() * sizeof(uint32_t), 0});
+            }
+        }
+        for(auto &column : columns[m])
+            column.hash = hashBytes(column.data, column.bytes);
+    }
+
+    pad();
+    uint64_t frameOffset = _offset;
+
+    //tables and names first, then the columns that changed
+    uint64_t offset = frameOffset + sizeof(MTMesh::FileHeader) + meshes.size() * sizeof(MTMesh::MeshRecord);
+    std::vector<MTMesh::MeshRecord> meshRecords(meshes.size());
+    for(size_t m = 0; m < meshes.size(); ++m) {
+        meshRecords[m].columnTableOffset = offset;
+        meshRecords[m].columnCount = columns[m].size();
+        offset += columns[m].size() * sizeof(MTMesh::ColumnRecord);
+    }
+
+    std::string names;
+    uint64_t namesOffset = offset;
+    std::vector<std::vector<MTMesh::ColumnRecord>> columnRecords(meshes.size());
+    for(size_t m = 0; m < meshes.size(); ++m) {
+        auto &record = meshRecords[m];
+        record.nameOffset = namesOffset + names.size();
+        record.nameLength = meshes[m].name.size();
+        names += meshes[m].name;
+        record.vertexCount = meshes[m].P->size();
+        record.polygonCount = 0;
+        std::memcpy(record.transformation, &meshes[m].transformation[0][0], sizeof(record.transformation));
+
+        for(const auto &column : columns[m]) {
+            MTMesh::ColumnRecord columnRecord;
+            columnRecord.nameOffset = namesOffset + names.size();
+            columnRecord.nameLength = column.name.size();
+            names += column.name;
+            columnRecord.type = column.type;
+            columnRecord.components = column.components;
+            columnRecord.reserved = 0;
+            columnRecord.count = column.count;
+            columnRecord.offset = 0;
+            if(column.name == "polygon.sizes") record.polygonCount = column.count;
+            columnRecords[m].push_back(columnRecord);
+        }
+    }
+    offset += names.size();
+
+    bool firstFrame = _frames.empty();
+    if(!firstFrame && meshes.size() != _meshCount) _constantTopology = false;
+    _meshCount = meshes.size();
+
+    std::vector<const Column*> changed;
+    for(size_t m = 0; m < meshes.size(); ++m) {
+        for(size_t c = 0; c < columns[m].size(); ++c) {
+            const Column &column = columns[m][c];
+            auto &written = _written[std::make_pair(m, column.name)];
+            if(!firstFrame && written.offset && written.hash == column.hash && written.bytes == column.bytes) {
+                columnRecords[m][c].offset = written.offset;
+                continue;
+            }
+
+            if(!firstFrame && column.name.compare(0, 8, "polygon.") == 0)
+                _constantTopology = false;
+
+            offset = align(offset);
+            columnRecords[m][c].offset = offset;
+            written = {column.hash, column.bytes, offset};
+            offset += column.bytes;
+            changed.push_back(&column);
+        }
+    }
+
+    MTMesh::FileHeader header;
+    std::memcpy(header.magic, MTMesh::MAGIC, sizeof(header.magic));
+    header.version = MTMesh::VERSION;
+    header.meshCount = meshes.size();
+    write(&header, sizeof(header));
+    write(meshRecords.data(), meshRecords.size() * sizeof(MTMesh::MeshRecord));
+    for(const auto &records : columnRecords)
+        write(records.data(), records.size() * sizeof(MTMesh::ColumnRecord));
+    write(names.data(), names.size());
+    for(const Column *column : changed) {
+        pad();
+        write(column->data, column->bytes);
+    }
+
+    _frames[frame] = frameOffset;
+    if(!_stream) {
+        std::cout << "writing frame " << frame << " to " << _filename << " failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool GeometryCacheWriter::close()
+{
+    if(!_stream.is_open()) return false;
+
+    MTCache::FileHeader header{};
+    std::memcpy(header.magic, MTCache::MAGIC, sizeof(header.magic));
+    header.version = MTCache::VERSION;
+    if(!_frames.empty()) {
+        header.firstFrame = _frames.begin()->first;
+        header.frameCount = _frames.rbegin()->first - header.firstFrame + 1;
+    }
+    header.flags = _constantTopology && _frames.size() > 1 ? uint32_t(MTCache::CONSTANT_TOPOLOGY) : 0u;
+
+    //frames that were never written have no block
+    std::vector<uint64_t> index(header.frameCount, 0);
+    for(const auto &frame : _frames)
+        index[frame.first - header.firstFrame] = frame.second;
+
+    pad();
+    header.indexOffset = _offset;
+    write(index.data(), index.size() * sizeof(uint64_t));
+    _stream.seekp(0);
+    _stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    bool success = static_cast<bool>(_stream);
+    _stream.close();
+    if(!success) std::cout << "could not finish " << _filename << std::endl;
+    return success;
+}
+
+void GeometryCacheWriter::discard()
+{
+    if(!_stream.is_open()) return;
+
+    _stream.close();
+    std::remove(_filename.c_str());
+}
+
+GeometryCacheReader::GeometryCacheReader(std::string filename) :
+    _file(std::make_shared<IO::MappedFile>(filename)),
+    _header{},
+    _index(nullptr)
+{
+    if(!_file->isOpen()) {
+        std::cout << "could not open " << filename << std::endl;
+        return;
+    }
+
+    const auto *header = at<MTCache::FileHeader>(0);
+    if(!header || std::memcmp(header->magic, MTCache::MAGIC, sizeof(header->magic)) != 0) {
+        std::cout << filename << " is not a geometry cache" << std::endl;
+        return;
+    }
+    if(header->version > MTCache::VERSION) {
+        std::cout << filename << " was written by a newer version" << std::endl;
+        return;
+    }
+    if(!header->indexOffset) {
+        std::cout << filename << " was not finished" << std::endl;
+        return;
+    }
+
+    _index = at<uint64_t>(header->indexOffset, header->frameCount);
+    if(_index) _header = *header;
+}
+
+GeometryCacheReader::~GeometryCacheReader()
+{
+}
+
+template<typename T>
+const T* GeometryCacheReader::at(uint64_t offset, size_t count) const
+{
+    if(offset > _file->size() || count * sizeof(T) > _file->size() - offset)
+        return nullptr;
+    return reinterpret_cast<const T*>(_file->data() + offset);
+}
+
+bool GeometryCacheReader::isOpen() const
+{
+    return _index != nullptr;
+}
+
+int GeometryCacheReader::firstFrame() const
+{
+    return _header.firstFrame;
+}
+
+int GeometryCacheReader::lastFrame() const
+{
+    return _header.firstFrame + static_cast<int>(_header.frameCount) - 1;
+}
+
+bool GeometryCacheReader::hasConstantTopology() const
+{
+    return _header.flags & MTCache::CONSTANT_TOPOLOGY;
+}
+
+AbstractTransformablePtr GeometryCacheReader::readFrame(int frame)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if(!isOpen() || !_header.frameCount) return nullptr;
+
+    //frames that were skipped while baking hold the frame before them
+    size_t i = std::max(firstFrame(), std::min(lastFrame(), frame)) - firstFrame();
+    while(i > 0 && !_index[i]) --i;
+    uint64_t offset = _index[i];
+    const auto *header = offset ? at<MTMesh::FileHeader>(offset) : nullptr;
+    if(!header) return nullptr;
+
+    const auto *meshRecords = at<MTMesh::MeshRecord>(offset + sizeof(MTMesh::FileHeader), header->meshCount);
+    if(!meshRecords) return nullptr;
+
+    auto name = [this] (uint64_t offset, uint32_t length) {
+        const char *chars = at<char>(offset, length);
+        return chars ? std::string(chars, length) : std::string();
+    };
+
+    std::map<uint64_t, Property> columns;
+    std::map<std::pair<uint64_t, uint64_t>, Property> polygons;
+    std::vector<AbstractTransformablePtr> objects;
+    for(uint32_t m = 0; m < header->meshCount; ++m) {
+        const auto &meshRecord = meshRecords[m];
+        const auto *columnRecords = at<MTMesh::ColumnRecord>(meshRecord.columnTableOffset, meshRecord.columnCount);
+        if(!columnRecords) return nullptr;
+
+        auto mesh = std::make_shared<MeshData>();
+        const MTMesh::ColumnRecord *sizes = nullptr, *indices = nullptr;
+        for(uint32_t c = 0; c < meshRecord.columnCount; ++c) {
+            const auto &column = columnRecords[c];
+            std::string columnName = name(column.nameOffset, column.nameLength);
+            if(columnName == "polygon.sizes") { sizes = &column; continue; }
+            if(columnName == "polygon.indices") { indices = &column; continue; }
+
+            //unchanged columns share the property of the last frame
+            auto cached = _columns.find(column.offset);
+            if(cached != _columns.end()) {
+                mesh->setProperty(columnName, cached->second);
+                columns[column.offset] = cached->second;
+                continue;
+            }
+
+            const char *data = at<char>(column.offset, column.count * column.components * elementSize(column.type));
+            if(!data) return nullptr;
+
+            Property prop;
+            if(column.type == MTMesh::FLOAT32 && column.components == 3) {
+                auto list = std::make_shared<VertexList>(column.count);
+                std::memcpy(list->data(), data, column.count * sizeof(glm::vec3));
+                prop = Property(list);
+            }
+            else if(column.type == MTMesh::FLOAT32 && column.components == 1) {
+                auto list = std::make_shared<std::vector<float>>(column.count);
+                std::memcpy(list->data(), data, column.count * sizeof(float));
+                prop = Property(list);
+            }
+            else if(column.type == MTMesh::UINT8) {
+                prop = Property(std::vector<uint8_t>(data, data + column.count * column.components));
+            }
+            else {
+                continue;
+            }
+            mesh->setProperty(columnName, prop);
+            columns[column.offset] = prop;
+        }
+
+        if(sizes && indices) {
+            auto key = std::make_pair(sizes->offset, indices->offset);
+            auto cached = _polygons.find(key);
+            if(cached != _polygons.end()) {
+                mesh->setProperty("polygon", cached->second);
+                polygons[key] = cached->second;
+            }
+            else {
+                const auto *polygonSizes = at<uint32_t>(sizes->offset, sizes->count);
+                const auto *polygonIndices = at<uint32_t>(indices->offset, indices->count);
+                if(!polygonSizes || !polygonIndices) return nullptr;
+
+                auto list = std::make_shared<PolygonList>(sizes->count);
+                uint64_t next = 0;
+                for(uint64_t i = 0; i < sizes->count; ++i) {
+                    if(polygonSizes[i] > indices->count - next) return nullptr;
+                    (*list)[i].assign(polygonIndices + next, polygonIndices + next + polygonSizes[i]);
+                    next += polygonSizes[i];
+                }
+                Property prop(list);
+                mesh->setProperty("polygon", prop);
+                polygons[key] = prop;
+            }
+        }
+
+        auto obj = std::make_shared<GeoObject>();
+        obj->setName(name(meshRecord.nameOffset, meshRecord.nameLength));
+        obj->setData(mesh);
+        glm::mat4 transformation;
+        std::memcpy(&transformation[0][0], meshRecord.transformation, sizeof(meshRecord.transformation));
+        obj->setTransformation(transformation);
+        objects.push_back(obj);
+    }
+
+    //only the columns of this frame can be shared with the next one
+    _columns.swap(columns);
+    _polygons.swap(polygons);
+
+    if(objects.size() == 1) return objects[0];
+
+    auto empty = std::make_shared<Empty>();
+    empty->addChildren(objects);
+    return empty;
+}
@@ -0,0 +1,118 @@
+#ifndef MT_GEOMETRY_CACHE_H
+#define MT_GEOMETRY_CACHE_H
+
+#include "string"
+#include "vector"
+#include "map"
+#include "mutex"
+#include "fstream"
+#include "cstdint"
+#include "mesh_export.h"
+
+namespace MindTree {
+namespace IO {
+class MappedFile;
+}
+
+//the mtcache format stores one block per frame in the mtmesh layout, with
+//column offsets relative to the start of the file. A column that did not
+//change since the previous frame is not written again, its record points at
+//the data of the earlier frame. The index at the end maps every frame to its
+//block, the header is only complete once the index is written
+namespace MTCache {
+const char MAGIC[8] = {'M', 'T', 'C', 'A', 'C', 'H', 'E', 0};
+const uint32_t VERSION = 1;
+
+enum Flags : uint32_t {
+    //every frame has the same polygons
+    CONSTANT_TOPOLOGY = 1
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t firstFrame;
+    uint32_t frameCount;
+    uint32_t flags;
+    //0 while the cache is being written
+    uint64_t indexOffset;
+};
+}
+
+class GeometryCacheWriter
+{
+public:
+    GeometryCacheWriter(std::string filename);
+    ~GeometryCacheWriter();
+
+    bool isOpen() const;
+
+    //frames can come in any order, a frame that is written twice uses the
+    //later block
+    bool writeFrame(int frame, const AbstractTransformablePtr &object);
+
+    //writes the index, the cache can not be read before
+    bool close();
+
+    //stops writing without an index and removes the unfinished file
+    void discard();
+
+private:
+    struct Column {
+        std::string name;
+        MTMesh::ColumnType type;
+        uint32_t components;
+        uint64_t count;
+        const void *data;
+        size_t bytes;
+        uint64_t hash;
+    };
+
+    struct WrittenColumn {
+        uint64_t hash;
+        size_t bytes;
+        uint64_t offset;
+    };
+
+    void write(const void *data, size_t size);
+    void pad();
+
+    std::string _filename;
+    std::ofstream _stream;
+    uint64_t _offset;
+    std::map<int, uint64_t> _frames;
+    //what was written for mesh and column name
+    std::map<std::pair<size_t, std::string>, WrittenColumn> _written;
+    bool _constantTopology;
+    uint32_t _meshCount;
+};
+
+class GeometryCacheReader
+{
+public:
+    GeometryCacheReader(std::string filename);
+    ~GeometryCacheReader();
+
+    bool isOpen() const;
+    int firstFrame() const;
+    int lastFrame() const;
+    bool hasConstantTopology() const;
+
+    //frames outside the cached range are clamped. Columns that are shared
+    //with the previously read frame are not read again
+    AbstractTransformablePtr readFrame(int frame);
+
+private:
+    template<typename T> const T* at(uint64_t offset, size_t count=1) const;
+
+    std::shared_ptr<const IO::MappedFile> _file;
+    MTCache::FileHeader _header;
+    const uint64_t *_index;
+    //properties of the last frame by the offsets of their columns
+    std::map<uint64_t, Property> _columns;
+    std::map<std::pair<uint64_t, uint64_t>, Property> _polygons;
+    std::mutex _mutex;
+};
+}
+
+#endif
@@ -0,0 +1,467 @@
+#include "chrono"
+#include "functional"
+#include "algorithm"
+#include "cstring"
+#include "cerrno"
+#include "sstream"
+#include "list"
+#include "fcntl.h"
+#include "unistd.h"
+#include "glm/glm.hpp"
+#include "chunking.h"
+
+#include "mesh_export.h"
+
+using namespace MindTree;
+using namespace MindTree::Chunking;
+
+namespace {
+    //meshes are split into ranges of this many vertices or polygons
+    const size_t RANGE_SIZE = 1 << 18;
+    //a range is encoded into a buffer of this size before it is written
+    const size_t BUFFER_SIZE = 1 << 22;
+
+    uint64_t align(uint64_t offset)
+    {
+        return (offset + MTMesh::ALIGNMENT - 1) / MTMesh::ALIGNMENT * MTMesh::ALIGNMENT;
+    }
+
+    bool isLittleEndian()
+    {
+        const uint16_t one = 1;
+        return *reinterpret_cast<const uint8_t*>(&one) == 1;
+    }
+
+    template<typename T>
+    std::shared_ptr<T> getColumn(const MeshDataPtr &data, const std::string &name)
+    {
+        if(!data->hasProperty(name)) return nullptr;
+        Property prop = data->getProperty(name);
+        if(prop.getType() != PropertyTypeInfo<std::shared_ptr<T>>::getType()) return nullptr;
+        return prop.getData<std::shared_ptr<T>>();
+    }
+
+    uint8_t toByte(float value)
+    {
+        return static_cast<uint8_t>(std::max(0.f, std::min(1.f, value)) * 255 + .5f);
+    }
+}
+
+//writes to fixed offsets of a file, from several threads at once
+class MeshExporter::OutputFile
+{
+public:
+    OutputFile(const std::string &filename) :
+        _fd(open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)), _failed(false)
+    {
+        if(_fd < 0) std::cout << "could not open " << filename << std::endl;
+    }
+
+    ~OutputFile()
+    {
+        if(_fd >= 0) close(_fd);
+    }
+
+    bool isOpen() const { return _fd >= 0; }
+    bool failed() const { return _failed; }
+
+    void write(uint64_t offset, const void *data, size_t size)
+    {
+        const char *bytes = static_cast<const char*>(data);
+        while(size && !_failed) {
+            ssize_t written = pwrite(_fd, bytes, size, offset);
+            if(written < 0 && errno == EINTR) continue;
+            if(written <= 0) {
+                std::cout << "writing failed: " << std::strerror(errno) << std::endl;
+                _failed = true;
+                return;
+            }
+            bytes += written;
+            offset += written;
+            size -= written;
+        }
+    }
+
+private:
+    int _fd;
+    std::atomic<bool> _failed;
+};
+
+namespace {
+    //collects small writes into one large one
+    class BufferedWriter
+    {
+    public:
+        typedef std::function<void(uint64_t, const void*, size_t)> WriteFunction;
+
+        BufferedWriter(WriteFunction write, uint64_t offset) :
+            _write(write), _offset(offset)
+        {
+            _buffer.reserve(BUFFER_SIZE);
+        }
+
+        ~BufferedWriter()
+        {
+            flush();
+        }
+
+        template<typename T>
+        void put(const T &value)
+        {
+            append(&value, sizeof(T));
+        }
+
+        void append(const void *data, size_t size)
+        {
+            if(_buffer.size() + size > BUFFER_SIZE) flush();
+            if(size >= BUFFER_SIZE) {
+                _write(_offset, data, size);
+                _offset += size;
+                return;
+            }
+            const char *bytes = static_cast<const char*>(data);
+            _buffer.insert(_buffer.end(), bytes, bytes + size);
+        }
+
+        void flush()
+        {
+            if(_buffer.empty()) return;
+            _write(_offset, _buffer.data(), _buffer.size());
+            _offset += _buffer.size();
+            _buffer.clear();
+        }
+
+    private:
+        WriteFunction _write;
+        uint64_t _offset;
+        std::vector<char> _buffer;
+    };
+}
+
+struct MeshExporter::Mesh {
+    std::string name;
+    glm::mat4 transformation;
+    MeshDataPtr data;
+    VertexListPtr P, N, C, UV;
+    PolygonListPtr polygons;
+};
+
+MeshExporter::MeshExporter(std::string filename) :
+    _filename(filename)
+{
+}
+
+MeshExporter::~MeshExporter()
+{
+}
+
+bool MeshExporter::canExport(const std::string &filename)
+{
+    auto dot = filename.rfind('.');
+    if(dot == std::string::npos) return false;
+
+    std::string extension = filename.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "ply" || extension == "mtmesh";
+}
+
+bool MeshExporter::exportObject(const AbstractTransformablePtr &object)
+{
+    auto start = std::chrono::steady_clock::now();
+    _meshes.clear();
+    if(object) collect(object);
+
+    OutputFile file(_filename);
+    if(!file.isOpen()) return false;
+
+    std::string extension = _filename.substr(_filename.rfind('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    bool success = extension == "ply" ? writePLY(file) : writeMTMesh(file);
+    success = success && !file.failed();
+
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    std::cout << (success ? "exported " : "failed to export ") << _meshes.size()
+        << " meshes to " << _filename << " in " << seconds.count() << "s" << std::endl;
+    _meshes.clear();
+    return success;
+}
+
+void MeshExporter::collect(const AbstractTransformablePtr &object)
+{
+    if(object->getType() == AbstractTransformable::GEO) {
+        auto obj = std::static_pointer_cast<GeoObject>(object);
+        auto data = std::dynamic_pointer_cast<MeshData>(obj->getData());
+        auto P = data ? getColumn<VertexList>(data, "P") : nullptr;
+        if(P) {
+            Mesh mesh;
+            mesh.name = obj->getName();
+            mesh.data = data;
+            mesh.P = P;
+            //columns that do not match the vertices would be read past their end
+            auto vertexColumn = [&](const std::string &name) {
+                auto column = getColumn<VertexList>(data, name);
+                return column && column->size() == P->size() ? column : nullptr;
+            };
+            mesh.N = vertexColumn("N");
+            mesh.C = vertexColumn("C");
+            mesh.UV = vertexColumn("UV");
+            mesh.polygons = getColumn<PolygonList>(data, "polygon");
+            mesh.transformation = obj->getWorldTransformation();
+            _meshes.push_back(mesh);
+        }
+    }
+
+    for(const auto &child : object->getChildren())
+        collect(child);
+}
+
+bool MeshExporter::writePLY(OutputFile &file)
+{
+    bool hasNormals = false, hasColors = false, hasUVs = false;
+    size_t vertexCount = 0, polygonCount = 0, maxPolygonSize = 0;
+    std::vector<size_t> firstVertex;
+    for(const auto &mesh : _meshes) {
+        hasNormals = hasNormals || mesh.N;
+        hasColors = hasColors || mesh.C;
+        hasUVs = hasUVs || mesh.UV;
+        firstVertex.push_back(vertexCount);
+        vertexCount += mesh.P->size();
+        if(!mesh.polygons) continue;
+        polygonCount += mesh.polygons->size();
+        for(const auto &polygon : *mesh.polygons)
+            maxPolygonSize = std::max(maxPolygonSize, polygon.size());
+    }
+    bool byteSizes = maxPolygonSize < 256;
+
+    std::stringstream header;
+    header << "ply\n"
+        << "format " << (isLittleEndian() ? "binary_little_endian" : "binary_big_endian") << " 1.0\n"
+        << "comment exported from MindTree\n"
+        << "element vertex " << vertexCount << "\n"
+        << "property float x\nproperty float y\nproperty float z\n";
+    if(hasNormals) header << "property float nx\nproperty float ny\nproperty float nz\n";
+    if(hasColors) header << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    if(hasUVs) header << "property float s\nproperty float t\n";
+    if(polygonCount)
+        header << "element face " << polygonCount << "\n"
+            << "property list " << (byteSizes ? "uchar" : "int") << " int vertex_indices\n";
+    header << "end_header\n";
+    std::string headerString = header.str();
+    file.write(0, headerString.data(), headerString.size());
+
+    size_t vertexSize = 3 * sizeof(float)
+        + (hasNormals ? 3 * sizeof(float) : 0)
+        + (hasColors ? 3 : 0)
+        + (hasUVs ? 2 * sizeof(float) : 0);
+    uint64_t vertexStart = headerString.size();
+    uint64_t faceOffset = vertexStart + vertexCount * vertexSize;
+
+    auto write = [&file](uint64_t offset, const void *data, size_t size) {
+        file.write(offset, data, size);
+    };
+
+    std::vector<std::function<void()>> tasks;
+    for(size_t m = 0; m < _meshes.size(); ++m) {
+        const Mesh &mesh = _meshes[m];
+        glm::mat4 transformation = mesh.transformation;
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transformation)));
+
+        for(size_t first = 0; first < mesh.P->size(); first += RANGE_SIZE) {
+            size_t last = std::min(first + RANGE_SIZE, mesh.P->size());
+            uint64_t offset = vertexStart + (firstVertex[m] + first) * vertexSize;
+            tasks.push_back([=, &mesh] {
+                BufferedWriter out(write, offset);
+                for(size_t i = first; i < last; ++i) {
+                    glm::vec3 p(transformation * glm::vec4((*mesh.P)[i], 1));
+                    out.put(p);
+                    if(hasNormals) {
+                        glm::vec3 n = mesh.N ? normalMatrix * (*mesh.N)[i] : glm::vec3(0);
+                        float length = glm::length(n);
+                        out.put(length > 0 ? n / length : n);
+                    }
+                    if(hasColors) {
+                        glm::vec3 c = mesh.C ? (*mesh.C)[i] : glm::vec3(1);
+                        uint8_t rgb[3] = {toByte(c.x), toByte(c.y), toByte(c.z)};
+                        out.append(rgb, 3);
+                    }
+                    if(hasUVs) {
+                        glm::vec3 uv = mesh.UV ? (*mesh.UV)[i] : glm::vec3(0);
+                        float st[2] = {uv.x, uv.y};
+                        out.append(st, sizeof(st));
+                    }
+                }
+            });
+        }
+
+        if(!mesh.polygons) continue;
+        const PolygonList &polygons = *mesh.polygons;
+        int32_t indexOffset = static_cast<int32_t>(firstVertex[m]);
+        for(size_t first = 0; first < polygons.size(); first += RANGE_SIZE) {
+            size_t last = std::min(first + RANGE_SIZE, polygons.size());
+            uint64_t offset = faceOffset;
+            for(size_t i = first; i < last; ++i)
+                faceOffset += (byteSizes ? 1 : 4) + polygons[i].size() * 4;
+
+            tasks.push_back([=, &polygons] {
+                BufferedWriter out(write, offset);
+                for(size_t i = first; i < last; ++i) {
+                    const Polygon &polygon = polygons[i];
+                    if(byteSizes) out.put(static_cast<uint8_t>(polygon.size()));
+                    else out.put(static_cast<int32_t>(polygon.size()));
+                    for(uint index : polygon)
+                        out.put(static_cast<int32_t>(index) + indexOffset);
+                }
+            });
+        }
+    }
+    runParallel(tasks);
+    return true;
+}
+
+bool MeshExporter::writeMTMesh(OutputFile &file)
+{
+    struct Column {
+        std::string name;
+        MTMesh::ColumnType type;
+        uint32_t components;
+        uint64_t count;
+        //columns are written as they are in memory, except for polygons
+        const void *data;
+        PolygonListPtr polygons;
+        bool sizes;
+    };
+
+    std::vector<std::vector<Column>> columns(_meshes.size());
+    //a list keeps its elements where they are when it grows
+    std::list<std::vector<uint8_t>> byteColumns;
+    for(size_t m = 0; m < _meshes.size(); ++m) {
+        const Mesh &mesh = _meshes[m];
+        for(const auto &property : mesh.data->getProperties()) {
+            const std::string &name = property.first;
+            const Property &prop = property.second;
+            if(prop.getType() == PropertyTypeInfo<VertexListPtr>::getType()) {
+                auto list = prop.getData<VertexListPtr>();
+                if(list) columns[m].push_back({name, MTMesh::FLOAT32, 3, list->size(), list->data(), nullptr, false});
+            }
+            else if(prop.getType() == PropertyTypeInfo<std::shared_ptr<std::vector<float>>>::getType()) {
+                auto list = prop.getData<std::shared_ptr<std::vector<float>>>();
+                if(list) columns[m].push_back({name, MTMesh::FLOAT32, 1, list->size(), list->data(), nullptr, false});
+            }
+            else if(prop.getType() == PropertyTypeInfo<std::vector<uint8_t>>::getType()) {
+                //the property only hands out copies
+                byteColumns.push_back(prop.getData<std::vector<uint8_t>>());
+                const auto &list = byteColumns.back();
+                columns[m].push_back({name, MTMesh::UINT8, 1, list.size(), list.data(), nullptr, false});
+            }
+        }
+
+        if(mesh.polygons) {
+            uint64_t indexCount = 0;
+            for(const auto &polygon : *mesh.polygons) indexCount += polygon.size();
+            columns[m].push_back({"polygon.sizes", MTMesh::UINT32, 1, mesh.polygons->size(), nullptr, mesh.polygons, true});
+            columns[m].push_back({"polygon.indices", MTMesh::UINT32, 1, indexCount, nullptr, mesh.polygons, false});
+        }
+    }
+
+    //tables and names come first, then the aligned column data
+    uint64_t offset = sizeof(MTMesh::FileHeader) + _meshes.size() * sizeof(MTMesh::MeshRecord);
+    std::vector<MTMesh::MeshRecord> meshRecords(_meshes.size());
+    std::vector<std::vector<MTMesh::ColumnRecord>> columnRecords(_meshes.size());
+    for(size_t m = 0; m < _meshes.size(); ++m) {
+        meshRecords[m].columnTableOffset = offset;
+        meshRecords[m].columnCount = columns[m].size();
+        offset += columns[m].size() * sizeof(MTMesh::ColumnRecord);
+    }
+
+    std::string names;
+    uint64_t namesOffset = offset;
+    for(size_t m = 0; m < _meshes.size(); ++m) {
+        const Mesh &mesh = _meshes[m];
+        auto &record = meshRecords[m];
+        record.nameOffset = namesOffset + names.size();
+        record.nameLength = mesh.name.size();
+        names += mesh.name;
+        record.vertexCount = mesh.P->size();
+        record.polygonCount = mesh.polygons ? mesh.polygons->size() : 0;
+        std::memcpy(record.transformation, &mesh.transformation[0][0], sizeof(record.transformation));
+
+        for(const auto &column : columns[m]) {
+            MTMesh::ColumnRecord columnRecord;
+            columnRecord.nameOffset = namesOffset + names.size();
+            columnRecord.nameLength = column.name.size();
+            names += column.name;
+            columnRecord.type = column.type;
+            columnRecord.components = column.components;
+            columnRecord.reserved = 0;
+            columnRecord.count = column.count;
+            columnRecords[m].push_back(columnRecord);
+        }
+    }
+    offset += names.size();
+
+    for(size_t m = 0; m < _meshes.size(); ++m) {
+        for(size_t c = 0; c < columns[m].size(); ++c) {
+            offset = align(offset);
+            columnRecords[m][c].offset = offset;
+            const Column &column = columns[m][c];
+            size_t elementSize = column.type == MTMesh::UINT8 ? 1 : 4;
+            offset += column.count * column.components * elementSize;
+        }
+    }
+
+    auto write = [&file](uint64_t offset, const void *data, size_t size) {
+        file.write(offset, data, size);
+    };
+
+    {
+        BufferedWriter out(write, 0);
+        MTMesh::FileHeader header;
+        std::memcpy(header.magic, MTMesh::MAGIC, sizeof(header.magic));
+        header.version = MTMesh::VERSION;
+        header.meshCount = _meshes.size();
+        out.put(header);
+        out.append(meshRecords.data(), meshRecords.size() * sizeof(MTMesh::MeshRecord));
+        for(const auto &records : columnRecords)
+            out.append(records.data(), records.size() * sizeof(MTMesh::ColumnRecord));
+        out.append(names.data(), names.size());
+    }
+
+    std::vector<std::function<void()>> tasks;
+    for(size_t m = 0; m < _meshes.size(); ++m) {
+        for(size_t c = 0; c < columns[m].size(); ++c) {
+            const Column &column = columns[m][c];
+            uint64_t columnOffset = columnRecords[m][c].offset;
+
+            if(column.data) {
+                //straight from memory, split so large columns are written in parallel
+                size_t bytes = column.count * column.components * (column.type == MTMesh::UINT8 ? 1 : 4);
+                const char *data = static_cast<const char*>(column.data);
+                for(size_t first = 0; first < bytes; first += RANGE_SIZE * 16) {
+                    size_t size = std::min(RANGE_SIZE * 16, bytes - first);
+                    tasks.push_back([&file, columnOffset, data, first, size] {
+                        file.write(columnOffset + first, data + first, size);
+                    });
+                }
+                continue;
+            }
+
+            const PolygonList &polygons = *column.polygons;
+            bool sizes = column.sizes;
+            uint64_t rangeOffset = columnOffset;
+            for(size_t first = 0; first < polygons.size(); first += RANGE_SIZE) {
+                size_t last = std::min(first + RANGE_SIZE, polygons.size());
+                tasks.push_back([=, &polygons] {
+                    BufferedWriter out(write, rangeOffset);
+                    for(size_t i = first; i < last; ++i) {
+                        if(sizes) out.put(static_cast<uint32_t>(polygons[i].size()));
+                        else out.append(polygons[i].data(), polygons[i].size() * sizeof(uint32_t));
+                    }
+                });
+                if(sizes) rangeOffset += (last - first) * sizeof(uint32_t);
+                else for(size_t i = first; i < last; ++i) rangeOffset += polygons[i].size() * sizeof(uint32_t);
+            }
+        }
+    }
+    runParallel(tasks);
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef MT_MESH_EXPORT_H
+#define MT_MESH_EXPORT_H
+
+#include "string"
+#include "vector"
+#include "cstdint"
+#include "source/plugins/datatypes/Object/object.h"
+
+namespace MindTree {
+
+//layout of the mtmesh format. The hierarchy is flattened, every mesh is
+//stored with its world transformation and its attribute columns exactly as
+//they are in memory, 16 byte aligned, so a reader can map the file and hand
+//the columns to the GPU without decoding. Strings are not terminated,
+//polygons are stored as a column of sizes and a column of indices
+namespace MTMesh {
+const char MAGIC[8] = {'M', 'T', 'M', 'E', 'S', 'H', 0, 0};
+const uint32_t VERSION = 1;
+const uint64_t ALIGNMENT = 16;
+
+enum ColumnType : uint32_t {
+    FLOAT32, UINT32, UINT8
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t meshCount;
+    //followed by meshCount MeshRecords
+};
+
+struct MeshRecord {
+    uint64_t nameOffset;
+    uint32_t nameLength;
+    uint32_t columnCount;
+    uint64_t columnTableOffset;
+    uint64_t vertexCount;
+    uint64_t polygonCount;
+    float transformation[16];
+};
+
+struct ColumnRecord {
+    uint64_t nameOffset;
+    uint32_t nameLength;
+    ColumnType type;
+    uint32_t components;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t offset;
+};
+}
+
+//writes meshes without going through assimp, as binary PLY or mtmesh.
+//PLY only knows one mesh, so the world transformations of all meshes are
+//baked into it. Meshes are split into ranges that are encoded into large
+//buffers in parallel and written straight to their place in the file
+class MeshExporter
+{
+public:
+    MeshExporter(std::string filename);
+    ~MeshExporter();
+
+    //whether the extension of filename is one of the native formats
+    static bool canExport(const std::string &filename);
+
+    bool exportObject(const AbstractTransformablePtr &object);
+
+private:
+    struct Mesh;
+    class OutputFile;
+
+    void collect(const AbstractTransformablePtr &object);
+    bool writePLY(OutputFile &file);
+    bool writeMTMesh(OutputFile &file);
+
+    std::string _filename;
+    std::vector<Mesh> _meshes;
+};
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef MT_NUMBER_PARSING_H
+#define MT_NUMBER_PARSING_H
+
+#include "cstdint"
+#include "cstdlib"
+#include "cstring"
+#include "algorithm"
+#include "string"
+
+//locale independent number parsing for ascii geometry files. Every function
+//takes the current position and the end of the text and returns the
+//position after the number, or the start position if there was none
+namespace MindTree {
+namespace NumberParsing {
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline const char* skipSpaces(const char *p, const char *end)
+{
+    while(p < end && isSpace(*p)) ++p;
+    return p;
+}
+
+inline const char* skipLine(const char *p, const char *end)
+{
+    if(p >= end) return end;
+    auto *newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return newline ? newline + 1 : end;
+}
+
+inline const char* parseInt(const char *p, const char *end, int64_t &value)
+{
+    const char *start = p;
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    if(p == end || !isDigit(*p)) return start;
+
+    int64_t result = 0;
+    while(p < end && isDigit(*p)) result = result * 10 + (*p++ - '0');
+    value = negative ? -result : result;
+    return p;
+}
+
+//exact for up to 19 significant digits, good enough for single precision
+//coordinates. Anything unusual like inf or nan goes through strtod
+inline const char* parseFloat(const char *p, const char *end, double &value)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char *start = p;
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for(; p < end && isDigit(*p); ++p, any = true) {
+        if(digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if(mantissa) ++digits;
+        }
+        else ++exponent;
+    }
+    if(p < end && *p == '.') {
+        for(++p; p < end && isDigit(*p); ++p, any = true) {
+            if(digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if(mantissa) ++digits;
+                --exponent;
+            }
+        }
+    }
+
+    if(!any) {
+        //inf, nan and friends
+        if(p < end && (*p == 'i' || *p == 'I' || *p == 'n' || *p == 'N')) {
+            std::string token(start, std::min<size_t>(end - start, 32));
+            char *tokenEnd = nullptr;
+            value = std::strtod(token.c_str(), &tokenEnd);
+            return start + (tokenEnd - token.c_str());
+        }
+        return start;
+    }
+
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        int64_t e = 0;
+        const char *afterExponent = parseInt(p + 1, end, e);
+        if(afterExponent != p + 1) {
+            exponent += static_cast<int>(std::max<int64_t>(-1000, std::min<int64_t>(1000, e)));
+            p = afterExponent;
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+    while(exponent > 22) { result *= 1e22; exponent -= 22; }
+    while(exponent < -22) { result /= 1e22; exponent += 22; }
+    result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+
+    value = negative ? -result : result;
+    return p;
+}
+
+inline const char* parseFloat(const char *p, const char *end, float &value)
+{
+    double d;
+    const char *next = parseFloat(p, end, d);
+    if(next != p) value = static_cast<float>(d);
+    return next;
+}
+
+}
+}
+
+#endif
@@ -16,132 +16,355 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include "QFile"
-#include "QFileInfo"
-#include "QString"
+#include "atomic"
+#include "chrono"
+#include "unordered_map"
+#include "limits"
+#include "algorithm"
 #define GLM_FORCE_SWIZZLE
 #include "glm/glm.hpp"
 
+#include "data/io.h"
+#include "number_parsing.h"
+#include "chunking.h"
+
 #include "obj.h"
 
 using namespace MindTree;
+using namespace MindTree::NumberParsing;
+using namespace MindTree::Chunking;
 
-ObjImporter::ObjImporter(std::string filepath)
-{
-    QFile file(filepath.c_str());
-    file.open(QFile::ReadOnly);
-    QFileInfo fi(file);
-    if(!fi.exists()) {
-        std::cout << filepath << " not found" << std::endl;
-        return;
+namespace {
+    //index of a missing texture coordinate or normal
+    const int64_t NO_INDEX = -1;
+
+    //negative (relative) indices that reach into a previous chunk can only
+    //be resolved once the chunk offsets are known. Until then they are
+    //stored relative to the start of the chunk, shifted by this
+    const int64_t RELATIVE_INDEX = int64_t(1) << 48;
+
+    const uint NEW_VERTEX = std::numeric_limits<uint>::max();
+
+    struct Corner {
+        int64_t v, t, n;
+        bool operator==(const Corner &other) const
+        {
+            return v == other.v && t == other.t && n == other.n;
+        }
+    };
+
+    struct CornerHash {
+        size_t operator()(const Corner &c) const
+        {
+            size_t h = std::hash<int64_t>()(c.v);
+            h ^= std::hash<int64_t>()(c.t) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            h ^= std::hash<int64_t>()(c.n) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    const char* parseVector(const char *p, const char *end, float *values, int max, int &count)
+    {
+        for(count = 0; count < max; ++count) {
+            p = skipSpaces(p, end);
+            const char *next = parseFloat(p, end, values[count]);
+            if(next == p) break;
+            p = next;
+        }
+        return p;
     }
-    QTextStream stream(&file);
 
-    readData(stream);
-}
+    //one based indices become zero based, negative ones stay relative to
+    //count, the number of elements so far in the chunk
+    int64_t toIndex(int64_t index, size_t count)
+    {
+        if(index > 0) return index - 1;
+        return RELATIVE_INDEX + int64_t(count) + index;
+    }
 
-ObjImporter::~ObjImporter()
-{
+    int64_t resolve(int64_t index, size_t offset)
+    {
+        if(index >= RELATIVE_INDEX / 2) return index - RELATIVE_INDEX + int64_t(offset);
+        return index;
+    }
 }
 
-void ObjImporter::readData(QTextStream &stream)    
+struct ObjImporter::Chunk {
+    VertexList positions, colors, normals, uvs;
+    std::vector<Corner> corners;
+    std::vector<uint> faceSizes;
+    //names of the objects started in this chunk and their first face
+    std::vector<std::pair<std::string, size_t>> objects;
+    size_t positionOffset = 0, normalOffset = 0, uvOffset = 0;
+};
+
+struct ObjImporter::ObjectRange {
+    std::string name;
+    //chunk and face the object starts and ends at
+    size_t firstChunk, firstFace, lastChunk, lastFace;
+};
+
+ObjImporter::ObjImporter(std::string filepath, std::function<void(float)> progress)
 {
-    std::shared_ptr<GeoObject> obj;
+    auto start = std::chrono::steady_clock::now();
+    IO::MappedFile file(filepath);
+    if(!file.isOpen()) {
+        std::cout << filepath << " not found" << std::endl;
+        return;
+    }
+
+    auto slash = filepath.find_last_of('/');
+    name = filepath.substr(slash == std::string::npos ? 0 : slash + 1);
+    name = name.substr(0, name.find_last_of('.'));
 
     std::cout <<  "importing object ...";
-    while(!stream.atEnd()) {
-        QString line = stream.readLine();
-        if(line.startsWith("o ")) {
-            obj = addObject(line);
+    size_t chunkCount = countChunks(file.size());
+    std::vector<const char*> bounds = splitLines(file.data(), file.data() + file.size(), chunkCount);
+
+    //parsing takes most of the time, creating the objects the rest
+    auto report = [&progress](float done) { if(progress) progress(done); };
+
+    std::vector<Chunk> chunks(chunkCount);
+    {
+        std::atomic<size_t> parsed{0};
+        parallelFor(chunkCount, [&](size_t i) {
+            parseChunk(bounds[i], bounds[i + 1], chunks[i]);
+            report(.8f * ++parsed / chunkCount);
+        });
+    }
+
+    //chunk offsets into the whole file
+    for(size_t i = 1; i < chunkCount; ++i) {
+        const Chunk &previous = chunks[i - 1];
+        chunks[i].positionOffset = previous.positionOffset + previous.positions.size();
+        chunks[i].normalOffset = previous.normalOffset + previous.normals.size();
+        chunks[i].uvOffset = previous.uvOffset + previous.uvs.size();
+    }
+
+    parallelFor(chunkCount, [&chunks](size_t i) {
+        Chunk &chunk = chunks[i];
+        for(auto &corner : chunk.corners) {
+            corner.v = resolve(corner.v, chunk.positionOffset);
+            if(corner.t != NO_INDEX) corner.t = resolve(corner.t, chunk.uvOffset);
+            if(corner.n != NO_INDEX) corner.n = resolve(corner.n, chunk.normalOffset);
+        }
+    });
+
+    //faces before the first object line go into an object named after the file
+    std::vector<ObjectRange> ranges{{name, 0, 0, 0, 0}};
+    for(size_t i = 0; i < chunkCount; ++i) {
+        for(const auto &object : chunks[i].objects) {
+            ranges.back().lastChunk = i;
+            ranges.back().lastFace = object.second;
+            ranges.push_back({object.first, i, object.second, 0, 0});
         }
-        else if(line.startsWith("v "))
-                addVertex(line, obj);
-        else if(line.startsWith("vn "))
-                addNormal(line, obj);
-        else if(line.startsWith("f "))
-                addFace(line, obj);
-        else if(line.startsWith("st "))
-            addUV(line, obj);
     }
+    ranges.back().lastChunk = chunkCount - 1;
+    ranges.back().lastFace = chunks.back().faceSizes.size();
 
-    std::cout <<  " done" << std::endl;
-    auto mesh = std::static_pointer_cast<MeshData>(obj->getData());
-    if(!mesh->hasProperty("N")) {
-        std::cout <<  "no normals found, computing normals ... ";
-        mesh->computeVertexNormals();
-        std::cout <<  "done" << std::endl;
+    grp = std::make_shared<Group>();
+    for(const auto &range : ranges) {
+        bool empty = range.firstChunk == range.lastChunk && range.firstFace == range.lastFace;
+        //the implicit first object only exists if it has faces
+        if(empty && &range == &ranges.front() && ranges.size() > 1) continue;
+        grp->addMember(createObject(range, chunks));
+        report(.8f + .2f * (&range - &ranges.front() + 1) / ranges.size());
     }
+
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    std::cout << " done, " << file.size() / (1 << 20) << " MB in "
+        << seconds.count() << "s" << std::endl;
 }
 
-std::shared_ptr<GeoObject> ObjImporter::addObject(QString line)    
+ObjImporter::~ObjImporter()
 {
-    auto obj = std::make_shared<GeoObject>();
-    obj->setName("ObjImported");
-
-    if(!grp) grp = std::make_shared<Group>();
-    grp->addMember(obj);
-    QStringList l = line.split(" ");
-    l.takeFirst();
-    obj->setName(l[0].toStdString());
-    auto mesh = std::make_shared<MeshData>();
-    mesh->setProperty("P", std::make_shared<VertexList>());
-    mesh->setProperty("polygon", std::make_shared<PolygonList>());
-    obj->setData(mesh);
-    return obj;
 }
 
-void ObjImporter::addVertex(QString line, std::shared_ptr<GeoObject> obj)
+void ObjImporter::parseChunk(const char *p, const char *end, Chunk &chunk)
 {
-    QStringList l = line.split(" ");
-    double d[3];
-    int i=0;
-    l.takeFirst();
-    for(QString vstr : l){
-        d[i] = vstr.toDouble();
-        ++i;
+    while(p < end) {
+        p = skipSpaces(p, end);
+        if(p == end) break;
+
+        char c0 = *p;
+        char c1 = p + 1 < end ? p[1] : '\n';
+        char c2 = p + 2 < end ? p[2] : '\n';
+        float values[6] = {0, 0, 0, 0, 0, 0};
+        int count;
+        if(c0 == 'v' && isSpace(c1)) {
+            //positions may be followed by a vertex color
+            p = parseVector(p + 1, end, values, 6, count);
+            chunk.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+            if(count == 6) {
+                chunk.colors.resize(chunk.positions.size() - 1, glm::vec3(1));
+                chunk.colors.push_back(glm::vec3(values[3], values[4], values[5]));
+            }
+        }
+        else if(c0 == 'v' && c1 == 'n' && isSpace(c2)) {
+            p = parseVector(p + 2, end, values, 3, count);
+            chunk.normals.push_back(glm::vec3(values[0], values[1], values[2]));
+        }
+        else if(((c0 == 'v' && c1 == 't') || (c0 == 's' && c1 == 't')) && isSpace(c2)) {
+            p = parseVector(p + 2, end, values, 3, count);
+            chunk.uvs.push_back(glm::vec3(values[0], values[1], values[2]));
+        }
+        else if(c0 == 'f' && isSpace(c1)) {
+            p = skipSpaces(p + 1, end);
+            uint size = 0;
+            while(p < end && *p != '\n' && *p != '#') {
+                int64_t v = 0, t = 0, n = 0;
+                const char *next = parseInt(p, end, v);
+                if(next == p) break;
+                p = next;
+                if(p < end && *p == '/') {
+                    p = parseInt(p + 1, end, t);
+                    if(p < end && *p == '/') p = parseInt(p + 1, end, n);
+                }
+                chunk.corners.push_back({toIndex(v, chunk.positions.size()),
+                                         t ? toIndex(t, chunk.uvs.size()) : NO_INDEX,
+                                         n ? toIndex(n, chunk.normals.size()) : NO_INDEX});
+                ++size;
+                p = skipSpaces(p, end);
+            }
+            if(size) chunk.faceSizes.push_back(size);
+        }
+        else if(c0 == 'o' && isSpace(c1)) {
+            const char *nameStart = skipSpaces(p + 1, end);
+            const char *nameEnd = nameStart;
+            while(nameEnd < end && *nameEnd != '\n' && !isSpace(*nameEnd)) ++nameEnd;
+            chunk.objects.push_back({std::string(nameStart, nameEnd), chunk.faceSizes.size()});
+            p = nameEnd;
+        }
+        p = skipLine(p, end);
     }
-    std::static_pointer_cast<MeshData>(obj->getData())
-        ->getProperty("P")
-        .getData<std::shared_ptr<VertexList>>()
-        ->push_back(glm::vec3(d[0], d[1], d[2]));
+
+    if(!chunk.colors.empty()) chunk.colors.resize(chunk.positions.size(), glm::vec3(1));
 }
 
-void ObjImporter::addNormal(QString line, std::shared_ptr<GeoObject> obj)
+std::shared_ptr<GeoObject> ObjImporter::createObject(const ObjectRange &range,
+                                                     const std::vector<Chunk> &chunks)
 {
-    QStringList l = line.split(" ");
-    double d[3];
-    int i=0;
-    l.takeFirst();
-    for(QString vstr : l){
-        d[i] = vstr.toDouble();
-        ++i;
+    const Chunk &last = chunks.back();
+    size_t positionCount = last.positionOffset + last.positions.size();
+    size_t normalCount = last.normalOffset + last.normals.size();
+    size_t uvCount = last.uvOffset + last.uvs.size();
+    bool hasColors = false;
+    for(const auto &chunk : chunks)
+        hasColors = hasColors || !chunk.colors.empty();
+
+    auto polygons = std::make_shared<PolygonList>();
+    //every distinct corner becomes a vertex. Most positions are only used
+    //with one normal and texture coordinate, so corners are first looked up
+    //by position and only seams go through the hash map
+    std::vector<Corner> vertices;
+    firstVertex.resize(positionCount, NEW_VERTEX);
+    std::unordered_map<Corner, uint, CornerHash> seams;
+    size_t invalidFaces = 0;
+
+    for(size_t c = range.firstChunk; c <= range.lastChunk; ++c) {
+        const Chunk &chunk = chunks[c];
+        size_t firstFace = c == range.firstChunk ? range.firstFace : 0;
+        size_t lastFace = c == range.lastChunk ? range.lastFace : chunk.faceSizes.size();
+
+        size_t corner = 0;
+        for(size_t f = 0; f < firstFace; ++f) corner += chunk.faceSizes[f];
+
+        polygons->reserve(polygons->size() + lastFace - firstFace);
+        for(size_t f = firstFace; f < lastFace; ++f) {
+            uint size = chunk.faceSizes[f];
+            const Corner *corners = &chunk.corners[corner];
+            corner += size;
+
+            bool valid = true;
+            for(uint i = 0; i < size; ++i) {
+                const Corner &cr = corners[i];
+                valid = valid && cr.v >= 0 && size_t(cr.v) < positionCount
+                    && (cr.t == NO_INDEX || (cr.t >= 0 && size_t(cr.t) < uvCount))
+                    && (cr.n == NO_INDEX || (cr.n >= 0 && size_t(cr.n) < normalCount));
+            }
+            if(!valid) {
+                ++invalidFaces;
+                continue;
+            }
+
+            Polygon polygon(size);
+            for(uint i = 0; i < size; ++i) {
+                const Corner &cr = corners[i];
+                uint &first = firstVertex[cr.v];
+                if(first == NEW_VERTEX) {
+                    first = vertices.size();
+                    vertices.push_back(cr);
+                    polygon[i] = first;
+                }
+                else if(vertices[first] == cr) {
+                    polygon[i] = first;
+                }
+                else {
+                    auto it = seams.insert({cr, uint(vertices.size())}).first;
+                    if(it->second == vertices.size()) vertices.push_back(cr);
+                    polygon[i] = it->second;
+                }
+            }
+            polygons->push_back(std::move(polygon));
+        }
     }
-    auto mesh = std::static_pointer_cast<MeshData>(obj->getData());
-    if(!mesh->hasProperty("N"))
-        mesh->setProperty("N", std::make_shared<VertexList>());
 
-    mesh->getProperty("N")
-        .getData<std::shared_ptr<VertexList>>()
-        ->push_back(glm::vec3(d[0], d[1], d[2]));
-}
+    for(const auto &vertex : vertices) firstVertex[vertex.v] = NEW_VERTEX;
 
-void ObjImporter::addFace(QString line, std::shared_ptr<GeoObject> obj)    
-{
-    QStringList l = line.split(" ");
-    Polygon p;
-    l.takeFirst();
-    for(QString vstr : l){
-        QStringList tmp = vstr.split("/");
-        p.push_back(tmp.at(0).toInt() - 1);
+    if(invalidFaces)
+        std::cout << "skipped " << invalidFaces << " faces with invalid indices in "
+            << range.name << std::endl;
+
+    //gather the attribute columns of the vertices
+    auto findChunk = [&chunks](size_t index, size_t Chunk::*offset) -> const Chunk& {
+        return *(std::upper_bound(begin(chunks), end(chunks), index,
+                                  [offset](size_t i, const Chunk &chunk) {
+                                      return i < chunk.*offset;
+                                  }) - 1);
+    };
+
+    bool hasNormals = false, hasUVs = false;
+    for(const auto &vertex : vertices) {
+        hasNormals = hasNormals || vertex.n != NO_INDEX;
+        hasUVs = hasUVs || vertex.t != NO_INDEX;
     }
-    std::static_pointer_cast<MeshData>(obj->getData())
-        ->getProperty("polygon")
-        .getData<std::shared_ptr<PolygonList>>()
-        ->push_back(p);
-}
 
-void ObjImporter::addUV(QString line, std::shared_ptr<GeoObject> obj)    
-{
+    auto P = std::make_shared<VertexList>(vertices.size());
+    auto N = std::make_shared<VertexList>(hasNormals ? vertices.size() : 0);
+    auto UV = std::make_shared<VertexList>(hasUVs ? vertices.size() : 0);
+    auto C = std::make_shared<VertexList>(hasColors ? vertices.size() : 0, glm::vec3(1));
+    for(size_t i = 0; i < vertices.size(); ++i) {
+        const Corner &vertex = vertices[i];
+        const Chunk &chunk = findChunk(vertex.v, &Chunk::positionOffset);
+        (*P)[i] = chunk.positions[vertex.v - chunk.positionOffset];
+        if(!chunk.colors.empty())
+            (*C)[i] = chunk.colors[vertex.v - chunk.positionOffset];
+        if(vertex.n != NO_INDEX) {
+            const Chunk &chunk = findChunk(vertex.n, &Chunk::normalOffset);
+            (*N)[i] = chunk.normals[vertex.n - chunk.normalOffset];
+        }
+        if(vertex.t != NO_INDEX) {
+            const Chunk &chunk = findChunk(vertex.t, &Chunk::uvOffset);
+            (*UV)[i] = chunk.uvs[vertex.t - chunk.uvOffset];
+        }
+    }
+
+    auto obj = std::make_shared<GeoObject>();
+    obj->setName(range.name);
+    auto mesh = std::make_shared<MeshData>();
+    mesh->setProperty("P", P);
+    mesh->setProperty("polygon", polygons);
+    if(hasNormals) mesh->setProperty("N", N);
+    if(hasUVs) mesh->setProperty("UV", UV);
+    if(hasColors) mesh->setProperty("C", C);
+    obj->setData(mesh);
+
+    if(!hasNormals) {
+        std::cout <<  "no normals found, computing normals ... ";
+        mesh->computeVertexNormals();
+        std::cout <<  "done" << std::endl;
+    }
+    return obj;
 }
 
 std::shared_ptr<Group> ObjImporter::getGroup()
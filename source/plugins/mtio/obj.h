@@ -20,31 +20,39 @@
 
 #define OBJ
 
-#include "QTextStream"
+#include "functional"
 #include "data/nodes/data_node.h"
 #include "source/plugins/datatypes/Object/object.h"
 
 class MeshData;
 class ObjImportNode;
 
+//the file is mapped and split into chunks at line ends that are parsed in
+//parallel. The chunks are merged by offsetting their indices, then every
+//object gets its own vertices for the distinct v/vt/vn combinations its
+//faces use
 class ObjImporter
 {
 public:
-    ObjImporter(std::string filepath);
+    //progress is called with the fraction that is done, from the parsing
+    //threads too
+    ObjImporter(std::string filepath, std::function<void(float)> progress=nullptr);
     virtual ~ObjImporter();
 
     std::shared_ptr<Group> getGroup();
 
 private:
-    void readData(QTextStream &stream);
-    std::shared_ptr<GeoObject> addObject(QString line);
-    void addVertex(QString line, std::shared_ptr<GeoObject> obj);
-    void addNormal(QString line, std::shared_ptr<GeoObject> obj);
-    void addFace(QString line, std::shared_ptr<GeoObject> obj);
-    void addUV(QString line, std::shared_ptr<GeoObject> obj);
+    struct Chunk;
+    struct ObjectRange;
+
+    static void parseChunk(const char *begin, const char *end, Chunk &chunk);
+    std::shared_ptr<GeoObject> createObject(const ObjectRange &range,
+                                            const std::vector<Chunk> &chunks);
 
     std::shared_ptr<Group> grp;
-    QString name;
+    std::string name;
+    //vertex of every position in the current object, kept between objects
+    std::vector<uint> firstVertex;
 };
 
 class ObjImportNode : public MindTree::DNode
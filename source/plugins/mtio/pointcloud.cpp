@@ -0,0 +1,483 @@
+#include "chrono"
+#include "cmath"
+#include "cstring"
+#include "algorithm"
+#include "limits"
+#include "sstream"
+#include "unordered_set"
+
+#include "data/io.h"
+#include "number_parsing.h"
+#include "chunking.h"
+
+#include "pointcloud.h"
+
+using namespace MindTree;
+using namespace MindTree::NumberParsing;
+using namespace MindTree::Chunking;
+
+namespace {
+    enum PlyType {
+        PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16,
+        PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_INVALID
+    };
+
+    PlyType plyType(const std::string &name)
+    {
+        if(name == "char" || name == "int8") return PLY_INT8;
+        if(name == "uchar" || name == "uint8") return PLY_UINT8;
+        if(name == "short" || name == "int16") return PLY_INT16;
+        if(name == "ushort" || name == "uint16") return PLY_UINT16;
+        if(name == "int" || name == "int32") return PLY_INT32;
+        if(name == "uint" || name == "uint32") return PLY_UINT32;
+        if(name == "float" || name == "float32") return PLY_FLOAT32;
+        if(name == "double" || name == "float64") return PLY_FLOAT64;
+        return PLY_INVALID;
+    }
+
+    size_t plySize(PlyType type)
+    {
+        static const size_t sizes[] = {1, 1, 2, 2, 4, 4, 4, 8, 0};
+        return sizes[type];
+    }
+
+    //colors stored as integers are scaled by the largest value of their type
+    float plyMax(PlyType type)
+    {
+        switch(type) {
+        case PLY_INT8: return 127;
+        case PLY_UINT8: return 255;
+        case PLY_INT16: return 32767;
+        case PLY_UINT16: return 65535;
+        case PLY_INT32: return 2147483647.f;
+        case PLY_UINT32: return 4294967295.f;
+        default: return 1;
+        }
+    }
+
+    template<typename T>
+    T load(const char *p, bool swap)
+    {
+        T value;
+        if(!swap) {
+            std::memcpy(&value, p, sizeof(T));
+            return value;
+        }
+        char bytes[sizeof(T)];
+        std::reverse_copy(p, p + sizeof(T), bytes);
+        std::memcpy(&value, bytes, sizeof(T));
+        return value;
+    }
+
+    double plyValue(const char *p, PlyType type, bool swap)
+    {
+        switch(type) {
+        case PLY_INT8: return load<int8_t>(p, swap);
+        case PLY_UINT8: return load<uint8_t>(p, swap);
+        case PLY_INT16: return load<int16_t>(p, swap);
+        case PLY_UINT16: return load<uint16_t>(p, swap);
+        case PLY_INT32: return load<int32_t>(p, swap);
+        case PLY_UINT32: return load<uint32_t>(p, swap);
+        case PLY_FLOAT32: return load<float>(p, swap);
+        case PLY_FLOAT64: return load<double>(p, swap);
+        default: return 0;
+        }
+    }
+
+    struct PlyProperty {
+        std::string name;
+        PlyType type, countType;
+        bool list;
+    };
+
+    struct PlyElement {
+        std::string name;
+        size_t count;
+        std::vector<PlyProperty> properties;
+    };
+
+    int attributeOf(std::string name)
+    {
+        std::transform(begin(name), end(name), begin(name), ::tolower);
+        if(name == "x") return PointCloudImporter::PX;
+        if(name == "y") return PointCloudImporter::PY;
+        if(name == "z") return PointCloudImporter::PZ;
+        if(name == "nx") return PointCloudImporter::NX;
+        if(name == "ny") return PointCloudImporter::NY;
+        if(name == "nz") return PointCloudImporter::NZ;
+        if(name == "red" || name == "r" || name == "diffuse_red") return PointCloudImporter::RED;
+        if(name == "green" || name == "g" || name == "diffuse_green") return PointCloudImporter::GREEN;
+        if(name == "blue" || name == "b" || name == "diffuse_blue") return PointCloudImporter::BLUE;
+        if(name == "intensity" || name == "scalar_intensity") return PointCloudImporter::INTENSITY;
+        return -1;
+    }
+
+    bool isColor(int attribute)
+    {
+        return attribute == PointCloudImporter::RED
+            || attribute == PointCloudImporter::GREEN
+            || attribute == PointCloudImporter::BLUE;
+    }
+
+    uint64_t voxelKey(float x, float y, float z, float size)
+    {
+        //21 bits per axis, far away cells wrap around
+        auto cell = [size](float v) {
+            return uint64_t(int64_t(std::floor(v / size)) & 0x1fffff);
+        };
+        return cell(x) | cell(y) << 21 | cell(z) << 42;
+    }
+}
+
+struct PointCloudImporter::Points {
+    VertexList P, N, C;
+    std::vector<float> intensity;
+    //cells of the voxel grid that already have a point
+    std::unordered_set<uint64_t> voxels;
+
+    void add(const float *values, const bool *attributes, float voxelSize)
+    {
+        if(voxelSize > 0
+           && !voxels.insert(voxelKey(values[PX], values[PY], values[PZ], voxelSize)).second)
+            return;
+
+        P.emplace_back(values[PX], values[PY], values[PZ]);
+        if(attributes[NX]) N.emplace_back(values[NX], values[NY], values[NZ]);
+        if(attributes[RED]) C.emplace_back(values[RED], values[GREEN], values[BLUE]);
+        if(attributes[INTENSITY]) intensity.push_back(values[INTENSITY]);
+    }
+};
+
+PointCloudImporter::PointCloudImporter(std::string filename, Options options)
+    : _filename(filename), _options(options)
+{
+    _options.stride = std::max(1, _options.stride);
+    std::fill(_attributes, _attributes + ATTRIBUTE_COUNT, false);
+}
+
+MeshDataPtr PointCloudImporter::import()
+{
+    auto start = std::chrono::steady_clock::now();
+    IO::MappedFile file(_filename);
+    if(!file.isOpen()) {
+        std::cout << _filename << " not found" << std::endl;
+        return nullptr;
+    }
+
+    bool isPLY = file.size() >= 4 && std::memcmp(file.data(), "ply", 3) == 0;
+    MeshDataPtr mesh = isPLY ? importPLY(file) : importXYZ(file);
+    if(!mesh) return nullptr;
+
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    std::cout << "imported " << mesh->getProperty("P").getData<VertexListPtr>()->size()
+        << " points from " << file.size() / (1 << 20) << " MB in "
+        << seconds.count() << "s" << std::endl;
+    return mesh;
+}
+
+MeshDataPtr PointCloudImporter::importPLY(const IO::MappedFile &file)
+{
+    const char *p = file.data();
+    const char *end = p + file.size();
+
+    std::string format;
+    std::vector<PlyElement> elements;
+    bool header = false;
+    while(p < end && !header) {
+        const char *next = skipLine(p, end);
+        std::istringstream line(std::string(p, next));
+        p = next;
+
+        std::string keyword;
+        line >> keyword;
+        if(keyword == "format") {
+            line >> format;
+        }
+        else if(keyword == "element") {
+            PlyElement element;
+            line >> element.name >> element.count;
+            elements.push_back(element);
+        }
+        else if(keyword == "property" && !elements.empty()) {
+            PlyProperty property;
+            std::string type;
+            line >> type;
+            property.list = type == "list";
+            if(property.list) {
+                std::string countType;
+                line >> countType >> type;
+                property.countType = plyType(countType);
+            }
+            property.type = plyType(type);
+            line >> property.name;
+            if(property.type == PLY_INVALID || (property.list && property.countType == PLY_INVALID)) {
+                std::cout << "unknown ply property type " << type << std::endl;
+                return nullptr;
+            }
+            elements.back().properties.push_back(property);
+        }
+        else if(keyword == "end_header") {
+            header = true;
+        }
+    }
+
+    auto vertexElement = std::find_if(elements.begin(), elements.end(),
+                                      [](const PlyElement &e) { return e.name == "vertex"; });
+    if(!header || vertexElement == elements.end()) {
+        std::cout << _filename << " has no vertices" << std::endl;
+        return nullptr;
+    }
+
+    //where the properties go and how they are scaled
+    std::vector<int> columns;
+    std::vector<float> scale(ATTRIBUTE_COUNT, 1);
+    for(const auto &property : vertexElement->properties) {
+        if(property.list) {
+            std::cout << "list properties of vertices are not supported" << std::endl;
+            return nullptr;
+        }
+        int attribute = attributeOf(property.name);
+        columns.push_back(attribute);
+        if(attribute < 0) continue;
+        _attributes[attribute] = true;
+        if(isColor(attribute)) scale[attribute] = 1 / plyMax(property.type);
+    }
+    if(!_attributes[PX] || !_attributes[PY] || !_attributes[PZ]) {
+        std::cout << _filename << " has no vertex positions" << std::endl;
+        return nullptr;
+    }
+
+    if(format == "ascii") {
+        //skip the lines of the elements before the vertices
+        for(auto it = elements.begin(); it != vertexElement; ++it)
+            for(size_t i = 0; i < it->count; ++i) p = skipLine(p, end);
+
+        auto chunks = parseLines(p, end, vertexElement->count, columns, scale);
+        return merge(chunks);
+    }
+
+    bool bigEndian = format == "binary_big_endian";
+    if(!bigEndian && format != "binary_little_endian") {
+        std::cout << "unknown ply format " << format << std::endl;
+        return nullptr;
+    }
+    uint16_t one = 1;
+    bool swap = bigEndian == (*reinterpret_cast<const char*>(&one) == 1);
+
+    //skip the elements before the vertices, only elements with lists have
+    //to be walked
+    for(auto it = elements.begin(); it != vertexElement && p < end; ++it) {
+        bool hasLists = std::any_of(it->properties.begin(), it->properties.end(),
+                                    [](const PlyProperty &property) { return property.list; });
+        if(!hasLists) {
+            size_t size = 0;
+            for(const auto &property : it->properties) size += plySize(property.type);
+            p += std::min<size_t>(end - p, size * it->count);
+            continue;
+        }
+        for(size_t i = 0; i < it->count && p < end; ++i) {
+            for(const auto &property : it->properties) {
+                if(!property.list) {
+                    p += plySize(property.type);
+                    continue;
+                }
+                if(p + plySize(property.countType) > end) break;
+                size_t count = plyValue(p, property.countType, swap);
+                p += plySize(property.countType) + count * plySize(property.type);
+            }
+        }
+    }
+
+    size_t recordSize = 0;
+    std::vector<size_t> offsets;
+    for(const auto &property : vertexElement->properties) {
+        offsets.push_back(recordSize);
+        recordSize += plySize(property.type);
+    }
+
+    size_t count = vertexElement->count;
+    size_t available = p < end ? (end - p) / recordSize : 0;
+    if(available < count) {
+        std::cout << _filename << " ends after " << available << " of "
+            << count << " vertices" << std::endl;
+        count = available;
+    }
+
+    size_t chunkCount = countChunks(count * recordSize);
+    std::vector<Points> chunks(chunkCount);
+    const auto &properties = vertexElement->properties;
+    size_t stride = _options.stride;
+    parallelFor(chunkCount, [&, p](size_t c) {
+        size_t first = count * c / chunkCount;
+        size_t last = count * (c + 1) / chunkCount;
+        first = (first + stride - 1) / stride * stride;
+
+        float values[ATTRIBUTE_COUNT] = {};
+        Points &points = chunks[c];
+        points.P.reserve((last - std::min(first, last)) / stride + 1);
+        for(size_t i = first; i < last; i += stride) {
+            const char *record = p + i * recordSize;
+            for(size_t j = 0; j < columns.size(); ++j) {
+                if(columns[j] < 0) continue;
+                values[columns[j]] = plyValue(record + offsets[j], properties[j].type, swap)
+                    * scale[columns[j]];
+            }
+            points.add(values, _attributes, _options.voxelSize);
+        }
+    });
+    return merge(chunks);
+}
+
+MeshDataPtr PointCloudImporter::importXYZ(const IO::MappedFile &file)
+{
+    const char *p = file.data();
+    const char *end = p + file.size();
+
+    //the number of values on the first line of data decides what they are
+    std::vector<float> firstLine;
+    for(const char *line = p; line < end && firstLine.empty(); line = skipLine(line, end)) {
+        const char *q = skipSpaces(line, end);
+        float value;
+        for(const char *next; (next = parseFloat(q, end, value)) != q; q = skipSpaces(next, end))
+            firstLine.push_back(value);
+        if(firstLine.size() < 3) firstLine.clear();
+    }
+
+    std::vector<int> columns;
+    switch(firstLine.size()) {
+    case 0: case 1: case 2:
+        std::cout << _filename << " has no points" << std::endl;
+        return nullptr;
+    case 4:
+        columns = {PX, PY, PZ, INTENSITY};
+        break;
+    case 6:
+        columns = {PX, PY, PZ, RED, GREEN, BLUE};
+        break;
+    case 7:
+        columns = {PX, PY, PZ, INTENSITY, RED, GREEN, BLUE};
+        break;
+    case 9:
+        columns = {PX, PY, PZ, RED, GREEN, BLUE, NX, NY, NZ};
+        break;
+    default:
+        columns = {PX, PY, PZ};
+        break;
+    }
+
+    //colors are either 0 to 1 or 0 to 255
+    std::vector<float> scale(ATTRIBUTE_COUNT, 1);
+    for(size_t i = 0; i < columns.size(); ++i) {
+        _attributes[columns[i]] = true;
+        if(isColor(columns[i]) && firstLine[i] > 1)
+            scale[RED] = scale[GREEN] = scale[BLUE] = 1.f / 255;
+    }
+
+    auto chunks = parseLines(p, end, std::numeric_limits<size_t>::max(), columns, scale);
+    return merge(chunks);
+}
+
+std::vector<PointCloudImporter::Points>
+PointCloudImporter::parseLines(const char *begin, const char *end, size_t maxLines,
+                               const std::vector<int> &columns,
+                               const std::vector<float> &scale)
+{
+    size_t chunkCount = countChunks(end - begin);
+    std::vector<const char*> bounds = splitLines(begin, end, chunkCount);
+
+    //the index of the first line of every chunk, for the stride and to stop
+    //after maxLines
+    std::vector<size_t> firstLine(chunkCount + 1, 0);
+    parallelFor(chunkCount, [&](size_t c) {
+        firstLine[c + 1] = std::count(bounds[c], bounds[c + 1], '\n');
+    });
+    for(size_t c = 0; c < chunkCount; ++c) {
+        firstLine[c + 1] += firstLine[c];
+        if(firstLine[c + 1] <= maxLines) continue;
+
+        const char *last = bounds[c];
+        for(size_t i = firstLine[c]; i < maxLines; ++i) last = skipLine(last, end);
+        bounds[c + 1] = std::max(bounds[c], last);
+        for(size_t rest = c + 1; rest < chunkCount; ++rest)
+            bounds[rest + 1] = bounds[c + 1];
+        break;
+    }
+
+    std::vector<Points> chunks(chunkCount);
+    size_t stride = _options.stride;
+    parallelFor(chunkCount, [&](size_t c) {
+        float values[ATTRIBUTE_COUNT] = {};
+        const char *p = bounds[c];
+        const char *chunkEnd = bounds[c + 1];
+        for(size_t line = firstLine[c]; p < chunkEnd; ++line) {
+            if(line % stride) {
+                p = skipLine(p, chunkEnd);
+                continue;
+            }
+
+            size_t parsed = 0;
+            for(; parsed < columns.size(); ++parsed) {
+                p = skipSpaces(p, chunkEnd);
+                float value;
+                const char *next = parseFloat(p, chunkEnd, value);
+                if(next == p) break;
+                p = next;
+                //properties that are not imported are parsed and dropped
+                if(columns[parsed] < 0) continue;
+                values[columns[parsed]] = value * scale[columns[parsed]];
+            }
+            //comments, empty and incomplete lines
+            if(parsed == columns.size())
+                chunks[c].add(values, _attributes, _options.voxelSize);
+            p = skipLine(p, chunkEnd);
+        }
+    });
+    return chunks;
+}
+
+MeshDataPtr PointCloudImporter::merge(std::vector<Points> &chunks)
+{
+    size_t total = 0;
+    for(const auto &chunk : chunks) total += chunk.P.size();
+
+    auto P = std::make_shared<VertexList>();
+    auto N = std::make_shared<VertexList>();
+    auto C = std::make_shared<VertexList>();
+    auto intensity = std::make_shared<std::vector<float>>();
+    P->reserve(total);
+    if(_attributes[NX]) N->reserve(total);
+    if(_attributes[RED]) C->reserve(total);
+    if(_attributes[INTENSITY]) intensity->reserve(total);
+
+    //every chunk only kept one point per voxel of its own, the first chunk
+    //that has a point in a voxel wins
+    std::unordered_set<uint64_t> voxels;
+    float voxelSize = _options.voxelSize;
+    for(auto &chunk : chunks) {
+        if(voxelSize <= 0) {
+            P->insert(P->end(), begin(chunk.P), end(chunk.P));
+            N->insert(N->end(), begin(chunk.N), end(chunk.N));
+            C->insert(C->end(), begin(chunk.C), end(chunk.C));
+            intensity->insert(intensity->end(), begin(chunk.intensity), end(chunk.intensity));
+        }
+        else {
+            for(size_t i = 0; i < chunk.P.size(); ++i) {
+                const glm::vec3 &point = chunk.P[i];
+                if(!voxels.insert(voxelKey(point.x, point.y, point.z, voxelSize)).second)
+                    continue;
+                P->push_back(point);
+                if(_attributes[NX]) N->push_back(chunk.N[i]);
+                if(_attributes[RED]) C->push_back(chunk.C[i]);
+                if(_attributes[INTENSITY]) intensity->push_back(chunk.intensity[i]);
+            }
+        }
+        chunk = Points();
+    }
+
+    auto mesh = std::make_shared<MeshData>();
+    mesh->setProperty("P", P);
+    if(_attributes[NX]) mesh->setProperty("N", N);
+    if(_attributes[RED]) mesh->setProperty("C", C);
+    if(_attributes[INTENSITY]) mesh->setProperty("intensity", intensity);
+    return mesh;
+}
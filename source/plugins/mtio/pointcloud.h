@@ -0,0 +1,55 @@
+#ifndef MT_POINTCLOUD_IMPORT_H
+#define MT_POINTCLOUD_IMPORT_H
+
+#include "string"
+#include "vector"
+#include "source/plugins/datatypes/Object/object.h"
+
+namespace MindTree {
+namespace IO {
+class MappedFile;
+}
+
+//reads PLY (ascii, binary little and big endian) and ascii XYZ point clouds
+//into the P, N, C and intensity columns of a MeshData without polygons.
+//The file is mapped and split into ranges of points that are decoded in
+//parallel. Every stride-th point is kept and, with a voxel size, only the
+//first point that falls into each cell of the grid
+class PointCloudImporter
+{
+public:
+    struct Options {
+        int stride = 1;
+        float voxelSize = 0;
+    };
+
+    PointCloudImporter(std::string filename, Options options);
+
+    //returns null if the file could not be read
+    MeshDataPtr import();
+
+    //the attributes a point can have, in the order they are decoded into
+    enum Attribute {
+        PX, PY, PZ, NX, NY, NZ, RED, GREEN, BLUE, INTENSITY, ATTRIBUTE_COUNT
+    };
+
+    struct Points;
+
+private:
+    MeshDataPtr importPLY(const IO::MappedFile &file);
+    MeshDataPtr importXYZ(const IO::MappedFile &file);
+
+    //parses whitespace separated values, one point per line. column maps
+    //the columns to attributes or -1, scale is applied per attribute
+    std::vector<Points> parseLines(const char *begin, const char *end, size_t maxLines,
+                                   const std::vector<int> &columns,
+                                   const std::vector<float> &scale);
+    MeshDataPtr merge(std::vector<Points> &chunks);
+
+    std::string _filename;
+    Options _options;
+    bool _attributes[ATTRIBUTE_COUNT];
+};
+}
+
+#endif
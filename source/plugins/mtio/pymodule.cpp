@@ -1,10 +1,131 @@
+#include "sstream"
+#include "thread"
+#include "atomic"
+#include "mutex"
+#include "map"
+#include "algorithm"
+#include "sys/stat.h"
 #include "obj.h"
+#include "pointcloud.h"
+#include "geometry_cache.h"
 #include "boost/python.hpp"
 #include "data/cache_main.h"
+#include "data/signal.h"
 #include "data/nodes/node_db.h"
+#include "data/async_loader.h"
+#include "data/python/pyutils.h"
 
 using namespace MindTree;
 
+namespace {
+    struct Bake {
+        std::atomic<bool> cancelled{false};
+        //held while a frame is evaluated
+        std::mutex evaluating;
+    };
+
+    //a new bake of the same file cancels the one that is running
+    std::mutex bakesMutex;
+    std::map<std::string, std::shared_ptr<Bake>> bakes;
+
+    //held by the bake that writes, the next one waits until a cancelled
+    //file is removed
+    std::mutex bakingMutex;
+
+    void forgetBake(const std::string &filename, const std::shared_ptr<Bake> &bake)
+    {
+        std::lock_guard<std::mutex> lock(bakesMutex);
+        auto it = bakes.find(filename);
+        if(it != bakes.end() && it->second == bake)
+            bakes.erase(it);
+    }
+
+    void bakeFrames(std::string filename, DoutSocket *socket, int start, int end,
+                    std::shared_ptr<Bake> bake)
+    {
+        //the scene is evaluated on this thread, a node that is deleted
+        //meanwhile cancels the bake once the frame that may use it is done
+        ConstNodeList upstream = socket->getNode()->getAllInNodesConst();
+        Signal::CallbackHandler deleted = Signal::getHandler<DNode*>()
+            .connect("nodeDeleted", [upstream, bake] (DNode *node) {
+                if(std::find(upstream.begin(), upstream.end(), node) == upstream.end())
+                    return;
+
+                bake->cancelled = true;
+                //the frame may need python, which this thread could hold
+                if(PyGILState_Check()) {
+                    Python::GILReleaser releaser;
+                    std::lock_guard<std::mutex> lock(bake->evaluating);
+                }
+                else {
+                    std::lock_guard<std::mutex> lock(bake->evaluating);
+                }
+            });
+
+        std::lock_guard<std::mutex> baking(bakingMutex);
+        if(bake->cancelled) {
+            forgetBake(filename, bake);
+            return;
+        }
+
+        GeometryCacheWriter writer(filename);
+        for(int frame = start; frame <= end && writer.isOpen(); ++frame) {
+            Property data;
+            {
+                std::lock_guard<std::mutex> evaluating(bake->evaluating);
+                if(bake->cancelled) break;
+
+                //the timeline and what viewers show stay untouched
+                FrameEvaluation evaluation(frame);
+                DataCache cache(socket);
+                data = cache.getOutput(socket);
+            }
+            if(data.getType() != "TRANSFORMABLE"
+               || !writer.writeFrame(frame, data.getData<AbstractTransformablePtr>()))
+                continue;
+
+            std::stringstream ss;
+            ss << "baking " << filename << " frame " << frame - start + 1 << "/" << end - start + 1;
+            MT_CUSTOM_SIGNAL_EMITTER("STATUSUPDATE", ss.str());
+        }
+
+        if(bake->cancelled) {
+            writer.discard();
+            MT_CUSTOM_SIGNAL_EMITTER("STATUSUPDATE", std::string("cancelled baking ") + filename);
+        }
+        else if(writer.close()) {
+            MT_CUSTOM_SIGNAL_EMITTER("STATUSUPDATE", std::string("done baking ") + filename);
+        }
+        forgetBake(filename, bake);
+    }
+
+    struct CacheFile {
+        std::shared_ptr<GeometryCacheReader> reader;
+        time_t modified;
+        off_t size;
+    };
+
+    //readers stay open for playback, they are opened again when the file
+    //was baked anew
+    std::shared_ptr<GeometryCacheReader> openCache(const std::string &filename)
+    {
+        static std::mutex mutex;
+        static std::map<std::string, CacheFile> files;
+
+        struct stat info;
+        if(stat(filename.c_str(), &info) != 0) return nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &file = files[filename];
+        if(!file.reader || file.modified != info.st_mtime || file.size != info.st_size) {
+            file.reader = std::make_shared<GeometryCacheReader>(filename);
+            file.modified = info.st_mtime;
+            file.size = info.st_size;
+        }
+        return file.reader->isOpen() ? file.reader : nullptr;
+    }
+}
+
 BOOST_PYTHON_MODULE(objio)
 {
     auto importFn = [] (bool raw)
@@ -21,11 +142,104 @@ BOOST_PYTHON_MODULE(objio)
         const ObjImportNode *node = cache->getNode()
             ->getDerivedConst<ObjImportNode>();
 
-        ObjImporter objio(node->getFilePath());
-        cache->pushData(objio.getGroup());
+        auto file = node->getFilePath();
+
+        //the file is read on an I/O thread, an empty group stands in until
+        //it is done
+        auto loaded = AsyncLoader::request(node, file,
+                                           [file] (const AsyncLoader::Progress &progress) {
+            return Property(ObjImporter(file, progress).getGroup());
+        });
+
+        std::shared_ptr<Group> grp;
+        if(loaded) grp = loaded.getData<std::shared_ptr<Group>>();
+        if(!grp) grp = std::make_shared<Group>();
+        cache->pushData(grp);
     };
 
     DataCache::addProcessor(new CacheProcessor(SocketType("GROUPDATA"),
                                                NodeType("OBJIMPORT"),
                                                proc));
+
+    auto importPointCloud = [] (MindTree::DataCache* cache)
+    {
+        auto file = cache->getData(0).getData<std::string>();
+        auto trans = cache->getData(1).getData<glm::mat4>();
+
+        if(file.empty())
+            return;
+
+        PointCloudImporter::Options options;
+        options.stride = std::max(1, cache->getData(2).getData<int>());
+        options.voxelSize = cache->getData(3).getData<double>();
+
+        //the options change what is loaded, so they are part of the key
+        std::stringstream key;
+        key << file << " stride " << options.stride << " voxel size " << options.voxelSize;
+        auto loaded = AsyncLoader::request(cache->getNode(), key.str(),
+                                           [file, options] (const AsyncLoader::Progress&) {
+            return Property(PointCloudImporter(file, options).import());
+        });
+
+        AbstractTransformablePtr ret;
+        if(loaded && loaded.getData<MeshDataPtr>()) {
+            auto obj = std::make_shared<GeoObject>();
+            obj->setName(file.substr(file.find_last_of('/') + 1));
+            obj->setData(loaded.getData<MeshDataPtr>());
+            ret = obj;
+        }
+        else {
+            //stands in until the points are loaded
+            ret = std::make_shared<Empty>();
+        }
+        ret->setTransformation(trans);
+        cache->pushData(ret);
+    };
+
+    DataCache::addProcessor(new CacheProcessor(SocketType("TRANSFORMABLE"),
+                                               NodeType("POINTCLOUDIMPORT"),
+                                               importPointCloud));
+
+    auto bakeGeometryCache = [] (MindTree::DataCache* cache)
+    {
+        auto file = cache->getData(0).getData<std::string>();
+        int start = cache->getData(2).getData<int>();
+        int end = cache->getData(3).getData<int>();
+
+        DoutSocket *scene = cache->getNode()->getInSockets()[1]->getCntdSocket();
+        if(file.empty() || !scene || end < start)
+            return;
+
+        auto bake = std::make_shared<Bake>();
+        {
+            std::lock_guard<std::mutex> lock(bakesMutex);
+            auto &running = bakes[file];
+            if(running) running->cancelled = true;
+            running = bake;
+        }
+        std::thread(bakeFrames, file, scene, start, end, bake).detach();
+    };
+
+    DataCache::addProcessor(new CacheProcessor(SocketType("ACTION"),
+                                               NodeType("GEOCACHEWRITE"),
+                                               bakeGeometryCache));
+
+    auto readGeometryCache = [] (MindTree::DataCache* cache)
+    {
+        auto file = cache->getData(0).getData<std::string>();
+        int frame = cache->getData(1).getData<int>();
+        auto trans = cache->getData(2).getData<glm::mat4>();
+
+        AbstractTransformablePtr ret;
+        auto reader = openCache(file);
+        if(reader) ret = reader->readFrame(frame);
+        if(!ret) ret = std::make_shared<Empty>();
+
+        ret->setTransformation(trans * ret->getTransformation());
+        cache->pushData(ret);
+    };
+
+    DataCache::addProcessor(new CacheProcessor(SocketType("TRANSFORMABLE"),
+                                               NodeType("GEOCACHEREAD"),
+                                               readGeometryCache));
 }
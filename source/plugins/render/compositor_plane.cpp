@@ -106,6 +106,18 @@ void Compositor::init()
     }
 
     _config->addSettings("LayerSettings", layerSettings);
+    updateInputs();
+}
+
+void Compositor::updateInputs()
+{
+    //layers are bound as "layer", so the render tree cannot see them
+    std::vector<std::string> inputs;
+    for(const auto &info : _plane->getLayers()) {
+        if(info.enabled)
+            inputs.push_back(info.texture->getName());
+    }
+    _pixelPass->setInputs(inputs);
 }
 
 void Compositor::setProperty(std::string name, Property prop)
@@ -126,8 +138,10 @@ void Compositor::setProperty(std::string name, Property prop)
                                return info.texture->getName() == name;
                            });
     if (it != end(layers)) {
-        if(setting == "enabled")
+        if(setting == "enabled") {
             it->enabled = prop.getData<bool>();
+            updateInputs();
+        }
         else if(setting == "mixValue")
             it->mixValue = prop.getData<double>();
     } else if (name == "GL:CUSTOMPIXELSHADER") {
@@ -148,6 +162,7 @@ void Compositor::setProperty(std::string name, Property prop)
             auto *tx = texture.get();
             custom_pass_->addOutput(std::move(texture));
             addLayer(tx, 1.0, CompositorPlane::CompositType::ALPHAOVER);
+            updateInputs();
         }
         else {
             custom_pass_->clearRenderers();
@@ -50,6 +50,8 @@ public:
     std::vector<std::string> getLayerNames() const;
 
  private:
+    void updateInputs();
+
     CompositorPlane *_plane;
     RenderPass *_pixelPass;
     RenderPass *custom_pass_;
@@ -0,0 +1,60 @@
+#version 330
+
+uniform sampler2D lowres;
+uniform sampler2D worldposition;
+uniform sampler2D outnormal;
+
+uniform mat4 view;
+
+//relative difference in camera distance at which a sample is ignored
+uniform float depthTolerance = 0.05;
+uniform float normalPower = 8;
+
+in vec2 st;
+
+out vec4 upsampled;
+
+void main()
+{
+    vec4 pos = texture(worldposition, st);
+    if(pos.a < 0.5) {
+        upsampled = texture(lowres, st);
+        return;
+    }
+
+    vec3 N = normalize(texture(outnormal, st).xyz);
+    vec3 camPos = (inverse(view) * vec4(0, 0, 0, 1)).xyz;
+    float dist = distance(pos.xyz, camPos);
+
+    ivec2 lowSize = textureSize(lowres, 0);
+    ivec2 fullSize = textureSize(worldposition, 0);
+    vec2 fp = st * lowSize - 0.5;
+    ivec2 base = ivec2(floor(fp));
+    vec2 f = fp - base;
+
+    vec4 sum = vec4(0);
+    float weightSum = 0;
+    for(int i = 0; i < 4; ++i) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 texel = clamp(base + offset, ivec2(0), lowSize - 1);
+
+        //the gbuffer where the low resolution pixel was shaded
+        ivec2 fullTexel = ivec2((vec2(texel) + 0.5) / lowSize * fullSize);
+        vec4 p = texelFetch(worldposition, fullTexel, 0);
+        vec3 n = normalize(texelFetch(outnormal, fullTexel, 0).xyz);
+
+        vec2 bilinear2 = mix(1 - f, f, vec2(offset));
+        float bilinear = bilinear2.x * bilinear2.y;
+        float depthWeight = 0;
+        if(p.a > 0.5)
+            depthWeight = exp(-abs(distance(p.xyz, camPos) - dist) / (depthTolerance * dist));
+        float normalWeight = pow(max(dot(N, n), 0), normalPower);
+
+        //falls back to bilinear when no sample matches
+        float weight = bilinear * (depthWeight * normalWeight + 1e-4);
+        sum += texelFetch(lowres, texel, 0) * weight;
+        weightSum += weight;
+    }
+
+    upsampled = sum / max(weightSum, 1e-8);
+}
@@ -30,6 +30,7 @@ struct Light {
     vec4 pos;
     vec3 dir;
     mat4 shadowmvp;
+    vec4 atlasRegion;
     int shadow;
     float bias;
 };
@@ -123,6 +124,11 @@ void main(){
         shadowP.z -= light.bias;
         inLight = texture(shadow, shadowP.xyz);
 
+        //do not pick up other lights shadows from the atlas
+        if(any(lessThan(shadowP.xy, light.atlasRegion.xy))
+           || any(greaterThan(shadowP.xy, light.atlasRegion.xy + light.atlasRegion.zw)))
+            inLight = 1;
+
         inLight += clamp(1 - light.shadow, 0, 1);
     }
 
@@ -0,0 +1,165 @@
+#version 430
+#define MAX_CASCADES 4
+
+vec3 pos;
+vec3 Nn;
+
+vec3 eye;
+uniform mat4 view;
+uniform bool GL_defaultLighting = true;
+
+in vec2 st;
+uniform ivec2 resolution;
+
+uniform sampler2D outnormal;
+uniform sampler2D outposition;
+uniform sampler2D outdiffusecolor;
+uniform sampler2D outspecroughness;
+uniform sampler2D outspecintensity;
+uniform sampler2DShadow shadow;
+
+uniform ivec3 clusterGrid;
+uniform float clusterNear;
+uniform float clusterFar;
+uniform bool clusterLinear;
+uniform int numDistantLights;
+
+out vec4 shading_out;
+
+const float GAMMA=2.2;
+
+struct Light {
+    vec4 color;
+    vec4 pos;
+    vec4 dir;       // xyz: direction, w: cone angle
+    vec4 params;    // x: intensity, y: bias, z: number of shadow matrices, w: range
+    vec4 cascadeSplits;
+    vec4 regions[MAX_CASCADES];
+    mat4 shadowmvp[MAX_CASCADES];
+};
+
+layout(std430, binding = 0) readonly buffer LightBuffer {
+    Light lights[];
+};
+
+// offset and count into lightIndices for every cluster
+layout(std430, binding = 1) readonly buffer ClusterBuffer {
+    uvec2 clusters[];
+};
+
+layout(std430, binding = 2) readonly buffer LightIndexBuffer {
+    uint lightIndices[];
+};
+
+vec3 gamma(vec3 col, float g) {
+    return pow(col, vec3(g));
+}
+
+float value(vec3 col) {
+    return (col.r + col.g + col.b) / 3;
+}
+
+float sampleShadow(Light light, float depth) {
+    int numMatrices = int(light.params.z);
+    if(numMatrices == 0)
+        return 1;
+
+    //pick the first cascade that reaches past this pixel
+    int cascade = 0;
+    while(cascade < numMatrices - 1 && depth > light.cascadeSplits[cascade])
+        ++cascade;
+
+    vec4 shadowP = light.shadowmvp[cascade] * vec4(pos, 1);
+    shadowP /= shadowP.w;
+    shadowP += 1;
+    shadowP *= 0.5;
+
+    //outside of the lights atlas region there is no shadow information
+    vec4 region = light.regions[cascade];
+    if(any(lessThan(shadowP.xy, region.xy))
+       || any(greaterThan(shadowP.xy, region.xy + region.zw)))
+        return 1;
+
+    shadowP.z -= light.params.y;
+    return texture(shadow, shadowP.xyz);
+}
+
+vec3 shadeLight(Light light, float depth, vec3 diffuse_color, float specint, float specrough) {
+    vec3 lvec;
+    float atten = 1;
+    float angleMask = 1;
+    float inLight = 1;
+    float intensity = light.params.x;
+
+    if(light.pos.w > 0.1) {// is point
+        lvec = light.pos.xyz - pos;
+        float dist2 = dot(lvec, lvec);
+        //window the falloff, so it reaches zero at the cluster range
+        float window = clamp(1 - pow(dist2 / (light.params.w * light.params.w), 2), 0, 1);
+        atten = window * window / dist2;
+    } else {
+        lvec = -light.dir.xyz;
+    }
+    lvec = normalize(lvec);
+
+    if(length(light.dir.xyz) > 0.1
+       && light.pos.w > 0.1) { // is spot
+        float lightAngleCos = abs(dot(lvec, normalize(light.dir.xyz)));
+        float lightangle = acos(lightAngleCos);
+        angleMask = smoothstep(light.dir.w, light.dir.w - 0.1, lightangle);
+        angleMask *= lightAngleCos;
+    }
+    inLight = sampleShadow(light, depth);
+
+    vec3 lightcolor = gamma(light.color.rgb, GAMMA) * intensity * atten;
+
+    float cosine = clamp(dot(Nn, lvec), 0.0, 1.0);
+    vec3 diff = lightcolor * cosine * diffuse_color;
+
+    vec3 Half = normalize(eye + lvec);
+    float spec_cosine = pow(clamp(dot(Nn, Half), 0., 1.), 1./specrough);
+    vec3 spec = lightcolor * spec_cosine * specint;
+
+    vec3 diffspec = mix(diff, spec, value(spec));
+    return diffspec * angleMask * inLight;
+}
+
+void main(){
+    if (GL_defaultLighting)
+        eye = vec3(0, 0, 1);
+    else
+        eye = normalize((view * vec4(0, 0, 1, 0)).xyz);
+
+    ivec2 p = ivec2(st.x * resolution.x, st.y * resolution.y);
+    vec4 _pos = texelFetch(outposition, p, 0);
+    if (_pos.a < 0.5)
+        discard;
+
+    pos = _pos.xyz;
+    Nn = normalize(texelFetch(outnormal, p, 0).xyz);
+
+    vec3 diffuse_color = texture(outdiffusecolor, st).rgb;
+    float specint = texture(outspecintensity, st).r;
+    float specrough = texture(outspecroughness, st).r;
+
+    vec3 color = vec3(0);
+    float depth = GL_defaultLighting ? -pos.z : -(view * vec4(pos, 1)).z;
+
+    //distant lights are not binned and affect every cluster
+    for(int i = 0; i < numDistantLights; ++i)
+        color += shadeLight(lights[i], depth, diffuse_color, specint, specrough);
+
+    float sliceDepth = max(depth, clusterNear);
+    int slice = clusterLinear
+        ? int((sliceDepth - clusterNear) / (clusterFar - clusterNear) * clusterGrid.z)
+        : int(log(sliceDepth / clusterNear) / log(clusterFar / clusterNear) * clusterGrid.z);
+    ivec3 cluster = clamp(ivec3(st * clusterGrid.xy, slice),
+                          ivec3(0),
+                          clusterGrid - 1);
+    uvec2 range = clusters[(cluster.z * clusterGrid.y + cluster.y) * clusterGrid.x + cluster.x];
+
+    for(uint i = range.x; i < range.x + range.y; ++i)
+        color += shadeLight(lights[lightIndices[i]], depth, diffuse_color, specint, specrough);
+
+    shading_out = vec4(color, 1);
+}
@@ -6,6 +6,7 @@ in vec3 cameraPos;
 in vec3 cameraNormal;
 in vec3 sn;
 in vec3 worldNormal;
+in vec2 uv;
 
 uniform float has_polygon_color = 0.0;
 uniform vec4 diffuse_color = vec4(1);
@@ -23,6 +24,8 @@ out vec4 outcolor;
 uniform int flatShading = 0;
 
 uniform sampler1D polygon_color;
+uniform sampler2D diffuse_texture;
+uniform float has_diffuse_texture = 0.0;
 
 vec3 Nn;
 
@@ -33,7 +36,7 @@ void main() {
     worldposition = vec4(worldPos, 1);
 
     //outdiffusecolor = vec4(vec3(has_polygon_color), 1.0);
-    outdiffusecolor = diffuse_color;
+    outdiffusecolor = diffuse_color * mix(vec4(1), texture(diffuse_texture, uv), has_diffuse_texture);
     //outdiffusecolor = mix(diffuse_color,
     //                      texelFetch(polygon_color, gl_PrimitiveID, 0),
     //                      has_polygon_color);
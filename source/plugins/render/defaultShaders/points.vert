@@ -1,6 +1,5 @@
 #version 330
-in vec3 P;
-in vec3 C;
+#pragma vertex_layout(P, C)
 out vec3 vertex_color;
 uniform float has_vertex_color = 0.0f;
 uniform mat4 modelView;
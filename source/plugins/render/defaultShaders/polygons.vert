@@ -5,8 +5,7 @@ uniform mat4 projection;
 
 uniform bool GL_defaultLighting = true;
 
-in vec3 P;
-in vec3 N;
+#pragma vertex_layout(P, N, UV)
 
 out vec3 pos;
 out vec3 worldPos;
@@ -14,6 +13,7 @@ out vec3 cameraPos;
 out vec3 cameraNormal;
 out vec3 sn;
 out vec3 worldNormal;
+out vec2 uv;
 
 void main(){
    gl_Position = projection * modelView * vec4(P, 1);
@@ -22,6 +22,7 @@ void main(){
    worldNormal = (model * vec4(N, 0)).xyz;
    cameraPos = (modelView * vec4(P, 1)).xyz;
    cameraNormal = (modelView * vec4(N, 0)).xyz;
+   uv = UV;
 
    if(GL_defaultLighting) {
        pos = cameraPos;
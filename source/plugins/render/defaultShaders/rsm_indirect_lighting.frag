@@ -9,6 +9,9 @@ uniform sampler2D outdiffusecolor;
 uniform sampler2D outdiffuseintensity;
 
 uniform sampler1D samplingPattern;
+//per pixel rotation of the sampling pattern
+uniform sampler2D blueNoise;
+uniform vec2 frameOffset;
 
 uniform bool highres = false;
 
@@ -19,6 +22,7 @@ struct Light {
     vec4 pos;
     vec3 dir;
     mat4 shadowmvp;
+    vec4 atlasRegion;
     int shadow;
 };
 
@@ -33,7 +37,7 @@ uniform Light light;
 uniform float searchradius;
 uniform float intensity;
 
-uniform int numSamples = 400;
+uniform int numSamples = 64;
 
 out vec4 rsm_indirect_out;
 
@@ -60,17 +64,24 @@ void main()
     shadowP += 1;
     shadowP *= 0.5;
 
+    ivec2 noiseSize = textureSize(blueNoise, 0);
+    vec2 rotation = texelFetch(blueNoise, ivec2(gl_FragCoord.xy) % noiseSize, 0).rg;
+    rotation = fract(rotation + frameOffset);
+
     vec3 indirect = vec3(0);
     for(int i = 0; i < numSamples; ++i) {
-        vec2 samplePosPolar = texelFetch(samplingPattern, i, 0).rg;
+        vec2 samplePosPolar = fract(texelFetch(samplingPattern, i, 0).rg + rotation);
         float radius = samplePosPolar.y;
 
         float radius_squared = radius * radius;
         float polar = 2 * PI * samplePosPolar.x;
         vec2 sampleOffset = vec2(sin(polar), cos(polar)) * radius;
-        sampleOffset *= searchradius * 0.5;
+        sampleOffset *= searchradius * 0.5 * light.atlasRegion.zw;
 
-        vec2 samplePosition = shadowP.xy + sampleOffset;
+        //stay inside the lights region of the shadow atlas
+        vec2 samplePosition = clamp(shadowP.xy + sampleOffset,
+                                    light.atlasRegion.xy,
+                                    light.atlasRegion.xy + light.atlasRegion.zw);
 
         vec3 flux = texture(shadow_flux, samplePosition).rgb;
         vec3 n = texture(shadow_normal, samplePosition).xyz;
@@ -13,7 +13,10 @@ uniform mat4 projection;
 const float MAXDIST = 5;
 const int MAXSTEPS = 50;
 const float thickness = 0.5;
-uniform float jitter=0.8;
+//per pixel start offset along the first step
+uniform sampler2D blueNoise;
+uniform vec2 frameOffset;
+float jitter;
 
 out vec4 reflection;
 out vec4 reflection_dir;
@@ -47,6 +50,8 @@ bool traceScreen(vec3 start, vec3 dir, out vec2 coord)
 void main()
 {
     camPos = (inverse(view) * vec4(0, 0, 0, 1)).xyz;
+    ivec2 noiseSize = textureSize(blueNoise, 0);
+    jitter = fract(texelFetch(blueNoise, ivec2(gl_FragCoord.xy) % noiseSize, 0).r + frameOffset.x);
     vec4 n = texture(outnormal, st);
     if(n.a < 0.5) discard;
     n.xyz = normalize(n.xyz);
@@ -0,0 +1,41 @@
+#version 330
+
+uniform sampler2D current;
+uniform sampler2D history;
+uniform sampler2D worldposition;
+
+uniform mat4 view;
+uniform mat4 previousViewProjection;
+uniform vec3 previousCameraPosition;
+uniform bool hasHistory = false;
+uniform float blend = 1;
+
+in vec2 st;
+
+out vec4 accumulated;
+out vec4 accumulated_history;
+
+//relative difference in camera distance up to which the history is reused
+const float DEPTH_TOLERANCE = 0.02;
+
+void main()
+{
+    vec4 value = texture(current, st);
+    vec4 pos = texture(worldposition, st);
+    vec3 camPos = (inverse(view) * vec4(0, 0, 0, 1)).xyz;
+
+    vec3 result = value.rgb;
+    if(hasHistory && pos.a > 0.5) {
+        vec4 prev = previousViewProjection * vec4(pos.xyz, 1);
+        vec2 uv = (prev.xy / prev.w) * 0.5 + 0.5;
+        if(prev.w > 0 && all(greaterThanEqual(uv, vec2(0))) && all(lessThanEqual(uv, vec2(1)))) {
+            vec4 h = texture(history, uv);
+            float dist = distance(pos.xyz, previousCameraPosition);
+            if(abs(h.a - dist) <= DEPTH_TOLERANCE * dist)
+                result = mix(h.rgb, value.rgb, blend);
+        }
+    }
+
+    accumulated = vec4(result, value.a);
+    accumulated_history = vec4(result, pos.a > 0.5 ? distance(pos.xyz, camPos) : -1);
+}
@@ -20,12 +20,23 @@ void DeferredLightingRenderBlock::setProperty(std::string name, Property prop)
     RenderBlock::setProperty(name, prop);
     if(name == "GL:defaultLighting") {
         if(prop.getData<bool>()) {
-            _deferredRenderer->setLights(_defaultLights);
+            setLights(_defaultLights);
         }
         else {
-            _deferredRenderer->setLights(_sceneLights);
+            setLights(_sceneLights);
         }
     }
+    if(name == "GL:clusteredLighting") {
+        bool clustered = prop.getData<bool>();
+        _clusteredRenderer->setVisible(clustered);
+        _deferredRenderer->setVisible(!clustered);
+    }
+}
+
+void DeferredLightingRenderBlock::setLights(std::vector<std::shared_ptr<Light>> lights)
+{
+    _deferredRenderer->setLights(lights);
+    _clusteredRenderer->setLights(lights);
 }
 
 void DeferredLightingRenderBlock::setGeometry(std::shared_ptr<Group> grp)
@@ -35,12 +46,14 @@ void DeferredLightingRenderBlock::setGeometry(std::shared_ptr<Group> grp)
 
     if(grp->hasProperty("GL:defaultLighting"))
         if(!grp->getProperty("GL:defaultLighting").getData<bool>())
-            _deferredRenderer->setLights(_sceneLights);
+            setLights(_sceneLights);
         else
-            _deferredRenderer->setLights(_defaultLights);
+            setLights(_defaultLights);
 
-    if(_shadowBlock)
-        _deferredRenderer->setShadowPasses(_shadowBlock->getShadowPasses());
+    if(_shadowBlock) {
+        _deferredRenderer->setShadowBlock(_shadowBlock);
+        _clusteredRenderer->setShadowBlock(_shadowBlock);
+    }
 }
 
 void DeferredLightingRenderBlock::addRendererFromLight(LightPtr obj)
@@ -70,8 +83,13 @@ void DeferredLightingRenderBlock::init()
         ->addOutput(make_resource<Texture2D>(_config->getTree()->getResourceManager(),
                                              "shading_out",
                                              Texture::RGBA16F));
+    //one fullscreen quad per light, or all lights at once binned into
+    //clusters, switched with GL:clusteredLighting
     _deferredRenderer = new LightAccumulationPlane();
+    _deferredRenderer->setVisible(false);
     _deferredPass->addRenderer(_deferredRenderer);
+    _clusteredRenderer = new ClusteredLightPlane();
+    _deferredPass->addRenderer(_clusteredRenderer);
     _deferredPass->setBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
 
     setupDefaultLights();
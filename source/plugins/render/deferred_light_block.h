@@ -8,6 +8,7 @@ namespace MindTree
 namespace GL
 {
 class LightAccumulationPlane;
+class ClusteredLightPlane;
 
 class DeferredLightingRenderBlock : public RenderBlock
 {
@@ -23,7 +24,10 @@ protected:
 
 private:
     void setupDefaultLights();
+    void setLights(std::vector<std::shared_ptr<Light>> lights);
+
     LightAccumulationPlane *_deferredRenderer;
+    ClusteredLightPlane *_clusteredRenderer;
     std::weak_ptr<RenderPass> _deferredPass;
 
     ShadowMappingRenderBlock *_shadowBlock;
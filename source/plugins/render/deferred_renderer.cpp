@@ -114,6 +114,12 @@ glm::vec4 DeferredRenderer::getPosition(glm::vec2 pixel) const
     return _geometryPass->readPixelSync(values, pixel)[0];
 }
 
+std::future<std::vector<glm::vec4>>
+DeferredRenderer::requestPositions(const std::vector<glm::ivec2> &pixels) const
+{
+    return _geometryPass->readPixelsAsync({"worldposition"}, pixels);
+}
+
 void DeferredRenderer::setProperty(const std::string &name, Property prop)
 {
     RenderConfigurator::setProperty(name, prop);
@@ -130,6 +136,10 @@ void DeferredRenderer::setProperty(const std::string &name, Property prop)
         auto value = prop.getData<glm::vec3>();
         _viewCenter->setPosition(value);
     }
+    if (name == "GL:occlusionCulling") {
+        auto value = prop.getData<bool>();
+        _geometryPass->setOcclusionCulling(value);
+    }
     if (name == "GL:backgroundColor") {
         auto value = prop.getData<glm::vec4>();
         _finalPass->setBackgroundColor(value);
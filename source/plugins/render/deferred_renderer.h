@@ -23,6 +23,8 @@ public:
     void setOverrideOutput(std::string output) override;
     void clearOverrideOutput() override;
     glm::vec4 getPosition(glm::vec2 pixel) const override;
+    std::future<std::vector<glm::vec4>>
+        requestPositions(const std::vector<glm::ivec2> &pixels) const override;
 
     void setCamera(std::shared_ptr<Camera> cam) override;
 
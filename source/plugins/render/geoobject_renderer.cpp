@@ -1,3 +1,4 @@
+#include "algorithm"
 #include "glwrapper.h"
 #include "rendertree.h"
 #include "geoobject_renderer.h"
@@ -6,7 +7,9 @@ using namespace MindTree;
 using namespace MindTree::GL;
 
 GeoObjectRenderer::GeoObjectRenderer(std::shared_ptr<GeoObject> o)
-    : obj(o)
+    : obj(o),
+    _lodBias(0),
+    _boundsRadius(0)
 {
     setTransformation(obj->getWorldTransformation());
 }
@@ -15,21 +18,77 @@ GeoObjectRenderer::~GeoObjectRenderer()
 {
 }
 
+const AbstractTransformable* GeoObjectRenderer::getCullObject() const
+{
+    return obj.get();
+}
+
 void GeoObjectRenderer::init(ShaderProgram* prog)
 {
     auto data = obj->getData();
-    auto propmap = data->getProperties();
-    for(auto propPair : propmap){
-        bool has_attr = prog->hasAttribute(propPair.first);
-        if(has_attr) {
-            getResourceManager()->geometryCache()->uploadData(data.get(), propPair.first);
-            auto vbo = getResourceManager()->geometryCache()->getVBO(data.get(), propPair.first);
-            prog->bindAttributeLocation(vbo);
+    auto *cache = getResourceManager()->geometryCache();
+    const auto &vertices = cache->uploadVertices(data.get());
+    for(const auto &attribute : vertices.layout.getAttributes()) {
+        std::string input = VertexLayout::getInputName(attribute.name);
+        if(!prog->hasAttribute(input)) continue;
+
+        GLuint index = cache->getIndexForAttribute(attribute.name);
+        vertices.layout.setPointer(attribute, index);
+        prog->bindAttributeLocation(index, input);
+    }
+
+    if(data->getType() == ObjectData::MESH
+       && std::static_pointer_cast<MeshData>(data)->getLODs()
+       && data->hasProperty("P")) {
+        auto vertices = data->getProperty("P").getData<VertexListPtr>();
+        if(vertices && !vertices->empty()) {
+            glm::vec3 low = vertices->front(), high = vertices->front();
+            for(const auto &v : *vertices) {
+                low = glm::min(low, v);
+                high = glm::max(high, v);
+            }
+            _boundsCenter = (low + high) * .5f;
+            _boundsRadius = glm::length(high - low) * .5f;
         }
     }
     initCustom();
 }
 
+void GeoObjectRenderer::setLODBias(int bias)
+{
+    _lodBias = bias;
+}
+
+size_t GeoObjectRenderer::selectLOD(const CameraPtr &camera, const std::vector<float> &errors)
+{
+    if(errors.empty() || !camera) return 0;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glm::mat4 model = getGlobalTransformation();
+    float scale = std::max(glm::length(glm::vec3(model[0])),
+                           std::max(glm::length(glm::vec3(model[1])),
+                                    glm::length(glm::vec3(model[2]))));
+    glm::vec4 center = camera->getViewMatrix() * model * glm::vec4(_boundsCenter, 1);
+    glm::mat4 projection = camera->getProjection();
+
+    //distance of the closest point of the bounds, the camera inside of the
+    //bounds always gets the full mesh
+    float depth = 1;
+    if(!camera->isOrthographic()) {
+        depth = -center.z - _boundsRadius * scale;
+        if(depth <= 0) return 0;
+    }
+    float pixelsPerUnit = projection[1][1] * .5f * viewport[3] / depth;
+
+    //errors grow with every level
+    size_t lod = 0;
+    while(lod < errors.size() && errors[lod] * scale * pixelsPerUnit < 1)
+        ++lod;
+    return std::min(lod + std::max(_lodBias.load(), 0), errors.size());
+}
+
 void GeoObjectRenderer::initCustom()
 {
 }
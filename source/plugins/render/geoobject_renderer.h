@@ -12,7 +12,16 @@ public:
     GeoObjectRenderer(std::shared_ptr<GeoObject> o);
     virtual ~GeoObjectRenderer();
 
+    const AbstractTransformable* getCullObject() const override;
+
+    //draw this many levels of detail coarser than the screen size asks for,
+    //for passes that are blurry or low resolution anyway
+    void setLODBias(int bias);
+
 protected:
+    //level of detail that keeps the error below a pixel, 0 is the full mesh
+    size_t selectLOD(const CameraPtr &camera, const std::vector<float> &errors);
+
     virtual void draw(const CameraPtr &camera, const RenderConfig &config, ShaderProgram* program);
 
     void init(ShaderProgram* prog);
@@ -22,6 +31,10 @@ protected:
 
 private:
     void setUniforms();
+
+    std::atomic<int> _lodBias;
+    glm::vec3 _boundsCenter;
+    float _boundsRadius;
 };
 
 }
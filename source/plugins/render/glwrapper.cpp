@@ -5,8 +5,12 @@
 #include "glm/gtx/string_cast.hpp"
 #include "iostream"
 #include "fstream"
+#include "algorithm"
+#include "cstring"
 #include "data/debuglog.h"
 #include <regex>
+#include "shader_library.h"
+#include "vertex_layout.h"
 
 #include "glwrapper.h"
 
@@ -189,6 +193,21 @@ GLint VBO::getIndex() const
     return _index;
 }
 
+InterleavedVBO::InterleavedVBO() :
+    Buffer(GL_ARRAY_BUFFER)
+{
+}
+
+InterleavedVBO::~InterleavedVBO()
+{
+}
+
+void InterleavedVBO::data(const std::vector<unsigned char> &bytes)
+{
+    glBufferData(GL_ARRAY_BUFFER, bytes.size(), bytes.data(), GL_STATIC_DRAW);
+    MTGLERROR;
+}
+
 IBO::IBO()
     : Buffer(GL_ELEMENT_ARRAY_BUFFER)
 {
@@ -255,6 +274,179 @@ UBO::~UBO()
 {
 }
 
+SSBO::SSBO()
+    : Buffer(GL_SHADER_STORAGE_BUFFER)
+{
+}
+
+SSBO::~SSBO()
+{
+}
+
+void SSBO::data(const void *data, size_t size)
+{
+    bind();
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    MTGLERROR;
+    release();
+}
+
+void SSBO::bindBase(GLuint index)
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, getID());
+    MTGLERROR;
+}
+
+PBO::PBO()
+    : Buffer(GL_PIXEL_PACK_BUFFER), _size(0), _fence(nullptr)
+{
+}
+
+PBO::~PBO()
+{
+    if(_fence) glDeleteSync(_fence);
+}
+
+void PBO::read(int x, int y, int width, int height, GLenum format, GLenum type, size_t size)
+{
+    allocate(size);
+    bind();
+    readAt(x, y, width, height, format, type, 0);
+    release();
+    fence();
+}
+
+void PBO::allocate(size_t size)
+{
+    if(size == _size) return;
+
+    bind();
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    MTGLERROR;
+    release();
+    _size = size;
+}
+
+void PBO::readAt(int x, int y, int width, int height, GLenum format, GLenum type, size_t offset)
+{
+    glReadPixels(x, y, width, height, format, type, reinterpret_cast<void*>(offset));
+    MTGLERROR;
+}
+
+void PBO::fence()
+{
+    if(_fence) glDeleteSync(_fence);
+    _fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    MTGLERROR;
+}
+
+bool PBO::isPending() const
+{
+    return _fence != nullptr;
+}
+
+bool PBO::isReady() const
+{
+    if(!_fence) return false;
+    GLenum result = glClientWaitSync(_fence, 0, 0);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+void PBO::wait()
+{
+    if(!_fence) return;
+    while(true) {
+        //1ms steps, flush on the first wait so the fence gets submitted
+        GLenum result = glClientWaitSync(_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        if(result != GL_TIMEOUT_EXPIRED) break;
+    }
+}
+
+bool PBO::copyTo(void *dst, size_t size)
+{
+    if(!_fence) return false;
+    wait();
+    glDeleteSync(_fence);
+    _fence = nullptr;
+
+    bind();
+    void *src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, std::min(size, _size), GL_MAP_READ_BIT);
+    if(src) {
+        memcpy(dst, src, std::min(size, _size));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    MTGLERROR;
+    release();
+    return src != nullptr;
+}
+
+size_t PBO::getSize() const
+{
+    return _size;
+}
+
+UploadPBO::UploadPBO()
+    : Buffer(GL_PIXEL_UNPACK_BUFFER), _size(0), _fence(nullptr)
+{
+}
+
+UploadPBO::~UploadPBO()
+{
+    if(_fence) glDeleteSync(_fence);
+}
+
+void UploadPBO::allocate(size_t size)
+{
+    if(size == _size) return;
+
+    bind();
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    MTGLERROR;
+    release();
+    _size = size;
+}
+
+size_t UploadPBO::getSize() const
+{
+    return _size;
+}
+
+void* UploadPBO::map()
+{
+    void *data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                  0,
+                                  _size,
+                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    MTGLERROR;
+    return data;
+}
+
+bool UploadPBO::unmap()
+{
+    bool success = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    MTGLERROR;
+    return success;
+}
+
+void UploadPBO::fence()
+{
+    if(_fence) glDeleteSync(_fence);
+    _fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    MTGLERROR;
+}
+
+bool UploadPBO::isReady()
+{
+    if(!_fence) return true;
+    GLenum result = glClientWaitSync(_fence, 0, 0);
+    if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        return false;
+
+    glDeleteSync(_fence);
+    _fence = nullptr;
+    return true;
+}
+
 //#define DEBUG_FBO
 
 FBO::FBO()
@@ -322,7 +514,7 @@ void FBO::attachColorTexture(Texture2D *tex)
 
 void FBO::attachColorRenderbuffer(Renderbuffer *rb)
 {
-    if(std::find(begin(_renderbuffers), end(_renderbuffers), rb) == end(_renderbuffers))
+    if(std::find(begin(_renderbuffers), end(_renderbuffers), rb) != end(_renderbuffers))
         return;
 
     _renderbuffers.push_back(rb);
@@ -497,6 +689,13 @@ void ShaderProgram::init()
     _initialized = true;
     _id = glCreateProgram();
     MTGLERROR;
+    glProgramParameteri(_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    MTGLERROR;
+
+    if(ShaderLibrary::instance()->loadBinary(_id, getBinaryKey())) {
+        _fromBinary = true;
+        return;
+    }
 
 #ifdef DEBUG_GL_WRAPPER_SHADER
     dbout("initializing GLSL Shader");
@@ -507,6 +706,12 @@ void ShaderProgram::init()
     link();
 }
 
+std::string ShaderProgram::getBinaryKey() const
+{
+    std::map<int, std::string> sources(_shaderSources.begin(), _shaderSources.end());
+    return ShaderLibrary::makeKey(sources, _bindings);
+}
+
 std::string ShaderProgram::shaderTypeStr(int type)
 {
     switch(type) {
@@ -533,25 +738,16 @@ void ShaderProgram::bind()
     glUseProgram(_id);
     _isBound  = !MTGLERROR;
 
-    std::vector<GLint> garbage;
     for (size_t i = 0; i < _textures.size(); ++i) {
-        const auto &tx = _textures[i];
-        if(!glIsTexture(tx.texture)) {
-            garbage.push_back(tx.texture);
-            continue;
-        }
+        auto &tx = _textures[i];
+        //a deleted texture leaves its slot empty, the samplers still point
+        //at the slots of the others
+        if(tx.texture && !glIsTexture(tx.texture))
+            tx.texture = 0;
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(tx.target, tx.texture);
     }
 
-    for (const auto &t : garbage) {
-        _textures.erase(std::remove_if(_textures.begin(),
-                                       _textures.end(),
-                                       [&t](const TextureInfo &tx) {
-                                           return tx.texture == t;
-                                       }), _textures.end());
-    }
-
 	assert(_isBound);
 }
 
@@ -567,6 +763,20 @@ void ShaderProgram::link()
 {
     _textures.clear();
 
+    std::string key = getBinaryKey();
+    if(_fromBinary) {
+        if(ShaderLibrary::instance()->loadBinary(_id, key)) {
+            reserveTextureSlots();
+            return;
+        }
+
+        //no binary for these bindings yet, the shaders are needed after all
+        for (auto p : _shaderSources)
+            _addShaderFromSource(p.second, static_cast<ShaderType>(p.first));
+        ShaderLibrary::replayBindings(_id, _bindings);
+        _fromBinary = false;
+    }
+
     glLinkProgram(_id);
     GLint linkStatus;
     glGetProgramiv(_id, GL_LINK_STATUS, &linkStatus);
@@ -580,6 +790,75 @@ void ShaderProgram::link()
     }
     assert(linkStatus == GL_TRUE);
     MTGLERROR;
+
+    if(linkStatus != GL_TRUE) return;
+    reserveTextureSlots();
+    ShaderLibrary::instance()->storeBinary(_id, key);
+
+    //only programs made from files can be compiled ahead in a later session
+    if(!_fileNameMap.empty() && _fileNameMap.size() == _shaderSources.size()) {
+        std::map<int, std::string> files(_fileNameMap.begin(), _fileNameMap.end());
+        ShaderLibrary::instance()->addKnownProgram(files, _bindings);
+    }
+}
+
+namespace {
+    //0 for uniforms that are not samplers
+    GLenum samplerTarget(GLenum type)
+    {
+        switch(type) {
+            case GL_SAMPLER_1D:
+                return GL_TEXTURE_1D;
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_2D_SHADOW:
+            case GL_INT_SAMPLER_2D:
+            case GL_UNSIGNED_INT_SAMPLER_2D:
+                return GL_TEXTURE_2D;
+            case GL_SAMPLER_3D:
+                return GL_TEXTURE_3D;
+            case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_CUBE_SHADOW:
+                return GL_TEXTURE_CUBE_MAP;
+            case GL_SAMPLER_2D_ARRAY:
+            case GL_SAMPLER_2D_ARRAY_SHADOW:
+                return GL_TEXTURE_2D_ARRAY;
+            case GL_SAMPLER_2D_RECT:
+                return GL_TEXTURE_RECTANGLE;
+            case GL_SAMPLER_BUFFER:
+                return GL_TEXTURE_BUFFER;
+            default:
+                return 0;
+        }
+    }
+}
+
+//every sampler gets a slot of its own right after linking. Samplers of
+//different types that are left on the same slot make every draw call fail,
+//even if the shader never reads them
+void ShaderProgram::reserveTextureSlots()
+{
+    GLint current = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+    glUseProgram(_id);
+
+    GLint count = 0;
+    glGetProgramiv(_id, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        GLchar name[256];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(_id, i, sizeof(name), &length, &size, &type, name);
+        GLenum target = samplerTarget(type);
+        if(!target) continue;
+
+        std::string n(name, length);
+        glUniform1i(glGetUniformLocation(_id, n.c_str()), _textures.size());
+        _textures.push_back({0, target, n});
+    }
+    MTGLERROR;
+
+    glUseProgram(current);
 }
 
 void ShaderProgram::addShaderFromSource(std::string src, ShaderProgram::ShaderType type)
@@ -590,7 +869,16 @@ void ShaderProgram::addShaderFromSource(std::string src, ShaderProgram::ShaderTy
 
 void ShaderProgram::_addShaderFromSource(std::string src, ShaderProgram::ShaderType type)
 {
+    GLuint shader = compileShader(src, type, _fileNameMap[type]);
+    glAttachShader(_id, shader);
+    MTGLERROR;
+    //stays alive as long as it is attached
+    glDeleteShader(shader);
+    MTGLERROR;
+}
 
+GLuint ShaderProgram::compileShader(const std::string &src, ShaderProgram::ShaderType type, const std::string &filename)
+{
     std::string shadertype;
     GLenum t = GL_VERTEX_SHADER;
     switch(type)
@@ -607,7 +895,17 @@ void ShaderProgram::_addShaderFromSource(std::string src, ShaderProgram::ShaderT
             t = GL_GEOMETRY_SHADER;
             shadertype = "Geometry Shader";
             break;
-        default:
+        case TESSELATION_CONTROL:
+            t = GL_TESS_CONTROL_SHADER;
+            shadertype = "Tesselation Control Shader";
+            break;
+        case TESSELATION_EVALUATION:
+            t = GL_TESS_EVALUATION_SHADER;
+            shadertype = "Tesselation Evaluation Shader";
+            break;
+        case COMPUTE:
+            t = GL_COMPUTE_SHADER;
+            shadertype = "Compute Shader";
             break;
     }
 
@@ -615,9 +913,12 @@ void ShaderProgram::_addShaderFromSource(std::string src, ShaderProgram::ShaderT
     dbout("compiling " << shadertype << " shader");
 #endif
 
+    //meshes upload their attributes in compact formats
+    std::string source = type == VERTEX ? VertexLayout::expandDeclarations(src) : src;
+
     GLuint shader = glCreateShader(t);
     MTGLERROR;
-    const char* c_str = src.c_str();
+    const char* c_str = source.c_str();
     glShaderSource(shader, 1, &c_str, 0);
     MTGLERROR;
 
@@ -631,36 +932,22 @@ void ShaderProgram::_addShaderFromSource(std::string src, ShaderProgram::ShaderT
     std::string log((char*)infolog);
     delete [] infolog;
 
-    std::string filename = _fileNameMap[type];
-
     if(log != "") {
         std::cout << "=========compile log(" << shadertype << ":" << filename << ")================" << std::endl;
         std::cout << log << std::endl;
         std::cout << "=====================================" << std::endl;
     }
 
-    glAttachShader(_id, shader);
-    MTGLERROR;
+    return shader;
 }
 
 void ShaderProgram::addShaderFromFile(std::string filename, ShaderProgram::ShaderType type)
 {
     _fileNameMap[type] = filename;
 
-    std::ifstream stream(filename);
-
-    if(!stream.is_open()) {
-        std::cout << "could not open file " << filename << std::endl;
-        return;
-    }
-
-    std::string content;
-    std::string line;
-    while (stream) {
-        std::getline(stream, line);
-        content += line;
-        content += "\n";
-    }
+    //shared between all programs using the same file
+    std::string content = ShaderLibrary::instance()->getSource(filename);
+    if(content == "") return;
 
     addShaderFromSource(content, type);
 }
@@ -864,6 +1151,11 @@ void ShaderProgram::setUniformFromProperty(std::string name, Property prop)
         setUniform(name, prop.getData<glm::vec3>());
     }
 
+    else if(prop.getType() == "VECTOR2D")
+    {
+        setUniform(name, prop.getData<glm::vec2>());
+    }
+
     else if(prop.getType() == "INTVECTOR2D")
     {
         setUniform(name, prop.getData<glm::ivec2>());
@@ -893,6 +1185,9 @@ MindTree::Property ShaderProgram::getUniformAsProperty(std::string name, DataTyp
     else if(t == "VECTOR3D")
         prop = getUniformf3(name);
 
+    else if(t == "VECTOR2D")
+        prop = getUniformf2(name);
+
     else if(t == "INTVECTOR2D")
         prop = getUniformi2(name);
 
@@ -923,11 +1218,19 @@ void ShaderProgram::setTexture(Texture *texture, std::string name)
     if(location < 0) return;
 
     int textureSlot;
+    //every sampler has its slot since the program was linked, objects that
+    //bind their own texture to it replace the one that was there
     auto it = std::find_if(begin(_textures),
                            end(_textures),
-                           [texture] (const TextureInfo &other){
-                               return other.texture == texture->getID();
+                           [&n] (const TextureInfo &other){
+                               return other.name == n;
                            });
+    if(it == end(_textures))
+        it = std::find_if(begin(_textures),
+                          end(_textures),
+                          [texture] (const TextureInfo &other){
+                              return other.texture == texture->getID();
+                          });
 
     if(it != end(_textures)) {
         textureSlot = std::distance(begin(_textures), it);
@@ -960,17 +1263,28 @@ void ShaderProgram::setTexture(Texture *texture, std::string name)
 }
 
 void ShaderProgram::bindAttributeLocation(VBO *vbo)
+{
+    bindAttributeLocation(vbo->getIndex(), vbo->getName());
+}
+
+void ShaderProgram::bindAttributeLocation(GLuint index, const std::string &name)
 {
     assert(_initialized);
-    if(!hasAttribute(vbo->getName())) return;
+    if(!hasAttribute(name)) return;
+
+    //programs are shared between renderers, a binding that is already in
+    //effect needs no relink
+    std::string binding = "a" + std::to_string(index) + "=" + name + ";";
+    if((";" + _bindings).find(";" + binding) != std::string::npos) return;
 
     bool wasntbound = false;
     if(!_isBound) {
         wasntbound = true;
         bind();
     }
-    glBindAttribLocation(_id, vbo->getIndex(), vbo->getName().c_str());
+    glBindAttribLocation(_id, index, name.c_str());
     MTGLERROR;
+    _bindings += binding;
 
     //needs to be relinked so that the binding actually goes into effect
     link();
@@ -984,6 +1298,9 @@ void ShaderProgram::bindFragmentLocation(unsigned int index, std::string name)
 #endif
     assert(_initialized);
 
+    std::string binding = "f" + std::to_string(index) + "=" + name + ";";
+    if((";" + _bindings).find(";" + binding) != std::string::npos) return;
+
     bool wasntbound = false;
     if(!_isBound) {
         wasntbound = true;
@@ -992,6 +1309,7 @@ void ShaderProgram::bindFragmentLocation(unsigned int index, std::string name)
 
     glBindFragDataLocation(_id, index, name.c_str());
     MTGLERROR;
+    _bindings += binding;
 
     link();
     if(wasntbound) release();
@@ -1118,6 +1436,7 @@ void UniformStateManager::setFromPropertyMap(PropertyMap map)
 
 Texture::Texture(std::string name, Texture::Format format, Target target) :
     _id(0),
+    _storageOwner(nullptr),
     _format(format),
     _target(target),
     _wrapMode(CLAMP_TO_EDGE),
@@ -1166,7 +1485,7 @@ void Texture::bind()
 {
     assert(_initialized);
     GLenum target = getGLTarget();
-    glBindTexture(target, _id);
+    glBindTexture(target, getID());
     GLenum wrap = getGLWrapMode();
     GLenum filter = getGLFilter();
     if(isDepthTexture(getFormat())) {
@@ -1175,7 +1494,7 @@ void Texture::bind()
         glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
     }
     glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
-    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, _filter == NEAREST ? GL_NEAREST : GL_LINEAR);
     glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
     glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
     glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
@@ -1211,6 +1530,7 @@ bool Texture::isInitialized() const
 void Texture::init()
 {
     _initialized = true;
+    if(_storageOwner) return;
 
     if(!_id) glGenTextures(1, &_id);
 #ifdef DEBUG_GL_WRAPPER
@@ -1222,7 +1542,24 @@ void Texture::init()
 
 GLuint Texture::getID() const
 {
-    return _id;
+    return _storageOwner ? _storageOwner->getID() : _id;
+}
+
+void Texture::shareStorage(Texture *owner)
+{
+    if(owner == this) owner = nullptr;
+    if(owner && _id) {
+        glDeleteTextures(1, &_id);
+        _id = 0;
+        MTGLERROR;
+    }
+    if(owner != _storageOwner) _initialized = false;
+    _storageOwner = owner;
+}
+
+bool Texture::sharesStorage() const
+{
+    return _storageOwner != nullptr;
 }
 
 Texture::Format Texture::getFormat() const
@@ -1257,6 +1594,7 @@ GLenum Texture::getGLFormat() const
         case RGBA:
         case RGBA8:
         case RGBA16F:
+        case SRGB8_ALPHA8:
             return GL_RGBA;
         case DEPTH:
         case DEPTH16:
@@ -1274,6 +1612,7 @@ GLenum Texture::getGLDataType() const
         case RGB8:
         case RGBA:
         case RGBA8:
+        case SRGB8_ALPHA8:
         case RG:
         case RG8:
         case DEPTH:
@@ -1328,6 +1667,8 @@ GLenum Texture::getGLInternalFormat() const
             return GL_RGB16F;
         case RGBA16F:
             return GL_RGBA16F;
+        case SRGB8_ALPHA8:
+            return GL_SRGB8_ALPHA8;
         case DEPTH:
             return GL_DEPTH_COMPONENT;
         case DEPTH16:
@@ -1352,6 +1693,7 @@ GLenum Texture::getGLFilter() const
     switch(_filter) {
         case NEAREST: return GL_NEAREST;
         case LINEAR: return GL_LINEAR;
+        case LINEAR_MIPMAP: return GL_LINEAR_MIPMAP_LINEAR;
     }
 }
 
@@ -1386,7 +1728,7 @@ int Texture::width()
 }
 
 Texture2D::Texture2D(std::string name, Texture::Format format)
-    : Texture(name, format, TEXTURE2D), _height(0)
+    : Texture(name, format, TEXTURE2D), _height(0), _levels(1), _baseLevel(0)
 {
 }
 
@@ -1450,6 +1792,7 @@ void Texture2D::init(std::vector<unsigned char> data)
 void Texture2D::init()
 {
     Texture::init();
+    if(sharesStorage()) return;
 
     GLenum format = getGLFormat();
     GLenum internalFormat = getGLInternalFormat();
@@ -1473,3 +1816,60 @@ int Texture2D::height()
 {
     return _height;
 }
+
+void Texture2D::initLevels(int levels)
+{
+    Texture::init();
+    _levels = levels;
+    _baseLevel = 0;
+
+    GLenum format = getGLFormat();
+    GLenum internalFormat = getGLInternalFormat();
+    GLenum type = getGLDataType();
+
+    bind();
+    for(int level = 0; level < levels; ++level) {
+        glTexImage2D(GL_TEXTURE_2D,
+                     level,
+                     internalFormat,
+                     std::max(width() >> level, 1),
+                     std::max(height() >> level, 1),
+                     0,
+                     format,
+                     type,
+                     nullptr);
+    }
+    MTGLERROR;
+}
+
+int Texture2D::getLevelCount() const
+{
+    return _levels;
+}
+
+void Texture2D::setBaseLevel(int level)
+{
+    _baseLevel = level;
+}
+
+int Texture2D::getBaseLevel() const
+{
+    return _baseLevel;
+}
+
+void Texture2D::subImage(int level, int x, int y, int width, int height, GLenum type, const void *data)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, getGLFormat(), type, data);
+    MTGLERROR;
+}
+
+void Texture2D::bind()
+{
+    Texture::bind();
+    //textures that were not allocated level by level keep the default range,
+    //so generated mipmaps are sampled
+    if(_levels < 2) return;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, _baseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _levels - 1);
+}
@@ -132,6 +132,16 @@ private:
     std::string _name;
 };
 
+//every per vertex attribute of a mesh in one buffer, see VertexLayout
+class InterleavedVBO : public Buffer
+{
+public:
+    InterleavedVBO();
+    virtual ~InterleavedVBO();
+
+    void data(const std::vector<unsigned char> &bytes);
+};
+
 class IBO : public Buffer
 {
 public:
@@ -156,6 +166,83 @@ public:
     virtual ~UBO();
 };
 
+class SSBO : public Buffer
+{
+public:
+    SSBO();
+    virtual ~SSBO();
+
+    void data(const void *data, size_t size);
+
+    template<typename T>
+    void data(const std::vector<T> &data)
+    {
+        //always allocate at least one element, so the buffer can be bound
+        if(data.empty()) {
+            T empty{};
+            this->data(&empty, sizeof(T));
+            return;
+        }
+        this->data(data.data(), data.size() * sizeof(T));
+    }
+
+    void bindBase(GLuint index);
+};
+
+//pixel pack buffer for asynchronous framebuffer readback, the read is
+//fenced so the data can be fetched without stalling the pipeline
+class PBO : public Buffer
+{
+public:
+    PBO();
+    virtual ~PBO();
+
+    //starts reading the currently bound read buffer into this pbo
+    void read(int x, int y, int width, int height, GLenum format, GLenum type, size_t size);
+
+    //batched reads: allocate once, read several regions at different
+    //offsets while bound and fence them all together
+    void allocate(size_t size);
+    void readAt(int x, int y, int width, int height, GLenum format, GLenum type, size_t offset);
+    void fence();
+
+    bool isPending() const;
+    bool isReady() const;
+    void wait();
+
+    //maps the buffer and copies its content, releases the fence
+    bool copyTo(void *dst, size_t size);
+    size_t getSize() const;
+
+private:
+    size_t _size;
+    GLsync _fence;
+};
+
+//pixel unpack buffer for asynchronous texture uploads. Once the copies out
+//of the buffer are fenced, it is only written again after they finished
+class UploadPBO : public Buffer
+{
+public:
+    UploadPBO();
+    virtual ~UploadPBO();
+
+    void allocate(size_t size);
+    size_t getSize() const;
+
+    //needs the buffer to be bound, the previous content is discarded
+    void* map();
+    bool unmap();
+
+    void fence();
+    //true if the copies of the last fence are done or there are none
+    bool isReady();
+
+private:
+    size_t _size;
+    GLsync _fence;
+};
+
 class Texture2D;
 class Renderbuffer;
 class FBO
@@ -255,6 +342,8 @@ public:
     int getUniformLocation(std::string name) const;
 
     static std::string shaderTypeStr(int type);
+    //compiles src, the returned shader is owned by the caller
+    static GLuint compileShader(const std::string &src, ShaderType type, const std::string &filename);
 
     glm::ivec2 getUniformi2(std::string name) const;
     glm::ivec3 getUniformi3(std::string name) const;
@@ -281,6 +370,7 @@ public:
     void setTexture(Texture *texture, std::string name="");
 
     void bindAttributeLocation(VBO *vbo);
+    void bindAttributeLocation(GLuint index, const std::string &name);
     void bindFragmentLocation(unsigned int index, std::string name);
 
     bool hasAttribute(std::string name);
@@ -306,9 +396,16 @@ private:
     };
 
     void _addShaderFromSource(std::string src, ShaderType type);
+    std::string getBinaryKey() const;
+    void reserveTextureSlots();
 
     GLuint _id;
     std::atomic<bool> _isBound, _initialized;
+    //the program was created from a cached binary and has no shaders
+    //attached yet
+    bool _fromBinary = false;
+    //location bindings in the order they were made, part of the binary key
+    std::string _bindings;
     int _attributes = 0;
     size_t _offset;
     std::mutex _srcLock;
@@ -371,6 +468,7 @@ public:
         RGBA8,
         RGB16F,
         RGBA16F,
+        SRGB8_ALPHA8,
         DEPTH,
         DEPTH16,
         DEPTH32F
@@ -389,7 +487,9 @@ public:
 
     enum Filter {
         NEAREST,
-        LINEAR
+        LINEAR,
+        //trilinear, needs the levels of the texture to be filled
+        LINEAR_MIPMAP
     };
 
     Texture(std::string name, Texture::Format format, Target target=TEXTURE1D);
@@ -450,11 +550,18 @@ public:
     void generateMipmaps();
     GLenum getGLTarget() const;
 
+    //use the storage of another texture with the same format and size
+    //instead of allocating own memory, nullptr goes back to own storage.
+    //The owner has to be initialized before this texture
+    void shareStorage(Texture *owner);
+    bool sharesStorage() const;
+
 protected:
     GLenum getInternalFormat() const;
 
 private:
     GLuint _id;
+    Texture *_storageOwner;
     Format _format;
     Target _target;
     WrapMode _wrapMode;
@@ -481,10 +588,27 @@ public:
     void init(std::vector<glm::vec2> data);
     void init(std::vector<unsigned char> data);
 
+    //allocates levels mip levels without filling them
+    void initLevels(int levels);
+    int getLevelCount() const;
+
+    //only levels from the base level on are sampled, so levels can be
+    //filled one after the other
+    void setBaseLevel(int level);
+    int getBaseLevel() const;
+
+    //needs the texture to be bound. data is an offset if a pixel unpack
+    //buffer is bound
+    void subImage(int level, int x, int y, int width, int height, GLenum type, const void *data);
+
+    void bind();
+
 protected:
 
 private:
     int _height;
+    int _levels;
+    int _baseLevel;
 };
 } /* GL */
 } /* MindTree */
@@ -0,0 +1,110 @@
+#include "data/benchmark.h"
+#include "glwrapper.h"
+
+#include "gpu_timer.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+GPUTimer::GPUTimer() :
+    _current{0, 0},
+    _running(false),
+    _clockOffset(0),
+    _calibrated(false)
+{
+}
+
+GPUTimer::~GPUTimer()
+{
+    for(const auto &measurement : _pending) {
+        _freeQueries.push_back(measurement.start);
+        _freeQueries.push_back(measurement.end);
+    }
+    if(_running) _freeQueries.push_back(_current.start);
+
+    if(!_freeQueries.empty())
+        glDeleteQueries(_freeQueries.size(), &_freeQueries[0]);
+}
+
+GLuint GPUTimer::getQuery()
+{
+    if(_freeQueries.empty()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        return query;
+    }
+
+    GLuint query = _freeQueries.back();
+    _freeQueries.pop_back();
+    return query;
+}
+
+void GPUTimer::begin()
+{
+    if(_running || _pending.size() >= MAX_PENDING) return;
+
+    if(!_calibrated) {
+        GLint64 gpuTime = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+        auto cpuTime = std::chrono::steady_clock::now().time_since_epoch();
+        _clockOffset = std::chrono::duration_cast<std::chrono::nanoseconds>(cpuTime)
+            - std::chrono::nanoseconds(gpuTime);
+        _calibrated = true;
+    }
+
+    _current.start = getQuery();
+    glQueryCounter(_current.start, GL_TIMESTAMP);
+    MTGLERROR;
+    _running = true;
+}
+
+void GPUTimer::end()
+{
+    if(!_running) return;
+
+    _current.end = getQuery();
+    glQueryCounter(_current.end, GL_TIMESTAMP);
+    MTGLERROR;
+    _pending.push_back(_current);
+    _running = false;
+}
+
+void GPUTimer::collect(Benchmark *benchmark)
+{
+    while(!_pending.empty()) {
+        const Measurement &measurement = _pending.front();
+
+        //queries finish in order, so the end of the oldest measurement
+        //tells whether anything is ready
+        GLint available = 0;
+        glGetQueryObjectiv(measurement.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available) break;
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(measurement.start, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(measurement.end, GL_QUERY_RESULT, &end);
+        MTGLERROR;
+
+        if(benchmark) {
+            std::chrono::steady_clock::time_point startPoint(
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::nanoseconds(start) + _clockOffset));
+            benchmark->addGPUTime(startPoint, std::chrono::nanoseconds(end - start));
+        }
+
+        _freeQueries.push_back(measurement.start);
+        _freeQueries.push_back(measurement.end);
+        _pending.pop_front();
+    }
+}
+
+GPUTimerHandler::GPUTimerHandler(GPUTimer *timer) :
+    _timer(timer)
+{
+    if(_timer) _timer->begin();
+}
+
+GPUTimerHandler::~GPUTimerHandler()
+{
+    if(_timer) _timer->end();
+}
@@ -0,0 +1,67 @@
+#ifndef MT_GL_GPU_TIMER_H
+#define MT_GL_GPU_TIMER_H
+
+#include "chrono"
+#include "deque"
+#include "memory"
+#include "vector"
+#include "GL/glew.h"
+
+namespace MindTree {
+class Benchmark;
+
+namespace GL {
+
+//measures the time the gpu spends on the commands issued between begin and
+//end with timestamp queries. Results are picked up a few frames later, once
+//the gpu has caught up, so measuring never stalls the pipeline
+class GPUTimer
+{
+public:
+    GPUTimer();
+    ~GPUTimer();
+    GPUTimer(const GPUTimer&) = delete;
+
+    void begin();
+    void end();
+
+    //adds every finished measurement to the benchmark, does not wait for
+    //measurements that are still in flight
+    void collect(Benchmark *benchmark);
+
+private:
+    GLuint getQuery();
+
+    struct Measurement {
+        GLuint start;
+        GLuint end;
+    };
+
+    //frames in flight are rarely more than two or three, anything beyond
+    //this is not measured until the gpu caught up
+    static const size_t MAX_PENDING = 16;
+
+    std::deque<Measurement> _pending;
+    std::vector<GLuint> _freeQueries;
+    Measurement _current;
+    bool _running;
+
+    //gpu timestamps are converted to the cpu clock for the trace
+    std::chrono::nanoseconds _clockOffset;
+    bool _calibrated;
+};
+
+class GPUTimerHandler
+{
+public:
+    GPUTimerHandler(GPUTimer *timer);
+    ~GPUTimerHandler();
+
+private:
+    GPUTimer *_timer;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include "algorithm"
+#include "cstdio"
+#include "iostream"
+
+#ifdef MT_WITH_PNG
+#include "png.h"
+#endif
+
+#include "image_writer.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+ImageWriter::ImageWriter(unsigned threads, size_t maxQueued) :
+    _maxQueued(std::max(maxQueued, size_t(1))),
+    _active(0),
+    _failed(0),
+    _stop(false)
+{
+    if(!threads)
+        threads = std::max(std::thread::hardware_concurrency() / 2, 1u);
+
+    for(unsigned i = 0; i < threads; ++i)
+        _threads.emplace_back(&ImageWriter::run, this);
+}
+
+ImageWriter::~ImageWriter()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(_queueLock);
+        _stop = true;
+    }
+    _queueChanged.notify_all();
+    for(auto &thread : _threads)
+        thread.join();
+}
+
+void ImageWriter::write(Image &&image)
+{
+    {
+        std::unique_lock<std::mutex> lock(_queueLock);
+        _imageDone.wait(lock, [this]{ return _queue.size() < _maxQueued; });
+        _queue.push_back(std::move(image));
+    }
+    _queueChanged.notify_one();
+}
+
+void ImageWriter::wait()
+{
+    std::unique_lock<std::mutex> lock(_queueLock);
+    _imageDone.wait(lock, [this]{ return _queue.empty() && !_active; });
+}
+
+size_t ImageWriter::getFailedCount() const
+{
+    std::lock_guard<std::mutex> lock(_queueLock);
+    return _failed;
+}
+
+void ImageWriter::run()
+{
+    while(true) {
+        Image image;
+        {
+            std::unique_lock<std::mutex> lock(_queueLock);
+            _queueChanged.wait(lock, [this]{ return _stop || !_queue.empty(); });
+            if(_queue.empty()) return;
+
+            image = std::move(_queue.front());
+            _queue.pop_front();
+            ++_active;
+        }
+        //the queue got shorter, writers waiting for space may continue
+        _imageDone.notify_all();
+
+        bool success = writeImage(image);
+        if(!success)
+            std::cout << "could not write image: " << image.filename << std::endl;
+
+        {
+            std::lock_guard<std::mutex> lock(_queueLock);
+            --_active;
+            if(!success) ++_failed;
+        }
+        _imageDone.notify_all();
+    }
+}
+
+namespace {
+    std::string extension(const std::string &filename)
+    {
+        auto pos = filename.find_last_of('.');
+        if(pos == std::string::npos) return "";
+        std::string ext = filename.substr(pos + 1);
+        std::transform(begin(ext), end(ext), begin(ext), ::tolower);
+        return ext;
+    }
+
+    const unsigned char* row(const Image &image, int y)
+    {
+        int r = image.bottomUp ? image.height - 1 - y : y;
+        return image.pixels.data() + size_t(r) * image.width * image.channels;
+    }
+
+    bool writeNetpbm(const Image &image, bool pam)
+    {
+        FILE *file = fopen(image.filename.c_str(), "wb");
+        if(!file) return false;
+
+        //ppm has no alpha, so alpha is only kept for pam
+        int channels = pam ? image.channels : std::min(image.channels, 3);
+        if(pam)
+            fprintf(file,
+                    "P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n",
+                    image.width, image.height, channels, channels == 4 ? "RGB_ALPHA" : "RGB");
+        else
+            fprintf(file, "P6\n%d %d\n255\n", image.width, image.height);
+
+        std::vector<unsigned char> line(size_t(image.width) * channels);
+        bool success = true;
+        for(int y = 0; y < image.height && success; ++y) {
+            const unsigned char *src = row(image, y);
+            if(channels == image.channels) {
+                success = fwrite(src, 1, line.size(), file) == line.size();
+                continue;
+            }
+            for(int x = 0; x < image.width; ++x)
+                for(int c = 0; c < channels; ++c)
+                    line[x * channels + c] = src[x * image.channels + c];
+            success = fwrite(line.data(), 1, line.size(), file) == line.size();
+        }
+        return fclose(file) == 0 && success;
+    }
+
+#ifdef MT_WITH_PNG
+    bool writePNG(const Image &image)
+    {
+        FILE *file = fopen(image.filename.c_str(), "wb");
+        if(!file) return false;
+
+        png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        png_infop info = png ? png_create_info_struct(png) : nullptr;
+        if(!png || !info || setjmp(png_jmpbuf(png))) {
+            png_destroy_write_struct(&png, &info);
+            fclose(file);
+            return false;
+        }
+
+        png_init_io(png, file);
+        //fast compression, turntables are written far more often than read
+        png_set_compression_level(png, 1);
+        png_set_IHDR(png, info, image.width, image.height, 8,
+                     image.channels == 4 ? PNG_COLOR_TYPE_RGBA : PNG_COLOR_TYPE_RGB,
+                     PNG_INTERLACE_NONE,
+                     PNG_COMPRESSION_TYPE_DEFAULT,
+                     PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(png, info);
+        for(int y = 0; y < image.height; ++y)
+            png_write_row(png, const_cast<png_bytep>(row(image, y)));
+        png_write_end(png, nullptr);
+        png_destroy_write_struct(&png, &info);
+        return fclose(file) == 0;
+    }
+#endif
+}
+
+bool ImageWriter::writeImage(const Image &image)
+{
+    if(image.width <= 0 || image.height <= 0
+       || (image.channels != 3 && image.channels != 4)
+       || image.pixels.size() < size_t(image.width) * image.height * image.channels)
+        return false;
+
+    std::string ext = extension(image.filename);
+#ifdef MT_WITH_PNG
+    if(ext == "png")
+        return writePNG(image);
+#endif
+    if(ext == "pam")
+        return writeNetpbm(image, true);
+    if(ext != "ppm")
+        std::cout << "unsupported image format: " << ext << ", writing ppm data" << std::endl;
+    return writeNetpbm(image, false);
+}
@@ -0,0 +1,62 @@
+#ifndef MT_GL_IMAGE_WRITER_H
+#define MT_GL_IMAGE_WRITER_H
+
+#include "string"
+#include "vector"
+#include "deque"
+#include "thread"
+#include "mutex"
+#include "condition_variable"
+
+namespace MindTree {
+namespace GL {
+
+struct Image
+{
+    std::string filename;
+    int width = 0;
+    int height = 0;
+    int channels = 4;
+    //rows are stored bottom up, as they come from glReadPixels
+    bool bottomUp = true;
+    std::vector<unsigned char> pixels;
+};
+
+//encodes and writes images on a pool of worker threads, so rendering never
+//waits for the disk unless too many frames are queued
+class ImageWriter
+{
+public:
+    ImageWriter(unsigned threads=0, size_t maxQueued=8);
+    ~ImageWriter();
+
+    //blocks while the queue is full
+    void write(Image &&image);
+
+    //blocks until all queued images are written
+    void wait();
+
+    size_t getFailedCount() const;
+
+    //writes .png (if built with libpng), .ppm or .pam, depending on the extension
+    static bool writeImage(const Image &image);
+
+private:
+    void run();
+
+    std::vector<std::thread> _threads;
+    std::deque<Image> _queue;
+    size_t _maxQueued;
+    size_t _active;
+    size_t _failed;
+    bool _stop;
+
+    mutable std::mutex _queueLock;
+    std::condition_variable _queueChanged;
+    std::condition_variable _imageDone;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,303 @@
+#include "algorithm"
+#include "limits"
+#include "numeric"
+
+#include "../datatypes/Object/mesh_simplification.h"
+
+#include "index_optimizer.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+namespace {
+    //runs are split at this size so the overdraw pass has something to sort
+    //on meshes without many dead ends
+    const size_t MAX_RUN_TRIANGLES = 512;
+
+    struct Adjacency {
+        std::vector<uint> first;
+        std::vector<uint> triangles;
+    };
+
+    Adjacency buildAdjacency(const std::vector<uint> &indices, size_t vertexCount)
+    {
+        Adjacency adjacency;
+        adjacency.first.assign(vertexCount + 1, 0);
+        for(uint index : indices) ++adjacency.first[index + 1];
+        for(size_t i = 1; i < adjacency.first.size(); ++i)
+            adjacency.first[i] += adjacency.first[i - 1];
+
+        adjacency.triangles.resize(indices.size());
+        auto fill = adjacency.first;
+        for(size_t i = 0; i < indices.size(); ++i)
+            adjacency.triangles[fill[indices[i]]++] = i / 3;
+        return adjacency;
+    }
+
+    std::vector<uint> optimizeRange(const std::vector<uint> &indices,
+                                    size_t first, size_t count,
+                                    const VertexList &vertices,
+                                    bool overdraw)
+    {
+        //work on the vertices of the range only, so small ranges like
+        //clusters do not pay for the whole mesh
+        std::vector<uint> used;
+        std::vector<uint> range(count);
+        if(count * 4 < vertices.size()) {
+            used.assign(begin(indices) + first, begin(indices) + first + count);
+            std::sort(begin(used), end(used));
+            used.erase(std::unique(begin(used), end(used)), end(used));
+            for(size_t i = 0; i < count; ++i)
+                range[i] = std::lower_bound(begin(used), end(used), indices[first + i]) - begin(used);
+        }
+        else {
+            const uint unused = std::numeric_limits<uint>::max();
+            std::vector<uint> local(vertices.size(), unused);
+            for(size_t i = 0; i < count; ++i) {
+                uint &index = local[indices[first + i]];
+                if(index == unused) {
+                    index = used.size();
+                    used.push_back(indices[first + i]);
+                }
+                range[i] = index;
+            }
+        }
+
+        std::vector<size_t> runs;
+        range = IndexOptimizer::optimizeVertexCache(range, used.size(), &runs);
+        if(overdraw) {
+            VertexList positions(used.size());
+            for(size_t i = 0; i < used.size(); ++i)
+                positions[i] = vertices[used[i]];
+            range = IndexOptimizer::optimizeOverdraw(range, runs, positions);
+        }
+
+        for(uint &index : range) index = used[index];
+        return range;
+    }
+}
+
+IndexOptimizer::Statistics IndexOptimizer::analyze(const std::vector<uint> &indices, size_t vertexCount, uint cacheSize)
+{
+    Statistics statistics{0, 0};
+    if(indices.empty()) return statistics;
+
+    //a vertex stays in the cache for cacheSize misses
+    const uint never = std::numeric_limits<uint>::max();
+    std::vector<uint> inserted(vertexCount, never);
+    uint misses = 0;
+    size_t referenced = 0;
+    for(uint index : indices) {
+        if(inserted[index] == never) ++referenced;
+        else if(misses - inserted[index] < cacheSize) continue;
+        inserted[index] = misses++;
+    }
+
+    statistics.acmr = float(misses) / (indices.size() / 3);
+    statistics.atvr = float(misses) / referenced;
+    return statistics;
+}
+
+std::vector<uint> IndexOptimizer::optimizeVertexCache(const std::vector<uint> &indices,
+                                                      size_t vertexCount,
+                                                      std::vector<size_t> *runs,
+                                                      uint cacheSize)
+{
+    std::vector<uint> result;
+    if(runs) runs->clear();
+    if(indices.empty()) return result;
+    result.reserve(indices.size());
+
+    auto adjacency = buildAdjacency(indices, vertexCount);
+    std::vector<uint> live(vertexCount);
+    for(size_t v = 0; v < vertexCount; ++v)
+        live[v] = adjacency.first[v + 1] - adjacency.first[v];
+
+    std::vector<uint> timestamps(vertexCount, 0);
+    std::vector<char> emitted(indices.size() / 3, false);
+    std::vector<uint> deadEnds;
+    std::vector<uint> candidates;
+    uint time = cacheSize + 1;
+    size_t cursor = 0;
+
+    if(runs) runs->push_back(0);
+    long current = indices[0];
+    while(current >= 0) {
+        candidates.clear();
+        for(uint a = adjacency.first[current]; a < adjacency.first[current + 1]; ++a) {
+            uint t = adjacency.triangles[a];
+            if(emitted[t]) continue;
+            emitted[t] = true;
+            for(int i = 0; i < 3; ++i) {
+                uint v = indices[t * 3 + i];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if(time - timestamps[v] > cacheSize)
+                    timestamps[v] = time++;
+            }
+        }
+
+        //the candidate that stays in the cache the longest while all of its
+        //triangles are emitted
+        long next = -1;
+        long bestPriority = -1;
+        for(uint v : candidates) {
+            if(!live[v]) continue;
+            long priority = 0;
+            if(time - timestamps[v] + 2 * live[v] <= cacheSize)
+                priority = time - timestamps[v];
+            if(priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if(next < 0) {
+            while(!deadEnds.empty()) {
+                uint v = deadEnds.back();
+                deadEnds.pop_back();
+                if(live[v]) {
+                    next = v;
+                    break;
+                }
+            }
+            if(next < 0) {
+                while(cursor < vertexCount && !live[cursor]) ++cursor;
+                if(cursor < vertexCount) next = cursor;
+            }
+            if(next >= 0 && runs && runs->back() != result.size() / 3)
+                runs->push_back(result.size() / 3);
+        }
+        current = next;
+    }
+    return result;
+}
+
+std::vector<uint> IndexOptimizer::optimizeOverdraw(const std::vector<uint> &indices,
+                                                   const std::vector<size_t> &runs,
+                                                   const VertexList &vertices,
+                                                   float threshold)
+{
+    size_t triangleCount = indices.size() / 3;
+    if(runs.empty() || !triangleCount) return indices;
+
+    std::vector<size_t> bounds;
+    for(size_t r = 0; r < runs.size(); ++r) {
+        size_t end = r + 1 < runs.size() ? runs[r + 1] : triangleCount;
+        for(size_t start = runs[r]; start < end; start += MAX_RUN_TRIANGLES)
+            bounds.push_back(start);
+    }
+    bounds.push_back(triangleCount);
+    size_t runCount = bounds.size() - 1;
+    if(runCount < 2) return indices;
+
+    std::vector<glm::vec3> centroids(runCount, glm::vec3(0));
+    std::vector<glm::vec3> normals(runCount, glm::vec3(0));
+    std::vector<float> areas(runCount, 0);
+    glm::vec3 meshCentroid(0);
+    float meshArea = 0;
+    for(size_t r = 0; r < runCount; ++r) {
+        for(size_t t = bounds[r]; t < bounds[r + 1]; ++t) {
+            const auto &a = vertices[indices[t * 3]];
+            const auto &b = vertices[indices[t * 3 + 1]];
+            const auto &c = vertices[indices[t * 3 + 2]];
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            float area = glm::length(normal);
+            centroids[r] += (a + b + c) * (area / 3);
+            normals[r] += normal;
+            areas[r] += area;
+        }
+        meshCentroid += centroids[r];
+        meshArea += areas[r];
+        if(areas[r] > 0) centroids[r] /= areas[r];
+    }
+    if(meshArea > 0) meshCentroid /= meshArea;
+
+    //runs that face away from the center occlude the ones inside
+    std::vector<float> keys(runCount, 0);
+    for(size_t r = 0; r < runCount; ++r) {
+        float length = glm::length(normals[r]);
+        if(length > 0)
+            keys[r] = glm::dot(centroids[r] - meshCentroid, normals[r] / length);
+    }
+
+    std::vector<size_t> order(runCount);
+    std::iota(begin(order), end(order), 0);
+    std::stable_sort(begin(order), end(order), [&](size_t a, size_t b) {
+        return keys[a] > keys[b];
+    });
+
+    std::vector<uint> result;
+    result.reserve(indices.size());
+    for(size_t r : order)
+        result.insert(end(result),
+                      begin(indices) + bounds[r] * 3,
+                      begin(indices) + bounds[r + 1] * 3);
+
+    if(analyze(result, vertices.size()).acmr > analyze(indices, vertices.size()).acmr * threshold)
+        return indices;
+    return result;
+}
+
+std::vector<uint> IndexOptimizer::optimizeVertexFetch(std::vector<uint> &indices, size_t vertexCount)
+{
+    const uint unused = std::numeric_limits<uint>::max();
+    std::vector<uint> remap(vertexCount, unused);
+    uint next = 0;
+    for(uint &index : indices) {
+        if(remap[index] == unused) remap[index] = next++;
+        index = remap[index];
+    }
+
+    //unreferenced vertices go to the end
+    for(uint &index : remap)
+        if(index == unused) index = next++;
+    return remap;
+}
+
+std::shared_ptr<const IndexOptimizer::TriangleBuffer> IndexOptimizer::build(VertexListPtr vertices,
+                                                                            PolygonListPtr polygons,
+                                                                            std::shared_ptr<const std::vector<MeshData::LOD>> lods,
+                                                                            std::shared_ptr<const MeshData::Clusters> clusters)
+{
+    if(!vertices || !polygons) return nullptr;
+
+    auto buffer = std::make_shared<TriangleBuffer>();
+    auto triangles = MeshSimplification::triangulate(*polygons);
+    buffer->original = analyze(triangles, vertices->size());
+
+    //the clusters are a reordering of the full mesh, the order of the
+    //clusters has to stay as it is so they can be drawn as ranges
+    if(clusters && clusters->triangles.size() == triangles.size()) {
+        buffer->clusters = clusters;
+        for(const auto &cluster : clusters->clusters) {
+            auto range = optimizeRange(clusters->triangles,
+                                       cluster.firstTriangle * 3,
+                                       cluster.triangleCount * 3,
+                                       *vertices,
+                                       false);
+            buffer->indices.insert(end(buffer->indices), begin(range), end(range));
+        }
+    }
+    else {
+        buffer->indices = optimizeRange(triangles, 0, triangles.size(), *vertices, true);
+    }
+    buffer->levels.push_back({0, buffer->indices.size()});
+
+    if(lods) {
+        for(const auto &lod : *lods) {
+            auto range = optimizeRange(lod.triangles, 0, lod.triangles.size(), *vertices, true);
+            buffer->levels.push_back({buffer->indices.size(), range.size()});
+            buffer->errors.push_back(lod.error);
+            buffer->indices.insert(end(buffer->indices), begin(range), end(range));
+        }
+    }
+
+    buffer->optimized = analyze(std::vector<uint>(begin(buffer->indices),
+                                                  begin(buffer->indices) + buffer->levels[0].count),
+                                vertices->size());
+    buffer->vertexRemap = optimizeVertexFetch(buffer->indices, vertices->size());
+    return buffer;
+}
@@ -0,0 +1,75 @@
+#ifndef MT_GL_INDEX_OPTIMIZER_H
+#define MT_GL_INDEX_OPTIMIZER_H
+
+#include "memory"
+#include "vector"
+#include "../datatypes/Object/object.h"
+
+namespace MindTree {
+namespace GL {
+
+//reorders triangle lists for the post transform vertex cache (tipsify),
+//for less overdraw and for linear vertex fetches
+namespace IndexOptimizer {
+
+//entries of the simulated fifo cache
+const uint CACHE_SIZE = 16;
+
+struct Statistics {
+    //transformed vertices per triangle, 0.5 is the best a regular grid can get
+    float acmr;
+    //transformed vertices per referenced vertex, 1 is optimal
+    float atvr;
+};
+
+Statistics analyze(const std::vector<uint> &indices, size_t vertexCount, uint cacheSize=CACHE_SIZE);
+
+//tipsify by Sander et al., runs receives the first triangle of every run
+//that starts after a dead end, these can be reordered without hurting the
+//cache much
+std::vector<uint> optimizeVertexCache(const std::vector<uint> &indices,
+                                      size_t vertexCount,
+                                      std::vector<size_t> *runs=nullptr,
+                                      uint cacheSize=CACHE_SIZE);
+
+//sorts runs so the ones that face outwards are drawn first, falls back to
+//the input order when that would cost more than threshold times the acmr
+std::vector<uint> optimizeOverdraw(const std::vector<uint> &indices,
+                                   const std::vector<size_t> &runs,
+                                   const VertexList &vertices,
+                                   float threshold=1.05);
+
+//renumbers the vertices in the order they are first used, returns the new
+//index of every old vertex
+std::vector<uint> optimizeVertexFetch(std::vector<uint> &indices, size_t vertexCount);
+
+//every level of detail of a mesh in one optimized index list
+struct TriangleBuffer {
+    struct Range {
+        size_t offset;
+        size_t count;
+    };
+    std::vector<uint> indices;
+    //full mesh first, followed by the levels of detail
+    std::vector<Range> levels;
+    std::vector<float> errors;
+    //the full mesh keeps the cluster order, clusters are optimized on their own
+    std::shared_ptr<const MeshData::Clusters> clusters;
+    //vertex attributes have to be uploaded in this order
+    std::vector<uint> vertexRemap;
+    //of the full mesh before and after optimizing
+    Statistics original;
+    Statistics optimized;
+};
+
+std::shared_ptr<const TriangleBuffer> build(VertexListPtr vertices,
+                                            PolygonListPtr polygons,
+                                            std::shared_ptr<const std::vector<MeshData::LOD>> lods,
+                                            std::shared_ptr<const MeshData::Clusters> clusters);
+
+}
+
+}
+}
+
+#endif
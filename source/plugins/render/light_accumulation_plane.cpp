@@ -1,13 +1,20 @@
 #define GLM_FORCE_SWIZZLE
 
+#include "algorithm"
+#include "cmath"
+#include "limits"
+
 #include "deferred_renderer.h"
+#include "shadow_mapping.h"
 #include "light_accumulation_plane.h"
 
 using namespace MindTree;
 using namespace GL;
 
 LightAccumulationPlane::LightAccumulationPlane()
-    : PixelPlane("../plugins/render/defaultShaders/deferredshading.frag")
+    : PixelPlane("../plugins/render/defaultShaders/deferredshading.frag"),
+    _lightsChanged(true),
+    _shadowBlock(nullptr)
 {
 }
 
@@ -19,6 +26,7 @@ void LightAccumulationPlane::setLights(std::vector<std::shared_ptr<Light>> light
 {
     std::lock_guard<std::mutex> lock(_lightsLock);
     _lights = lights;
+    _lightsChanged = true;
 }
 
 std::vector<LightPtr> LightAccumulationPlane::getLight() const
@@ -26,35 +34,31 @@ std::vector<LightPtr> LightAccumulationPlane::getLight() const
     std::lock_guard<std::mutex> lock(_lightsLock);
     return _lights;
 }
-void LightAccumulationPlane::setShadowPasses(std::unordered_map<std::shared_ptr<Light>,
-                                             RenderPass*> shadowPasses)
+void LightAccumulationPlane::setShadowBlock(ShadowMappingRenderBlock *shadowBlock)
 {
-    std::lock_guard<std::mutex> lock(_shadowPassesLock);
-    _shadowPasses = shadowPasses;
+    _shadowBlock = shadowBlock;
+    _lightsChanged = true;
 }
 
-std::unordered_map<LightPtr, RenderPass*> LightAccumulationPlane::getShadowPases() const
+ShadowMappingRenderBlock* LightAccumulationPlane::getShadowBlock() const
 {
-    return _shadowPasses;
+    return _shadowBlock;
 }
 
 
 void LightAccumulationPlane::drawLight(const LightPtr &light,
                                        ShaderProgram *program)
 {
-    std::lock_guard<std::mutex> lock2(_shadowPassesLock);
     static const float PI = 3.14159265359;
     UniformStateManager states(program);
     states.addState("light.shadow", static_cast<int>(light->getShadowInfo()._enabled));
     states.addState("light.bias", light->getShadowInfo()._bias);
-    if(_shadowPasses.find(light) != _shadowPasses.end()) {
-        auto shadowPass = _shadowPasses.at(light);
-        auto shadowmap = shadowPass->getOutDepthTexture();
-        program->setTexture(shadowmap);
-        auto shadowcam = shadowPass->getCamera();
-        glm::mat4 mvp = shadowcam->getProjection()
-            * shadowcam->getViewMatrix();
-        states.addState("light.shadowmvp", mvp);
+    ShadowMappingRenderBlock *shadowBlock = _shadowBlock;
+    ShadowMap shadowMap;
+    if(shadowBlock && shadowBlock->getShadowMap(light, &shadowMap)) {
+        program->setTexture(shadowBlock->getAtlasTexture(), "shadow");
+        states.addState("light.shadowmvp", shadowMap.matrices[0]);
+        states.addState("light.atlasRegion", shadowMap.regions[0]);
     }
     double coneangle = 360;
     if(light->getLightType() == Light::SPOT)
@@ -89,3 +93,207 @@ void LightAccumulationPlane::draw(const CameraPtr& /* camera */,
         drawLight(light, program);
     }
 }
+
+namespace {
+    const int CLUSTER_X = 16;
+    const int CLUSTER_Y = 9;
+    const int CLUSTER_Z = 24;
+
+    //light contribution at which point and spot lights get cut off
+    const float LIGHT_CUTOFF = .005;
+}
+
+ClusteredLightPlane::ClusteredLightPlane() :
+    _numDistantLights(0),
+    _shadowVersion(0),
+    _clusterNear(.1),
+    _clusterFar(100),
+    _clusterLinear(false)
+{
+    setFragmentShader("../plugins/render/defaultShaders/deferredshading_clustered.frag");
+}
+
+void ClusteredLightPlane::init(ShaderProgram* program)
+{
+    PixelPlane::init(program);
+
+    _lightBuffer = make_resource<SSBO>(getResourceManager());
+    _clusterBuffer = make_resource<SSBO>(getResourceManager());
+    _lightIndexBuffer = make_resource<SSBO>(getResourceManager());
+
+    //the shadow sampler needs a depth texture bound, even without shadows
+    _emptyShadowMap = make_resource<Texture2D>(getResourceManager(),
+                                               "emptyshadow",
+                                               Texture::DEPTH32F);
+    _emptyShadowMap->setWidth(1);
+    _emptyShadowMap->setHeight(1);
+    _emptyShadowMap->init();
+
+    _lightsChanged = true;
+}
+
+void ClusteredLightPlane::uploadLights()
+{
+    static const float PI = 3.14159265359;
+    _lightData.clear();
+
+    auto lights = getLight();
+    ShadowMappingRenderBlock *shadowBlock = getShadowBlock();
+    if(shadowBlock) _shadowVersion = shadowBlock->getVersion();
+
+    //distant lights go first, they are not binned into clusters
+    std::stable_partition(begin(lights), end(lights), [](const LightPtr &light) {
+                              return light->getLightType() == Light::DISTANT;
+                          });
+
+    _numDistantLights = 0;
+    for(const auto &light : lights) {
+        LightData data;
+        data.color = light->getColor();
+
+        bool distant = light->getLightType() == Light::DISTANT;
+        if(distant) ++_numDistantLights;
+        data.pos = glm::vec4(light->getPosition(), distant ? 0 : 1);
+
+        double coneangle = 360;
+        glm::vec3 dir(0);
+        if(light->getLightType() == Light::SPOT) {
+            coneangle = std::static_pointer_cast<SpotLight>(light)->getConeAngle();
+        }
+        if(light->getLightType() != Light::POINT) {
+            dir = light->getTransformation()[2].xyz();
+        }
+        data.dir = glm::vec4(dir, coneangle * PI / 180);
+
+        float numShadowMatrices = 0;
+        auto info = light->getShadowInfo();
+        ShadowMap shadowMap;
+        if(info._enabled
+           && shadowBlock
+           && shadowBlock->getShadowMap(light, &shadowMap)) {
+            numShadowMatrices = std::min(shadowMap.matrices.size(),
+                                         size_t(ShadowMappingRenderBlock::MAX_CASCADES));
+            for(int i = 0; i < numShadowMatrices; ++i) {
+                data.shadowmvp[i] = shadowMap.matrices[i];
+                data.regions[i] = shadowMap.regions[i];
+                data.cascadeSplits[i] = shadowMap.splits[i];
+            }
+        }
+
+        glm::vec3 col = glm::pow(glm::vec3(data.color), glm::vec3(2.2));
+        float brightness = std::max(col.r, std::max(col.g, col.b)) * light->getIntensity();
+        float range = std::sqrt(std::max(brightness, 0.f) / LIGHT_CUTOFF);
+        data.params = glm::vec4(light->getIntensity(), info._bias, numShadowMatrices, range);
+
+        _lightData.push_back(data);
+    }
+
+    _lightBuffer->data(_lightData);
+    _lightsChanged = false;
+}
+
+void ClusteredLightPlane::buildClusters(const CameraPtr &camera)
+{
+    glm::mat4 projection = camera->getProjection();
+    glm::mat4 view = camera->getViewMatrix();
+
+    _clusterNear = camera->getNear();
+    _clusterFar = camera->getFar();
+    _clusterLinear = camera->isOrthographic();
+    float logDepthRange = std::log(_clusterFar / _clusterNear);
+
+    //orthographic views do not get coarser with distance, so their slices
+    //are spread evenly instead of logarithmically
+    auto slice = [this, logDepthRange](float depth) {
+        depth = std::max(depth, _clusterNear);
+        int s = _clusterLinear
+            ? (depth - _clusterNear) / (_clusterFar - _clusterNear) * CLUSTER_Z
+            : std::log(depth / _clusterNear) / logDepthRange * CLUSTER_Z;
+        return glm::clamp(s, 0, CLUSTER_Z - 1);
+    };
+
+    std::vector<std::vector<uint>> bins(CLUSTER_X * CLUSTER_Y * CLUSTER_Z);
+    for(size_t i = _numDistantLights; i < _lightData.size(); ++i) {
+        const auto &light = _lightData[i];
+        float radius = light.params.w;
+        glm::vec3 center = (view * glm::vec4(light.pos.xyz(), 1)).xyz();
+
+        float minDepth = -center.z - radius;
+        float maxDepth = -center.z + radius;
+        if(maxDepth < _clusterNear || minDepth > _clusterFar) continue;
+
+        int z0 = slice(minDepth);
+        int z1 = slice(std::min(maxDepth, _clusterFar));
+        int x0 = 0, x1 = CLUSTER_X - 1;
+        int y0 = 0, y1 = CLUSTER_Y - 1;
+
+        //if the sphere crosses the near plane, it covers the whole screen
+        if(minDepth > _clusterNear) {
+            glm::vec2 ndcMin(std::numeric_limits<float>::max());
+            glm::vec2 ndcMax(std::numeric_limits<float>::lowest());
+            for(int c = 0; c < 8; ++c) {
+                glm::vec3 corner = center + radius * glm::vec3((c & 1) ? 1 : -1,
+                                                               (c & 2) ? 1 : -1,
+                                                               (c & 4) ? 1 : -1);
+                glm::vec4 clip = projection * glm::vec4(corner, 1);
+                glm::vec2 ndc = clip.xy() / clip.w;
+                ndcMin = glm::min(ndcMin, ndc);
+                ndcMax = glm::max(ndcMax, ndc);
+            }
+            if(ndcMax.x < -1 || ndcMax.y < -1 || ndcMin.x > 1 || ndcMin.y > 1)
+                continue;
+
+            x0 = glm::clamp(int((ndcMin.x * .5 + .5) * CLUSTER_X), 0, CLUSTER_X - 1);
+            x1 = glm::clamp(int((ndcMax.x * .5 + .5) * CLUSTER_X), 0, CLUSTER_X - 1);
+            y0 = glm::clamp(int((ndcMin.y * .5 + .5) * CLUSTER_Y), 0, CLUSTER_Y - 1);
+            y1 = glm::clamp(int((ndcMax.y * .5 + .5) * CLUSTER_Y), 0, CLUSTER_Y - 1);
+        }
+
+        for(int z = z0; z <= z1; ++z)
+            for(int y = y0; y <= y1; ++y)
+                for(int x = x0; x <= x1; ++x)
+                    bins[(z * CLUSTER_Y + y) * CLUSTER_X + x].push_back(i);
+    }
+
+    _clusters.resize(bins.size());
+    _lightIndices.clear();
+    for(size_t i = 0; i < bins.size(); ++i) {
+        _clusters[i] = glm::uvec2(_lightIndices.size(), bins[i].size());
+        _lightIndices.insert(end(_lightIndices), begin(bins[i]), end(bins[i]));
+    }
+
+    _clusterBuffer->data(_clusters);
+    _lightIndexBuffer->data(_lightIndices);
+}
+
+void ClusteredLightPlane::draw(const CameraPtr &camera,
+                               const RenderConfig& /* config */,
+                               ShaderProgram *program)
+{
+    if(!camera) return;
+
+    //cascades follow the camera, so the shadow matrices can change without
+    //any light being touched
+    ShadowMappingRenderBlock *shadowBlock = getShadowBlock();
+    if(_lightsChanged || (shadowBlock && shadowBlock->getVersion() != _shadowVersion))
+        uploadLights();
+    buildClusters(camera);
+
+    Texture2D *atlas = shadowBlock ? shadowBlock->getAtlasTexture() : nullptr;
+    program->setTexture(atlas ? atlas : _emptyShadowMap.get(), "shadow");
+
+    _lightBuffer->bindBase(0);
+    _clusterBuffer->bindBase(1);
+    _lightIndexBuffer->bindBase(2);
+
+    program->setUniform("clusterGrid", glm::ivec3(CLUSTER_X, CLUSTER_Y, CLUSTER_Z));
+    program->setUniform("clusterNear", _clusterNear);
+    program->setUniform("clusterFar", _clusterFar);
+    program->setUniform("clusterLinear", static_cast<int>(_clusterLinear));
+    program->setUniform("numDistantLights", _numDistantLights);
+
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendEquationSeparate(GL_FUNC_ADD, GL_MAX);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    MTGLERROR;
+}
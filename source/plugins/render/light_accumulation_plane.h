@@ -8,6 +8,8 @@ class SpotLight;
 namespace MindTree {
 namespace GL {
 
+class ShadowMappingRenderBlock;
+
 class LightAccumulationPlane : public PixelPlane
 {
 public:
@@ -15,22 +17,66 @@ public:
     virtual ~LightAccumulationPlane();
 
     void setLights(std::vector<std::shared_ptr<Light>> lights);
-    void setShadowPasses(std::unordered_map<std::shared_ptr<Light>, RenderPass*> shadowPasses);
+    void setShadowBlock(ShadowMappingRenderBlock *shadowBlock);
 
 protected:
     virtual void draw(const CameraPtr &camera, const RenderConfig &config, ShaderProgram* program);
     virtual void drawLight(const LightPtr &light, ShaderProgram* program);
 
     std::vector<LightPtr> getLight() const;
-    std::unordered_map<LightPtr, RenderPass*> getShadowPases() const;
+    ShadowMappingRenderBlock* getShadowBlock() const;
+
+    std::atomic<bool> _lightsChanged;
 
 private:
-    mutable std::mutex _shadowPassesLock;
     mutable std::mutex _lightsLock;
-    std::unordered_map<std::shared_ptr<Light>, RenderPass*> _shadowPasses;
+    std::atomic<ShadowMappingRenderBlock*> _shadowBlock;
     std::vector<std::shared_ptr<Light>> _lights;
 };
 
+//shades all lights in a single fullscreen pass, point and spot lights are
+//binned into a view space froxel grid so every pixel only loops over the
+//lights that can reach it
+class ClusteredLightPlane : public LightAccumulationPlane
+{
+public:
+    ClusteredLightPlane();
+
+protected:
+    void init(ShaderProgram* program) override;
+    void draw(const CameraPtr &camera, const RenderConfig &config, ShaderProgram* program) override;
+
+private:
+    struct LightData {
+        glm::vec4 color;
+        glm::vec4 pos;
+        glm::vec4 dir;
+        glm::vec4 params;
+        //far view depth of every cascade
+        glm::vec4 cascadeSplits;
+        //atlas uv offset and scale per cascade
+        glm::vec4 regions[4];
+        glm::mat4 shadowmvp[4];
+    };
+
+    void uploadLights();
+    void buildClusters(const CameraPtr &camera);
+
+    std::vector<LightData> _lightData;
+    int _numDistantLights;
+    unsigned _shadowVersion;
+
+    float _clusterNear, _clusterFar;
+    bool _clusterLinear;
+    std::vector<glm::uvec2> _clusters;
+    std::vector<uint> _lightIndices;
+
+    ResourceHandle<SSBO> _lightBuffer;
+    ResourceHandle<SSBO> _clusterBuffer;
+    ResourceHandle<SSBO> _lightIndexBuffer;
+    ResourceHandle<Texture2D> _emptyShadowMap;
+};
+
 }
 }
 #endif
@@ -0,0 +1,181 @@
+#include "iostream"
+#include "vector"
+
+#ifdef MT_WITH_EGL
+#include "EGL/egl.h"
+#include "EGL/eglext.h"
+#endif
+
+#ifdef MT_WITH_OSMESA
+#include "GL/osmesa.h"
+#endif
+
+#include "offscreen_context.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+OffscreenContext::~OffscreenContext()
+{
+}
+
+namespace {
+#ifdef MT_WITH_EGL
+class EGLOffscreenContext : public OffscreenContext
+{
+public:
+    EGLOffscreenContext() :
+        _display(EGL_NO_DISPLAY), _context(EGL_NO_CONTEXT)
+    {
+    }
+
+    ~EGLOffscreenContext()
+    {
+        if(_context != EGL_NO_CONTEXT) {
+            doneCurrent();
+            eglDestroyContext(_display, _context);
+        }
+        if(_display != EGL_NO_DISPLAY)
+            eglTerminate(_display);
+    }
+
+    bool init(int major, int minor)
+    {
+        //prefer mesas surfaceless platform, it needs neither X11 nor a gpu
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if(getPlatformDisplay)
+            _display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if(_display == EGL_NO_DISPLAY)
+            _display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if(_display == EGL_NO_DISPLAY) return false;
+
+        EGLint eglMajor, eglMinor;
+        if(!eglInitialize(_display, &eglMajor, &eglMinor)) {
+            _display = EGL_NO_DISPLAY;
+            return false;
+        }
+
+        std::string extensions = eglQueryString(_display, EGL_EXTENSIONS);
+        if(extensions.find("EGL_KHR_surfaceless_context") == std::string::npos) {
+            std::cout << "EGL display does not support surfaceless contexts" << std::endl;
+            return false;
+        }
+
+        if(!eglBindAPI(EGL_OPENGL_API)) return false;
+
+        EGLint configAttribs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint numConfigs = 0;
+        if(!eglChooseConfig(_display, configAttribs, &config, 1, &numConfigs) || !numConfigs)
+            return false;
+
+        //same profile as the qt viewports use
+        EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, major,
+            EGL_CONTEXT_MINOR_VERSION, minor,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+            EGL_NONE
+        };
+        _context = eglCreateContext(_display, config, EGL_NO_CONTEXT, contextAttribs);
+        return _context != EGL_NO_CONTEXT;
+    }
+
+    bool makeCurrent() override
+    {
+        return eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context);
+    }
+
+    void doneCurrent() override
+    {
+        eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    }
+
+    std::string getName() const override
+    {
+        return std::string("EGL ") + eglQueryString(_display, EGL_VENDOR);
+    }
+
+private:
+    EGLDisplay _display;
+    EGLContext _context;
+};
+#endif
+
+#ifdef MT_WITH_OSMESA
+class OSMesaOffscreenContext : public OffscreenContext
+{
+public:
+    OSMesaOffscreenContext() :
+        _context(nullptr),
+        //osmesa always needs a color buffer, the render tree draws into
+        //its own framebuffer objects anyway
+        _buffer(4)
+    {
+    }
+
+    ~OSMesaOffscreenContext()
+    {
+        if(_context) OSMesaDestroyContext(_context);
+    }
+
+    bool init(int major, int minor)
+    {
+        const int attribs[] = {
+            OSMESA_FORMAT, OSMESA_RGBA,
+            OSMESA_DEPTH_BITS, 24,
+            OSMESA_PROFILE, OSMESA_COMPAT_PROFILE,
+            OSMESA_CONTEXT_MAJOR_VERSION, major,
+            OSMESA_CONTEXT_MINOR_VERSION, minor,
+            0
+        };
+        _context = OSMesaCreateContextAttribs(attribs, nullptr);
+        return _context != nullptr;
+    }
+
+    bool makeCurrent() override
+    {
+        return OSMesaMakeCurrent(_context, _buffer.data(), GL_UNSIGNED_BYTE, 1, 1);
+    }
+
+    void doneCurrent() override
+    {
+        OSMesaMakeCurrent(nullptr, nullptr, GL_UNSIGNED_BYTE, 0, 0);
+    }
+
+    std::string getName() const override
+    {
+        return "OSMesa";
+    }
+
+private:
+    OSMesaContext _context;
+    std::vector<unsigned char> _buffer;
+};
+#endif
+}
+
+std::unique_ptr<OffscreenContext> OffscreenContext::create(int major, int minor)
+{
+#ifdef MT_WITH_EGL
+    {
+        auto context = std::make_unique<EGLOffscreenContext>();
+        if(context->init(major, minor) && context->makeCurrent())
+            return std::move(context);
+        std::cout << "could not create EGL offscreen context" << std::endl;
+    }
+#endif
+#ifdef MT_WITH_OSMESA
+    {
+        auto context = std::make_unique<OSMesaOffscreenContext>();
+        if(context->init(major, minor) && context->makeCurrent())
+            return std::move(context);
+        std::cout << "could not create OSMesa offscreen context" << std::endl;
+    }
+#endif
+    std::cout << "no offscreen context available" << std::endl;
+    return nullptr;
+}
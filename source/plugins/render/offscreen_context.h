@@ -0,0 +1,28 @@
+#ifndef MT_GL_OFFSCREEN_CONTEXT_H
+#define MT_GL_OFFSCREEN_CONTEXT_H
+
+#include "memory"
+#include "string"
+
+namespace MindTree {
+namespace GL {
+
+//gl context that is not bound to any window system surface, so it can be
+//created on headless machines (EGL surfaceless or OSMesa)
+class OffscreenContext
+{
+public:
+    virtual ~OffscreenContext();
+
+    //tries all backends that were compiled in, returns nullptr if none works
+    static std::unique_ptr<OffscreenContext> create(int major=4, int minor=3);
+
+    virtual bool makeCurrent() = 0;
+    virtual void doneCurrent() = 0;
+    virtual std::string getName() const = 0;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "iostream"
+
+#include "glwrapper.h"
+#include "rendertree.h"
+#include "render_setup.h"
+#include "deferred_renderer.h"
+#include "forward_renderer.h"
+#include "offscreen_context.h"
+#include "../datatypes/Object/object.h"
+
+#include "offscreen_renderer.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+namespace {
+    //frames in flight before the oldest readback has to be mapped
+    const size_t NUM_READBACKS = 3;
+}
+
+OffscreenRenderer::OffscreenRenderer(int width, int height, Pipeline pipeline) :
+    _width(width),
+    _height(height),
+    _context(OffscreenContext::create()),
+    _currentReadback(0)
+{
+    if(!_context) return;
+    std::cout << "offscreen context: " << _context->getName() << std::endl;
+
+    glewExperimental = GL_TRUE;
+    glewInit();
+    //glew may leave an error behind on core contexts
+    glGetError();
+
+    _camera = std::make_shared<Camera>();
+    _camera->setResolution(_width, _height);
+    _camera->setAspect(double(_width) / _height);
+
+    switch(pipeline) {
+        case DEFERRED:
+            _configurator = std::make_unique<DeferredRenderer>(_camera, nullptr);
+            break;
+        case FORWARD:
+            _configurator = std::make_unique<ForwardRenderer>(_camera, nullptr);
+            break;
+    }
+
+    auto *manager = _configurator->getTree()->getResourceManager();
+    _color = make_resource<Renderbuffer>(manager, "color", Renderbuffer::RGBA8, _width, _height);
+    _color->init();
+    _depth = make_resource<Renderbuffer>(manager, "depth", Renderbuffer::DEPTH, _width, _height);
+    _depth->init();
+
+    _target = make_resource<FBO>(manager);
+    {
+        GLObjectBinder<FBO*> binder(_target.get());
+        _target->attachColorRenderbuffer(_color.get());
+        _target->attachDepthRenderbuffer(_depth.get());
+        getGLFramebufferError("OffscreenRenderer");
+    }
+
+    for(size_t i = 0; i < NUM_READBACKS; ++i)
+        _readbacks.push_back({make_resource<PBO>(manager), ""});
+
+    _writer = std::make_unique<ImageWriter>();
+}
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+    if(isValid()) finish();
+}
+
+bool OffscreenRenderer::isValid() const
+{
+    return _context != nullptr;
+}
+
+std::string OffscreenRenderer::getContextName() const
+{
+    return _context ? _context->getName() : "";
+}
+
+RenderConfigurator* OffscreenRenderer::getConfigurator()
+{
+    return _configurator.get();
+}
+
+void OffscreenRenderer::setCamera(std::shared_ptr<Camera> camera)
+{
+    if(!isValid() || !camera) return;
+
+    _camera = camera;
+    _camera->setResolution(_width, _height);
+    _camera->setAspect(double(_width) / _height);
+    _configurator->setCamera(_camera);
+}
+
+void OffscreenRenderer::setGeometry(std::shared_ptr<Group> grp)
+{
+    if(!isValid() || !grp) return;
+    _configurator->setGeometry(grp);
+}
+
+void OffscreenRenderer::setProperty(const std::string &name, Property prop)
+{
+    if(!isValid()) return;
+    _configurator->setProperty(name, prop);
+}
+
+void OffscreenRenderer::renderFrame(const std::string &filename)
+{
+    if(!isValid()) return;
+
+    Readback &readback = _readbacks[_currentReadback];
+    _currentReadback = (_currentReadback + 1) % _readbacks.size();
+
+    //the oldest frame in the ring is done by now in all but the slowest cases
+    if(readback.pbo->isPending())
+        fetch(readback);
+
+    {
+        GLObjectBinder<FBO*> binder(_target.get());
+        glViewport(0, 0, _width, _height);
+        _configurator->getTree()->draw();
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, _target->getID());
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        readback.pbo->read(0, 0, _width, _height,
+                           GL_RGBA, GL_UNSIGNED_BYTE,
+                           size_t(_width) * _height * 4);
+        readback.filename = filename;
+    }
+    MTGLERROR;
+}
+
+void OffscreenRenderer::fetch(Readback &readback)
+{
+    Image image;
+    image.filename = readback.filename;
+    image.width = _width;
+    image.height = _height;
+    image.channels = 4;
+    image.pixels.resize(size_t(_width) * _height * 4);
+    if(!readback.pbo->copyTo(image.pixels.data(), image.pixels.size())) {
+        std::cout << "readback failed for: " << readback.filename << std::endl;
+        return;
+    }
+    _writer->write(std::move(image));
+}
+
+bool OffscreenRenderer::finish()
+{
+    if(!isValid()) return false;
+
+    //fetch in submission order, starting with the oldest frame
+    for(size_t i = 0; i < _readbacks.size(); ++i) {
+        Readback &readback = _readbacks[(_currentReadback + i) % _readbacks.size()];
+        if(readback.pbo->isPending())
+            fetch(readback);
+    }
+    _writer->wait();
+    return _writer->getFailedCount() == 0;
+}
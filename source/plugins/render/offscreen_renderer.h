@@ -0,0 +1,75 @@
+#ifndef MT_GL_OFFSCREEN_RENDERER_H
+#define MT_GL_OFFSCREEN_RENDERER_H
+
+#include "memory"
+#include "string"
+#include "vector"
+
+#include "data/properties.h"
+#include "resource_handling.h"
+#include "image_writer.h"
+
+class Camera;
+class Group;
+
+namespace MindTree {
+namespace GL {
+
+class OffscreenContext;
+class RenderConfigurator;
+
+//drives a render tree without any window or qt widget, frames are rendered
+//into a framebuffer object, read back asynchronously through a ring of pbos
+//and written to disk by an ImageWriter
+class OffscreenRenderer
+{
+public:
+    enum Pipeline {
+        DEFERRED,
+        FORWARD
+    };
+
+    OffscreenRenderer(int width, int height, Pipeline pipeline=DEFERRED);
+    ~OffscreenRenderer();
+
+    bool isValid() const;
+    std::string getContextName() const;
+
+    RenderConfigurator* getConfigurator();
+
+    void setCamera(std::shared_ptr<Camera> camera);
+    void setGeometry(std::shared_ptr<Group> grp);
+    void setProperty(const std::string &name, Property prop);
+
+    //renders one frame and queues it for writing, the readback of a frame
+    //completes while the following frames render
+    void renderFrame(const std::string &filename);
+
+    //blocks until every rendered frame is on disk, returns false if any
+    //frame could not be written
+    bool finish();
+
+private:
+    struct Readback {
+        ResourceHandle<PBO> pbo;
+        std::string filename;
+    };
+
+    void fetch(Readback &readback);
+
+    int _width, _height;
+    std::unique_ptr<OffscreenContext> _context;
+    std::unique_ptr<RenderConfigurator> _configurator;
+    std::shared_ptr<Camera> _camera;
+    ResourceHandle<FBO> _target;
+    ResourceHandle<Renderbuffer> _color;
+    ResourceHandle<Renderbuffer> _depth;
+    std::vector<Readback> _readbacks;
+    size_t _currentReadback;
+    std::unique_ptr<ImageWriter> _writer;
+};
+
+}
+}
+
+#endif
@@ -1,18 +1,49 @@
 //#include "GL/glew.h"
+#include "thread"
 #include "glm/gtc/matrix_transform.hpp"
 
 #include "glwrapper.h"
 #include "rendertree.h"
+#include "scene_bvh.h"
+#include "texture_cache.h"
 #include "data/debuglog.h"
 
 #include "polygon_renderer.h"
 
 using namespace MindTree::GL;
 
+namespace {
+    //below this many clusters spawning threads costs more than it saves
+    const size_t PARALLEL_CULL_CLUSTERS = 1 << 14;
+
+    //the normal cone of the cluster faces away from eye for every point
+    //inside of its bounding sphere
+    bool isBackfacing(const MeshData::Cluster &cluster, const glm::vec3 &eye)
+    {
+        if(cluster.coneCos <= 0) return false;
+
+        glm::vec3 toCluster = cluster.center - eye;
+        float distance = glm::length(toCluster);
+        if(distance <= cluster.radius) return false;
+
+        float cosView = glm::dot(toCluster, cluster.coneAxis) / distance;
+        float sinView = std::sqrt(std::max(0.f, 1 - cosView * cosView));
+        float sinCone = std::sqrt(std::max(0.f, 1 - cluster.coneCos * cluster.coneCos));
+        return cosView * cluster.coneCos - sinView * sinCone > cluster.radius / distance;
+    }
+}
+
 PolygonRenderer::PolygonRenderer(std::shared_ptr<GeoObject> o) :
-	GeoObjectRenderer(o),
-	_triangleCount(0)
+	GeoObjectRenderer(o)
 {
+    //optimizing starts right away, so all meshes of a scene are processed
+    //in parallel before the first renderer is initialized
+    GeometryCache::prepareTriangles(static_cast<MeshData*>(o->getData().get()));
+
+    //textures are decoded in the background while the scene is set up
+    auto material = o->getMaterial();
+    if(material && material->hasProperty("diffuse_texture"))
+        TextureLoader::request(material->getProperty("diffuse_texture").getData<std::string>());
 }
 
 PolygonRenderer::~PolygonRenderer()
@@ -31,34 +62,13 @@ ShaderProgram* PolygonRenderer::getProgram()
     return getResourceManager()->shaderManager()->getProgram<PolygonRenderer>();
 }
 
-std::vector<uint> PolygonRenderer::triangulate()
-{
-    auto data = obj->getData();
-    auto polygons = data->getProperty("polygon").getData<PolygonListPtr>();
-
-    std::cout << "---------" << std::endl;
-    std::cout << "polygon count: " << polygons->size() << std::endl;
-    std::vector<uint> triangles;
-    for(const Polygon &poly : *polygons) {
-        uint first = poly[0];
-        for(size_t i = 1; i < poly.size() - 1; ++i) {
-            triangles.push_back(first);
-            triangles.push_back(poly[i]);
-            triangles.push_back(poly[i+1]);
-        }
-    }
-    _triangleCount = triangles.size();
-    std::cout << "traingle count: " << _triangleCount << std::endl;
-    std::cout << "---------" << std::endl;
-    return triangles;
-}
-
 void PolygonRenderer::initCustom()
 {
     auto data = obj->getData();
     _triangulatedIBO = make_resource<IBO>(getResourceManager());
     _triangulatedIBO->bind();
-    _triangulatedIBO->data(triangulate());
+    _triangles = GeometryCache::getTriangles(static_cast<MeshData*>(data.get()));
+    if(_triangles) _triangulatedIBO->data(_triangles->indices);
     if (std::static_pointer_cast<MeshData>(data)->hasProperty("polygon_color")) {
         auto colProp = std::static_pointer_cast<MeshData>(data)->getProperty("polygon_color");
         auto colors = colProp.getData<std::vector<uint8_t>>();
@@ -80,8 +90,19 @@ void PolygonRenderer::draw(const CameraPtr &camera, const RenderConfig &config,
 
     if(_polyColors) program->setTexture(_polyColors.get());
 
-    if(obj->getMaterial()) {
-        manager.setFromPropertyMap(obj->getMaterial()->getProperties());
+    auto material = obj->getMaterial();
+    if(material) {
+        manager.setFromPropertyMap(material->getProperties());
+    }
+
+    //objects are drawn without their texture until it is uploaded
+    if(material && material->hasProperty("diffuse_texture")) {
+        auto filename = material->getProperty("diffuse_texture").getData<std::string>();
+        Texture2D *texture = getResourceManager()->textureCache()->getTexture(filename);
+        if(texture) {
+            program->setTexture(texture, "diffuse_texture");
+            manager.addState("has_diffuse_texture", 1.0f);
+        }
     }
 
     bool has_polys = _polyColors.get();
@@ -90,10 +111,76 @@ void PolygonRenderer::draw(const CameraPtr &camera, const RenderConfig &config,
     //program->setTexture(_polyColorTexture);
     glPolygonOffset(1.0, 1.0);
     MTGLERROR;
+    if(!_triangles) return;
+    size_t lod = selectLOD(camera, _triangles->errors);
+    if(lod == 0 && _triangles->clusters && camera) {
+        drawClusters(camera);
+        return;
+    }
+
+    const auto &range = _triangles->levels[lod];
     glDrawElements(GL_TRIANGLES, //Primitive type
-                   _triangleCount,
+                   range.count,
                    GL_UNSIGNED_INT, //index datatype
-                   nullptr); //offsets
+                   reinterpret_cast<const GLvoid*>(range.offset * sizeof(uint))); //offsets
+    MTGLERROR;
+}
+
+void PolygonRenderer::drawClusters(const CameraPtr &camera)
+{
+    const auto &clusters = _triangles->clusters->clusters;
+
+    //culling happens in object space, planes and the side of a triangle the
+    //eye is on do not change under the model transformation
+    glm::mat4 modelView = camera->getViewMatrix() * getGlobalTransformation();
+    Frustum frustum(camera->getProjection() * modelView);
+    bool cullBackfaces = !camera->isOrthographic();
+    glm::vec3 eye(glm::inverse(modelView) * glm::vec4(0, 0, 0, 1));
+
+    _visibleClusters.resize(clusters.size());
+    auto cull = [&](size_t first, size_t last) {
+        for(size_t i = first; i < last; ++i) {
+            const auto &cluster = clusters[i];
+            _visibleClusters[i] = frustum.intersects(cluster.center, cluster.radius)
+                && !(cullBackfaces && isBackfacing(cluster, eye));
+        }
+    };
+
+    size_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    if(clusters.size() < PARALLEL_CULL_CLUSTERS || threadCount == 1) {
+        cull(0, clusters.size());
+    }
+    else {
+        std::vector<std::thread> threads;
+        size_t chunk = (clusters.size() + threadCount - 1) / threadCount;
+        for(size_t first = chunk; first < clusters.size(); first += chunk)
+            threads.emplace_back(cull, first, std::min(first + chunk, clusters.size()));
+        cull(0, std::min(chunk, clusters.size()));
+        for(auto &thread : threads) thread.join();
+    }
+
+    //neighbouring visible clusters are consecutive in the index buffer
+    _drawCounts.clear();
+    _drawOffsets.clear();
+    bool previousVisible = false;
+    for(size_t i = 0; i < clusters.size(); ++i) {
+        bool visible = _visibleClusters[i];
+        if(visible && previousVisible) {
+            _drawCounts.back() += clusters[i].triangleCount * 3;
+        }
+        else if(visible) {
+            _drawCounts.push_back(clusters[i].triangleCount * 3);
+            _drawOffsets.push_back(reinterpret_cast<const GLvoid*>(clusters[i].firstTriangle * 3 * sizeof(uint)));
+        }
+        previousVisible = visible;
+    }
+    if(_drawCounts.empty()) return;
+
+    glMultiDrawElements(GL_TRIANGLES, //Primitive type
+                        &_drawCounts[0], //index counts
+                        GL_UNSIGNED_INT, //index datatype
+                        &_drawOffsets[0], //offsets
+                        _drawCounts.size()); //draw count
     MTGLERROR;
 }
 
@@ -123,7 +210,18 @@ void EdgeRenderer::initCustom()
     auto data = obj->getData();
     auto ibo = getResourceManager()->geometryCache()->getIBO(data.get());
     ibo->bind();
-    ibo->data(data->getProperty("polygon").getData<PolygonListPtr>());
+    auto polygons = data->getProperty("polygon").getData<PolygonListPtr>();
+
+    //the vertices are uploaded in the order of the optimized triangles
+    auto triangles = GeometryCache::getTriangles(static_cast<MeshData*>(data.get()));
+    if(polygons && triangles) {
+        auto remapped = std::make_shared<PolygonList>(*polygons);
+        for(auto &polygon : *remapped)
+            for(auto &index : polygon)
+                index = triangles->vertexRemap[index];
+        polygons = remapped;
+    }
+    ibo->data(polygons);
 }
 
 void EdgeRenderer::draw(const CameraPtr &camera, const RenderConfig &config, ShaderProgram* program)
@@ -20,12 +20,20 @@ protected:
     void draw(const CameraPtr &camera, const RenderConfig &config, ShaderProgram* program);
 
 private:
-    std::vector<uint> triangulate();
+    void drawClusters(const CameraPtr &camera);
 
-    size_t _triangleCount;
     void initCustom();
     ResourceHandle<Texture> _polyColors;
     ResourceHandle<IBO> _triangulatedIBO;
+
+    //the levels of detail follow the full mesh in the same index buffer,
+    //the full mesh is in cluster order when the mesh has clusters
+    std::shared_ptr<const IndexOptimizer::TriangleBuffer> _triangles;
+
+    //visible clusters are merged into as few draw ranges as possible
+    std::vector<char> _visibleClusters;
+    std::vector<GLsizei> _drawCounts;
+    std::vector<const GLvoid*> _drawOffsets;
 };
 
 class EdgeRenderer : public GeoObjectRenderer
@@ -37,6 +37,11 @@ void Renderer::setResourceManager(ResourceManager *manager)
         child->setResourceManager(manager);
 }
 
+const AbstractTransformable* Renderer::getCullObject() const
+{
+    return nullptr;
+}
+
 ResourceManager* Renderer::getResourceManager()
 {
     return _resourceManager;
@@ -43,6 +43,9 @@ public:
     virtual ShaderProgram* getProgram() = 0;
     void setResourceManager(ResourceManager *manager);
 
+    //object whose bounds decide whether this renderer can be culled
+    virtual const AbstractTransformable* getCullObject() const;
+
 protected:
     friend class ShaderRenderNode;
     ResourceManager* getResourceManager();
@@ -7,6 +7,7 @@
 #include "coordsystem_renderer.h"
 #include "empty_renderer.h"
 #include "skeleton_renderer.h"
+#include "pixel_plane.h"
 
 #include "render_setup.h"
 #include "rendertree.h"
@@ -19,7 +20,8 @@ using namespace MindTree;
 using namespace GL;
 
 RenderBlock::RenderBlock()
-    : _config(nullptr)
+    : _config(nullptr),
+    _resolutionScale(1)
 {
 
 }
@@ -164,6 +166,41 @@ RenderPass* RenderBlock::addPassBefore(const RenderPass *hint, const std::string
     return pass_ptr;
 }
 
+RenderPass* RenderBlock::addScaledPass(const std::string &name)
+{
+    auto pass = addPass(name);
+    _scaledPasses.push_back(pass);
+    pass->setResolutionScale(_resolutionScale);
+    return pass;
+}
+
+Texture2D* RenderBlock::addUpsamplePass(Texture2D *lowres, const std::string &name)
+{
+    auto pass = addPass(name);
+    auto output = make_resource<Texture2D>(_config->getTree()->getResourceManager(),
+                                           lowres->getName() + "_upsampled",
+                                           lowres->getFormat());
+    auto outputPtr = output.get();
+    pass->addOutput(std::move(output));
+    pass->setCustomTextureNameMapping(lowres->getName(), "lowres");
+    pass->setCustomFragmentNameMapping(outputPtr->getName(), "upsampled");
+    pass->addRenderer(new PixelPlane("../plugins/render/defaultShaders/bilateral_upsample.frag"));
+    if(auto camera = _camera.lock()) pass->setCamera(camera);
+    return outputPtr;
+}
+
+void RenderBlock::setResolutionScale(double scale)
+{
+    _resolutionScale = scale;
+    for(auto *pass : _scaledPasses)
+        pass->setResolutionScale(scale);
+}
+
+double RenderBlock::getResolutionScale() const
+{
+    return _resolutionScale;
+}
+
 GeometryRenderBlock::GeometryRenderBlock(RenderPass *geopass)
     : _geometryPass(geopass)
 {
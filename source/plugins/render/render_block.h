@@ -40,6 +40,14 @@ public:
     virtual void setGeometry(std::shared_ptr<Group> grp);
     RenderPass* addPass(const std::string &name="unnamed");
     RenderPass* addPassBefore(const RenderPass *hint, const std::string &name="unnamed");
+    //renders at the resolution scale of the block
+    RenderPass* addScaledPass(const std::string &name="unnamed");
+    //depth and normal aware upsampling of a scaled output to the camera
+    //resolution, returns the upsampled texture
+    Texture2D* addUpsamplePass(Texture2D *lowres, const std::string &name="upsample");
+
+    void setResolutionScale(double scale);
+    double getResolutionScale() const;
     void setEnabled(bool enable);
     std::vector<Texture2D*> getOutputs() const;
     void setProperty(std::string name, Property prop);
@@ -62,6 +70,8 @@ protected:
 private:
     friend class RenderConfigurator;
     std::vector<RenderPass*> _passes;
+    std::vector<RenderPass*> _scaledPasses;
+    double _resolutionScale;
     std::weak_ptr<Camera> _camera;
     std::vector<Texture2D*> _outputs;
 };
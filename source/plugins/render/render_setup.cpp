@@ -16,6 +16,7 @@
 #include "shader_render_node.h"
 #include "render_block.h"
 #include "data/benchmark.h"
+#include "scene_bvh.h"
 
 #include "render_setup.h"
 
@@ -32,6 +33,13 @@ RenderConfigurator::RenderConfigurator(CameraPtr camera) :
     _geometryPass = geometryPass.get();
     _rendertree->addPass(std::move(geometryPass));
     _geometryPass->setCamera(camera);
+    //picking reads back from the geometry pass
+    _geometryPass->setKeepOutputs(true);
+
+    //cpu and gpu times of every pass, visible in python through MT.benchmarks()
+    auto benchmark = std::make_shared<Benchmark>("Render");
+    _rendertree->setBenchmark(benchmark);
+    Benchmark::addRoot(benchmark);
 
     _grid = new GL::GridRenderer(100, 100, 100, 100);
     auto trans = glm::rotate(glm::mat4(),
@@ -72,6 +80,14 @@ glm::vec4 RenderConfigurator::getPosition(glm::vec2 pixel) const
     return glm::vec4(0);
 }
 
+std::future<std::vector<glm::vec4>>
+RenderConfigurator::requestPositions(const std::vector<glm::ivec2> &pixels) const
+{
+    std::promise<std::vector<glm::vec4>> positions;
+    positions.set_value(std::vector<glm::vec4>(pixels.size(), glm::vec4(0)));
+    return positions.get_future();
+}
+
 RenderTree* RenderConfigurator::getTree()
 {
 	return _rendertree.get();
@@ -91,6 +107,7 @@ void RenderConfigurator::setProperty(const std::string &name, Property prop)
     for(auto &block : _renderBlocks) {
         block->setProperty(name, prop);
     }
+    _rendertree->invalidate();
 }
 
 int RenderConfigurator::getPolygonCount() const
@@ -107,9 +124,11 @@ void RenderConfigurator::setGeometry(std::shared_ptr<Group> grp)
 {
     _vertexCount = grp->getVertexCount();
     _polyCount = grp->getPolygonCount();
+    _rendertree->getSceneBVH()->build(grp);
     for(auto &block : _renderBlocks) {
         block->setGeometry(grp);
     }
+    _rendertree->invalidate();
 
     if(!_rendertree->getBenchmark().expired())
         _rendertree->getBenchmark().lock()->reset();
@@ -3,6 +3,7 @@
 
 #include "memory"
 #include "vector"
+#include "future"
 
 #include "data/mtobject.h"
 #include "glwrapper.h"
@@ -42,6 +43,10 @@ public:
     virtual void setOverrideOutput(std::string output);
     virtual void clearOverrideOutput();
     virtual glm::vec4 getPosition(glm::vec2 pixel) const;
+    //world positions under the given pixels without stalling the caller,
+    //the future becomes ready after the next frames have been drawn
+    virtual std::future<std::vector<glm::vec4>>
+        requestPositions(const std::vector<glm::ivec2> &pixels) const;
 
     void addRenderBlock(std::unique_ptr<RenderBlock> &&block);
 
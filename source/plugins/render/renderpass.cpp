@@ -14,6 +14,12 @@ using namespace MindTree::GL;
 RenderPass::RenderPass(const std::string &name) :
     _initialized(false),
     _enabled(true),
+    _frustumCulling(true),
+    _occlusionCulling(false),
+    _damaged(true),
+    _keepOutputs(false),
+    _culled(false),
+    _sharedOutputs(false),
     _blendColorSource(GL_SRC_ALPHA),
     _blendAlphaSource(GL_ONE),
     _blendColorDest(GL_ONE_MINUS_SRC_ALPHA),
@@ -23,6 +29,9 @@ RenderPass::RenderPass(const std::string &name) :
     _bgColor(0),
     _depth(1),
     overrideProgramFlag_(false),
+    _currentWidth(0),
+    _currentHeight(0),
+    _resolutionScale(1),
     _tree(nullptr),
     _name(name)
 {
@@ -30,6 +39,55 @@ RenderPass::RenderPass(const std::string &name) :
 
 RenderPass::~RenderPass()
 {
+    //nobody renders the pass anymore, don't leave anyone waiting
+    for(auto &readback : _pixelReadbacks)
+        resolveEmpty(readback.requests);
+
+    std::lock_guard<std::mutex> lock(_pixelRequestsLock);
+    resolveEmpty(_pixelRequests);
+}
+
+void RenderPass::addPreRenderCallback(std::function<void(RenderPass*)> cb)
+{
+    _preRenderCallbacks.push_back(cb);
+}
+
+void RenderPass::setViewports(std::vector<Viewport> viewports)
+{
+    std::lock_guard<std::mutex> lock(_viewportsLock);
+    _viewports = viewports;
+    invalidate();
+}
+
+std::vector<RenderPass::Viewport> RenderPass::getViewports()
+{
+    std::lock_guard<std::mutex> lock(_viewportsLock);
+    return _viewports;
+}
+
+void RenderPass::setViewportCamera(size_t index, CameraPtr camera)
+{
+    std::lock_guard<std::mutex> lock(_viewportsLock);
+    if(index >= _viewports.size()) return;
+    _viewports[index].camera = camera;
+    _viewports[index].dirty = true;
+    invalidate();
+}
+
+void RenderPass::invalidateViewport(size_t index)
+{
+    std::lock_guard<std::mutex> lock(_viewportsLock);
+    if(index < _viewports.size())
+        _viewports[index].dirty = true;
+    invalidate();
+}
+
+void RenderPass::invalidateViewports()
+{
+    std::lock_guard<std::mutex> lock(_viewportsLock);
+    for(auto &viewport : _viewports)
+        viewport.dirty = true;
+    invalidate();
 }
 
 void RenderPass::addPostRenderCallback(std::function<void(RenderPass*)> cb)
@@ -45,6 +103,7 @@ void RenderPass::setBenchmark(std::shared_ptr<Benchmark> benchmark)
 void RenderPass::setEnabled(bool enable)
 {
     _enabled = enable;
+    invalidate();
 }
 
 bool RenderPass::isEnabled() const
@@ -52,11 +111,95 @@ bool RenderPass::isEnabled() const
     return _enabled;
 }
 
+void RenderPass::setFrustumCulling(bool enable)
+{
+    _frustumCulling = enable;
+}
+
+void RenderPass::invalidate()
+{
+    _damaged = true;
+    if(_tree) _tree->requestFrame();
+}
+
+bool RenderPass::isDamaged()
+{
+    if(_culled) return false;
+    if(_damaged || !_initialized) return true;
+
+    {
+        //cameras are mostly moved in place, so compare against what was
+        //rendered last
+        std::shared_lock<std::shared_timed_mutex> lock(_cameraLock);
+        if(_camera && _camera->getProjection() * _camera->getViewMatrix() != _renderedViewProjection)
+            return true;
+    }
+
+    std::lock_guard<std::mutex> lock(_viewportsLock);
+    return std::any_of(begin(_viewports), end(_viewports),
+                       [](const Viewport &viewport) { return viewport.dirty; });
+}
+
+bool RenderPass::hasPixelReadbacks() const
+{
+    return !_pixelReadbacks.empty();
+}
+
+void RenderPass::setOcclusionCulling(bool enable)
+{
+    _occlusionCulling = enable;
+    if(!enable) _hiZBuffer.clear();
+}
+
+const CullSet& RenderPass::cullObjects(CameraPtr camera)
+{
+    if(!_tree || !_frustumCulling || !camera) {
+        _cullSet.clear();
+        return _cullSet;
+    }
+
+    glm::mat4 viewProjection = camera->getProjection() * camera->getViewMatrix();
+
+    //the hiz buffer holds the depth of an earlier frame, objects that just
+    //got disoccluded may therefore show up a frame or two late
+    const HiZBuffer *hiz = nullptr;
+    if(_occlusionCulling) hiz = &_hiZBuffer;
+    _tree->getSceneBVH()->cull(Frustum(viewProjection), hiz, _cullSet);
+    return _cullSet;
+}
+
+void RenderPass::updateHiZBuffer(int width, int height)
+{
+    if(!_hiZReadback)
+        _hiZReadback = make_resource<PBO>(_tree->getResourceManager());
+
+    //depth is read back through a pbo and only used once its fence
+    //signalled, usually a frame later. No new read starts before that, so
+    //the pipeline never waits for it
+    if(_hiZReadback->isPending()) {
+        if(!_hiZReadback->isReady()) return;
+
+        std::vector<float> depth(_hiZSize.x * _hiZSize.y);
+        if(_hiZReadback->copyTo(&depth[0], depth.size() * sizeof(float)))
+            _hiZBuffer.build(depth, _hiZSize.x, _hiZSize.y, _hiZViewProjection);
+    }
+
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_cameraLock);
+        _hiZViewProjection = _camera->getProjection() * _camera->getViewMatrix();
+    }
+    _hiZSize = glm::ivec2(width, height);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    _hiZReadback->read(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, width * height * sizeof(float));
+}
+
 void RenderPass::setCamera(CameraPtr camera)
 {
     std::unique_lock<std::shared_timed_mutex> lock(_cameraLock);
 
     _camera = camera;
+    invalidate();
 }
 
 void RenderPass::setBlendFunc(GLenum src, GLenum dst)
@@ -66,6 +209,7 @@ void RenderPass::setBlendFunc(GLenum src, GLenum dst)
     _blendAlphaSource = src;
     _blendColorDest = dst;
     _blendAlphaDest = dst;
+    invalidate();
 }
 
 void RenderPass::setBlendFuncSeparate(GLenum srcColor, GLenum srcAlpha, GLenum dstColor, GLenum dstAlpha)
@@ -75,11 +219,13 @@ void RenderPass::setBlendFuncSeparate(GLenum srcColor, GLenum srcAlpha, GLenum d
     _blendAlphaSource = srcAlpha;
     _blendColorDest = dstColor;
     _blendAlphaDest = dstAlpha;
+    invalidate();
 }
 
 void RenderPass::setEnableBlending(bool value)
 {
     _blending = value;
+    invalidate();
 }
 
 void RenderPass::setOverrideProgram(ResourceHandle<ShaderProgram> &&program)
@@ -87,6 +233,7 @@ void RenderPass::setOverrideProgram(ResourceHandle<ShaderProgram> &&program)
     std::unique_lock<std::shared_timed_mutex> lock(_overrideProgramLock);
     _overrideProgram = std::move(program);
     overrideProgramFlag_ = true;
+    invalidate();
 }
 
 void RenderPass::setTree(RenderTree *tree)
@@ -94,17 +241,8 @@ void RenderPass::setTree(RenderTree *tree)
     _tree = tree;
 }
 
-void RenderPass::init()
+void RenderPass::initShaders()
 {
-    _initialized = true;
-
-	std::cout << "initialize renderpass: " << _name << std::endl;
-
-    {
-        std::shared_lock<std::shared_timed_mutex> lock(_cameraLock);
-        _currentWidth = getCamera()->getWidth();
-        _currentHeight = getCamera()->getHeight();
-    }
     //make sure shaderprograms are clean
     {
         std::shared_lock<std::shared_timed_mutex> shapeLock(_shapesLock);
@@ -119,6 +257,75 @@ void RenderPass::init()
             shadernode->init();
         }
     }
+}
+
+void RenderPass::setInputs(const std::vector<std::string> &names)
+{
+    {
+        std::lock_guard<std::mutex> lock(_inputsLock);
+        if(names == _inputs) return;
+        _inputs = names;
+    }
+    //the graph has to be scheduled again
+    if(_tree) _tree->setDirty();
+}
+
+bool RenderPass::reads(Texture2D *texture)
+{
+    std::string name = getTextureName(texture);
+    {
+        std::lock_guard<std::mutex> lock(_inputsLock);
+        if(std::find(begin(_inputs), end(_inputs), name) != end(_inputs))
+            return true;
+    }
+
+    {
+        //geometry programs are only set up once there is geometry, so
+        //assume they read everything
+        std::shared_lock<std::shared_timed_mutex> geoLock(_geometryLock);
+        if(!_geometryShaderNodes.empty()) return true;
+    }
+
+    std::shared_lock<std::shared_timed_mutex> shapeLock(_shapesLock);
+    for(auto &shadernode : _shadernodes) {
+        if(shadernode->program()->getUniformLocation(name) > -1)
+            return true;
+    }
+    return false;
+}
+
+void RenderPass::setKeepOutputs(bool keep)
+{
+    _keepOutputs = keep;
+}
+
+bool RenderPass::keepsOutputs()
+{
+    if(_keepOutputs || !_outputRenderbuffers.empty()) return true;
+
+    //viewports keep their content across frames
+    std::lock_guard<std::mutex> lock(_viewportsLock);
+    return !_viewports.empty();
+}
+
+bool RenderPass::isCulled() const
+{
+    return _culled;
+}
+
+void RenderPass::init()
+{
+    _initialized = true;
+
+    //all cached viewport content is lost with the new targets
+    invalidateViewports();
+
+	std::cout << "initialize renderpass: " << _name << std::endl;
+
+    glm::ivec2 resolution = getResolution();
+    _currentWidth = resolution.x;
+    _currentHeight = resolution.y;
+    initShaders();
 
     //if there are no outputs, were rendering to the default framebuffer
     //so no need to setup anything
@@ -204,6 +411,7 @@ void RenderPass::init()
 void RenderPass::setDirty()
 {
     _initialized = false;
+    invalidate();
 }
 
 void RenderPass::setCustomTextureNameMapping(std::string realname, std::string newname)
@@ -275,14 +483,21 @@ void RenderPass::setTextures(std::vector<Texture2D*> textures)
     }
 }
 
-std::vector<glm::vec4> RenderPass::readPixel(const std::vector<std::string> &names, glm::ivec2 pos)
+std::future<std::vector<glm::vec4>>
+RenderPass::readPixelsAsync(const std::vector<std::string> &names,
+                            const std::vector<glm::ivec2> &positions)
 {
-    std::unique_lock<std::mutex> lock(_pixelRequestsLock);
-    for(auto name : names)
-        _pixelRequests.push(std::make_pair(name, pos));
+    PixelRequest request;
+    request.names = names;
+    request.positions = positions;
+    auto future = request.result.get_future();
 
-    pixelRequestsCondition_.wait(lock);
-    return _requestedPixels;
+    {
+        std::lock_guard<std::mutex> lock(_pixelRequestsLock);
+        _pixelRequests.push_back(std::move(request));
+    }
+    if(_tree) _tree->requestFrame();
+    return future;
 }
 
 template<typename T>
@@ -388,84 +603,150 @@ std::vector<glm::vec4> RenderPass::readPixelSync(const std::vector<std::string>
 	return ret;
 }
 
-void RenderPass::processPixelRequests()
+namespace {
+    //every pixel is read as float rgba, gl converts normalized formats
+    const size_t PIXEL_SIZE = 4 * sizeof(GLfloat);
+
+    //readbacks older than this are waited for instead of polled
+    const int MAX_READBACK_AGE = 2;
+}
+
+bool RenderPass::bindReadBuffer(const std::string &name)
 {
-	std::unique_lock<std::mutex> locker(_pixelRequestsLock);
-	_requestedPixels.clear();
-	if (_pixelRequests.empty()) return;
-	while(_pixelRequests.size() > 0) {
-		auto request = _pixelRequests.front();
-		_pixelRequests.pop();
-		auto name = request.first;
-		auto pos = request.second;
+    if(!_target) {
+        GLint readFramebuffer = 0;
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+        glReadBuffer(readFramebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+        MTGLERROR;
+        return true;
+    }
 
-		//find attachment
-		if(_target) {
-            glReadBuffer(GL_COLOR_ATTACHMENT0 + _target->getAttachmentPos(name));
-            MTGLERROR;
-        }
-        else {
-            glReadBuffer(GL_BACK);
-            MTGLERROR;
-        }
+    size_t pos = _target->getAttachmentPos(name);
+    if(pos >= _outputTextures.size() + _outputRenderbuffers.size())
+        return false;
 
-        //find out whether name is a renderbuffer or a taxture
-        GLenum datasize = GL_UNSIGNED_BYTE;
-        GLenum format = GL_RGBA;
+    glReadBuffer(GL_COLOR_ATTACHMENT0 + pos);
+    MTGLERROR;
+    return true;
+}
 
-		auto getBuffer = [&name](const auto &buffer) {
-			return buffer->getName() == name;
-		};
+void RenderPass::processPixelRequests(int width, int height)
+{
+    finishPixelReadbacks();
 
-		auto tex = std::find_if(_outputTextures.begin(), _outputTextures.end(), getBuffer);
-		getFormatAndSize(*tex, &datasize, &format);
-		auto renderbuffer = std::find_if(_outputRenderbuffers.begin(), _outputRenderbuffers.end(), getBuffer);
-		getFormatAndSize(*renderbuffer, &datasize, &format);
-		
-        //and then find its datasize
-        void* data = nullptr;
+    std::vector<PixelRequest> requests;
+    {
+        std::lock_guard<std::mutex> lock(_pixelRequestsLock);
+        if(_pixelRequests.empty()) return;
+        requests.swap(_pixelRequests);
+    }
+    startPixelReadback(std::move(requests), width, height);
+}
 
-        if(format == GL_RGB)
-            data = new GLubyte[3];
-        else if(format == GL_RGBA && datasize == GL_UNSIGNED_BYTE)
-            data = new GLubyte[4];
-        else if(format == GL_RGBA && datasize == GL_FLOAT)
-            data = new GLfloat[4];
+void RenderPass::skipPixelRequests()
+{
+    //readbacks in flight still complete, there is just nothing new to read
+    finishPixelReadbacks();
 
-        glPixelStorei(GL_PACK_ALIGNMENT, 1);
-        MTGLERROR;
-        glReadPixels(pos.x, pos.y, 1, 1, format, datasize, data);
-        MTGLERROR;
+    std::vector<PixelRequest> requests;
+    {
+        std::lock_guard<std::mutex> lock(_pixelRequestsLock);
+        requests.swap(_pixelRequests);
+    }
+    resolveEmpty(requests);
+}
 
-        glm::vec4 color;
-        if(format == GL_RGB) {
-            GLubyte* raw_color = reinterpret_cast<GLubyte*>(data);
-            color = glm::vec4(raw_color[0] / 255.0,
-                              raw_color[1] / 255.0,
-                              raw_color[2] / 255.0,
-                              1);
-            delete [] raw_color;
+void RenderPass::resolveEmpty(std::vector<PixelRequest> &requests)
+{
+    for(auto &request : requests)
+        request.result.set_value(std::vector<glm::vec4>(request.names.size() * request.positions.size(),
+                                                        glm::vec4(0)));
+    requests.clear();
+}
+
+void RenderPass::startPixelReadback(std::vector<PixelRequest> &&requests, int width, int height)
+{
+    PixelReadback readback;
+    if(!_freeReadbackBuffers.empty()) {
+        readback.pbo = std::move(_freeReadbackBuffers.back());
+        _freeReadbackBuffers.pop_back();
+    }
+    else {
+        readback.pbo = make_resource<PBO>(_tree->getResourceManager());
+    }
+    readback.age = 0;
+
+    size_t pixelCount = 0;
+    for(const auto &request : requests)
+        pixelCount += request.names.size() * request.positions.size();
+    readback.pbo->allocate(std::max<size_t>(pixelCount, 1) * PIXEL_SIZE);
+
+    //read every name once for all requests, each pixel lands at its own
+    //offset so the whole batch is fetched with a single map later on
+    std::vector<std::string> names;
+    for(const auto &request : requests)
+        for(const auto &name : request.names)
+            if(std::find(begin(names), end(names), name) == end(names))
+                names.push_back(name);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    readback.pbo->bind();
+    for(const auto &name : names) {
+        if(!bindReadBuffer(name)) {
+            std::cout << "readPixel: " << _name << " has no output: " << name << std::endl;
+            readback.missing.push_back(name);
+            continue;
         }
-        else if(format == GL_RGBA && datasize == GL_UNSIGNED_BYTE) {
-            GLubyte* raw_color = reinterpret_cast<GLubyte*>(data);
-            color = glm::vec4(raw_color[0] / 255.0,
-                              raw_color[1] / 255.0,
-                              raw_color[2] / 255.0,
-                              raw_color[3] / 255.0);
-            delete [] raw_color;
+
+        size_t offset = 0;
+        for(const auto &request : requests) {
+            for(const auto &pos : request.positions) {
+                for(const auto &requestedName : request.names) {
+                    if(requestedName == name) {
+                        glm::ivec2 pixel = glm::clamp(pos, glm::ivec2(0), glm::ivec2(width - 1, height - 1));
+                        readback.pbo->readAt(pixel.x, pixel.y, 1, 1, GL_RGBA, GL_FLOAT, offset);
+                    }
+                    offset += PIXEL_SIZE;
+                }
+            }
         }
-        else if(format == GL_RGBA && datasize == GL_FLOAT) {
-            GLfloat* raw_color = reinterpret_cast<GLfloat*>(data);
-            color = glm::vec4(raw_color[0],
-                              raw_color[1],
-                              raw_color[2],
-                              raw_color[3]);
-            delete [] raw_color;
+    }
+    readback.pbo->release();
+    readback.pbo->fence();
+
+    readback.requests = std::move(requests);
+    _pixelReadbacks.push_back(std::move(readback));
+}
+
+void RenderPass::finishPixelReadbacks()
+{
+    for(auto &readback : _pixelReadbacks)
+        ++readback.age;
+
+    //readbacks complete in order, so stop at the first one still in flight
+    while(!_pixelReadbacks.empty()) {
+        PixelReadback &readback = _pixelReadbacks.front();
+        if(readback.age < MAX_READBACK_AGE && !readback.pbo->isReady())
+            break;
+
+        std::vector<glm::vec4> pixels(readback.pbo->getSize() / PIXEL_SIZE);
+        readback.pbo->copyTo(pixels.data(), pixels.size() * PIXEL_SIZE);
+
+        auto it = begin(pixels);
+        for(auto &request : readback.requests) {
+            auto count = request.names.size() * request.positions.size();
+            for(size_t i = 0; i < count; ++i) {
+                const auto &name = request.names[i % request.names.size()];
+                if(std::find(begin(readback.missing), end(readback.missing), name) != end(readback.missing))
+                    it[i] = glm::vec4(0);
+            }
+            request.result.set_value(std::vector<glm::vec4>(it, it + count));
+            it += count;
         }
 
-        _requestedPixels.push_back(color);
+        _freeReadbackBuffers.push_back(std::move(readback.pbo));
+        _pixelReadbacks.pop_front();
     }
-    pixelRequestsCondition_.notify_all();
 }
 
 void RenderPass::setTarget(ResourceHandle<FBO> &&target)
@@ -524,6 +805,7 @@ void RenderPass::addShaderNode(std::shared_ptr<ShaderRenderNode> node)
     std::unique_lock<std::shared_timed_mutex> lock(_shapesLock);
     node->setResourceManager(_tree->getResourceManager());
     _shadernodes.push_back(node);
+    invalidate();
 }
 
 void RenderPass::addGeometryShaderNodeNoLock(std::shared_ptr<ShaderRenderNode> node)
@@ -537,6 +819,7 @@ void RenderPass::addGeometryShaderNode(std::shared_ptr<ShaderRenderNode> node)
     std::unique_lock<std::shared_timed_mutex> lock(_geometryLock);
     node->setResourceManager(_tree->getResourceManager());
     _geometryShaderNodes.push_back(node);
+    invalidate();
 }
 
 std::pair<bool, std::shared_ptr<ShaderRenderNode>>
@@ -583,6 +866,7 @@ void RenderPass::addRenderer(Renderer *renderer)
         if(shaderNode.first) addShaderNodeNoLock(shaderNode.second);
         shaderNode.second->addRenderer(renderer);
     }
+    invalidate();
 }
 
 void RenderPass::addGeometryRenderer(Renderer *renderer)
@@ -600,6 +884,7 @@ void RenderPass::addGeometryRenderer(Renderer *renderer)
         if(shaderNode.first) addGeometryShaderNodeNoLock(shaderNode.second);
         shaderNode.second->addRenderer(renderer);
     }
+    invalidate();
 }
 
 void RenderPass::clearRenderers()
@@ -609,6 +894,7 @@ void RenderPass::clearRenderers()
     for (auto node : _geometryShaderNodes)
         node->clear();
 
+    invalidate();
 }
 
 void RenderPass::clearUnusedShaderNodes()
@@ -623,8 +909,11 @@ void RenderPass::clearUnusedShaderNodes()
     }
 
     //kill all the unused shaders!!
-    for (auto node : obsolete)
+    for (auto node : obsolete) {
         _geometryShaderNodes.erase(std::find(begin(_geometryShaderNodes), end(_geometryShaderNodes), node));
+        if(_benchmark && node->_benchmark) _benchmark->removeBenchmark(node->_benchmark);
+        node->_benchmark.reset();
+    }
 }
 
 std::vector<std::shared_ptr<ShaderRenderNode>> RenderPass::getShaderNodes()
@@ -638,33 +927,86 @@ CameraPtr RenderPass::getCamera()
     return _camera;
 }
 
+void RenderPass::setResolutionScale(double scale)
+{
+    scale = glm::clamp(scale, .01, 1.);
+    if(scale == _resolutionScale) return;
+    _resolutionScale = scale;
+    //aliasing of the outputs depends on their size
+    if(_tree) _tree->setDirty();
+    invalidate();
+}
+
+double RenderPass::getResolutionScale() const
+{
+    return _resolutionScale;
+}
+
+glm::ivec2 RenderPass::getResolution()
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_cameraLock);
+    if(!_camera) return glm::ivec2(0);
+    glm::ivec2 resolution(_camera->getWidth(), _camera->getHeight());
+    if(_resolutionScale == 1.) return resolution;
+    return glm::max(glm::ivec2(glm::vec2(resolution) * float(_resolutionScale.load()) + .5f),
+                    glm::ivec2(1));
+}
+
 void RenderPass::setBackgroundColor(glm::vec4 color)
 {
     std::lock_guard<std::mutex> lock(_bgColorLock);
     _bgColor = color;
+    invalidate();
 }
 
 void RenderPass::setClearDepth(float value)
 {
     _depth = value;
+    invalidate();
 }
 
-void RenderPass::render(const RenderConfig &config)
+bool RenderPass::render(const RenderConfig &config, bool force)
 {
-    int width{0};
-    int height{0};
-    {
-        std::shared_lock<std::shared_timed_mutex> lock(_cameraLock);
-        if(!_camera) return;
-        width = _camera->getWidth();
-        height = _camera->getHeight();
+    glm::ivec2 resolution = getResolution();
+    int width = resolution.x;
+    int height = resolution.y;
+
+    //timings of earlier frames
+    if(_benchmark) {
+        _gpuTimer.collect(_benchmark.get());
+        std::shared_lock<std::shared_timed_mutex> lock(_geometryLock);
+        for(const auto &node : _shadernodes)
+            node->_gpuTimer.collect(node->_benchmark.get());
+        for(const auto &node : _geometryShaderNodes)
+            node->_gpuTimer.collect(node->_benchmark.get());
     }
 
-    if(!width || !height) {
-        return;
+    if(!width || !height || _culled) {
+        skipPixelRequests();
+        return false;
+    }
+
+    for(auto cb : _preRenderCallbacks)
+        cb(this);
+
+    //passes without a target draw into the window framebuffer, which does
+    //not keep its content across swaps, aliased outputs are overwritten
+    //by other passes within the frame
+    if(!force && _target && !_sharedOutputs && _currentWidth == width
+       && _currentHeight == height && !isDamaged()) {
+        GLObjectBinder<FBO*> fbobinder(_target.get());
+        processPixelRequests(width, height);
+        return false;
+    }
+
+    _damaged = false;
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(_cameraLock);
+        _renderedViewProjection = _camera->getProjection() * _camera->getViewMatrix();
     }
 
     BenchmarkHandler bhandler(_benchmark);
+    GPUTimerHandler gpuHandler(_benchmark ? &_gpuTimer : nullptr);
 
     if(!_initialized || _currentHeight != height || _currentWidth != width) init();
 
@@ -719,7 +1061,11 @@ void RenderPass::render(const RenderConfig &config)
         }
         else {
             if(!_target) {
-                glDrawBuffer(GL_BACK);
+                //offscreen drivers bind their own framebuffer instead of
+                //the window system one
+                GLint drawFramebuffer = 0;
+                glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+                glDrawBuffer(drawFramebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
             }
             else {
                 glDrawBuffer(GL_NONE);
@@ -728,54 +1074,112 @@ void RenderPass::render(const RenderConfig &config)
 
         if(_shadernodes.empty() && _geometryShaderNodes.empty()) {
             std::cout << "RenderPass is empty" << std::endl;
-            return;
+            skipPixelRequests();
+            return false;
         }
 
-        glViewport(0, 0, (GLint)width, (GLint)height);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        if(_enabled) {
-            {
-                std::shared_lock<std::shared_timed_mutex> lock(_geometryLock);
-                std::shared_lock<std::shared_timed_mutex> shapeLock(_shapesLock);
-                //render nodes that do not have a corresponding objectdata element (grid, 3d widgets, etc.)
-                for(auto node : _shadernodes) {
-                    node->init();
-                    {
-                        GLObjectBinder<ShaderProgram*> binder(node->program());
-                        for(const auto &p : getProperties())
-                            node->program()->setUniformFromProperty(p.first, p.second);
+        bool hasViewports;
+        {
+            std::lock_guard<std::mutex> lock(_viewportsLock);
+            hasViewports = !_viewports.empty();
+        }
 
-                        for(const auto &p : config.getProperties())
-                            node->program()->setUniformFromProperty(p.first, p.second);
+        if(hasViewports) {
+            if(_enabled) renderViewports(config);
+        }
+        else {
+            glViewport(0, 0, (GLint)width, (GLint)height);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-                        {
-                            std::shared_lock<std::shared_timed_mutex> lock(_cameraLock);
-                            node->render(_camera, glm::ivec2(width, height), config);
-                        }
-                    }
+            if(_enabled) {
+                CameraPtr camera;
+                {
+                    std::shared_lock<std::shared_timed_mutex> lock(_cameraLock);
+                    camera = _camera;
                 }
+                const CullSet &culled = cullObjects(camera);
+                renderNodes(camera, glm::ivec2(width, height), config, culled, PropertyMap());
 
-                for(auto node : _geometryShaderNodes) {
-                    node->init();
-                    {
-                        GLObjectBinder<ShaderProgram*> binder(node->program());
-                        for(const auto &p : getProperties())
-                            node->program()->setUniformFromProperty(p.first, p.second);
-
-                        for(const auto &p : config.getProperties())
-                            node->program()->setUniformFromProperty(p.first, p.second);
-                        {
-                            std::shared_lock<std::shared_timed_mutex> lock(_cameraLock);
-                            node->render(_camera, glm::ivec2(width, height), config);
-                        }
-                    }
-                }
+                if(_occlusionCulling && _depthOutput == TEXTURE)
+                    updateHiZBuffer(width, height);
             }
+        }
+
+        if(_enabled) {
             for(auto cb : _postRenderCallbacks)
                 cb(this);
         }
-        processPixelRequests();
+        processPixelRequests(width, height);
+    }
+    return true;
+}
+
+void RenderPass::renderNodes(CameraPtr camera,
+                             glm::ivec2 resolution,
+                             const RenderConfig &config,
+                             const CullSet &culled,
+                             const PropertyMap &properties)
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_geometryLock);
+    std::shared_lock<std::shared_timed_mutex> shapeLock(_shapesLock);
+    //render nodes that do not have a corresponding objectdata element (grid, 3d widgets, etc.)
+    for(auto node : _shadernodes)
+        renderNode(node.get(), camera, resolution, config, culled, properties);
+
+    for(auto node : _geometryShaderNodes)
+        renderNode(node.get(), camera, resolution, config, culled, properties);
+}
+
+void RenderPass::renderNode(ShaderRenderNode *node,
+                            CameraPtr camera,
+                            glm::ivec2 resolution,
+                            const RenderConfig &config,
+                            const CullSet &culled,
+                            const PropertyMap &properties)
+{
+    node->init();
+
+    //every shader node gets its own row below the pass, named after its
+    //fragment shader
+    if(_benchmark && !node->_benchmark) {
+        std::string name = node->program()->getFileName(ShaderProgram::FRAGMENT);
+        name = name.substr(name.find_last_of('/') + 1);
+        node->_benchmark = std::make_shared<Benchmark>(name.empty() ? "shader" : name);
+        _benchmark->addBenchmark(node->_benchmark);
+    }
+
+    BenchmarkHandler bhandler(node->_benchmark);
+    GPUTimerHandler gpuHandler(node->_benchmark ? &node->_gpuTimer : nullptr);
+
+    GLObjectBinder<ShaderProgram*> binder(node->program());
+    for(const auto &p : getProperties())
+        node->program()->setUniformFromProperty(p.first, p.second);
+
+    for(const auto &p : properties)
+        node->program()->setUniformFromProperty(p.first, p.second);
+
+    for(const auto &p : config.getProperties())
+        node->program()->setUniformFromProperty(p.first, p.second);
+
+    node->render(camera, resolution, config, &culled);
+}
+
+void RenderPass::renderViewports(const RenderConfig &config)
+{
+    std::lock_guard<std::mutex> lock(_viewportsLock);
+    glEnable(GL_SCISSOR_TEST);
+    for(auto &viewport : _viewports) {
+        if(!viewport.dirty || !viewport.camera) continue;
+
+        const glm::ivec4 &rect = viewport.rect;
+        glViewport(rect.x, rect.y, rect.z, rect.w);
+        glScissor(rect.x, rect.y, rect.z, rect.w);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        MTGLERROR;
+
+        const CullSet &culled = cullObjects(viewport.camera);
+        renderNodes(viewport.camera, glm::ivec2(rect.z, rect.w), config, culled, viewport.properties);
+        viewport.dirty = false;
     }
-    glFinish();
+    glDisable(GL_SCISSOR_TEST);
 }
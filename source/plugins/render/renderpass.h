@@ -7,10 +7,14 @@
 #include "shared_mutex"
 #include "vector"
 #include "queue"
+#include "deque"
+#include "future"
 #include "utility"
 
 #include "glwrapper.h"
+#include "gpu_timer.h"
 #include "resource_handling.h"
+#include "scene_bvh.h"
 
 #include "../datatypes/Object/object.h"
 #include "../datatypes/Object/lights.h"
@@ -39,8 +43,24 @@ public:
     void setTarget(ResourceHandle<FBO> &&target);
     FBO* getTarget();
 
+    void addPreRenderCallback(std::function<void(RenderPass*)> cb);
     void addPostRenderCallback(std::function<void(RenderPass*)> cb);
 
+    //a region of the render target drawn with its own camera, viewports
+    //keep their content until they get invalidated
+    struct Viewport {
+        CameraPtr camera;
+        glm::ivec4 rect;
+        PropertyMap properties;
+        bool dirty = true;
+    };
+
+    void setViewports(std::vector<Viewport> viewports);
+    std::vector<Viewport> getViewports();
+    void setViewportCamera(size_t index, CameraPtr camera);
+    void invalidateViewport(size_t index);
+    void invalidateViewports();
+
     enum DepthOutput {
         TEXTURE,
         RENDERBUFFER,
@@ -67,9 +87,23 @@ public:
 
     CameraPtr getCamera();
 
-    std::vector<glm::vec4> readPixel(const std::vector<std::string> &name, glm::ivec2 pos);
+    //renders at a fraction of the camera resolution, the outputs have to be
+    //upsampled by a later pass
+    void setResolutionScale(double scale);
+    double getResolutionScale() const;
+    //size of the outputs, the camera resolution times the scale
+    glm::ivec2 getResolution();
+
 	std::vector<glm::vec4> readPixelSync(const std::vector<std::string> &names, glm::ivec2 pos);
 
+    //non blocking readback, all requests of a frame are batched into one pbo
+    //and the future becomes ready one or two frames later. The values are
+    //ordered by position, then by name, passes that skip rendering or get
+    //destroyed resolve pending requests with zeros
+    std::future<std::vector<glm::vec4>>
+        readPixelsAsync(const std::vector<std::string> &names,
+                        const std::vector<glm::ivec2> &positions);
+
     void setOverrideProgram(ResourceHandle<ShaderProgram> &&program);
 
     void addShaderNode(std::shared_ptr<ShaderRenderNode> node);
@@ -92,12 +126,54 @@ public:
     void setEnabled(bool enable);
     bool isEnabled() const;
 
+    //skip geometry outside of the pass camera frustum
+    void setFrustumCulling(bool enable);
+
+    //inputs are found through the sampler uniforms of the pass programs,
+    //textures bound under a different name have to be declared
+    void setInputs(const std::vector<std::string> &names);
+    bool reads(Texture2D *texture);
+
+    //the outputs are read outside of the tree (picking, readbacks), the
+    //pass is never culled and its outputs never alias other targets
+    void setKeepOutputs(bool keep);
+    bool keepsOutputs();
+    //culled passes have no consumer for their outputs and are skipped
+    bool isCulled() const;
+
+    //marks the pass for redraw, the passes after it follow along
+    void invalidate();
+    //whether the pass would draw something different than last frame,
+    //call from the render thread
+    bool isDamaged();
+    bool hasPixelReadbacks() const;
+    //additionally skip geometry hidden behind the depth of the previous frame,
+    //requires a depth texture output
+    void setOcclusionCulling(bool enable);
+
 private:
     void init();
-    void render(const RenderConfig &config);
+    void initShaders();
+    //returns whether the pass drew, unchanged passes with their own target
+    //keep last frames outputs unless force is set
+    bool render(const RenderConfig &config, bool force);
     void setDirty();
 
-    void processPixelRequests();
+    void processPixelRequests(int width, int height);
+    const CullSet& cullObjects(CameraPtr camera);
+    void renderNodes(CameraPtr camera,
+                     glm::ivec2 resolution,
+                     const RenderConfig &config,
+                     const CullSet &culled,
+                     const PropertyMap &properties);
+    void renderViewports(const RenderConfig &config);
+    void renderNode(ShaderRenderNode *node,
+                    CameraPtr camera,
+                    glm::ivec2 resolution,
+                    const RenderConfig &config,
+                    const CullSet &culled,
+                    const PropertyMap &properties);
+    void updateHiZBuffer(int width, int height);
     void addShaderNodeNoLock(std::shared_ptr<ShaderRenderNode> node);
     void addGeometryShaderNodeNoLock(std::shared_ptr<ShaderRenderNode> node);
     std::pair<bool, std::shared_ptr<ShaderRenderNode>>
@@ -106,15 +182,48 @@ private:
 
     std::string getTextureName(Texture2D *tex) const;
 
-    std::vector<glm::vec4> _requestedPixels;
-    std::queue<std::pair<std::string, glm::ivec2>> _pixelRequests;
-    std::condition_variable pixelRequestsCondition_;
+    struct PixelRequest {
+        std::vector<std::string> names;
+        std::vector<glm::ivec2> positions;
+        std::promise<std::vector<glm::vec4>> result;
+    };
+
+    struct PixelReadback {
+        ResourceHandle<PBO> pbo;
+        std::vector<PixelRequest> requests;
+        std::vector<std::string> missing;
+        int age;
+    };
+
+    bool bindReadBuffer(const std::string &name);
+    void startPixelReadback(std::vector<PixelRequest> &&requests, int width, int height);
+    void finishPixelReadbacks();
+    void skipPixelRequests();
+    static void resolveEmpty(std::vector<PixelRequest> &requests);
+
+    std::vector<PixelRequest> _pixelRequests;
     std::mutex _pixelRequestsLock;
+    std::deque<PixelReadback> _pixelReadbacks;
+    std::vector<ResourceHandle<PBO>> _freeReadbackBuffers;
 
     friend class RenderTree;
 
     std::atomic<bool> _initialized;
     std::atomic<bool> _enabled;
+    std::atomic<bool> _frustumCulling;
+    std::atomic<bool> _occlusionCulling;
+    std::atomic<bool> _damaged;
+    std::atomic<bool> _keepOutputs;
+    std::atomic<bool> _culled;
+    std::atomic<bool> _sharedOutputs;
+    std::vector<std::string> _inputs;
+    std::mutex _inputsLock;
+    glm::mat4 _renderedViewProjection;
+    HiZBuffer _hiZBuffer;
+    CullSet _cullSet;
+    ResourceHandle<PBO> _hiZReadback;
+    glm::mat4 _hiZViewProjection;
+    glm::ivec2 _hiZSize;
     std::shared_ptr<Camera> _camera;
     ResourceHandle<FBO> _target;
 
@@ -151,6 +260,7 @@ private:
     std::atomic_bool overrideProgramFlag_;
 
     int _currentWidth, _currentHeight;
+    std::atomic<double> _resolutionScale;
 
     mutable std::shared_timed_mutex _textureNameMappingLock;
     std::unordered_map<std::string, std::string> _textureNameMappings;
@@ -161,9 +271,14 @@ private:
     RenderTree *_tree;
 
     std::shared_ptr<Benchmark> _benchmark;
+    GPUTimer _gpuTimer;
 
+    std::vector<std::function<void(RenderPass*)>> _preRenderCallbacks;
     std::vector<std::function<void(RenderPass*)>> _postRenderCallbacks;
 
+    std::mutex _viewportsLock;
+    std::vector<Viewport> _viewports;
+
     std::string _name;
 };
 
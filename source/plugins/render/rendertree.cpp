@@ -6,6 +6,8 @@
 #include "renderpass.h"
 #include "shader_render_node.h"
 #include "data/benchmark.h"
+#include "scene_bvh.h"
+#include "texture_cache.h"
 
 #include "rendertree.h"
 
@@ -54,12 +56,19 @@ bool RenderConfig::flatShading() const
 
 RenderTree::RenderTree() :
     _resourceManager(std::make_unique<ResourceManager>()),
-    _initialized(false)
+    _sceneBVH(std::make_unique<SceneBVH>()),
+    _initialized(false),
+    _damaged(true),
+    _invalidated(true)
 {
+    //decoded images are uploaded with the next frame
+    _resourceManager->textureCache()->setReadyCallback([this] { requestFrame(); });
 }
 
 RenderTree::~RenderTree()
 {
+    //the cache outlives the members requestFrame uses
+    _resourceManager->textureCache()->setReadyCallback(nullptr);
 }
 
 void RenderTree::setBenchmark(std::shared_ptr<Benchmark> benchmark)
@@ -77,9 +86,51 @@ ResourceManager *RenderTree::getResourceManager()
     return _resourceManager.get();
 }
 
+SceneBVH *RenderTree::getSceneBVH()
+{
+    return _sceneBVH.get();
+}
+
 void RenderTree::setDirty()
 {
     _initialized = false;
+    invalidate();
+}
+
+void RenderTree::invalidate()
+{
+    _invalidated = true;
+    requestFrame();
+}
+
+void RenderTree::requestFrame()
+{
+    _damaged = true;
+
+    std::function<void()> cb;
+    {
+        std::lock_guard<std::mutex> lock(_damageCallbackLock);
+        cb = _damageCallback;
+    }
+    if(cb) cb();
+}
+
+bool RenderTree::isDamaged()
+{
+    if(_damaged) return true;
+
+    std::shared_lock<std::shared_timed_mutex> lock(_managerLock);
+    for(auto &pass : passes) {
+        if(pass->isDamaged() || pass->hasPixelReadbacks())
+            return true;
+    }
+    return false;
+}
+
+void RenderTree::setDamageCallback(std::function<void()> cb)
+{
+    std::lock_guard<std::mutex> lock(_damageCallbackLock);
+    _damageCallback = cb;
 }
 
 void RenderTree::init()
@@ -95,24 +146,120 @@ void RenderTree::init()
 
     glEnable(GL_CULL_FACE);
 
+    std::shared_lock<std::shared_timed_mutex> lock(_managerLock);
+
+    //programs have to be linked to find out what the passes read
+    for(auto &pass : passes)
+        pass->initShaders();
+
+    scheduleGraph();
+
     //connect output textures to all following passes
-    {
-        std::shared_lock<std::shared_timed_mutex> lock(_managerLock);
-        uint i=0;
-        for(auto &pass : passes){
-            pass->init();
-            if(i > 0) {
-                for (uint j = 0; j < i; ++j){
-                    auto *lastPass = passes[j].get();
-                    auto textures = lastPass->getOutputTextures();
-                    if(lastPass->_depthOutput == RenderPass::TEXTURE)
-                        textures.push_back(lastPass->_depthTexture.get());
-                    pass->setTextures(textures);
+    for(size_t i = 0; i < passes.size(); ++i) {
+        auto *pass = passes[i].get();
+        if(pass->isCulled()) continue;
+
+        pass->init();
+        for(size_t j = 0; j < i; ++j) {
+            auto *lastPass = passes[j].get();
+            if(lastPass->isCulled()) continue;
+            pass->setTextures(getOutputs(lastPass));
+        }
+    }
+}
 
+std::vector<Texture2D*> RenderTree::getOutputs(RenderPass *pass)
+{
+    auto textures = pass->getOutputTextures();
+    if(pass->_depthOutput == RenderPass::TEXTURE)
+        textures.push_back(pass->_depthTexture.get());
+    return textures;
+}
+
+void RenderTree::scheduleGraph()
+{
+    size_t count = passes.size();
+
+    //walk backwards from the passes drawing to the screen or read from
+    //outside and keep everything that feeds them
+    std::vector<bool> live(count, false);
+    std::vector<std::vector<size_t>> lastRead(count);
+    for(size_t i = count; i-- > 0;) {
+        auto *pass = passes[i].get();
+        auto outputs = getOutputs(pass);
+        //passes without outputs draw into the framebuffer bound by the caller
+        bool sink = outputs.empty() && pass->_outputRenderbuffers.empty();
+        live[i] = sink || pass->keepsOutputs();
+
+        lastRead[i].resize(outputs.size(), i);
+        for(size_t o = 0; o < outputs.size(); ++o) {
+            for(size_t j = count; j-- > i + 1;) {
+                if(live[j] && passes[j]->reads(outputs[o])) {
+                    lastRead[i][o] = j;
+                    live[i] = true;
+                    break;
                 }
             }
-            ++i;
         }
+        pass->_culled = !live[i];
+    }
+
+    //transient color targets whose lifetimes do not overlap share their
+    //storage, depth textures and kept outputs are left alone
+    struct Storage {
+        Texture2D *texture;
+        int width, height;
+        size_t lastRead;
+        bool shared;
+    };
+    std::vector<Storage> storages;
+    for(size_t i = 0; i < count; ++i) {
+        auto *pass = passes[i].get();
+        auto textures = pass->getOutputTextures();
+        for(auto *texture : textures) texture->shareStorage(nullptr);
+
+        if(!live[i]) continue;
+        if(pass->keepsOutputs() || !pass->getCamera()) continue;
+
+        glm::ivec2 resolution = pass->getResolution();
+        int width = resolution.x;
+        int height = resolution.y;
+        //storages freed before this pass, outputs of one pass never share
+        std::vector<size_t> available;
+        for(size_t s = 0; s < storages.size(); ++s)
+            if(storages[s].lastRead < i) available.push_back(s);
+
+        for(size_t o = 0; o < textures.size(); ++o) {
+            auto *texture = textures[o];
+            auto it = std::find_if(begin(available), end(available), [&](size_t s) {
+                return storages[s].width == width
+                    && storages[s].height == height
+                    && storages[s].texture->getFormat() == texture->getFormat();
+            });
+
+            if(it != end(available)) {
+                Storage &storage = storages[*it];
+                texture->shareStorage(storage.texture);
+                storage.lastRead = lastRead[i][o];
+                storage.shared = true;
+                available.erase(it);
+            }
+            else {
+                storages.push_back({texture, width, height, lastRead[i][o], false});
+            }
+        }
+    }
+
+    //owners and sharing passes overwrite each others outputs every frame
+    for(auto &pass : passes) {
+        bool shared = false;
+        for(auto *texture : pass->getOutputTextures()) {
+            shared = shared || texture->sharesStorage()
+                || std::any_of(begin(storages), end(storages), [texture](const Storage &s) {
+                    return s.texture == texture && s.shared;
+                });
+        }
+        pass->_sharedOutputs = shared;
     }
 }
 
@@ -133,8 +280,11 @@ std::vector<std::string> RenderTree::getAllOutputs() const
 
 void RenderTree::setConfig(RenderConfig cfg)
 {
-    std::lock_guard<std::shared_timed_mutex> lock(_managerLock);
-    config = cfg;
+    {
+        std::lock_guard<std::shared_timed_mutex> lock(_managerLock);
+        config = cfg;
+    }
+    invalidate();
 }
 
 RenderConfig RenderTree::getConfig()
@@ -147,7 +297,7 @@ void RenderTree::addPass(std::unique_ptr<RenderPass> &&pass)
 {
     std::lock_guard<std::shared_timed_mutex> lock(_managerLock);
     pass->setTree(this);
-    _initialized = false;
+    setDirty();
     passes.push_back(std::move(pass));
 }
 
@@ -155,7 +305,7 @@ void RenderTree::insertPassBefore(const RenderPass *ref_pass, std::unique_ptr<Re
 {
     std::lock_guard<std::shared_timed_mutex> lock(_managerLock);
     pass->setTree(this);
-    _initialized = false;
+    setDirty();
     auto it = std::find_if(begin(passes),
                            end(passes),
                            [&p=ref_pass] (const std::unique_ptr<RenderPass> &pass) { return pass.get() == p; });
@@ -166,7 +316,7 @@ void RenderTree::insertPassAfter(const RenderPass *ref_pass, std::unique_ptr<Ren
 {
     std::lock_guard<std::shared_timed_mutex> lock(_managerLock);
     pass->setTree(this);
-    _initialized = false;
+    setDirty();
     auto it = std::find_if(begin(passes),
                            end(passes),
                            [&p=ref_pass] (const std::unique_ptr<RenderPass> &pass) { return pass.get() == p; });
@@ -182,7 +332,7 @@ void RenderTree::removePass(RenderPass *pass)
                            [&p=pass] (const std::unique_ptr<RenderPass> &pass) { return pass.get() == p; });
     if(it != passes.end()) {
         passes.erase(it);
-        _initialized = false;
+        setDirty();
     }
     else {
         std::cout << "could not remove renderpass" << std::endl;
@@ -200,19 +350,31 @@ void RenderTree::draw()
     glEnable(GL_PROGRAM_POINT_SIZE);
     glEnable(GL_POLYGON_OFFSET_POINT);
 
+    if(_benchmark) _gpuTimer.collect(_benchmark.get());
     BenchmarkHandler handler(_benchmark);
+    GPUTimerHandler gpuHandler(_benchmark ? &_gpuTimer : nullptr);
 
     if(!_initialized) {
         init();
     }
+    //changes made while drawing schedule another frame
+    _damaged = false;
+    bool redraw = _invalidated.exchange(false);
+    redraw = _sceneBVH->refit() || redraw;
+    //finer texture levels arrive over several frames
+    redraw = _resourceManager->textureCache()->update() || redraw;
     {
         std::shared_lock<std::shared_timed_mutex> lock(_managerLock);
-        int i = 0;
+        //passes only read outputs of the passes before them, so everything
+        //after the first pass that redraws has to redraw as well
         for(auto &pass : passes){
-            pass->render(config);
+            if(pass->render(config, redraw))
+                redraw = true;
         }
         _resourceManager->cleanUp();
     }
+    if(_resourceManager->textureCache()->isUploading())
+        requestFrame();
 
     glDisable(GL_PROGRAM_POINT_SIZE);
     glDisable(GL_POLYGON_OFFSET_POINT);
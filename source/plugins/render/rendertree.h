@@ -9,16 +9,20 @@
 #include "atomic"
 #include "thread"
 #include "memory"
+#include "functional"
 #include "queue"
 #include "unordered_map"
 #include "../datatypes/Object/object.h"
+#include "gpu_timer.h"
 
 namespace MindTree {
 class Benchmark;
 namespace GL {
 
 class Texture;
+class Texture2D;
 class RenderPass;
+class SceneBVH;
 
 class RenderConfig : public Object
 {
@@ -62,22 +66,42 @@ public:
     RenderConfig getConfig();
     void setDirty();
 
+    //redraw every pass with the next frame
+    void invalidate();
+    //schedule a frame, only passes that changed and the passes after them
+    //are redrawn
+    void requestFrame();
+    //whether drawing now would change anything, call from the render thread
+    bool isDamaged();
+    //called whenever the tree needs a new frame, may be called from any thread
+    void setDamageCallback(std::function<void()> cb);
+
     ResourceManager *getResourceManager();
+    SceneBVH *getSceneBVH();
     void draw();
 
 private:
     void init();
+    //culls passes nobody reads from and aliases transient targets
+    void scheduleGraph();
+    std::vector<Texture2D*> getOutputs(RenderPass *pass);
 
     std::shared_timed_mutex _managerLock;
 
     glm::vec4 backgroundColor;
     std::unique_ptr<ResourceManager> _resourceManager;
+    std::unique_ptr<SceneBVH> _sceneBVH;
     std::vector<std::unique_ptr<RenderPass>> passes;
     RenderConfig config;
     std::atomic_bool _initialized;
+    std::atomic_bool _damaged;
+    std::atomic_bool _invalidated;
+    std::mutex _damageCallbackLock;
+    std::function<void()> _damageCallback;
     double renderTime;
 
     std::shared_ptr<Benchmark> _benchmark;
+    GPUTimer _gpuTimer;
 };
 
 }
@@ -1,9 +1,34 @@
+#include "algorithm"
+#include "functional"
+#include "map"
+#include "mutex"
 #include "data/debuglog.h"
+#include "data/thread_pool.h"
+#include "texture_cache.h"
 #include "resource_handling.h"
 
 using namespace MindTree;
 using namespace MindTree::GL;
 
+namespace {
+    //the triangles of a mesh depend on its polygons, positions, levels of
+    //detail and clusters. Positions and polygons are only watched, so
+    //entries of meshes that are gone can be dropped
+    //positions only influence the overdraw order, which stays good enough
+    //while a mesh deforms. Meshes that share their polygons with an
+    //earlier one reuse its triangles, whatever their positions are
+    struct TopologyEntry {
+        std::weak_ptr<PolygonList> polygons;
+        size_t vertexCount;
+        std::shared_ptr<const std::vector<MeshData::LOD>> lods;
+        std::shared_ptr<const MeshData::Clusters> clusters;
+        std::shared_future<std::shared_ptr<const IndexOptimizer::TriangleBuffer>> triangles;
+    };
+
+    std::mutex topologyLock;
+    std::map<const void*, std::vector<TopologyEntry>> topologies;
+}
+
 AbstractResource::AbstractResource(std::string name)
     : _name(name)
 {
@@ -33,15 +58,28 @@ const std::string Resource<VBO>::s_resource_name("VBO");
 template<>
 const std::string Resource<IBO>::s_resource_name("IBO");
 
+template<>
+const std::string Resource<InterleavedVBO>::s_resource_name("InterleavedVBO");
+
 template<>
 const std::string Resource<VAO>::s_resource_name("VAO");
 
 template<>
 const std::string Resource<Renderbuffer>::s_resource_name("Renderbuffer");
 
+template<>
+const std::string Resource<SSBO>::s_resource_name("SSBO");
+
+template<>
+const std::string Resource<PBO>::s_resource_name("PBO");
+
+template<>
+const std::string Resource<UploadPBO>::s_resource_name("UploadPBO");
+
 ResourceManager::ResourceManager() :
     shaderManager_(std::make_unique<ShaderManager>(this)),
-    geometryCache_(std::make_unique<GeometryCache>(this))
+    geometryCache_(std::make_unique<GeometryCache>(this)),
+    textureCache_(std::make_unique<TextureCache>(this))
 {
 }
 
@@ -72,45 +110,83 @@ int GeometryCache::getIndexForAttribute(std::string name)
     return index;
 }
 
-VBO* GeometryCache::createVBO(ObjectData *data, std::string name)
+const GeometryCache::VertexBuffer& GeometryCache::uploadVertices(ObjectData *data)
 {
-    auto &vbos = _vboMap[data];
-    auto vbo = make_resource<VBO>(manager_, name);
-    vbo->overrideIndex(getIndexForAttribute(name));
-    auto *ret = vbo.get();
-    vbos.push_back(std::move(vbo));
-    return ret;
+    auto &buffer = _vertexBuffers[data];
+    if(!buffer.vbo) buffer.vbo = make_resource<InterleavedVBO>(manager_);
+
+    //every vertex list with one entry per position is a vertex attribute
+    std::vector<VertexListPtr> lists;
+    std::vector<const VertexList*> streams;
+    buffer.layout = VertexLayout();
+    auto positions = data->getProperty("P").getData<VertexListPtr>();
+    if(positions) {
+        for(const auto &prop : data->getProperties()) {
+            auto list = prop.second.getData<VertexListPtr>();
+            if(!list || list->size() != positions->size()) continue;
+            buffer.layout.addAttribute(prop.first);
+            streams.push_back(list.get());
+            lists.push_back(list);
+        }
+    }
+
+    //vertices follow the order of the optimized triangles
+    std::shared_ptr<const IndexOptimizer::TriangleBuffer> triangles;
+    if(data->getType() == ObjectData::MESH && data->hasProperty("polygon"))
+        triangles = getTriangles(static_cast<MeshData*>(data));
+    const std::vector<uint> *remap = nullptr;
+    if(positions && triangles && triangles->vertexRemap.size() == positions->size())
+        remap = &triangles->vertexRemap;
+
+    buffer.vbo->bind();
+    buffer.vbo->data(buffer.layout.pack(streams, remap));
+    return buffer;
 }
 
-VBO* GeometryCache::getVBO(ObjectData *data, std::string name)
+GeometryCache::TriangleFuture GeometryCache::requestTriangles(MeshData *data)
 {
-    auto &vbos = _vboMap[data];
-    dbout(_vboMap.size());
-    for(auto &vbo : vbos)
-        if(vbo->getName() == name)
-            return vbo.get();
-
-    auto vbo = createVBO(data, name);
-    return vbo;
+    auto polygons = data->getProperty("polygon").getData<PolygonListPtr>();
+    auto vertices = data->getProperty("P").getData<VertexListPtr>();
+    auto lods = data->getLODs();
+    auto clusters = data->getClusters();
+
+    std::lock_guard<std::mutex> lock(topologyLock);
+    for(auto it = begin(topologies); it != end(topologies);) {
+        auto &entries = it->second;
+        entries.erase(std::remove_if(begin(entries), end(entries), [](const TopologyEntry &entry) {
+                          return entry.polygons.expired();
+                      }),
+                      end(entries));
+        if(entries.empty()) it = topologies.erase(it);
+        else ++it;
+    }
+
+    size_t vertexCount = vertices ? vertices->size() : 0;
+    auto &entries = topologies[polygons.get()];
+    for(const auto &entry : entries)
+        if(entry.vertexCount == vertexCount && entry.lods == lods && entry.clusters == clusters)
+            return entry.triangles;
+
+    //the mesh itself may be gone by the time the job runs
+    auto task = std::make_shared<std::packaged_task<std::shared_ptr<const IndexOptimizer::TriangleBuffer>()>>([=] {
+        return IndexOptimizer::build(vertices, polygons, lods, clusters);
+    });
+    TriangleFuture triangles = task->get_future().share();
+    entries.push_back({polygons, vertexCount, lods, clusters, triangles});
+    ThreadPool::enqueue([task] { (*task)(); });
+    return triangles;
 }
 
-void GeometryCache::uploadData(ObjectData *data, std::string name)
+void GeometryCache::prepareTriangles(MeshData *data)
 {
-    auto &vbos = _vboMap[data];
-
-    VBO *data_vbo{nullptr};
-    for(auto &vbo : vbos) {
-        if(vbo->getName() == name) {
-	        data_vbo = vbo.get();
-        }
-    }
-    if (!data_vbo) {
-		data_vbo = createVBO(data, name);
-    }
+    if(!data->hasProperty("P") || !data->hasProperty("polygon")) return;
+    requestTriangles(data);
+}
 
-    data_vbo->bind();
-    data_vbo->data(data->getProperty(name).getData<std::shared_ptr<VertexList>>());
-    data_vbo->setPointer();
+std::shared_ptr<const IndexOptimizer::TriangleBuffer> GeometryCache::getTriangles(MeshData *data)
+{
+    if(!data->hasProperty("P") || !data->hasProperty("polygon")) return nullptr;
+    return requestTriangles(data).get();
 }
 
 IBO* GeometryCache::createIBO(ObjectData *data)
@@ -1,7 +1,10 @@
 #ifndef MT_GL_RESOURCE_HANDLING_H
 #define MT_GL_RESOURCE_HANDLING_H
 
+#include "future"
 #include "glwrapper.h"
+#include "index_optimizer.h"
+#include "vertex_layout.h"
 
 namespace MindTree {
 namespace GL {
@@ -32,6 +35,7 @@ private:
 
 class ShaderManager;
 class GeometryCache;
+class TextureCache;
 
 class ResourceManager
 {
@@ -40,6 +44,7 @@ public:
     virtual ~ResourceManager();
 
     GeometryCache* geometryCache() { return geometryCache_.get(); }
+    TextureCache* textureCache() { return textureCache_.get(); }
 
     template<class T>
     void scheduleCleanUp(T* resource)
@@ -60,6 +65,7 @@ private:
     std::unique_ptr<ShaderManager> shaderManager_;
     std::vector<std::unique_ptr<AbstractResource>> _scheduledResource;
     std::unique_ptr<GeometryCache> geometryCache_;
+    std::unique_ptr<TextureCache> textureCache_;
 };
 
 template<typename T>
@@ -92,21 +98,36 @@ class GeometryCache
 public:
     GeometryCache(ResourceManager *manager);
 
-    VBO* createVBO(ObjectData *data, std::string name);
     IBO* createIBO(ObjectData *data);
-    VBO* getVBO(ObjectData *data, std::string name);
     IBO* getIBO(ObjectData *data);
 
     void clean(ObjectData*);
 
-    void uploadData(ObjectData *data, std::string name);
+    struct VertexBuffer {
+        ResourceHandle<InterleavedVBO> vbo;
+        VertexLayout layout;
+    };
+
+    //uploads every per vertex attribute of data into one interleaved
+    //buffer and leaves it bound
+    const VertexBuffer& uploadVertices(ObjectData *data);
     int getIndexForAttribute(std::string name);
 
+    //optimized triangles are built once per topology on background threads
+    //and shared by every renderer and context. Meshes that are prepared
+    //together are optimized in parallel
+    static void prepareTriangles(MeshData *data);
+    //waits for the triangles, nullptr for meshes without polygons
+    static std::shared_ptr<const IndexOptimizer::TriangleBuffer> getTriangles(MeshData *data);
+
 private:
-    std::unordered_map<ObjectData*, std::vector<ResourceHandle<VBO>>> _vboMap;
+    std::unordered_map<ObjectData*, VertexBuffer> _vertexBuffers;
     std::unordered_map<ObjectData*, ResourceHandle<IBO>> _iboMap;
     std::unordered_map<std::string, int> _attributeIndexMap;
     ResourceManager *manager_;
+
+    typedef std::shared_future<std::shared_ptr<const IndexOptimizer::TriangleBuffer>> TriangleFuture;
+    static TriangleFuture requestTriangles(MeshData *data);
 };
 
 template<typename T>
@@ -141,9 +162,9 @@ struct ShaderProvider {
 
         if(vert != "")prog->addShaderFromFile(vert, ShaderProgram::VERTEX);
         if(frag != "")prog->addShaderFromFile(frag, ShaderProgram::FRAGMENT);
-        if(geo != "")prog->addShaderFromFile(vert, ShaderProgram::GEOMETRY);
-        if(tessc != "")prog->addShaderFromFile(frag, ShaderProgram::TESSELATION_CONTROL);
-        if(tesse != "")prog->addShaderFromFile(frag, ShaderProgram::TESSELATION_EVALUATION);
+        if(geo != "")prog->addShaderFromFile(geo, ShaderProgram::GEOMETRY);
+        if(tessc != "")prog->addShaderFromFile(tessc, ShaderProgram::TESSELATION_CONTROL);
+        if(tesse != "")prog->addShaderFromFile(tesse, ShaderProgram::TESSELATION_EVALUATION);
         return prog;
     }
 };
@@ -1,9 +1,10 @@
-#include "random"
+#include "cmath"
 #define GLM_ENABLE_EXPERIMENTAL
 #include "glm/gtx/string_cast.hpp"
 #include "render_setup.h"
 #include "rendertree.h"
 #include "data/benchmark.h"
+#include "sample_sets.h"
 #include "rsm_computation_plane.h"
 
 using namespace MindTree;
@@ -12,7 +13,8 @@ using namespace GL;
 RSMIndirectPlane::RSMIndirectPlane() :
     _intensity(1.f),
     _searchRadius(.5f),
-    _numSamples(400),
+    _numSamples(64),
+    _frame(0),
     _samplesChanged(false)
 {
     setFragmentShader("../plugins/render/defaultShaders/rsm_indirect_lighting.frag");
@@ -22,6 +24,15 @@ void RSMIndirectPlane::init(ShaderProgram* program)
 {
     PixelPlane::init(program);
     initSamplingTexture();
+
+    _blueNoise = make_resource<Texture2D>(getResourceManager(),
+                                          "blueNoise",
+                                          Texture::RG32F);
+    _blueNoise->setFilter(Texture::NEAREST);
+    _blueNoise->setWrapMode(Texture::REPEAT);
+    _blueNoise->setWidth(SampleSets::BLUE_NOISE_SIZE);
+    _blueNoise->setHeight(SampleSets::BLUE_NOISE_SIZE);
+    _blueNoise->init(SampleSets::blueNoise());
 }
 
 void RSMIndirectPlane::initSamplingTexture()
@@ -30,14 +41,8 @@ void RSMIndirectPlane::initSamplingTexture()
                                               "samplingPattern",
                                               Texture::RG32F);
 
-    size_t dataSize = _numSamples.load();
-    std::vector<glm::vec2> samples;
-    std::mt19937 engine;
-    std::uniform_real_distribution<float> uniform_distribution;
-    for(int i = 0; i< dataSize; ++i) {
-        samples.emplace_back(uniform_distribution(engine),
-                             uniform_distribution(engine));
-    }
+    //polar coordinates, the shader shifts them per pixel and frame
+    std::vector<glm::vec2> samples = SampleSets::sobol(_numSamples.load());
 
     _samplingPattern->setWidth(_numSamples.load());
     _samplingPattern->init(samples);
@@ -53,7 +58,9 @@ void RSMIndirectPlane::drawLight(const LightPtr &light, ShaderProgram* program)
         initSamplingTexture();
 
     program->setTexture(_samplingPattern.get());
+    program->setTexture(_blueNoise.get());
     UniformStateManager manager(program);
+    manager.addState("frameOffset", SampleSets::frameOffset(_frame++));
 
     manager.addState("searchradius", _searchRadius.load());
     manager.addState("intensity", _intensity.load());
@@ -83,45 +90,44 @@ void RSMIndirectPlane::setSamples(int samples)
 
 RSMGenerationBlock::RSMGenerationBlock()
 {
+    //the flux and normals are only sampled sparsely
+    _lodBias = 2;
+
     auto shadowBench = std::make_shared<Benchmark>("RSM Generation");
     setBenchmark(shadowBench);
 }
 
-RenderPass* RSMGenerationBlock::createShadowPass(SpotLightPtr spot)
+void RSMGenerationBlock::init()
 {
-    auto shadowPass = ShadowMappingRenderBlock::createShadowPass(spot);
-
-    if(!shadowPass)
-        return nullptr;
+    ShadowMappingRenderBlock::init();
 
     if(_benchmark) {
         std::string name = _benchmark->getName();
-        std::string spot_name = spot->getName();
-        auto bench = std::make_shared<Benchmark>(name + "_" + spot_name);
+        auto bench = std::make_shared<Benchmark>(name + "_atlas");
         _benchmark->addBenchmark(bench);
-        shadowPass->setBenchmark(bench);
+        _atlasPass->setBenchmark(bench);
     }
 
+    //flux, normal and position are rendered into the same atlas layout as
+    //the depth
     auto pos = make_resource<Texture2D>(_config->getTree()->getResourceManager(),
                                         "shadow_position",
                                         Texture::RGBA16F);
     pos->setFilter(Texture::NEAREST);
     pos->setWrapMode(Texture::REPEAT);
-    shadowPass->addOutput(std::move(pos));
+    _atlasPass->addOutput(std::move(pos));
     auto normal = make_resource<Texture2D>(_config->getTree()->getResourceManager(),
                                            "shadow_normal",
                                            Texture::RGBA16F);
     normal->setFilter(Texture::NEAREST);
     normal->setWrapMode(Texture::REPEAT);
-    shadowPass->addOutput(std::move(normal));
+    _atlasPass->addOutput(std::move(normal));
     auto flux = make_resource<Texture2D>(_config->getTree()->getResourceManager(),
                                          "shadow_flux",
                                          Texture::RGBA16F);
     flux->setFilter(Texture::NEAREST);
     flux->setWrapMode(Texture::REPEAT);
-    shadowPass->addOutput(std::move(flux));
-
-    return shadowPass;
+    _atlasPass->addOutput(std::move(flux));
 }
 
 RSMEvaluationBlock::RSMEvaluationBlock(RSMGenerationBlock *shadowBlock) :
@@ -130,6 +136,7 @@ RSMEvaluationBlock::RSMEvaluationBlock(RSMGenerationBlock *shadowBlock) :
     _rsmIndirectPass(nullptr),
     _rsmIndirectLowResPass(nullptr),
     _rsmInterpolatePass(nullptr),
+    _accumulationPlane(nullptr),
     _downSampling(2),
     _shadowBlock(shadowBlock)
 {
@@ -148,7 +155,8 @@ void RSMEvaluationBlock::init()
     };
     //_config->addSettings("RSM Evaluation", settings);
 
-    auto rsmIndirectLowResPass = addPass("rsm_lowres");
+    setResolutionScale(std::pow(.5, _downSampling.load()));
+    auto rsmIndirectLowResPass = addScaledPass("rsm_lowres");
     _rsmIndirectLowResPass = rsmIndirectLowResPass;
     rsmIndirectLowResPass->addOutput(make_resource<Texture2D>(_config->getTree()->getResourceManager(),
                                                               "rsm_indirect_out_lowres",
@@ -193,20 +201,27 @@ void RSMEvaluationBlock::init()
     auto rsmFinalPlane = new PixelPlane("../plugins/render/defaultShaders/rsm_final.frag");
     rsmFinalPass->addRenderer(rsmFinalPlane);
 
-    setBenchmark(std::make_shared<Benchmark>("RSM Evaluation"));
-    addOutput(rsmFinalPass->getOutputTextures()[0]);
-}
+    //the few samples per frame are averaged over time, static images keep
+    //being refined until the history is full
+    auto rsmAccumulatePass = addPass("rsm_accumulate");
+    rsmAccumulatePass->addOutput(make_resource<Texture2D>(_config->getTree()->getResourceManager(),
+                                                          "rsm_indirect_accumulated",
+                                                          Texture::RGBA16F));
+    rsmAccumulatePass->addOutput(make_resource<Texture2D>(_config->getTree()->getResourceManager(),
+                                                          "rsm_indirect_history",
+                                                          Texture::RGBA16F));
+    rsmAccumulatePass->setCustomTextureNameMapping("rsm_indirect_out", "current");
+    rsmAccumulatePass->setCustomFragmentNameMapping("rsm_indirect_accumulated", "accumulated");
+    rsmAccumulatePass->setCustomFragmentNameMapping("rsm_indirect_history", "accumulated_history");
+    _accumulationPlane = new TemporalAccumulationPlane();
+    rsmAccumulatePass->addRenderer(_accumulationPlane);
+    rsmAccumulatePass->addPostRenderCallback([this](RenderPass*) {
+        if(!_accumulationPlane->isConverged())
+            _rsmIndirectLowResPass->invalidate();
+    });
 
-void RSMEvaluationBlock::setCamera(std::shared_ptr<Camera> cam)
-{
-    RenderBlock::setCamera(cam);
-    _rsmIndirectPass->setCamera(cam);
-    auto lowrescam = std::dynamic_pointer_cast<Camera>(cam->clone());
-    int downres = pow(2, _downSampling.load());
-    int w = cam->getWidth() / downres;
-    int h = cam->getHeight() / downres;
-    lowrescam->setResolution(w, h);
-    _rsmIndirectLowResPass->setCamera(lowrescam);
+    setBenchmark(std::make_shared<Benchmark>("RSM Evaluation"));
+    addOutput(rsmAccumulatePass->getOutputTextures()[0]);
 }
 
 void RSMEvaluationBlock::setGeometry(std::shared_ptr<Group> grp)
@@ -224,9 +239,9 @@ void RSMEvaluationBlock::setGeometry(std::shared_ptr<Group> grp)
         _rsmIndirectHighResPlane->setLights(grp->getLights());
         _rsmIndirectLowResPlane->setLights(grp->getLights());
     }
-    auto shadowPasses = _shadowBlock->getShadowPasses();
-    _rsmIndirectHighResPlane->setShadowPasses(shadowPasses);
-    _rsmIndirectLowResPlane->setShadowPasses(shadowPasses);
+    _rsmIndirectHighResPlane->setShadowBlock(_shadowBlock);
+    _rsmIndirectLowResPlane->setShadowBlock(_shadowBlock);
+    _accumulationPlane->reset();
 
     if (grp->hasProperty("RSM:searchRadius")) {
         _rsmIndirectHighResPlane->setSearchRadius(grp->getProperty("RSM:searchRadius").getData<double>());
@@ -243,7 +258,7 @@ void RSMEvaluationBlock::setGeometry(std::shared_ptr<Group> grp)
     if (grp->hasProperty("RSM:downsampling")) {
         _downSampling = grp->getProperty("RSM:downsampling").getData<int>();
         _rsmInterpolatePass->setProperty("downsampling", _downSampling.load());
-        setCamera(getCamera().lock());
+        setResolutionScale(std::pow(.5, _downSampling.load()));
     }
     if (grp->hasProperty("RSM:lowresdistance")) {
         auto prop = grp->getProperty("RSM:lowresdistance");
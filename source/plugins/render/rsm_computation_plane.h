@@ -3,6 +3,7 @@
 
 #include "light_accumulation_plane.h"
 #include "shadow_mapping.h"
+#include "temporal_accumulation.h"
 
 namespace MindTree {
 namespace GL {
@@ -24,6 +25,9 @@ private:
     void initSamplingTexture();
 
     ResourceHandle<Texture> _samplingPattern;
+    //rotates the sampling pattern per pixel and frame
+    ResourceHandle<Texture2D> _blueNoise;
+    unsigned _frame;
     std::atomic<double> _searchRadius;
     std::atomic<double> _intensity;
     std::atomic<int> _numSamples;
@@ -35,11 +39,7 @@ class RSMGenerationBlock : public ShadowMappingRenderBlock
 {
 public:
     RSMGenerationBlock();
-
-protected:
-    virtual RenderPass* createShadowPass(std::shared_ptr<SpotLight> spot);
-
-private:
+    void init() override;
 };
 
 class RSMEvaluationBlock : public RenderBlock
@@ -48,8 +48,6 @@ public:
     RSMEvaluationBlock(RSMGenerationBlock *shadowBlock);
     void init();
 
-    void setCamera(std::shared_ptr<Camera> cam);
-
     void setGeometry(std::shared_ptr<Group> grp);
 
 private:
@@ -59,6 +57,7 @@ private:
     RenderPass *_rsmIndirectPass;
     RenderPass *_rsmIndirectLowResPass;
     RenderPass *_rsmInterpolatePass;
+    TemporalAccumulationPlane *_accumulationPlane;
 
     std::atomic<int> _downSampling;
 
@@ -0,0 +1,173 @@
+#include "algorithm"
+#include "cmath"
+#include "cstdint"
+#include "random"
+
+#include "sample_sets.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+namespace {
+    float radicalInverse(size_t index, unsigned base)
+    {
+        float inverseBase = 1.f / base;
+        float factor = inverseBase;
+        float result = 0;
+        while(index) {
+            result += (index % base) * factor;
+            index /= base;
+            factor *= inverseBase;
+        }
+        return result;
+    }
+
+    float toUnitFloat(uint32_t value)
+    {
+        //keep it below 1 after the conversion to float
+        return std::min(value * (1.f / 4294967296.f), 0.99999994f);
+    }
+
+    //ranks every pixel of a toroidal size x size grid with void and
+    //cluster, the result is uniformly distributed in [0, 1)
+    std::vector<float> voidAndCluster(int size, unsigned seed)
+    {
+        const int count = size * size;
+        const float sigma = 1.5;
+
+        //energy contribution of a point, indexed by wrapped offset
+        std::vector<float> kernel(count);
+        for(int y = 0; y < size; ++y) {
+            for(int x = 0; x < size; ++x) {
+                int dx = std::min(x, size - x);
+                int dy = std::min(y, size - y);
+                kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+            }
+        }
+
+        auto splat = [&](std::vector<float> &energy, int index, float sign) {
+            int px = index % size, py = index / size;
+            for(int y = 0; y < size; ++y) {
+                int ky = ((y - py + size) % size) * size;
+                for(int x = 0; x < size; ++x)
+                    energy[y * size + x] += sign * kernel[ky + (x - px + size) % size];
+            }
+        };
+
+        //tightest cluster among set pixels, largest void among the others
+        auto find = [&](const std::vector<float> &energy, const std::vector<bool> &pattern, bool set) {
+            int best = -1;
+            for(int i = 0; i < count; ++i) {
+                if(pattern[i] != set) continue;
+                if(best < 0
+                   || (set && energy[i] > energy[best])
+                   || (!set && energy[i] < energy[best]))
+                    best = i;
+            }
+            return best;
+        };
+
+        std::vector<bool> pattern(count, false);
+        std::vector<float> energy(count, 0);
+        std::mt19937 engine(seed);
+        std::uniform_int_distribution<int> position(0, count - 1);
+        int initialCount = count / 10;
+        for(int placed = 0; placed < initialCount;) {
+            int index = position(engine);
+            if(pattern[index]) continue;
+            pattern[index] = true;
+            splat(energy, index, 1);
+            ++placed;
+        }
+
+        //move points from clusters to voids until it is evenly spread
+        for(int i = 0; i < count; ++i) {
+            int cluster = find(energy, pattern, true);
+            pattern[cluster] = false;
+            splat(energy, cluster, -1);
+            int hole = find(energy, pattern, false);
+            pattern[hole] = true;
+            splat(energy, hole, 1);
+            if(hole == cluster) break;
+        }
+
+        std::vector<int> rank(count, 0);
+
+        //the initial points get the lowest ranks, tightest clusters last
+        {
+            auto clusterPattern = pattern;
+            auto clusterEnergy = energy;
+            for(int r = initialCount - 1; r >= 0; --r) {
+                int cluster = find(clusterEnergy, clusterPattern, true);
+                clusterPattern[cluster] = false;
+                splat(clusterEnergy, cluster, -1);
+                rank[cluster] = r;
+            }
+        }
+
+        //every other pixel is ranked by filling the largest void
+        for(int r = initialCount; r < count; ++r) {
+            int hole = find(energy, pattern, false);
+            pattern[hole] = true;
+            splat(energy, hole, 1);
+            rank[hole] = r;
+        }
+
+        std::vector<float> values(count);
+        for(int i = 0; i < count; ++i)
+            values[i] = (rank[i] + .5f) / count;
+        return values;
+    }
+}
+
+std::vector<glm::vec2> SampleSets::sobol(size_t count)
+{
+    //direction numbers of the second dimension, the first one is the
+    //van der corput sequence
+    uint32_t directions[32];
+    directions[0] = 1u << 31;
+    for(int i = 1; i < 32; ++i)
+        directions[i] = directions[i - 1] ^ (directions[i - 1] >> 1);
+
+    std::vector<glm::vec2> samples;
+    samples.reserve(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        uint32_t x = 0, y = 0;
+        for(int bit = 0; bit < 32; ++bit) {
+            if(!(i & (1u << bit))) continue;
+            x ^= 1u << (31 - bit);
+            y ^= directions[bit];
+        }
+        samples.emplace_back(toUnitFloat(x), toUnitFloat(y));
+    }
+    return samples;
+}
+
+std::vector<glm::vec2> SampleSets::halton(size_t count, size_t offset)
+{
+    std::vector<glm::vec2> samples;
+    samples.reserve(count);
+    for(size_t i = offset; i < offset + count; ++i)
+        samples.emplace_back(radicalInverse(i, 2), radicalInverse(i, 3));
+    return samples;
+}
+
+const std::vector<glm::vec2>& SampleSets::blueNoise()
+{
+    static const std::vector<glm::vec2> tile = [] {
+        auto first = voidAndCluster(BLUE_NOISE_SIZE, 1);
+        auto second = voidAndCluster(BLUE_NOISE_SIZE, 2);
+        std::vector<glm::vec2> noise(first.size());
+        for(size_t i = 0; i < noise.size(); ++i)
+            noise[i] = glm::vec2(first[i], second[i]);
+        return noise;
+    }();
+    return tile;
+}
+
+glm::vec2 SampleSets::frameOffset(unsigned frame)
+{
+    //index 0 of the halton sequence is the origin, which would leave every
+    //first frame unrotated
+    return halton(1, frame % 256 + 1)[0];
+}
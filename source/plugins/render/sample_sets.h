@@ -0,0 +1,36 @@
+#ifndef MT_GL_SAMPLE_SETS_H
+#define MT_GL_SAMPLE_SETS_H
+
+#include "vector"
+#include "glm/glm.hpp"
+
+namespace MindTree {
+namespace GL {
+
+//low discrepancy sample sets in [0, 1)^2. They converge a lot faster than
+//white noise, so passes can get away with fewer samples per pixel
+namespace SampleSets {
+
+//first count points of the 2D sobol sequence
+std::vector<glm::vec2> sobol(size_t count);
+
+//halton sequence with bases 2 and 3, starting at index offset
+std::vector<glm::vec2> halton(size_t count, size_t offset=0);
+
+//size of the blue noise tile in pixels
+const int BLUE_NOISE_SIZE = 64;
+
+//tileable BLUE_NOISE_SIZE^2 blue noise with two independent channels,
+//generated once with void and cluster
+const std::vector<glm::vec2>& blueNoise();
+
+//offset that rotates a sample set from frame to frame, so passes that are
+//accumulated over time see different samples every frame
+glm::vec2 frameOffset(unsigned frame);
+
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,463 @@
+#include "algorithm"
+#include "limits"
+#include "cmath"
+
+#include "scene_bvh.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+namespace {
+    const int MAX_LEAF_SIZE = 4;
+}
+
+AABB::AABB() :
+    min(std::numeric_limits<float>::max()),
+    max(std::numeric_limits<float>::lowest())
+{
+}
+
+AABB::AABB(glm::vec3 minimum, glm::vec3 maximum) :
+    min(minimum), max(maximum)
+{
+}
+
+void AABB::extend(glm::vec3 point)
+{
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+}
+
+void AABB::extend(const AABB &other)
+{
+    if(!other.isValid()) return;
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+bool AABB::isValid() const
+{
+    return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+}
+
+glm::vec3 AABB::center() const
+{
+    return (min + max) * .5f;
+}
+
+AABB AABB::transformed(const glm::mat4 &mat) const
+{
+    if(!isValid()) return AABB();
+
+    //Arvo's method, transform the extents instead of all 8 corners
+    glm::vec3 translation(mat[3]);
+    AABB ret(translation, translation);
+    for(int col = 0; col < 3; ++col) {
+        for(int row = 0; row < 3; ++row) {
+            float a = mat[col][row] * min[col];
+            float b = mat[col][row] * max[col];
+            ret.min[row] += std::min(a, b);
+            ret.max[row] += std::max(a, b);
+        }
+    }
+    return ret;
+}
+
+AABB MindTree::GL::computeBounds(const std::shared_ptr<ObjectData> &data)
+{
+    AABB bounds;
+    if(!data || !data->hasProperty("P")) return bounds;
+
+    auto vertices = data->getProperty("P").getData<VertexListPtr>();
+    if(!vertices) return bounds;
+
+    for(const auto &p : *vertices)
+        bounds.extend(p);
+    return bounds;
+}
+
+Frustum::Frustum(const glm::mat4 &vp)
+{
+    //Gribb/Hartmann plane extraction, glm matrices are column major
+    auto row = [&vp](int i) {
+        return glm::vec4(vp[0][i], vp[1][i], vp[2][i], vp[3][i]);
+    };
+
+    _planes[0] = row(3) + row(0);
+    _planes[1] = row(3) - row(0);
+    _planes[2] = row(3) + row(1);
+    _planes[3] = row(3) - row(1);
+    _planes[4] = row(3) + row(2);
+    _planes[5] = row(3) - row(2);
+
+    //normalized, so spheres can be tested with their radius
+    for(auto &plane : _planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+bool Frustum::intersects(const AABB &box) const
+{
+    if(!box.isValid()) return true;
+
+    for(const auto &plane : _planes) {
+        //test the corner that lies furthest along the plane normal
+        glm::vec3 p(plane.x >= 0 ? box.max.x : box.min.x,
+                    plane.y >= 0 ? box.max.y : box.min.y,
+                    plane.z >= 0 ? box.max.z : box.min.z);
+        if(glm::dot(glm::vec3(plane), p) + plane.w < 0)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::intersects(const glm::vec3 &center, float radius) const
+{
+    for(const auto &plane : _planes)
+        if(glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    return true;
+}
+
+HiZBuffer::HiZBuffer()
+{
+}
+
+void HiZBuffer::clear()
+{
+    _levels.clear();
+    _sizes.clear();
+}
+
+bool HiZBuffer::isValid() const
+{
+    return !_levels.empty();
+}
+
+void HiZBuffer::build(const std::vector<float> &depth, int width, int height, const glm::mat4 &viewProjection)
+{
+    clear();
+    if(width <= 0 || height <= 0 || depth.size() < size_t(width * height))
+        return;
+
+    _viewProjection = viewProjection;
+    _levels.push_back(depth);
+    _sizes.push_back(glm::ivec2(width, height));
+
+    while(width > 1 || height > 1) {
+        int w = std::max(1, (width + 1) / 2);
+        int h = std::max(1, (height + 1) / 2);
+        const auto &src = _levels.back();
+        std::vector<float> dst(w * h);
+        for(int y = 0; y < h; ++y) {
+            int y0 = std::min(2 * y, height - 1);
+            int y1 = std::min(2 * y + 1, height - 1);
+            for(int x = 0; x < w; ++x) {
+                int x0 = std::min(2 * x, width - 1);
+                int x1 = std::min(2 * x + 1, width - 1);
+                dst[y * w + x] = std::max(std::max(src[y0 * width + x0], src[y0 * width + x1]),
+                                          std::max(src[y1 * width + x0], src[y1 * width + x1]));
+            }
+        }
+        _levels.push_back(std::move(dst));
+        _sizes.push_back(glm::ivec2(w, h));
+        width = w;
+        height = h;
+    }
+}
+
+bool HiZBuffer::isOccluded(const AABB &box) const
+{
+    if(!isValid() || !box.isValid()) return false;
+
+    glm::vec3 ndcMin(std::numeric_limits<float>::max());
+    glm::vec3 ndcMax(std::numeric_limits<float>::lowest());
+    for(int i = 0; i < 8; ++i) {
+        glm::vec4 corner((i & 1) ? box.max.x : box.min.x,
+                         (i & 2) ? box.max.y : box.min.y,
+                         (i & 4) ? box.max.z : box.min.z,
+                         1);
+        glm::vec4 clip = _viewProjection * corner;
+
+        //box crosses the near plane, can't say anything about it
+        if(clip.w <= 1e-5) return false;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+
+    const glm::ivec2 size = _sizes[0];
+    float x0 = (ndcMin.x * .5f + .5f) * size.x;
+    float x1 = (ndcMax.x * .5f + .5f) * size.x;
+    float y0 = (ndcMin.y * .5f + .5f) * size.y;
+    float y1 = (ndcMax.y * .5f + .5f) * size.y;
+
+    //offscreen boxes are handled by the frustum test
+    if(x1 < 0 || y1 < 0 || x0 >= size.x || y0 >= size.y)
+        return false;
+
+    x0 = std::max(x0, 0.f);
+    y0 = std::max(y0, 0.f);
+    x1 = std::min(x1, float(size.x - 1));
+    y1 = std::min(y1, float(size.y - 1));
+
+    //pick the level on which the box covers about 2x2 texels
+    float extent = std::max(std::max(x1 - x0, y1 - y0), 1.f);
+    int level = std::max(0, int(std::ceil(std::log2(extent * .5f))));
+    level = std::min(level, int(_levels.size()) - 1);
+
+    const auto &data = _levels[level];
+    const glm::ivec2 levelSize = _sizes[level];
+    int lx0 = std::min(int(x0) >> level, levelSize.x - 1);
+    int lx1 = std::min(int(x1) >> level, levelSize.x - 1);
+    int ly0 = std::min(int(y0) >> level, levelSize.y - 1);
+    int ly1 = std::min(int(y1) >> level, levelSize.y - 1);
+
+    float maxDepth = 0;
+    for(int y = ly0; y <= ly1; ++y)
+        for(int x = lx0; x <= lx1; ++x)
+            maxDepth = std::max(maxDepth, data[y * levelSize.x + x]);
+
+    float nearestDepth = ndcMin.z * .5f + .5f;
+    return nearestDepth > maxDepth;
+}
+
+CullSet::CullSet() :
+    _empty(true)
+{
+}
+
+void CullSet::clear()
+{
+    _empty = true;
+}
+
+bool CullSet::empty() const
+{
+    return _empty;
+}
+
+bool CullSet::isCulled(const AbstractTransformable *obj) const
+{
+    if(_empty) return false;
+
+    auto it = _indices->find(obj);
+    return it != _indices->end() && _culled[it->second];
+}
+
+void CullSet::cull(int item)
+{
+    _culled[item] = true;
+    _empty = false;
+}
+
+SceneBVH::SceneBVH() :
+    _itemIndices(std::make_shared<CullSet::ItemIndices>())
+{
+}
+
+void SceneBVH::clear()
+{
+    std::unique_lock<std::shared_timed_mutex> lock(_lock);
+    _items.clear();
+    _indices.clear();
+    _nodes.clear();
+    _itemIndices = std::make_shared<CullSet::ItemIndices>();
+}
+
+size_t SceneBVH::size() const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_lock);
+    return _items.size();
+}
+
+AABB SceneBVH::getBounds() const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_lock);
+    if(_nodes.empty()) return AABB();
+    return _nodes[0].bounds;
+}
+
+void SceneBVH::collect(const std::vector<AbstractTransformablePtr> &transformables)
+{
+    for(const auto &transformable : transformables) {
+        if(transformable->getType() == AbstractTransformable::GEO) {
+            auto obj = std::dynamic_pointer_cast<GeoObject>(transformable);
+            AABB bounds = computeBounds(obj->getData());
+            if(bounds.isValid()) {
+                Item item;
+                item.object = obj;
+                item.localBounds = bounds;
+                item.transformationVersion = obj->getTransformationVersion();
+                item.worldTransformation = obj->getWorldTransformation();
+                item.worldBounds = item.localBounds.transformed(item.worldTransformation);
+                item.leaf = -1;
+                _items.push_back(item);
+            }
+        }
+        collect(transformable->getChildren());
+    }
+}
+
+void SceneBVH::build(std::shared_ptr<Group> grp)
+{
+    std::unique_lock<std::shared_timed_mutex> lock(_lock);
+    _items.clear();
+    _indices.clear();
+    _nodes.clear();
+    _itemIndices = std::make_shared<CullSet::ItemIndices>();
+
+    if(!grp) return;
+    collect(grp->getMembers());
+    if(_items.empty()) return;
+
+    auto itemIndices = std::make_shared<CullSet::ItemIndices>();
+    _indices.resize(_items.size());
+    for(size_t i = 0; i < _indices.size(); ++i) {
+        _indices[i] = i;
+        (*itemIndices)[_items[i].object.get()] = i;
+    }
+    _itemIndices = itemIndices;
+
+    _nodes.reserve(2 * _items.size());
+    buildNode(-1, 0, _items.size());
+}
+
+int SceneBVH::buildNode(int parent, int first, int count)
+{
+    int index = _nodes.size();
+    _nodes.push_back(Node());
+    _nodes[index].parent = parent;
+    _nodes[index].left = _nodes[index].right = -1;
+    _nodes[index].first = first;
+    _nodes[index].count = count;
+
+    AABB bounds, centroids;
+    for(int i = first; i < first + count; ++i) {
+        bounds.extend(_items[_indices[i]].worldBounds);
+        centroids.extend(_items[_indices[i]].worldBounds.center());
+    }
+    _nodes[index].bounds = bounds;
+
+    if(count <= MAX_LEAF_SIZE) {
+        for(int i = first; i < first + count; ++i)
+            _items[_indices[i]].leaf = index;
+        return index;
+    }
+
+    //median split along the longest axis of the centroid bounds
+    glm::vec3 extent = centroids.max - centroids.min;
+    int axis = 0;
+    if(extent.y > extent[axis]) axis = 1;
+    if(extent.z > extent[axis]) axis = 2;
+
+    int half = count / 2;
+    std::nth_element(_indices.begin() + first,
+                     _indices.begin() + first + half,
+                     _indices.begin() + first + count,
+                     [this, axis](int a, int b) {
+                        return _items[a].worldBounds.center()[axis]
+                            < _items[b].worldBounds.center()[axis];
+                     });
+
+    int left = buildNode(index, first, half);
+    int right = buildNode(index, first + half, count - half);
+    _nodes[index].left = left;
+    _nodes[index].right = right;
+    _nodes[index].count = 0;
+    return index;
+}
+
+void SceneBVH::updateNodeBounds(int node)
+{
+    Node &n = _nodes[node];
+    AABB bounds;
+    if(n.left < 0) {
+        for(int i = n.first; i < n.first + n.count; ++i)
+            bounds.extend(_items[_indices[i]].worldBounds);
+    }
+    else {
+        bounds.extend(_nodes[n.left].bounds);
+        bounds.extend(_nodes[n.right].bounds);
+    }
+    n.bounds = bounds;
+}
+
+bool SceneBVH::refit()
+{
+    std::unique_lock<std::shared_timed_mutex> lock(_lock);
+    std::vector<bool> dirty(_nodes.size(), false);
+    bool changed = false;
+    for(auto &item : _items) {
+        //only objects touched since the last refit get their bounds updated
+        unsigned version = item.object->getTransformationVersion();
+        if(version == item.transformationVersion) continue;
+        item.transformationVersion = version;
+
+        glm::mat4 world = item.object->getWorldTransformation();
+        if(world == item.worldTransformation) continue;
+
+        item.worldTransformation = world;
+        item.worldBounds = item.localBounds.transformed(world);
+        dirty[item.leaf] = true;
+        changed = true;
+    }
+    if(!changed) return false;
+
+    //children are always stored after their parents, so walking backwards
+    //refits every dirty subtree bottom up
+    for(int i = _nodes.size() - 1; i >= 0; --i) {
+        if(!dirty[i]) continue;
+        updateNodeBounds(i);
+        if(_nodes[i].parent >= 0)
+            dirty[_nodes[i].parent] = true;
+    }
+    return true;
+}
+
+void SceneBVH::cullSubtree(int node, CullSet &culled) const
+{
+    const Node &n = _nodes[node];
+    if(n.left < 0) {
+        for(int i = n.first; i < n.first + n.count; ++i)
+            culled.cull(_indices[i]);
+        return;
+    }
+    cullSubtree(n.left, culled);
+    cullSubtree(n.right, culled);
+}
+
+void SceneBVH::cullNode(int node, const Frustum &frustum, const HiZBuffer *hiz, CullSet &culled) const
+{
+    const Node &n = _nodes[node];
+    if(!frustum.intersects(n.bounds)
+       || (hiz && hiz->isOccluded(n.bounds))) {
+        cullSubtree(node, culled);
+        return;
+    }
+
+    if(n.left < 0) {
+        if(n.count == 1) return;
+        for(int i = n.first; i < n.first + n.count; ++i) {
+            const Item &item = _items[_indices[i]];
+            if(!frustum.intersects(item.worldBounds)
+               || (hiz && hiz->isOccluded(item.worldBounds)))
+                culled.cull(_indices[i]);
+        }
+        return;
+    }
+    cullNode(n.left, frustum, hiz, culled);
+    cullNode(n.right, frustum, hiz, culled);
+}
+
+void SceneBVH::cull(const Frustum &frustum, const HiZBuffer *hiz, CullSet &culled) const
+{
+    std::shared_lock<std::shared_timed_mutex> lock(_lock);
+    culled._indices = _itemIndices;
+    culled._culled.assign(_items.size(), false);
+    culled._empty = true;
+    if(_nodes.empty()) return;
+
+    if(hiz && !hiz->isValid()) hiz = nullptr;
+    cullNode(0, frustum, hiz, culled);
+}
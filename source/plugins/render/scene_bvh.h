@@ -0,0 +1,142 @@
+#ifndef MT_GL_SCENE_BVH_H
+#define MT_GL_SCENE_BVH_H
+
+#include "memory"
+#include "vector"
+#include "shared_mutex"
+#include "unordered_map"
+
+#include "glm/glm.hpp"
+
+#include "../datatypes/Object/object.h"
+
+namespace MindTree {
+namespace GL {
+
+struct AABB
+{
+    AABB();
+    AABB(glm::vec3 minimum, glm::vec3 maximum);
+
+    void extend(glm::vec3 point);
+    void extend(const AABB &other);
+    bool isValid() const;
+    glm::vec3 center() const;
+
+    //bounds of this box after being transformed by mat
+    AABB transformed(const glm::mat4 &mat) const;
+
+    glm::vec3 min, max;
+};
+
+//object space bounds of the "P" attribute, invalid if there is none
+AABB computeBounds(const std::shared_ptr<ObjectData> &data);
+
+class Frustum
+{
+public:
+    Frustum(const glm::mat4 &viewProjection);
+
+    bool intersects(const AABB &box) const;
+    bool intersects(const glm::vec3 &center, float radius) const;
+
+private:
+    glm::vec4 _planes[6];
+};
+
+//max depth pyramid built from a depth buffer of a previous frame,
+//used to conservatively reject boxes hidden behind already drawn geometry
+class HiZBuffer
+{
+public:
+    HiZBuffer();
+
+    void build(const std::vector<float> &depth, int width, int height, const glm::mat4 &viewProjection);
+    void clear();
+    bool isValid() const;
+    bool isOccluded(const AABB &box) const;
+
+private:
+    std::vector<std::vector<float>> _levels;
+    std::vector<glm::ivec2> _sizes;
+    glm::mat4 _viewProjection;
+};
+
+//per item visibility of a SceneBVH seen from one view, kept around by the
+//passes so culling does not allocate every frame
+class CullSet
+{
+public:
+    CullSet();
+
+    void clear();
+    bool empty() const;
+    bool isCulled(const AbstractTransformable *obj) const;
+
+private:
+    friend class SceneBVH;
+    typedef std::unordered_map<const AbstractTransformable*, int> ItemIndices;
+
+    void cull(int item);
+
+    std::shared_ptr<const ItemIndices> _indices;
+    std::vector<bool> _culled;
+    bool _empty;
+};
+
+//bounding volume hierarchy over the world space bounds of all geometry
+//objects of a scene, shared by all passes of a render tree
+class SceneBVH
+{
+public:
+    SceneBVH();
+
+    void build(std::shared_ptr<Group> grp);
+    void clear();
+
+    //update world bounds of objects whose transformation changed since the
+    //last build/refit and propagate them up the tree, returns whether
+    //anything moved
+    bool refit();
+
+    //marks all objects that are known to the hierarchy and not visible
+    void cull(const Frustum &frustum, const HiZBuffer *hiz, CullSet &culled) const;
+
+    size_t size() const;
+    AABB getBounds() const;
+
+private:
+    struct Item {
+        std::shared_ptr<GeoObject> object;
+        AABB localBounds;
+        AABB worldBounds;
+        glm::mat4 worldTransformation;
+        unsigned transformationVersion;
+        int leaf;
+    };
+
+    struct Node {
+        AABB bounds;
+        int parent;
+        int left, right;
+        int first, count;
+    };
+
+    void collect(const std::vector<AbstractTransformablePtr> &transformables);
+    int buildNode(int parent, int first, int count);
+    void updateNodeBounds(int node);
+    void cullNode(int node, const Frustum &frustum, const HiZBuffer *hiz, CullSet &culled) const;
+    void cullSubtree(int node, CullSet &culled) const;
+
+    std::vector<Item> _items;
+    std::vector<int> _indices;
+    std::vector<Node> _nodes;
+    std::shared_ptr<const CullSet::ItemIndices> _itemIndices;
+
+    mutable std::shared_timed_mutex _lock;
+};
+
+}
+}
+
+#endif
@@ -2,25 +2,80 @@
 #include "renderpass.h"
 #include "render_setup.h"
 #include "rendertree.h"
+#include "sample_sets.h"
+#include "temporal_accumulation.h"
 #include "screenspace_reflection.h"
 
 using namespace MindTree;
 using namespace MindTree::GL;
 
+ScreenSpaceReflectionPlane::ScreenSpaceReflectionPlane() :
+    PixelPlane("../plugins/render/defaultShaders/screenspace_reflection.frag"),
+    _frame(0)
+{
+}
+
+void ScreenSpaceReflectionPlane::init(ShaderProgram *program)
+{
+    PixelPlane::init(program);
+
+    _blueNoise = make_resource<Texture2D>(getResourceManager(),
+                                          "blueNoise",
+                                          Texture::RG32F);
+    _blueNoise->setFilter(Texture::NEAREST);
+    _blueNoise->setWrapMode(Texture::REPEAT);
+    _blueNoise->setWidth(SampleSets::BLUE_NOISE_SIZE);
+    _blueNoise->setHeight(SampleSets::BLUE_NOISE_SIZE);
+    _blueNoise->init(SampleSets::blueNoise());
+}
+
+void ScreenSpaceReflectionPlane::draw(const CameraPtr &camera,
+                                      const RenderConfig &config,
+                                      ShaderProgram *program)
+{
+    program->setTexture(_blueNoise.get());
+    UniformState state(program, "frameOffset", SampleSets::frameOffset(_frame++));
+    PixelPlane::draw(camera, config, program);
+}
+
 void ScreenSpaceReflectionBlock::init()
 {
-    auto pass = addPass("ssreflection");
+    //traced and accumulated at half resolution by default
+    setResolutionScale(.5);
+    auto pass = addScaledPass("ssreflection");
     auto reflection = make_resource<Texture2D>(_config->getTree()->getResourceManager(),
                                                "reflection",
-                                               Texture::RGBA);
+                                               Texture::RGBA16F);
     auto reflection_dir = make_resource<Texture2D>(_config->getTree()->getResourceManager(),
                                                    "reflection_dir",
                                                    Texture::RGBA16F);
 
-    auto plane = new PixelPlane();
-    plane->setFragmentShader("../plugins/render/defaultShaders/screenspace_reflection.frag");
-    pass->addRenderer(plane);
+    pass->addRenderer(new ScreenSpaceReflectionPlane());
     pass->addOutput(std::move(reflection));
-    addOutput(reflection.get());
     pass->addOutput(std::move(reflection_dir));
+
+    auto accumulatePass = addScaledPass("ssreflection_accumulate");
+    accumulatePass->addOutput(make_resource<Texture2D>(_config->getTree()->getResourceManager(),
+                                                       "reflection_accumulated",
+                                                       Texture::RGBA16F));
+    accumulatePass->addOutput(make_resource<Texture2D>(_config->getTree()->getResourceManager(),
+                                                       "reflection_history",
+                                                       Texture::RGBA16F));
+    accumulatePass->setCustomTextureNameMapping("reflection", "current");
+    accumulatePass->setCustomFragmentNameMapping("reflection_accumulated", "accumulated");
+    accumulatePass->setCustomFragmentNameMapping("reflection_history", "accumulated_history");
+    _accumulationPlane = new TemporalAccumulationPlane();
+    accumulatePass->addRenderer(_accumulationPlane);
+    accumulatePass->addPostRenderCallback([this, pass](RenderPass*) {
+        if(!_accumulationPlane->isConverged())
+            pass->invalidate();
+    });
+    addOutput(addUpsamplePass(accumulatePass->getOutputTextures()[0], "ssreflection_upsample"));
+}
+
+void ScreenSpaceReflectionBlock::setGeometry(std::shared_ptr<Group> grp)
+{
+    if(grp->hasProperty("SSR:resolutionScale"))
+        setResolutionScale(grp->getProperty("SSR:resolutionScale").getData<double>());
+    _accumulationPlane->reset();
 }
@@ -2,16 +2,38 @@
 #define SCREENSPACE_REFLECTION_H
 
 #include "render_block.h"
+#include "pixel_plane.h"
 
 namespace MindTree
 {
 namespace GL
 {
 
+//marches with a blue noise jitter that changes every frame, the banding
+//of the fixed step size turns into noise that is accumulated over time
+class ScreenSpaceReflectionPlane : public PixelPlane
+{
+public:
+    ScreenSpaceReflectionPlane();
+
+protected:
+    void init(ShaderProgram *program) override;
+    void draw(const CameraPtr &camera, const RenderConfig &config, ShaderProgram *program) override;
+
+private:
+    ResourceHandle<Texture2D> _blueNoise;
+    unsigned _frame;
+};
+
+class TemporalAccumulationPlane;
 class ScreenSpaceReflectionBlock : public RenderBlock
 {
  public:
     void init();
+    void setGeometry(std::shared_ptr<Group> grp) override;
+
+ private:
+    TemporalAccumulationPlane *_accumulationPlane{nullptr};
 };
 
 }
@@ -0,0 +1,441 @@
+#include "iostream"
+#include "fstream"
+#include "sstream"
+#include "iomanip"
+#include "cstdlib"
+#include "climits"
+#include "cstdint"
+#include "cstring"
+#include "cstdio"
+#include "cerrno"
+#include "sys/stat.h"
+#include "sys/types.h"
+
+#include "glwrapper.h"
+
+#include "shader_library.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+namespace {
+    const char BINARY_MAGIC[4] = {'M', 'T', 'S', 'B'};
+
+    //creates every missing directory of path
+    bool makePath(const std::string &path)
+    {
+        for(size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+            std::string dir = path.substr(0, pos);
+            if(mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+                return false;
+            if(pos == std::string::npos) break;
+        }
+        return true;
+    }
+
+    std::string absolutePath(const std::string &path)
+    {
+        char resolved[PATH_MAX];
+        if(!realpath(path.c_str(), resolved)) return "";
+        return resolved;
+    }
+
+    std::string driverString()
+    {
+        std::string driver;
+        for(GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const GLubyte *str = glGetString(name);
+            if(str) driver += reinterpret_cast<const char*>(str);
+            driver += "\n";
+        }
+        return driver;
+    }
+
+    //bindings are recorded as a sequence of "f<index>=<name>;" for fragment
+    //outputs and "a<index>=<name>;" for attributes
+    std::vector<std::string> splitBindings(const std::string &bindings)
+    {
+        std::vector<std::string> entries;
+        size_t start = 0;
+        for(size_t end = bindings.find(';'); end != std::string::npos; end = bindings.find(';', start)) {
+            entries.push_back(bindings.substr(start, end - start + 1));
+            start = end + 1;
+        }
+        return entries;
+    }
+
+    void applyBinding(GLuint program, const std::string &entry)
+    {
+        auto eq = entry.find('=');
+        if(entry.size() < 4 || eq == std::string::npos) return;
+        GLuint index = std::stoul(entry.substr(1, eq - 1));
+        std::string name = entry.substr(eq + 1, entry.size() - eq - 2);
+        if(entry[0] == 'f') glBindFragDataLocation(program, index, name.c_str());
+        else glBindAttribLocation(program, index, name.c_str());
+        MTGLERROR;
+    }
+}
+
+ShaderLibrary* ShaderLibrary::instance()
+{
+    static ShaderLibrary library;
+    return &library;
+}
+
+ShaderLibrary::ShaderLibrary() :
+    _manifestLoaded(false),
+    _stopWriting(false)
+{
+    std::string dir;
+    if(const char *cache = std::getenv("XDG_CACHE_HOME")) dir = cache;
+    else if(const char *home = std::getenv("HOME")) dir = std::string(home) + "/.cache";
+    else dir = "/tmp";
+    setCacheDirectory(dir + "/mindtree/shaders");
+
+    _writer = std::thread(&ShaderLibrary::writeFiles, this);
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+    {
+        std::lock_guard<std::mutex> lock(_writeLock);
+        _stopWriting = true;
+    }
+    _writeCondition.notify_all();
+    _writer.join();
+}
+
+void ShaderLibrary::setCacheDirectory(const std::string &dir)
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    if(!makePath(dir)) {
+        std::cout << "could not create shader cache directory: " << dir << std::endl;
+        _cacheDirectory = "";
+    }
+    else {
+        _cacheDirectory = dir;
+    }
+    _knownPrograms.clear();
+    _manifestLoaded = false;
+}
+
+std::string ShaderLibrary::getCacheDirectory() const
+{
+    std::lock_guard<std::mutex> lock(_lock);
+    return _cacheDirectory;
+}
+
+std::string ShaderLibrary::getSource(const std::string &filename)
+{
+    struct stat info;
+    if(stat(filename.c_str(), &info) != 0) {
+        std::cout << "could not open file " << filename << std::endl;
+        return "";
+    }
+    long long modified = static_cast<long long>(info.st_mtime);
+
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        auto it = _sources.find(filename);
+        if(it != _sources.end() && it->second.modified == modified)
+            return it->second.content;
+    }
+
+    std::ifstream stream(filename, std::ios::binary);
+    if(!stream.is_open()) {
+        std::cout << "could not open file " << filename << std::endl;
+        return "";
+    }
+    std::string content(static_cast<size_t>(info.st_size), '\0');
+    stream.read(&content[0], content.size());
+    content.resize(stream.gcount());
+    if(content.empty() || content.back() != '\n') content += "\n";
+
+    std::lock_guard<std::mutex> lock(_lock);
+    _sources[filename] = {modified, content};
+    return content;
+}
+
+std::string ShaderLibrary::makeKey(const std::map<int, std::string> &sources,
+                                   const std::string &bindings)
+{
+    //64 bit FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const std::string &str) {
+        for(unsigned char c : str) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        hash ^= 0xff;
+        hash *= 1099511628211ull;
+    };
+
+    add(driverString());
+    for(const auto &p : sources) {
+        add(std::to_string(p.first));
+        add(p.second);
+    }
+    add(bindings);
+
+    std::ostringstream key;
+    key << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return key.str();
+}
+
+std::string ShaderLibrary::getBinaryPath(const std::string &key) const
+{
+    if(_cacheDirectory == "") return "";
+    return _cacheDirectory + "/" + key + ".bin";
+}
+
+bool ShaderLibrary::readBinary(const std::string &key, Binary &binary)
+{
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        path = getBinaryPath(key);
+    }
+    if(path == "") return false;
+
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if(!stream.is_open()) return false;
+
+    size_t size = stream.tellg();
+    char magic[4];
+    uint32_t format;
+    if(size <= sizeof(magic) + sizeof(format)) return false;
+
+    stream.seekg(0);
+    stream.read(magic, sizeof(magic));
+    stream.read(reinterpret_cast<char*>(&format), sizeof(format));
+    if(std::memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0) return false;
+
+    binary.format = format;
+    binary.data.resize(size - sizeof(magic) - sizeof(format));
+    stream.read(binary.data.data(), binary.data.size());
+    return static_cast<size_t>(stream.gcount()) == binary.data.size();
+}
+
+bool ShaderLibrary::loadBinary(GLuint program, const std::string &key)
+{
+    Binary binary;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        auto it = _binaries.find(key);
+        if(it != _binaries.end()) {
+            binary = it->second;
+            found = true;
+        }
+    }
+    if(!found) {
+        if(!readBinary(key, binary)) return false;
+        std::lock_guard<std::mutex> lock(_lock);
+        _binaries[key] = binary;
+    }
+
+    glProgramBinary(program, binary.format, binary.data.data(), binary.data.size());
+    MTGLERROR;
+
+    GLint linkStatus;
+    glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    if(linkStatus != GL_TRUE) {
+        //rejected by the driver, it will be compiled and stored again
+        std::lock_guard<std::mutex> lock(_lock);
+        _binaries.erase(key);
+        return false;
+    }
+    return true;
+}
+
+void ShaderLibrary::storeBinary(GLuint program, const std::string &key)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    MTGLERROR;
+    if(length <= 0) return;
+
+    Binary binary;
+    binary.data.resize(length);
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &binary.format, binary.data.data());
+    if(MTGLERROR || written <= 0) return;
+    binary.data.resize(written);
+
+    std::vector<char> file(BINARY_MAGIC, BINARY_MAGIC + sizeof(BINARY_MAGIC));
+    uint32_t format = binary.format;
+    const char *formatBytes = reinterpret_cast<const char*>(&format);
+    file.insert(file.end(), formatBytes, formatBytes + sizeof(format));
+    file.insert(file.end(), binary.data.begin(), binary.data.end());
+
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _binaries[key] = std::move(binary);
+        path = getBinaryPath(key);
+    }
+    if(path != "") writeFile(path, std::move(file), false);
+}
+
+void ShaderLibrary::loadManifest()
+{
+    if(_manifestLoaded || _cacheDirectory == "") return;
+    _manifestLoaded = true;
+
+    std::ifstream stream(_cacheDirectory + "/programs.txt");
+    std::string line;
+    while(std::getline(stream, line))
+        if(line != "") _knownPrograms.insert(line);
+}
+
+void ShaderLibrary::addKnownProgram(const std::map<int, std::string> &files,
+                                    const std::string &bindings)
+{
+    std::string line = bindings;
+    for(const auto &p : files) {
+        std::string path = absolutePath(p.second);
+        if(path == "") return;
+        line += "\t" + std::to_string(p.first) + "=" + path;
+    }
+
+    std::string manifest;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        loadManifest();
+        if(_cacheDirectory == "" || !_knownPrograms.insert(line).second) return;
+        manifest = _cacheDirectory + "/programs.txt";
+    }
+    line += "\n";
+    writeFile(manifest, std::vector<char>(line.begin(), line.end()), true);
+}
+
+void ShaderLibrary::precompile()
+{
+    std::set<std::string> programs;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        loadManifest();
+        programs = _knownPrograms;
+    }
+
+    int compiled = 0, loaded = 0;
+    for(const auto &line : programs) {
+        std::istringstream stream(line);
+        std::string bindings, entry;
+        std::getline(stream, bindings, '\t');
+
+        std::map<int, std::string> sources;
+        bool valid = true;
+        while(std::getline(stream, entry, '\t')) {
+            auto eq = entry.find('=');
+            if(eq == std::string::npos) { valid = false; break; }
+            std::string src = getSource(entry.substr(eq + 1));
+            if(src == "") { valid = false; break; }
+            sources[std::stoi(entry.substr(0, eq))] = src;
+        }
+        if(!valid || sources.empty()) continue;
+
+        //every relink after a binding has its own binary
+        std::vector<std::string> keys;
+        std::string prefix;
+        keys.push_back(makeKey(sources, prefix));
+        for(const auto &binding : splitBindings(bindings)) {
+            prefix += binding;
+            keys.push_back(makeKey(sources, prefix));
+        }
+
+        bool cached = true;
+        for(const auto &key : keys) {
+            {
+                std::lock_guard<std::mutex> lock(_lock);
+                if(_binaries.find(key) != _binaries.end()) continue;
+            }
+            Binary binary;
+            if(!readBinary(key, binary)) {
+                cached = false;
+                break;
+            }
+            std::lock_guard<std::mutex> lock(_lock);
+            _binaries[key] = std::move(binary);
+        }
+        if(cached) {
+            ++loaded;
+            continue;
+        }
+
+        GLuint program = glCreateProgram();
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        for(const auto &p : sources) {
+            GLuint shader = ShaderProgram::compileShader(p.second,
+                                                         static_cast<ShaderProgram::ShaderType>(p.first),
+                                                         "");
+            glAttachShader(program, shader);
+            glDeleteShader(shader);
+        }
+        MTGLERROR;
+
+        auto bindingEntries = splitBindings(bindings);
+        for(size_t i = 0; i < keys.size(); ++i) {
+            if(i > 0) applyBinding(program, bindingEntries[i - 1]);
+            glLinkProgram(program);
+            GLint linkStatus;
+            glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+            if(linkStatus != GL_TRUE) break;
+            storeBinary(program, keys[i]);
+        }
+        glDeleteProgram(program);
+        ++compiled;
+    }
+    glFinish();
+    std::cout << "shader library: " << loaded << " programs loaded, "
+              << compiled << " compiled" << std::endl;
+}
+
+void ShaderLibrary::replayBindings(GLuint program, const std::string &bindings)
+{
+    for(const auto &binding : splitBindings(bindings))
+        applyBinding(program, binding);
+}
+
+void ShaderLibrary::writeFile(const std::string &path, std::vector<char> &&data, bool append)
+{
+    {
+        std::lock_guard<std::mutex> lock(_writeLock);
+        _writes.push({path, std::move(data), append});
+    }
+    _writeCondition.notify_one();
+}
+
+void ShaderLibrary::writeFiles()
+{
+    while(true) {
+        FileWrite write;
+        {
+            std::unique_lock<std::mutex> lock(_writeLock);
+            _writeCondition.wait(lock, [this] { return _stopWriting || !_writes.empty(); });
+            if(_writes.empty()) return;
+            write = std::move(_writes.front());
+            _writes.pop();
+        }
+
+        if(write.append) {
+            std::ofstream stream(write.path, std::ios::binary | std::ios::app);
+            stream.write(write.data.data(), write.data.size());
+            continue;
+        }
+
+        //written next to the target and renamed, so a reader never sees a
+        //partial binary
+        std::string tmp = write.path + ".tmp";
+        {
+            std::ofstream stream(tmp, std::ios::binary | std::ios::trunc);
+            stream.write(write.data.data(), write.data.size());
+            if(!stream) {
+                std::cout << "could not write shader binary " << write.path << std::endl;
+                std::remove(tmp.c_str());
+                continue;
+            }
+        }
+        std::rename(tmp.c_str(), write.path.c_str());
+    }
+}
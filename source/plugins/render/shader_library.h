@@ -0,0 +1,99 @@
+#ifndef MT_GL_SHADER_LIBRARY_H
+#define MT_GL_SHADER_LIBRARY_H
+
+#include "map"
+#include "set"
+#include "string"
+#include "vector"
+#include "queue"
+#include "mutex"
+#include "thread"
+#include "condition_variable"
+#include "unordered_map"
+#include "GL/glew.h"
+
+namespace MindTree {
+namespace GL {
+
+//process wide cache shared by all render trees. Shader files are read once,
+//linked programs are kept as binaries in memory and on disk, keyed by a
+//hash of their sources, location bindings and the driver
+class ShaderLibrary
+{
+public:
+    static ShaderLibrary* instance();
+    ~ShaderLibrary();
+
+    void setCacheDirectory(const std::string &dir);
+    std::string getCacheDirectory() const;
+
+    //file content, read again only when the file changed on disk
+    std::string getSource(const std::string &filename);
+
+    //needs a current context for the driver string, sources are mapped
+    //by ShaderProgram::ShaderType
+    static std::string makeKey(const std::map<int, std::string> &sources,
+                               const std::string &bindings);
+
+    //creates the program from a cached binary, returns false if it has
+    //to be compiled
+    bool loadBinary(GLuint program, const std::string &key);
+    //stores the binary of a linked program that was created with
+    //GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+    void storeBinary(GLuint program, const std::string &key);
+    //binds locations again after a binary was loaded into program and it
+    //has to be linked from source
+    static void replayBindings(GLuint program, const std::string &bindings);
+
+    //remembers the files of a program, so later sessions can compile it
+    //before it is used
+    void addKnownProgram(const std::map<int, std::string> &files,
+                         const std::string &bindings);
+
+    //compiles every known program that is not cached yet, meant to run on
+    //a worker thread with its own context
+    void precompile();
+
+private:
+    ShaderLibrary();
+
+    struct Binary {
+        GLenum format;
+        std::vector<char> data;
+    };
+
+    struct Source {
+        long long modified;
+        std::string content;
+    };
+
+    std::string getBinaryPath(const std::string &key) const;
+    bool readBinary(const std::string &key, Binary &binary);
+    void loadManifest();
+    void writeFile(const std::string &path, std::vector<char> &&data, bool append);
+    void writeFiles();
+
+    mutable std::mutex _lock;
+    std::string _cacheDirectory;
+    std::unordered_map<std::string, Source> _sources;
+    std::unordered_map<std::string, Binary> _binaries;
+    std::set<std::string> _knownPrograms;
+    bool _manifestLoaded;
+
+    //disk writes happen in the background
+    struct FileWrite {
+        std::string path;
+        std::vector<char> data;
+        bool append;
+    };
+    std::mutex _writeLock;
+    std::condition_variable _writeCondition;
+    std::queue<FileWrite> _writes;
+    bool _stopWriting;
+    std::thread _writer;
+};
+
+}
+}
+
+#endif
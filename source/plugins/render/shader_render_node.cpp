@@ -50,7 +50,7 @@ void ShaderRenderNode::addRenderer(Renderer *renderer)
     _initialized = false;
 }
 
-void ShaderRenderNode::render(CameraPtr camera, glm::ivec2 resolution, const RenderConfig &config)
+void ShaderRenderNode::render(CameraPtr camera, glm::ivec2 resolution, const RenderConfig &config, const CullSet *culled)
 {
     std::lock_guard<std::mutex> lock(_rendersLock);
     if(!_initialized || !_program) return;
@@ -58,6 +58,11 @@ void ShaderRenderNode::render(CameraPtr camera, glm::ivec2 resolution, const Ren
     {
         UniformState us(_program, "resolution", resolution);
         for(const auto &renderer : _renders) {
+            if(culled && !culled->empty()) {
+                const auto *cullObject = renderer->getCullObject();
+                if(cullObject && culled->isCulled(cullObject))
+                    continue;
+            }
             renderer->render(camera, config, _program);
         }
     }
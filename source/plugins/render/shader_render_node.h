@@ -7,9 +7,13 @@
 #include "mutex"
 
 #include "../datatypes/Object/object.h"
+#include "scene_bvh.h"
+#include "gpu_timer.h"
 
 namespace MindTree
 {
+class Benchmark;
+
 namespace GL
 {
 
@@ -23,7 +27,7 @@ public:
     ShaderRenderNode(ShaderProgram *program);
 
     void addRenderer(Renderer *renderer);
-    void render(CameraPtr camera, glm::ivec2 resolution, const RenderConfig &config);
+    void render(CameraPtr camera, glm::ivec2 resolution, const RenderConfig &config, const CullSet *culled=nullptr);
     ShaderProgram* program();
     std::vector<Renderer*> renders();
     void setResourceManager(ResourceManager *manager);
@@ -43,6 +47,10 @@ private:
     bool _persistend;
 
     std::atomic<bool> _initialized;
+
+    //set up by the pass that renders this node when it is benchmarked
+    std::shared_ptr<Benchmark> _benchmark;
+    GPUTimer _gpuTimer;
 };
 
 
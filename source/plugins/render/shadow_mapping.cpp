@@ -1,3 +1,8 @@
+#include "algorithm"
+#include "cmath"
+#include "iostream"
+#include "glm/gtc/matrix_transform.hpp"
+
 #include "glwrapper.h"
 #include "render_setup.h"
 #include "rendertree.h"
@@ -11,12 +16,28 @@
 using namespace MindTree;
 using namespace MindTree::GL;
 
-ShadowMappingRenderBlock::ShadowMappingRenderBlock()
+namespace {
+    const int ATLAS_MIN_WIDTH = 2048;
+    const int NUM_CASCADES = 3;
+    //blend between uniform and logarithmic cascade splits
+    const float CASCADE_SPLIT_LAMBDA = .75;
+}
+
+ShadowMappingRenderBlock::ShadowMappingRenderBlock() :
+    _atlasPass(nullptr),
+    _lodBias(1),
+    _atlasSize(1, 1),
+    _maxAtlasSize(8192),
+    _cascadesDirty(true),
+    _version(0)
 {
 }
 
 void ShadowMappingRenderBlock::init()
 {
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &_maxAtlasSize);
+    MTGLERROR;
+
     auto shadowShader = _config->
 		getTree()->getResourceManager()->shaderManager()->getProgram<ShadowMappingRenderBlock>();
 	_shadowNode = std::make_shared<ShaderRenderNode>(shadowShader);
@@ -28,29 +49,67 @@ void ShadowMappingRenderBlock::init()
     shadowShader
         ->addShaderFromFile("../plugins/render/defaultShaders/shadow.frag",
                             ShaderProgram::FRAGMENT);
+
+    auto atlas_pass = std::make_unique<RenderPass>("shadowatlas");
+    _atlasPass = atlas_pass.get();
+    atlas_pass->setTree(_config->getTree());
+
+    //the atlas camera only defines the size of the atlas, every light
+    //renders with its own viewport camera
+    _atlasCamera = std::make_shared<Camera>();
+    _atlasCamera->setResolution(_atlasSize.x, _atlasSize.y);
+    atlas_pass->setCamera(_atlasCamera);
+    atlas_pass
+        ->setDepthOutput(make_resource<Texture2D>(_config->getTree()->getResourceManager(),
+                                                  "shadow",
+                                                  Texture::DEPTH32F));
+    atlas_pass->addGeometryShaderNode(_shadowNode);
+    atlas_pass->setClearDepth(1.);
+    atlas_pass->setEnabled(false);
+    //atlas regions are cached across frames
+    atlas_pass->setKeepOutputs(true);
+    atlas_pass->addPreRenderCallback([this](RenderPass *pass) {
+                                         updateCascades(pass);
+                                     });
+
+    _config->getTree()->insertPassAfter(_config->getGeometryPass(), std::move(atlas_pass));
 }
 
 void ShadowMappingRenderBlock::addRendererFromLight(LightPtr obj)
 {
+    Light::ShadowInfo info = obj->getShadowInfo();
+    if(!info._enabled) return;
+
+    ShadowEntry entry;
+    entry.light = obj;
+    entry.transformation = obj->getWorldTransformation();
+    entry.size = info._size;
+    entry.near = info._near;
+    entry.far = info._far;
+    entry.coneangle = 0;
+    entry.firstViewport = 0;
+
     switch(obj->getLightType()) {
         case Light::POINT:
+            return;
         case Light::DISTANT:
+            entry.cascades = NUM_CASCADES;
             break;
         case Light::SPOT:
-           createShadowPass(std::dynamic_pointer_cast<SpotLight>(obj));
+            entry.cascades = 1;
+            entry.coneangle = std::dynamic_pointer_cast<SpotLight>(obj)->getConeAngle();
+            break;
     }
-}
 
-void ShadowMappingRenderBlock::setGeometry(std::shared_ptr<Group> grp)
-{
-    //clear shadow passes
-    for(auto p : _shadowPasses) {
-        _config->getTree()->removePass(p.second);
-    }
-    _shadowNode->clear();
-    _shadowPasses.clear();
+    entry.cameras.resize(entry.cascades);
+    entry.rects.resize(entry.cascades);
+    entry.splits.resize(entry.cascades, 0);
+    entry.dirty.resize(entry.cascades, true);
 
-    setRenderersFromGroup(grp);
+    if(obj->getLightType() == Light::SPOT)
+        entry.cameras[0] = createSpotCamera(entry);
+
+    _newEntries.push_back(entry);
 }
 
 void ShadowMappingRenderBlock::addRendererFromObject(std::shared_ptr<GeoObject> obj)
@@ -58,47 +117,355 @@ void ShadowMappingRenderBlock::addRendererFromObject(std::shared_ptr<GeoObject>
     auto data = obj->getData();
     switch(data->getType()){
         case ObjectData::MESH:
-            if(data->hasProperty("polygon"))
-               _shadowNode->addRenderer(new PolygonRenderer(obj));
+            if(data->hasProperty("polygon")) {
+               auto renderer = new PolygonRenderer(obj);
+               renderer->setLODBias(_lodBias);
+               _shadowNode->addRenderer(renderer);
+               _newCasters.push_back({data, obj->getMaterial(), obj->getWorldTransformation()});
+            }
             break;
         case ObjectData::POINTCLOUD:
             break;
     }
 }
 
-std::unordered_map<std::shared_ptr<Light>, RenderPass*> ShadowMappingRenderBlock::getShadowPasses() const
+CameraPtr ShadowMappingRenderBlock::createSpotCamera(const ShadowEntry &entry) const
 {
-    return _shadowPasses;
+    auto camera = std::make_shared<Camera>();
+    camera->setResolution(entry.size.x, entry.size.y);
+    camera->setTransformation(entry.transformation);
+    camera->setFov(entry.coneangle * 2);
+    camera->setNear(entry.near);
+    camera->setFar(entry.far);
+    return camera;
 }
 
-RenderPass* ShadowMappingRenderBlock::createShadowPass(SpotLightPtr spot)
+bool ShadowMappingRenderBlock::isSameLight(const ShadowEntry &a, const ShadowEntry &b) const
 {
-    Light::ShadowInfo info = spot->getShadowInfo();
-    if(!info._enabled) return nullptr;
+    return a.light->getName() != ""
+        && a.light->getName() == b.light->getName()
+        && a.light->getLightType() == b.light->getLightType()
+        && a.light->getIntensity() == b.light->getIntensity()
+        && a.transformation == b.transformation
+        && a.size == b.size
+        && a.near == b.near
+        && a.far == b.far
+        && a.coneangle == b.coneangle
+        && a.cascades == b.cascades;
+}
 
-    auto shadow_pass = std::make_unique<RenderPass>("shadowpass");
-    shadow_pass->setTree(_config->getTree());
-    _shadowPasses[spot] = shadow_pass.get();
+void ShadowMappingRenderBlock::layoutAtlas(std::vector<ShadowEntry> &entries)
+{
+    struct Request {
+        size_t entry;
+        int cascade;
+        glm::ivec2 size;
+    };
 
-    auto camera = std::make_shared<Camera>();
-    camera->setResolution(info._size.x, info._size.y);
-    camera->setTransformation(spot->getWorldTransformation());
-    camera->setFov(spot->getConeAngle() * 2);
-    camera->setNear(info._near);
-    camera->setFar(info._far);
-    shadow_pass->setCamera(camera);
-    shadow_pass
-        ->setDepthOutput(make_resource<Texture2D>(_config->getTree()->getResourceManager(),
-                                                  "shadow",
-                                                  Texture::DEPTH32F));
-    shadow_pass->addGeometryShaderNode(_shadowNode);
-    shadow_pass->setClearDepth(1.);
+    std::vector<Request> requests;
+    for(size_t i = 0; i < entries.size(); ++i)
+        for(int c = 0; c < entries[i].cascades; ++c)
+            requests.push_back({i, c, entries[i].size});
+
+    //simple shelf packing, tallest maps first
+    std::stable_sort(begin(requests), end(requests), [](const Request &a, const Request &b) {
+                         return a.size.y > b.size.y;
+                     });
+
+    auto pack = [&](int scale) {
+        int width = std::min(ATLAS_MIN_WIDTH, _maxAtlasSize);
+        for(const auto &request : requests)
+            width = std::max(width, std::max(request.size.x / scale, 1));
+
+        int x = 0, y = 0, shelfHeight = 0;
+        for(const auto &request : requests) {
+            glm::ivec2 size = glm::max(request.size / scale, glm::ivec2(1));
+            if(x + size.x > width) {
+                x = 0;
+                y += shelfHeight;
+                shelfHeight = 0;
+            }
+            entries[request.entry].rects[request.cascade] = glm::ivec4(x, y, size.x, size.y);
+            x += size.x;
+            shelfHeight = std::max(shelfHeight, size.y);
+        }
+        return glm::ivec2(width, std::max(y + shelfHeight, 1));
+    };
+
+    //the atlas has to fit into a single texture, with too many or too
+    //large maps all of them lose resolution
+    int scale = 1;
+    glm::ivec2 atlasSize = pack(scale);
+    while((atlasSize.x > _maxAtlasSize || atlasSize.y > _maxAtlasSize)
+          && scale < _maxAtlasSize) {
+        scale *= 2;
+        atlasSize = pack(scale);
+    }
+    if(scale > 1)
+        std::cout << "shadow atlas exceeds the maximum texture size, "
+                  << "shadow maps are scaled down by " << scale << std::endl;
+
+    if(atlasSize != _atlasSize) {
+        //resizing recreates the atlas, so every viewport gets redrawn anyway
+        _atlasSize = atlasSize;
+        _atlasCamera->setResolution(_atlasSize.x, _atlasSize.y);
+    }
+}
+
+void ShadowMappingRenderBlock::invalidateCasters(const std::vector<CasterEntry> &casters,
+                                                 std::vector<ShadowEntry> &entries)
+{
+    auto contains = [](const std::unordered_multimap<ObjectData*, const CasterEntry*> &map,
+                       const CasterEntry &caster) {
+        auto range = map.equal_range(caster.data.get());
+        for(auto it = range.first; it != range.second; ++it) {
+            if(it->second->material == caster.material
+               && it->second->transformation == caster.transformation)
+                return true;
+        }
+        return false;
+    };
+
+    std::unordered_multimap<ObjectData*, const CasterEntry*> oldCasters, newCasters;
+    for(const auto &caster : _casters)
+        oldCasters.insert({caster.data.get(), &caster});
+    for(const auto &caster : casters)
+        newCasters.insert({caster.data.get(), &caster});
+
+    //world bounds of everything that was added, removed or moved
+    std::vector<AABB> changed;
+    for(const auto &caster : _casters)
+        if(!contains(newCasters, caster))
+            changed.push_back(computeBounds(caster.data).transformed(caster.transformation));
+    for(const auto &caster : casters)
+        if(!contains(oldCasters, caster))
+            changed.push_back(computeBounds(caster.data).transformed(caster.transformation));
+
+    if(changed.empty()) return;
+
+    for(auto &entry : entries) {
+        for(int c = 0; c < entry.cascades; ++c) {
+            if(entry.dirty[c]) continue;
+            if(!entry.cameras[c]) {
+                entry.dirty[c] = true;
+                continue;
+            }
+
+            Frustum frustum(entry.cameras[c]->getProjection() * entry.cameras[c]->getViewMatrix());
+            for(const auto &bounds : changed) {
+                if(frustum.intersects(bounds)) {
+                    entry.dirty[c] = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void ShadowMappingRenderBlock::updateViewports()
+{
     static const float PI = 3.14159265359;
-    shadow_pass->setProperty("coneangle", spot->getConeAngle() * PI /180);
-    shadow_pass->setProperty("intensity", spot->getIntensity());
+    std::vector<RenderPass::Viewport> viewports;
+    for(auto &entry : _entries) {
+        entry.firstViewport = viewports.size();
+        for(int c = 0; c < entry.cascades; ++c) {
+            RenderPass::Viewport viewport;
+            viewport.camera = entry.cameras[c];
+            viewport.rect = entry.rects[c];
+            viewport.dirty = entry.dirty[c];
+            viewport.properties["coneangle"] = entry.light->getLightType() == Light::SPOT
+                ? entry.coneangle * PI / 180
+                : 2 * PI;
+            viewport.properties["intensity"] = entry.light->getIntensity();
+            viewports.push_back(viewport);
+            entry.dirty[c] = false;
+        }
+    }
+    _atlasPass->setViewports(viewports);
+    _atlasPass->setEnabled(!viewports.empty());
+}
+
+void ShadowMappingRenderBlock::setGeometry(std::shared_ptr<Group> grp)
+{
+    _shadowNode->clear();
+    _newEntries.clear();
+    _newCasters.clear();
+
+    setRenderersFromGroup(grp);
+
+    std::lock_guard<std::mutex> lock(_shadowLock);
+    layoutAtlas(_newEntries);
+
+    //keep the content of lights that did not change and did not move
+    auto oldViewports = _atlasPass->getViewports();
+    for(auto &entry : _newEntries) {
+        for(const auto &old : _entries) {
+            if(!isSameLight(entry, old) || entry.rects != old.rects)
+                continue;
+
+            for(int c = 0; c < entry.cascades; ++c) {
+                size_t index = old.firstViewport + c;
+                bool pending = index >= oldViewports.size() || oldViewports[index].dirty;
+                entry.cameras[c] = old.cameras[c];
+                entry.splits[c] = old.splits[c];
+                entry.dirty[c] = pending || !old.cameras[c];
+            }
+            break;
+        }
+    }
+
+    invalidateCasters(_newCasters, _newEntries);
+
+    _entries = std::move(_newEntries);
+    _casters = std::move(_newCasters);
+    _newEntries.clear();
+    _newCasters.clear();
+    _cascadesDirty = true;
+
+    updateViewports();
+    ++_version;
+}
+
+void ShadowMappingRenderBlock::updateCascades(RenderPass *pass)
+{
+    auto camera = getCamera().lock();
+    if(!camera) return;
+
+    glm::mat4 view = camera->getViewMatrix();
+    glm::mat4 projection = camera->getProjection();
+
+    std::lock_guard<std::mutex> lock(_shadowLock);
+    if(!_cascadesDirty && view == _lastView && projection == _lastProjection)
+        return;
+
+    _cascadesDirty = false;
+    _lastView = view;
+    _lastProjection = projection;
+
+    glm::mat4 invView = glm::inverse(view);
+    float cameraNear = projection[3][2] / (projection[2][2] - 1);
+    float cameraFar = projection[3][2] / (projection[2][2] + 1);
+    float tanX = 1 / projection[0][0];
+    float tanY = 1 / projection[1][1];
+
+    AABB sceneBounds = _config->getTree()->getSceneBVH()->getBounds();
+
+    bool changed = false;
+    for(auto &entry : _entries) {
+        if(entry.light->getLightType() != Light::DISTANT) continue;
 
-    auto *ret = shadow_pass.get();
-    _config->getTree()->insertPassAfter(_config->getGeometryPass(), std::move(shadow_pass));
+        float far = std::min(float(entry.far), cameraFar);
+        float near = std::min(cameraNear, far);
+        glm::vec3 dir = glm::normalize(glm::vec3(entry.transformation[2]));
+        glm::vec3 up = std::abs(dir.y) > .99 ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+        glm::mat4 lightRotation = glm::lookAt(glm::vec3(0), dir, up);
 
-    return ret;
+        for(int c = 0; c < entry.cascades; ++c) {
+            float t = float(c + 1) / entry.cascades;
+            float z0 = c == 0 ? near : entry.splits[c - 1];
+            float z1 = glm::mix(near + (far - near) * t,
+                                near * std::pow(far / near, t),
+                                CASCADE_SPLIT_LAMBDA);
+            entry.splits[c] = z1;
+
+            //bounding sphere of the view frustum slice keeps the cascade
+            //size stable while the camera rotates
+            glm::vec3 corners[8];
+            glm::vec3 center(0);
+            for(int i = 0; i < 8; ++i) {
+                float z = (i & 4) ? z1 : z0;
+                glm::vec4 p((i & 1 ? 1 : -1) * tanX * z,
+                            (i & 2 ? 1 : -1) * tanY * z,
+                            -z,
+                            1);
+                corners[i] = glm::vec3(invView * p);
+                center += corners[i] / 8.f;
+            }
+            float radius = 0;
+            for(const auto &corner : corners)
+                radius = std::max(radius, glm::length(corner - center));
+            radius = std::ceil(radius * 16) / 16;
+
+            //snap the center to shadow map texels to avoid shimmering edges
+            float texel = 2 * radius / entry.rects[c].z;
+            glm::vec3 lightSpaceCenter(lightRotation * glm::vec4(center, 1));
+            lightSpaceCenter.x = std::floor(lightSpaceCenter.x / texel) * texel;
+            lightSpaceCenter.y = std::floor(lightSpaceCenter.y / texel) * texel;
+            center = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightSpaceCenter, 1));
+
+            //move the near plane back to catch all casters between the light
+            //and the cascade
+            float back = radius;
+            if(sceneBounds.isValid()) {
+                for(int i = 0; i < 8; ++i) {
+                    glm::vec3 corner((i & 1) ? sceneBounds.max.x : sceneBounds.min.x,
+                                     (i & 2) ? sceneBounds.max.y : sceneBounds.min.y,
+                                     (i & 4) ? sceneBounds.max.z : sceneBounds.min.z);
+                    back = std::max(back, glm::dot(center - corner, dir));
+                }
+            }
+
+            auto cascadeCamera = std::make_shared<Camera>();
+            cascadeCamera->setTransformation(glm::inverse(glm::lookAt(center - dir * back, center, up)));
+            cascadeCamera->setOrthographic(radius);
+            cascadeCamera->setNear(0);
+            cascadeCamera->setFar(back + radius);
+            cascadeCamera->setResolution(entry.rects[c].z, entry.rects[c].w);
+
+            const auto &current = entry.cameras[c];
+            if(current
+               && current->getViewMatrix() == cascadeCamera->getViewMatrix()
+               && current->getProjection() == cascadeCamera->getProjection())
+                continue;
+
+            entry.cameras[c] = cascadeCamera;
+            pass->setViewportCamera(entry.firstViewport + c, cascadeCamera);
+            changed = true;
+        }
+    }
+    if(changed) ++_version;
+}
+
+RenderPass* ShadowMappingRenderBlock::getAtlasPass() const
+{
+    return _atlasPass;
+}
+
+Texture2D* ShadowMappingRenderBlock::getAtlasTexture() const
+{
+    return _atlasPass->getOutDepthTexture();
+}
+
+unsigned ShadowMappingRenderBlock::getVersion() const
+{
+    return _version;
+}
+
+bool ShadowMappingRenderBlock::getShadowMap(const LightPtr &light, ShadowMap *shadowMap) const
+{
+    std::lock_guard<std::mutex> lock(_shadowLock);
+    auto it = std::find_if(begin(_entries), end(_entries), [&light](const ShadowEntry &entry) {
+                               return entry.light == light;
+                           });
+    if(it == end(_entries)) return false;
+
+    glm::vec2 atlasSize(_atlasSize);
+    shadowMap->matrices.clear();
+    shadowMap->regions.clear();
+    shadowMap->splits = it->splits;
+    for(int c = 0; c < it->cascades; ++c) {
+        if(!it->cameras[c]) return false;
+
+        //map the lights clip space into its region of the atlas
+        glm::vec2 offset = glm::vec2(it->rects[c].x, it->rects[c].y) / atlasSize;
+        glm::vec2 scale = glm::vec2(it->rects[c].z, it->rects[c].w) / atlasSize;
+        glm::vec2 ndcOffset = (offset + scale * .5f) * 2.f - 1.f;
+        glm::mat4 atlasMatrix = glm::translate(glm::mat4(), glm::vec3(ndcOffset, 0))
+            * glm::scale(glm::mat4(), glm::vec3(scale, 1));
+
+        const auto &camera = it->cameras[c];
+        shadowMap->matrices.push_back(atlasMatrix * camera->getProjection() * camera->getViewMatrix());
+        shadowMap->regions.push_back(glm::vec4(offset, scale));
+    }
+    return true;
 }
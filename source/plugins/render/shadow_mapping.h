@@ -1,14 +1,32 @@
 #ifndef MT_GL_SHADOW_MAPPING_H
 #define MT_GL_SHADOW_MAPPING_H
 
-#include "render_block.h"
+#include "mutex"
+#include "atomic"
+#include "unordered_map"
 
-class SpotLight;
+#include "render_block.h"
+#include "scene_bvh.h"
+#include "../datatypes/Object/lights.h"
 
 namespace MindTree {
 namespace GL {
 
 class ShaderRenderNode;
+
+//location of a lights shadow map(s) inside the shadow atlas
+struct ShadowMap {
+    //atlas space shadow matrix and uv region (offset, scale) per cascade,
+    //spot lights always have exactly one
+    std::vector<glm::mat4> matrices;
+    std::vector<glm::vec4> regions;
+    //far view depth of every cascade
+    std::vector<float> splits;
+};
+
+//renders the shadow maps of all lights into a single depth atlas, each light
+//gets its own viewport, which is only redrawn when the light or the geometry
+//inside its frustum changed
 class ShadowMappingRenderBlock : public RenderBlock
 {
 public:
@@ -16,16 +34,64 @@ public:
     void init() override;
 
     void setGeometry(std::shared_ptr<Group> grp) override;
-    std::unordered_map<std::shared_ptr<Light>, RenderPass*> getShadowPasses() const;
+
+    RenderPass* getAtlasPass() const;
+    Texture2D* getAtlasTexture() const;
+    bool getShadowMap(const LightPtr &light, ShadowMap *shadowMap) const;
+
+    //changes whenever the shadow matrices change
+    unsigned getVersion() const;
+
+    static const int MAX_CASCADES = 4;
 
 protected:
     virtual void addRendererFromLight(std::shared_ptr<Light> obj) override;
     void addRendererFromObject(std::shared_ptr<GeoObject> obj) override;
-    virtual RenderPass* createShadowPass(std::shared_ptr<SpotLight> spot);
+
+    RenderPass *_atlasPass;
+    //shadow maps get by with coarser geometry than the camera view
+    int _lodBias;
 
 private:
-    std::unordered_map<std::shared_ptr<Light>, RenderPass*> _shadowPasses;
+    struct ShadowEntry {
+        LightPtr light;
+        glm::mat4 transformation;
+        glm::ivec2 size;
+        double near, far, coneangle;
+        int cascades;
+        std::vector<CameraPtr> cameras;
+        std::vector<glm::ivec4> rects;
+        std::vector<float> splits;
+        std::vector<bool> dirty;
+        size_t firstViewport;
+    };
+
+    struct CasterEntry {
+        std::shared_ptr<ObjectData> data;
+        MaterialInstancePtr material;
+        glm::mat4 transformation;
+    };
+
+    bool isSameLight(const ShadowEntry &a, const ShadowEntry &b) const;
+    CameraPtr createSpotCamera(const ShadowEntry &entry) const;
+    void layoutAtlas(std::vector<ShadowEntry> &entries);
+    void invalidateCasters(const std::vector<CasterEntry> &casters, std::vector<ShadowEntry> &entries);
+    void updateViewports();
+    void updateCascades(RenderPass *pass);
+
+    glm::ivec2 _atlasSize;
+    int _maxAtlasSize;
+    mutable std::mutex _shadowLock;
+    std::vector<ShadowEntry> _entries;
+    std::vector<ShadowEntry> _newEntries;
+    std::vector<CasterEntry> _casters;
+    std::vector<CasterEntry> _newCasters;
     std::shared_ptr<ShaderRenderNode> _shadowNode;
+    CameraPtr _atlasCamera;
+
+    bool _cascadesDirty;
+    glm::mat4 _lastView, _lastProjection;
+    std::atomic<unsigned> _version;
 };
 
 }
@@ -0,0 +1,83 @@
+#include "algorithm"
+
+#include "temporal_accumulation.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+TemporalAccumulationPlane::TemporalAccumulationPlane(int maxFrames) :
+    PixelPlane("../plugins/render/defaultShaders/temporal_accumulation.frag"),
+    _maxFrames(std::max(maxFrames, 1)),
+    _accumulatedFrames(0)
+{
+}
+
+void TemporalAccumulationPlane::setMaxFrames(int frames)
+{
+    _maxFrames = std::max(frames, 1);
+}
+
+void TemporalAccumulationPlane::reset()
+{
+    _accumulatedFrames = 0;
+}
+
+bool TemporalAccumulationPlane::isConverged() const
+{
+    return _accumulatedFrames >= _maxFrames;
+}
+
+void TemporalAccumulationPlane::init(ShaderProgram *program)
+{
+    PixelPlane::init(program);
+    _history = make_resource<Texture2D>(getResourceManager(),
+                                        "history",
+                                        Texture::RGBA16F);
+    _history->setFilter(Texture::LINEAR);
+    _history->setWrapMode(Texture::CLAMP_TO_EDGE);
+}
+
+void TemporalAccumulationPlane::draw(const CameraPtr &camera,
+                                     const RenderConfig& /* config */,
+                                     ShaderProgram *program)
+{
+    //the pass may render at a fraction of the camera resolution
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int width = viewport[2];
+    int height = viewport[3];
+    if(!_history->isInitialized() || _history->width() != width || _history->height() != height) {
+        _history->setWidth(width);
+        _history->setHeight(height);
+        _history->init();
+        _accumulatedFrames = 0;
+    }
+
+    int frames = std::min(_accumulatedFrames.load(), _maxFrames.load());
+    glm::mat4 viewProjection = camera->getProjection() * camera->getViewMatrix();
+
+    program->setTexture(_history.get(), "history");
+    {
+        UniformStateManager states(program);
+        states.addState("previousViewProjection", _previousViewProjection);
+        states.addState("previousCameraPosition", _previousCameraPosition);
+        states.addState("hasHistory", static_cast<int>(frames > 0));
+        //running average until the history holds maxFrames, after that
+        //an exponential one
+        states.addState("blend", 1. / (frames + 1));
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        MTGLERROR;
+    }
+
+    //the second output becomes the history of the next frame
+    glReadBuffer(GL_COLOR_ATTACHMENT1);
+    _history->bind();
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+    MTGLERROR;
+    _history->release();
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+    _previousViewProjection = viewProjection;
+    _previousCameraPosition = camera->getPosition();
+    _accumulatedFrames = std::min(frames + 1, _maxFrames.load());
+}
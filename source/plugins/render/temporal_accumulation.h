@@ -0,0 +1,39 @@
+#ifndef MT_GL_TEMPORAL_ACCUMULATION_H
+#define MT_GL_TEMPORAL_ACCUMULATION_H
+
+#include "pixel_plane.h"
+
+namespace MindTree {
+namespace GL {
+
+//averages a noisy input over the last frames. The history is reprojected
+//with the world position, so it survives camera moves and only disoccluded
+//pixels start over. The pass needs two outputs, the accumulated value and
+//"accumulated_history", which also carries the distance to the camera
+class TemporalAccumulationPlane : public PixelPlane
+{
+public:
+    TemporalAccumulationPlane(int maxFrames=16);
+
+    void setMaxFrames(int frames);
+    //throw the history away, e.g. when the input changed
+    void reset();
+    //the history holds maxFrames, more frames do not improve it
+    bool isConverged() const;
+
+protected:
+    void init(ShaderProgram *program) override;
+    void draw(const CameraPtr &camera, const RenderConfig &config, ShaderProgram *program) override;
+
+private:
+    ResourceHandle<Texture2D> _history;
+    glm::mat4 _previousViewProjection;
+    glm::vec3 _previousCameraPosition;
+    std::atomic<int> _maxFrames;
+    std::atomic<int> _accumulatedFrames;
+};
+
+}
+}
+
+#endif
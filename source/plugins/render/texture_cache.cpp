@@ -0,0 +1,267 @@
+#include "cstring"
+#include "sys/stat.h"
+
+#include "texture_cache.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+namespace {
+    //bytes that are copied per frame, a 4k rgba8 texture with all of its
+    //levels takes about ten frames
+    const size_t UPLOAD_BUDGET = 8 << 20;
+    const size_t BUFFER_SIZE = 4 << 20;
+    const size_t BUFFER_COUNT = 3;
+
+    //how often the images are checked for changes on disk
+    const std::chrono::seconds CHECK_INTERVAL(1);
+
+    //frames a texture is kept without being asked for
+    const uint64_t UNUSED_FRAMES = 120;
+
+    bool statFile(const std::string &filename, uint64_t &size, int64_t &time)
+    {
+        struct stat info;
+        if(stat(filename.c_str(), &info) != 0) {
+            size = 0;
+            time = 0;
+            return false;
+        }
+        size = info.st_size;
+        time = info.st_mtime;
+        return true;
+    }
+}
+
+TextureCache::TextureCache(ResourceManager *manager) :
+    _nextBuffer(0),
+    _lastCheck(std::chrono::steady_clock::now()),
+    _frame(0),
+    _ready(std::make_shared<ReadyCallback>()),
+    manager_(manager)
+{
+}
+
+TextureCache::~TextureCache()
+{
+    //waits for a callback that is running right now
+    setReadyCallback(nullptr);
+}
+
+void TextureCache::setReadyCallback(std::function<void()> cb)
+{
+    std::lock_guard<std::mutex> lock(_ready->lock);
+    _ready->callback = cb;
+}
+
+TextureLoader::Future TextureCache::request(const std::string &filename)
+{
+    std::weak_ptr<ReadyCallback> weakReady = _ready;
+    return TextureLoader::request(filename, [weakReady] {
+        auto ready = weakReady.lock();
+        if(!ready) return;
+
+        std::lock_guard<std::mutex> lock(ready->lock);
+        if(ready->callback) ready->callback();
+    });
+}
+
+Texture2D* TextureCache::getTexture(const std::string &filename)
+{
+    auto it = _entries.find(filename);
+    if(it == end(_entries)) {
+        Entry entry;
+        statFile(filename, entry.sourceSize, entry.sourceTime);
+        entry.future = request(filename);
+        entry.level = -1;
+        entry.tile = 0;
+        entry.visible = false;
+        it = _entries.emplace(filename, std::move(entry)).first;
+    }
+
+    Entry &entry = it->second;
+    entry.used = _frame;
+    return entry.visible ? entry.texture.get() : nullptr;
+}
+
+bool TextureCache::isUploading() const
+{
+    for(const auto &pair : _entries) {
+        const Entry &entry = pair.second;
+        if(entry.image && entry.level >= 0)
+            return true;
+    }
+    return false;
+}
+
+void TextureCache::checkForChanges()
+{
+    auto now = std::chrono::steady_clock::now();
+    if(now - _lastCheck < CHECK_INTERVAL) return;
+    _lastCheck = now;
+
+    for(auto &pair : _entries) {
+        Entry &entry = pair.second;
+        if(entry.future.valid()) continue;
+
+        uint64_t size;
+        int64_t time;
+        statFile(pair.first, size, time);
+        if(size == entry.sourceSize && time == entry.sourceTime) continue;
+
+        //the old texture is shown while the new one is decoded
+        entry.sourceSize = size;
+        entry.sourceTime = time;
+        entry.future = request(pair.first);
+    }
+}
+
+bool TextureCache::update()
+{
+    //materials that were removed or changed do not ask for their textures
+    //anymore
+    ++_frame;
+    for(auto it = begin(_entries); it != end(_entries);) {
+        if(_frame - it->second.used > UNUSED_FRAMES) it = _entries.erase(it);
+        else ++it;
+    }
+
+    if(_entries.empty()) return false;
+    checkForChanges();
+
+    for(auto &pair : _entries) {
+        Entry &entry = pair.second;
+        if(!entry.future.valid()
+           || entry.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+
+        TextureImagePtr image = entry.future.get();
+        entry.future = TextureLoader::Future();
+        if(!image) continue;
+
+        Texture::Format format = image->getPixelType() == TextureImage::RGBA16F
+            ? Texture::RGBA16F
+            : Texture::SRGB8_ALPHA8;
+        auto texture = make_resource<Texture2D>(manager_, pair.first, format);
+        texture->setWidth(image->getWidth());
+        texture->setHeight(image->getHeight());
+        texture->setWrapMode(Texture::REPEAT);
+        texture->setFilter(Texture::LINEAR_MIPMAP);
+        texture->initLevels(image->getLevelCount());
+        texture->release();
+
+        //a reloaded texture is hidden until its smallest level is there,
+        //which is within this frame unless the buffers are busy
+        entry.image = image;
+        entry.level = image->getLevelCount() - 1;
+        entry.tile = 0;
+        entry.visible = false;
+        entry.texture = std::move(texture);
+        entry.texture->setBaseLevel(entry.level);
+    }
+
+    bool changed = false;
+    size_t budget = UPLOAD_BUDGET;
+    while(uploadTiles(budget))
+        changed = true;
+    return changed;
+}
+
+bool TextureCache::uploadTiles(size_t &budget)
+{
+    if(_buffers.empty()) {
+        for(size_t i = 0; i < BUFFER_COUNT; ++i) {
+            _buffers.push_back(make_resource<UploadPBO>(manager_));
+            _buffers.back()->allocate(BUFFER_SIZE);
+        }
+    }
+
+    //a buffer the copies are still reading from is skipped this frame
+    //instead of waiting for it
+    UploadPBO *buffer = _buffers[_nextBuffer].get();
+    if(!buffer->isReady()) return false;
+
+    struct Copy {
+        Entry *entry;
+        int level;
+        TextureImage::Tile tile;
+        size_t offset;
+    };
+
+    std::vector<Copy> copies;
+    size_t used = 0;
+    size_t limit = std::min(budget, BUFFER_SIZE);
+    for(auto &pair : _entries) {
+        Entry &entry = pair.second;
+        while(entry.image && entry.level >= 0) {
+            auto tile = entry.image->getTile(entry.level, entry.tile);
+            if(used + tile.size > limit) break;
+
+            copies.push_back({&entry, entry.level, tile, used});
+            used += tile.size;
+            if(++entry.tile == entry.image->getTileCount(entry.level)) {
+                entry.tile = 0;
+                --entry.level;
+            }
+        }
+        if(used >= limit) break;
+    }
+    if(copies.empty()) return false;
+
+    buffer->bind();
+    char *data = static_cast<char*>(buffer->map());
+    if(data) {
+        for(const auto &copy : copies)
+            memcpy(data + copy.offset, copy.tile.data, copy.tile.size);
+    }
+
+    //the content of a buffer whose mapping got lost is undefined, the
+    //textures start over
+    if(!data || !buffer->unmap()) {
+        buffer->release();
+        for(const auto &copy : copies) {
+            copy.entry->level = copy.entry->image->getLevelCount() - 1;
+            copy.entry->tile = 0;
+        }
+        return false;
+    }
+
+    Texture2D *bound = nullptr;
+    for(const auto &copy : copies) {
+        Texture2D *texture = copy.entry->texture.get();
+        if(texture != bound) {
+            texture->bind();
+            bound = texture;
+        }
+        GLenum type = copy.entry->image->getPixelType() == TextureImage::RGBA16F
+            ? GL_HALF_FLOAT
+            : GL_UNSIGNED_BYTE;
+        texture->subImage(copy.level,
+                          copy.tile.x,
+                          copy.tile.y,
+                          copy.tile.width,
+                          copy.tile.height,
+                          type,
+                          reinterpret_cast<const void*>(copy.offset));
+    }
+    if(bound) bound->release();
+    buffer->release();
+    buffer->fence();
+    _nextBuffer = (_nextBuffer + 1) % _buffers.size();
+    budget -= used;
+
+    //every level above the one that is being filled is complete
+    for(const auto &copy : copies) {
+        Entry &entry = *copy.entry;
+        if(!entry.image) continue;
+
+        int levels = entry.image->getLevelCount();
+        if(entry.level + 1 < levels) {
+            entry.texture->setBaseLevel(entry.level + 1);
+            entry.visible = true;
+        }
+        //the gpu has its own copy, the image is not needed anymore
+        if(entry.level < 0) entry.image.reset();
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef MT_GL_TEXTURE_CACHE_H
+#define MT_GL_TEXTURE_CACHE_H
+
+#include "string"
+#include "unordered_map"
+#include "chrono"
+#include "mutex"
+#include "functional"
+#include "resource_handling.h"
+#include "texture_loader.h"
+
+namespace MindTree {
+namespace GL {
+
+//textures of image files for one context. Images are loaded in the
+//background, their tiles are copied through a ring of pixel unpack buffers
+//within a budget per frame, smallest levels first. A texture can be
+//sampled as soon as its smallest level is there, finer levels are added
+//while it is in use. Textures that were not asked for in a while are
+//dropped
+class TextureCache
+{
+public:
+    TextureCache(ResourceManager *manager);
+    ~TextureCache();
+
+    //nullptr while the image is loading or if it could not be read
+    Texture2D* getTexture(const std::string &filename);
+
+    //uploads what fits into this frame, true if a texture changed
+    bool update();
+
+    //true while tiles are waiting for their upload
+    bool isUploading() const;
+
+    //called from the loading threads when an image is decoded, so a frame
+    //can pick it up
+    void setReadyCallback(std::function<void()> cb);
+
+private:
+    struct Entry {
+        TextureLoader::Future future;
+        TextureImagePtr image;
+        ResourceHandle<Texture2D> texture;
+        //the next tile to upload
+        int level;
+        int tile;
+        bool visible;
+        uint64_t sourceSize;
+        int64_t sourceTime;
+        //the last frame the texture was asked for
+        uint64_t used;
+    };
+
+    struct ReadyCallback {
+        std::mutex lock;
+        std::function<void()> callback;
+    };
+
+    TextureLoader::Future request(const std::string &filename);
+
+    bool uploadTiles(size_t &budget);
+    void checkForChanges();
+
+    std::unordered_map<std::string, Entry> _entries;
+    std::vector<ResourceHandle<UploadPBO>> _buffers;
+    size_t _nextBuffer;
+    std::chrono::steady_clock::time_point _lastCheck;
+    uint64_t _frame;
+    std::shared_ptr<ReadyCallback> _ready;
+    ResourceManager *manager_;
+};
+
+}
+}
+
+#endif
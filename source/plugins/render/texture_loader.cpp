@@ -0,0 +1,846 @@
+#include "cstdio"
+#include "csetjmp"
+#include "cstring"
+#include "cmath"
+#include "algorithm"
+#include "functional"
+#include "iostream"
+#include "map"
+#include "mutex"
+#include "climits"
+#include "cstdlib"
+#include "sys/stat.h"
+#include "unistd.h"
+#include "glm/gtc/packing.hpp"
+#include "data/io.h"
+#include "data/thread_pool.h"
+
+#ifdef MT_WITH_PNG
+#include "png.h"
+#endif
+
+#ifdef MT_WITH_JPEG
+extern "C" {
+#include "jpeglib.h"
+}
+#endif
+
+#ifdef MT_WITH_OPENEXR
+#include "ImfRgbaFile.h"
+#endif
+
+#include "texture_loader.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+namespace {
+    const double PI = 3.14159265358979323846;
+
+    //in pixels of the smaller level, kaiser parameters as in most texture
+    //tools
+    const double KAISER_WIDTH = 3;
+    const double KAISER_ALPHA = 4;
+
+    const uint32_t MAX_LEVELS = 32;
+
+    struct SRGBTables {
+        float toLinear[256];
+        unsigned char fromLinear[4096];
+
+        SRGBTables()
+        {
+            for(int i = 0; i < 256; ++i) {
+                double c = i / 255.;
+                toLinear[i] = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+            }
+            for(int i = 0; i < 4096; ++i) {
+                double l = i / 4095.;
+                double c = l <= 0.0031308 ? l * 12.92 : 1.055 * std::pow(l, 1 / 2.4) - 0.055;
+                fromLinear[i] = static_cast<unsigned char>(std::min(c, 1.) * 255 + .5);
+            }
+        }
+    };
+
+    const SRGBTables& srgb()
+    {
+        static SRGBTables tables;
+        return tables;
+    }
+
+    size_t pixelSize(TextureImage::PixelType type)
+    {
+        return type == TextureImage::RGBA16F ? 4 * sizeof(uint16_t) : 4;
+    }
+
+    //source pixels and their weights for every pixel of a downsampled row
+    struct Taps {
+        int stride;
+        std::vector<int> first;
+        std::vector<int> count;
+        std::vector<float> weights;
+    };
+
+    double besselI0(double x)
+    {
+        double sum = 1, term = 1;
+        for(int k = 1; k < 32; ++k) {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+            if(term < sum * 1e-12) break;
+        }
+        return sum;
+    }
+
+    double kaiser(double x)
+    {
+        if(std::abs(x) >= KAISER_WIDTH) return 0;
+        double t = x / KAISER_WIDTH;
+        double sinc = x == 0 ? 1 : std::sin(PI * x) / (PI * x);
+        return sinc * besselI0(KAISER_ALPHA * std::sqrt(1 - t * t)) / besselI0(KAISER_ALPHA);
+    }
+
+    //pixels outside of the image repeat the border
+    Taps computeTaps(int size, int dstSize, TextureImage::Filter filter)
+    {
+        double scale = double(size) / dstSize;
+        double support = filter == TextureImage::BOX ? scale / 2 : KAISER_WIDTH * scale;
+
+        Taps taps;
+        taps.stride = int(std::ceil(2 * support)) + 2;
+        taps.first.resize(dstSize);
+        taps.count.resize(dstSize);
+        taps.weights.resize(size_t(dstSize) * taps.stride, 0);
+
+        std::vector<double> weights;
+        for(int i = 0; i < dstSize; ++i) {
+            double center = (i + .5) * scale;
+            int first = int(std::floor(center - support));
+            int last = int(std::ceil(center + support));
+            int lo = std::max(first, 0);
+            int hi = std::min(last - 1, size - 1);
+            lo = std::min(lo, hi);
+
+            weights.assign(hi - lo + 1, 0);
+            double sum = 0;
+            for(int j = first; j < last; ++j) {
+                double weight;
+                if(filter == TextureImage::BOX)
+                    weight = std::max(0., std::min(j + 1., center + support)
+                                      - std::max(double(j), center - support));
+                else
+                    weight = kaiser((j + .5 - center) / scale);
+                weights[std::min(std::max(j, lo), hi) - lo] += weight;
+                sum += weight;
+            }
+
+            taps.first[i] = lo;
+            taps.count[i] = hi - lo + 1;
+            float *dst = &taps.weights[size_t(i) * taps.stride];
+            for(size_t j = 0; j < weights.size(); ++j)
+                dst[j] = sum != 0 ? weights[j] / sum : 1. / weights.size();
+        }
+        return taps;
+    }
+
+    //filtering happens on linear, premultiplied values, so dark fringes do
+    //not bleed in from transparent pixels
+    void loadRow(const char *src, int width, TextureImage::PixelType type, float *out)
+    {
+        if(type == TextureImage::RGBA8) {
+            const float *toLinear = srgb().toLinear;
+            const unsigned char *p = reinterpret_cast<const unsigned char*>(src);
+            for(int x = 0; x < width; ++x, p += 4, out += 4) {
+                float alpha = p[3] / 255.f;
+                out[0] = toLinear[p[0]] * alpha;
+                out[1] = toLinear[p[1]] * alpha;
+                out[2] = toLinear[p[2]] * alpha;
+                out[3] = alpha;
+            }
+            return;
+        }
+
+        const uint16_t *p = reinterpret_cast<const uint16_t*>(src);
+        for(int x = 0; x < width; ++x, p += 4, out += 4) {
+            float alpha = glm::unpackHalf1x16(p[3]);
+            for(int c = 0; c < 3; ++c)
+                out[c] = glm::unpackHalf1x16(p[c]) * alpha;
+            out[3] = alpha;
+        }
+    }
+
+    //the negative lobes of the kaiser filter can ring below zero
+    void storeRow(const float *in, int width, TextureImage::PixelType type, char *dst)
+    {
+        if(type == TextureImage::RGBA8) {
+            const unsigned char *fromLinear = srgb().fromLinear;
+            unsigned char *p = reinterpret_cast<unsigned char*>(dst);
+            for(int x = 0; x < width; ++x, p += 4, in += 4) {
+                float alpha = std::min(std::max(in[3], 0.f), 1.f);
+                float inv = alpha > 0 ? 1 / alpha : 0;
+                for(int c = 0; c < 3; ++c) {
+                    float value = std::min(std::max(in[c] * inv, 0.f), 1.f);
+                    p[c] = fromLinear[int(value * 4095 + .5f)];
+                }
+                p[3] = static_cast<unsigned char>(alpha * 255 + .5f);
+            }
+            return;
+        }
+
+        uint16_t *p = reinterpret_cast<uint16_t*>(dst);
+        for(int x = 0; x < width; ++x, p += 4, in += 4) {
+            float alpha = std::max(in[3], 0.f);
+            float inv = alpha > 0 ? 1 / alpha : 0;
+            for(int c = 0; c < 3; ++c)
+                p[c] = glm::packHalf1x16(std::max(in[c] * inv, 0.f));
+            p[3] = glm::packHalf1x16(alpha);
+        }
+    }
+
+    void filterRow(const float *line, const Taps &taps, int dstWidth, float *out)
+    {
+        for(int x = 0; x < dstWidth; ++x, out += 4) {
+            const float *weights = &taps.weights[size_t(x) * taps.stride];
+            const float *src = line + size_t(taps.first[x]) * 4;
+            float sum[4] = {0, 0, 0, 0};
+            for(int t = 0; t < taps.count[x]; ++t, src += 4)
+                for(int c = 0; c < 4; ++c)
+                    sum[c] += weights[t] * src[c];
+            for(int c = 0; c < 4; ++c)
+                out[c] = sum[c];
+        }
+    }
+
+    //separable, every source row is filtered horizontally once and kept in
+    //a ring while the rows of the smaller level that use it are summed up.
+    //The inner loops run over plain float arrays, so they get vectorized
+    std::vector<char> downsample(const std::vector<char> &src,
+                                 int width,
+                                 int height,
+                                 int dstWidth,
+                                 int dstHeight,
+                                 TextureImage::PixelType type,
+                                 TextureImage::Filter filter)
+    {
+        size_t ps = pixelSize(type);
+        Taps horizontal = computeTaps(width, dstWidth, filter);
+        Taps vertical = computeTaps(height, dstHeight, filter);
+
+        int ringSize = vertical.stride;
+        size_t rowFloats = size_t(dstWidth) * 4;
+        std::vector<float> ring(ringSize * rowFloats);
+        std::vector<int> ringRows(ringSize, -1);
+        std::vector<float> line(size_t(width) * 4);
+        std::vector<float> sum(rowFloats);
+        std::vector<char> dst(size_t(dstWidth) * dstHeight * ps);
+
+        for(int y = 0; y < dstHeight; ++y) {
+            std::fill(begin(sum), end(sum), 0.f);
+            const float *weights = &vertical.weights[size_t(y) * vertical.stride];
+            for(int t = 0; t < vertical.count[y]; ++t) {
+                int row = vertical.first[y] + t;
+                int slot = row % ringSize;
+                float *filtered = &ring[slot * rowFloats];
+                if(ringRows[slot] != row) {
+                    loadRow(&src[size_t(row) * width * ps], width, type, line.data());
+                    filterRow(line.data(), horizontal, dstWidth, filtered);
+                    ringRows[slot] = row;
+                }
+
+                float weight = weights[t];
+                float *s = sum.data();
+                for(size_t i = 0; i < rowFloats; ++i)
+                    s[i] += weight * filtered[i];
+            }
+            storeRow(sum.data(), dstWidth, type, &dst[size_t(y) * dstWidth * ps]);
+        }
+        return dst;
+    }
+
+    void appendTiles(const std::vector<char> &level, int width, int height, size_t ps, std::vector<char> &out)
+    {
+        const int T = TextureImage::TILE_SIZE;
+        for(int ty = 0; ty < height; ty += T) {
+            int th = std::min(T, height - ty);
+            for(int tx = 0; tx < width; tx += T) {
+                int tw = std::min(T, width - tx);
+                for(int y = ty; y < ty + th; ++y) {
+                    const char *row = &level[(size_t(y) * width + tx) * ps];
+                    out.insert(out.end(), row, row + tw * ps);
+                }
+            }
+        }
+    }
+
+    struct Decoded {
+        int width = 0;
+        int height = 0;
+        TextureImage::PixelType type = TextureImage::RGBA8;
+        std::vector<char> pixels;
+    };
+
+    //expands gray, gray alpha and rgb rows that come top down
+    void setRow(Decoded &image, int y, const unsigned char *src, int channels)
+    {
+        unsigned char *dst = reinterpret_cast<unsigned char*>(&image.pixels[size_t(image.height - 1 - y) * image.width * 4]);
+        for(int x = 0; x < image.width; ++x, src += channels, dst += 4) {
+            bool gray = channels < 3;
+            dst[0] = src[0];
+            dst[1] = gray ? src[0] : src[1];
+            dst[2] = gray ? src[0] : src[2];
+            dst[3] = channels == 2 ? src[1] : channels == 4 ? src[3] : 255;
+        }
+    }
+
+#ifdef MT_WITH_PNG
+    bool readPNG(FILE *file, Decoded &image)
+    {
+        png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+        png_infop info = png ? png_create_info_struct(png) : nullptr;
+        if(!png || !info || setjmp(png_jmpbuf(png))) {
+            png_destroy_read_struct(&png, &info, nullptr);
+            return false;
+        }
+
+        png_init_io(png, file);
+        png_read_info(png, info);
+        //palettes, low bit depths and transparency chunks all become rgba8
+        png_set_expand(png);
+        png_set_strip_16(png);
+        png_set_gray_to_rgb(png);
+        png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+        png_set_interlace_handling(png);
+        png_read_update_info(png, info);
+
+        image.width = png_get_image_width(png, info);
+        image.height = png_get_image_height(png, info);
+        image.pixels.resize(size_t(image.width) * image.height * 4);
+        std::vector<png_bytep> rows(image.height);
+        for(int y = 0; y < image.height; ++y)
+            rows[y] = reinterpret_cast<png_bytep>(&image.pixels[size_t(image.height - 1 - y) * image.width * 4]);
+        png_read_image(png, rows.data());
+        png_read_end(png, nullptr);
+        png_destroy_read_struct(&png, &info, nullptr);
+        return true;
+    }
+#endif
+
+#ifdef MT_WITH_JPEG
+    struct JPEGError {
+        jpeg_error_mgr manager;
+        jmp_buf jump;
+    };
+
+    void exitJPEG(j_common_ptr info)
+    {
+        (*info->err->output_message)(info);
+        longjmp(reinterpret_cast<JPEGError*>(info->err)->jump, 1);
+    }
+
+    bool readJPEG(FILE *file, Decoded &image)
+    {
+        jpeg_decompress_struct info;
+        JPEGError error;
+        info.err = jpeg_std_error(&error.manager);
+        error.manager.error_exit = exitJPEG;
+        if(setjmp(error.jump)) {
+            jpeg_destroy_decompress(&info);
+            return false;
+        }
+
+        jpeg_create_decompress(&info);
+        jpeg_stdio_src(&info, file);
+        jpeg_read_header(&info, TRUE);
+        info.out_color_space = JCS_RGB;
+        jpeg_start_decompress(&info);
+
+        image.width = info.output_width;
+        image.height = info.output_height;
+        image.pixels.resize(size_t(image.width) * image.height * 4);
+        std::vector<unsigned char> line(size_t(image.width) * info.output_components);
+        while(info.output_scanline < info.output_height) {
+            int y = info.output_scanline;
+            JSAMPROW row = line.data();
+            jpeg_read_scanlines(&info, &row, 1);
+            setRow(image, y, line.data(), info.output_components);
+        }
+        jpeg_finish_decompress(&info);
+        jpeg_destroy_decompress(&info);
+        return true;
+    }
+#endif
+
+#ifdef MT_WITH_OPENEXR
+    bool readEXR(const std::string &filename, Decoded &image)
+    {
+        try {
+            Imf::RgbaInputFile file(filename.c_str());
+            auto window = file.dataWindow();
+            image.width = window.max.x - window.min.x + 1;
+            image.height = window.max.y - window.min.y + 1;
+            image.type = TextureImage::RGBA16F;
+
+            std::vector<Imf::Rgba> pixels(size_t(image.width) * image.height);
+            file.setFrameBuffer(pixels.data() - window.min.x - size_t(window.min.y) * image.width,
+                                1,
+                                image.width);
+            file.readPixels(window.min.y, window.max.y);
+
+            image.pixels.resize(pixels.size() * 4 * sizeof(uint16_t));
+            uint16_t *dst = reinterpret_cast<uint16_t*>(image.pixels.data());
+            for(int y = 0; y < image.height; ++y) {
+                const Imf::Rgba *src = &pixels[size_t(image.height - 1 - y) * image.width];
+                for(int x = 0; x < image.width; ++x, dst += 4) {
+                    dst[0] = src[x].r.bits();
+                    dst[1] = src[x].g.bits();
+                    dst[2] = src[x].b.bits();
+                    dst[3] = src[x].a.bits();
+                }
+            }
+        } catch(const std::exception &e) {
+            std::cout << "could not read " << filename << ": " << e.what() << std::endl;
+            return false;
+        }
+        return true;
+    }
+#endif
+
+    //whitespace separated numbers of a ppm header, comments are skipped
+    bool readNumber(FILE *file, int &value)
+    {
+        int c = fgetc(file);
+        while(c != EOF && (isspace(c) || c == '#')) {
+            if(c == '#')
+                while(c != EOF && c != '\n') c = fgetc(file);
+            c = fgetc(file);
+        }
+        if(!isdigit(c)) return false;
+
+        value = 0;
+        while(isdigit(c)) {
+            value = value * 10 + (c - '0');
+            c = fgetc(file);
+        }
+        //exactly one whitespace follows the last number of the header
+        return c != EOF;
+    }
+
+    bool readNetpbm(FILE *file, Decoded &image)
+    {
+        char magic[3] = {0, 0, 0};
+        if(fread(magic, 1, 2, file) != 2) return false;
+
+        int channels = 3, maxval = 0;
+        if(magic[1] == '6') {
+            if(!readNumber(file, image.width)
+               || !readNumber(file, image.height)
+               || !readNumber(file, maxval))
+                return false;
+        }
+        else {
+            char line[256];
+            while(fgets(line, sizeof(line), file) && strncmp(line, "ENDHDR", 6)) {
+                char key[32];
+                int value;
+                if(sscanf(line, "%31s %d", key, &value) != 2) continue;
+                if(!strcmp(key, "WIDTH")) image.width = value;
+                else if(!strcmp(key, "HEIGHT")) image.height = value;
+                else if(!strcmp(key, "DEPTH")) channels = value;
+                else if(!strcmp(key, "MAXVAL")) maxval = value;
+            }
+        }
+        if(maxval != 255 || channels < 1 || channels > 4
+           || image.width <= 0 || image.height <= 0)
+            return false;
+
+        image.pixels.resize(size_t(image.width) * image.height * 4);
+        std::vector<unsigned char> line(size_t(image.width) * channels);
+        for(int y = 0; y < image.height; ++y) {
+            if(fread(line.data(), 1, line.size(), file) != line.size()) return false;
+            setRow(image, y, line.data(), channels);
+        }
+        return true;
+    }
+
+    uint64_t hash(const std::string &str)
+    {
+        uint64_t h = 14695981039346656037ull;
+        for(unsigned char c : str) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    //guarded by requestLock
+    struct Waiting {
+        bool loaded{false};
+        std::vector<std::function<void()>> callbacks;
+    };
+
+    struct Request {
+        uint64_t size;
+        int64_t time;
+        TextureLoader::Future image;
+        std::shared_ptr<Waiting> waiting;
+    };
+
+    std::mutex requestLock;
+    std::map<std::string, Request> requests;
+}
+
+const int TextureImage::TILE_SIZE;
+
+TextureImage::TextureImage() :
+    _type(RGBA8),
+    _filter(KAISER),
+    _sourceSize(0),
+    _sourceTime(0),
+    _begin(nullptr),
+    _size(0)
+{
+}
+
+TextureImage::~TextureImage()
+{
+}
+
+TextureImage::PixelType TextureImage::getPixelType() const
+{
+    return _type;
+}
+
+TextureImage::Filter TextureImage::getFilter() const
+{
+    return _filter;
+}
+
+size_t TextureImage::getPixelSize() const
+{
+    return pixelSize(_type);
+}
+
+int TextureImage::getWidth() const
+{
+    return _levels.empty() ? 0 : _levels[0].width;
+}
+
+int TextureImage::getHeight() const
+{
+    return _levels.empty() ? 0 : _levels[0].height;
+}
+
+int TextureImage::getLevelCount() const
+{
+    return _levels.size();
+}
+
+const TextureImage::Level& TextureImage::getLevel(int level) const
+{
+    return _levels[level];
+}
+
+int TextureImage::getTileCount(int level) const
+{
+    const Level &l = _levels[level];
+    return ((l.width + TILE_SIZE - 1) / TILE_SIZE) * ((l.height + TILE_SIZE - 1) / TILE_SIZE);
+}
+
+TextureImage::Tile TextureImage::getTile(int level, int index) const
+{
+    const Level &l = _levels[level];
+    int tilesX = (l.width + TILE_SIZE - 1) / TILE_SIZE;
+
+    Tile tile;
+    tile.x = (index % tilesX) * TILE_SIZE;
+    tile.y = (index / tilesX) * TILE_SIZE;
+    tile.width = std::min(TILE_SIZE, l.width - tile.x);
+    tile.height = std::min(TILE_SIZE, l.height - tile.y);
+
+    //all tile rows below are full height, all tiles to the left in this row
+    //are full width
+    size_t ps = getPixelSize();
+    size_t offset = l.offset
+        + (size_t(tile.y) * l.width + size_t(tile.height) * tile.x) * ps;
+    tile.data = _begin + offset;
+    tile.size = size_t(tile.width) * tile.height * ps;
+    return tile;
+}
+
+uint64_t TextureImage::getSourceSize() const
+{
+    return _sourceSize;
+}
+
+int64_t TextureImage::getSourceTime() const
+{
+    return _sourceTime;
+}
+
+std::shared_ptr<TextureImage> TextureImage::create(int width,
+                                                   int height,
+                                                   PixelType type,
+                                                   const std::vector<char> &pixels,
+                                                   Filter filter)
+{
+    size_t ps = pixelSize(type);
+    if(width <= 0 || height <= 0 || pixels.size() < size_t(width) * height * ps)
+        return nullptr;
+
+    auto image = std::make_shared<TextureImage>();
+    image->_type = type;
+    image->_filter = filter;
+    image->_data.reserve(size_t(width) * height * ps * 4 / 3 + ps);
+
+    const std::vector<char> *current = &pixels;
+    std::vector<char> level;
+    while(true) {
+        image->_levels.push_back({width, height, image->_data.size()});
+        appendTiles(*current, width, height, ps, image->_data);
+        if(width == 1 && height == 1) break;
+
+        int dstWidth = std::max(width / 2, 1);
+        int dstHeight = std::max(height / 2, 1);
+        level = downsample(*current, width, height, dstWidth, dstHeight, type, filter);
+        current = &level;
+        width = dstWidth;
+        height = dstHeight;
+    }
+
+    image->_begin = image->_data.data();
+    image->_size = image->_data.size();
+    return image;
+}
+
+std::shared_ptr<TextureImage> TextureImage::decode(std::string filename, Filter filter)
+{
+    struct stat info;
+    if(stat(filename.c_str(), &info) != 0) {
+        std::cout << "could not open " << filename << std::endl;
+        return nullptr;
+    }
+
+    FILE *file = fopen(filename.c_str(), "rb");
+    if(!file) {
+        std::cout << "could not open " << filename << std::endl;
+        return nullptr;
+    }
+
+    unsigned char magic[4] = {0, 0, 0, 0};
+    size_t read = fread(magic, 1, 4, file);
+    rewind(file);
+
+    Decoded image;
+    bool success = false;
+    bool supported = true;
+    if(read >= 2 && magic[0] == 'P' && (magic[1] == '6' || magic[1] == '7'))
+        success = readNetpbm(file, image);
+#ifdef MT_WITH_PNG
+    else if(read == 4 && magic[0] == 0x89 && magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G')
+        success = readPNG(file, image);
+#endif
+#ifdef MT_WITH_JPEG
+    else if(read >= 2 && magic[0] == 0xff && magic[1] == 0xd8)
+        success = readJPEG(file, image);
+#endif
+#ifdef MT_WITH_OPENEXR
+    else if(read == 4 && magic[0] == 0x76 && magic[1] == 0x2f && magic[2] == 0x31 && magic[3] == 0x01)
+        success = readEXR(filename, image);
+#endif
+    else
+        supported = false;
+    fclose(file);
+
+    if(!supported) {
+        std::cout << "unsupported image format: " << filename << std::endl;
+        return nullptr;
+    }
+    if(!success) {
+        std::cout << "could not decode " << filename << std::endl;
+        return nullptr;
+    }
+
+    auto texture = create(image.width, image.height, image.type, image.pixels, filter);
+    if(!texture) return nullptr;
+    texture->_sourceSize = info.st_size;
+    texture->_sourceTime = info.st_mtime;
+    return texture;
+}
+
+bool TextureImage::write(std::string filename) const
+{
+    std::string tmp = filename + "." + std::to_string(getpid()) + ".tmp";
+    FILE *file = fopen(tmp.c_str(), "wb");
+    if(!file) return false;
+
+    MTTexture::FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MTTexture::MAGIC, sizeof(header.magic));
+    header.version = MTTexture::VERSION;
+    header.pixelType = _type;
+    header.filter = _filter;
+    header.tileSize = TILE_SIZE;
+    header.levelCount = _levels.size();
+    header.sourceSize = _sourceSize;
+    header.sourceTime = _sourceTime;
+
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(_levels.data(), sizeof(Level), _levels.size(), file) == _levels.size()
+        && fwrite(_begin, 1, _size, file) == _size;
+    success = fclose(file) == 0 && success;
+
+    //the cache only shows up once it is complete
+    if(!success || rename(tmp.c_str(), filename.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<TextureImage> TextureImage::read(std::string filename)
+{
+    struct stat info;
+    if(stat(filename.c_str(), &info) != 0) return nullptr;
+
+    auto file = std::make_shared<const IO::MappedFile>(filename);
+    if(!file->isOpen() || file->size() < sizeof(MTTexture::FileHeader)) return nullptr;
+
+    MTTexture::FileHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    if(memcmp(header.magic, MTTexture::MAGIC, sizeof(header.magic))
+       || header.version != MTTexture::VERSION
+       || header.pixelType > RGBA16F
+       || header.filter > KAISER
+       || header.tileSize != TILE_SIZE
+       || !header.levelCount
+       || header.levelCount > MAX_LEVELS)
+        return nullptr;
+
+    auto image = std::make_shared<TextureImage>();
+    image->_type = static_cast<PixelType>(header.pixelType);
+    image->_filter = static_cast<Filter>(header.filter);
+    image->_sourceSize = header.sourceSize;
+    image->_sourceTime = header.sourceTime;
+
+    size_t levelsOffset = sizeof(header);
+    size_t dataOffset = levelsOffset + header.levelCount * sizeof(Level);
+    if(file->size() < dataOffset) return nullptr;
+
+    image->_levels.resize(header.levelCount);
+    memcpy(image->_levels.data(), file->data() + levelsOffset, header.levelCount * sizeof(Level));
+    image->_begin = file->data() + dataOffset;
+    image->_size = file->size() - dataOffset;
+
+    size_t ps = image->getPixelSize();
+    for(const Level &level : image->_levels) {
+        if(level.width <= 0 || level.height <= 0
+           || level.offset > image->_size
+           || size_t(level.width) * level.height * ps > image->_size - level.offset) {
+            std::cout << "corrupted texture cache: " << filename << std::endl;
+            return nullptr;
+        }
+    }
+
+    image->_file = file;
+    return image;
+}
+
+TextureLoader::Future TextureLoader::request(std::string filename, std::function<void()> done)
+{
+    struct stat info;
+    if(stat(filename.c_str(), &info) != 0) {
+        info.st_size = 0;
+        info.st_mtime = 0;
+    }
+
+    std::unique_lock<std::mutex> lock(requestLock);
+    //finished images are only shared while someone still holds them
+    for(auto it = begin(requests); it != end(requests);) {
+        const auto &image = it->second.image;
+        bool ready = image.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        if(ready && image.get().use_count() <= 1) it = requests.erase(it);
+        else ++it;
+    }
+
+    auto it = requests.find(filename);
+    if(it != end(requests)
+       && it->second.size == uint64_t(info.st_size)
+       && it->second.time == info.st_mtime) {
+        Future image = it->second.image;
+        if(done && !it->second.waiting->loaded) {
+            it->second.waiting->callbacks.push_back(done);
+            done = nullptr;
+        }
+        lock.unlock();
+        if(done) done();
+        return image;
+    }
+
+    auto task = std::make_shared<std::packaged_task<TextureImagePtr()>>([filename] {
+        return load(filename);
+    });
+    Future image = task->get_future().share();
+    auto waiting = std::make_shared<Waiting>();
+    if(done) waiting->callbacks.push_back(done);
+    requests[filename] = {uint64_t(info.st_size), int64_t(info.st_mtime), image, waiting};
+    ThreadPool::enqueue([task, waiting] {
+        (*task)();
+
+        std::vector<std::function<void()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(requestLock);
+            waiting->loaded = true;
+            callbacks.swap(waiting->callbacks);
+        }
+        for(const auto &callback : callbacks)
+            callback();
+    });
+    return image;
+}
+
+TextureImagePtr TextureLoader::load(std::string filename)
+{
+    struct stat info;
+    if(stat(filename.c_str(), &info) != 0) {
+        std::cout << "could not open " << filename << std::endl;
+        return nullptr;
+    }
+
+    std::string paths[] = {cachePath(filename), tempCachePath(filename)};
+    for(const auto &path : paths) {
+        auto cached = TextureImage::read(path);
+        if(cached
+           && cached->getFilter() == TextureImage::KAISER
+           && cached->getSourceSize() == uint64_t(info.st_size)
+           && cached->getSourceTime() == info.st_mtime)
+            return cached;
+    }
+
+    auto image = TextureImage::decode(filename);
+    if(!image) return nullptr;
+
+    //the written cache is mapped instead, so the pixels are only held by
+    //the page cache
+    for(const auto &path : paths) {
+        if(!image->write(path)) continue;
+        auto cached = TextureImage::read(path);
+        if(cached) return cached;
+    }
+    return image;
+}
+
+std::string TextureLoader::cachePath(std::string filename)
+{
+    return filename + ".mttx";
+}
+
+std::string TextureLoader::tempCachePath(std::string filename)
+{
+    char absolute[PATH_MAX];
+    if(realpath(filename.c_str(), absolute))
+        filename = absolute;
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash(filename)));
+    return std::string(P_tmpdir) + "/mindtree_" + name + ".mttx";
+}
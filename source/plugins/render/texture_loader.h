@@ -0,0 +1,144 @@
+#ifndef MT_GL_TEXTURE_LOADER_H
+#define MT_GL_TEXTURE_LOADER_H
+
+#include "string"
+#include "functional"
+#include "vector"
+#include "memory"
+#include "future"
+#include "cstdint"
+
+namespace MindTree {
+namespace IO {
+class MappedFile;
+}
+
+namespace GL {
+
+//the mttx format stores the whole mip chain of an image in tiles, so a
+//level can be uploaded a few tiles at a time. The header records size and
+//modification time of the source image, a cache that does not match them
+//is decoded again
+namespace MTTexture {
+const char MAGIC[8] = {'M', 'T', 'T', 'E', 'X', 0, 0, 0};
+const uint32_t VERSION = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t pixelType;
+    uint32_t filter;
+    uint32_t tileSize;
+    uint32_t levelCount;
+    uint32_t padding;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+};
+}
+
+//a decoded image with all of its mip levels. Pixels are always four
+//channels, rows go bottom up like texture coordinates. Every level is
+//split into tiles of TILE_SIZE pixels that are stored one after the other,
+//tiles at the right and top border are smaller
+class TextureImage
+{
+public:
+    enum PixelType : uint32_t {
+        //srgb color, linear alpha
+        RGBA8,
+        //linear half floats
+        RGBA16F
+    };
+
+    enum Filter : uint32_t {
+        BOX,
+        //kaiser windowed sinc, sharper than the box filter
+        KAISER
+    };
+
+    static const int TILE_SIZE = 64;
+
+    struct Level {
+        int32_t width;
+        int32_t height;
+        uint64_t offset;
+    };
+
+    struct Tile {
+        int x, y, width, height;
+        const char *data;
+        size_t size;
+    };
+
+    TextureImage();
+    ~TextureImage();
+
+    PixelType getPixelType() const;
+    Filter getFilter() const;
+    size_t getPixelSize() const;
+    int getWidth() const;
+    int getHeight() const;
+
+    int getLevelCount() const;
+    const Level& getLevel(int level) const;
+    int getTileCount(int level) const;
+    Tile getTile(int level, int index) const;
+
+    uint64_t getSourceSize() const;
+    int64_t getSourceTime() const;
+
+    //builds the mip chain of an image with its rows bottom up and splits
+    //every level into tiles
+    static std::shared_ptr<TextureImage> create(int width,
+                                                int height,
+                                                PixelType type,
+                                                const std::vector<char> &pixels,
+                                                Filter filter=KAISER);
+
+    //decodes png, jpeg, exr (depending on the libraries MindTree was built
+    //with), pam and ppm files
+    static std::shared_ptr<TextureImage> decode(std::string filename, Filter filter=KAISER);
+
+    bool write(std::string filename) const;
+    static std::shared_ptr<TextureImage> read(std::string filename);
+
+private:
+    PixelType _type;
+    Filter _filter;
+    std::vector<Level> _levels;
+    uint64_t _sourceSize;
+    int64_t _sourceTime;
+
+    //tiled levels are either in memory or in a mapped cache file
+    std::vector<char> _data;
+    std::shared_ptr<const IO::MappedFile> _file;
+    const char *_begin;
+    size_t _size;
+};
+typedef std::shared_ptr<const TextureImage> TextureImagePtr;
+
+//decodes images and builds their mip chains on a pool of worker threads.
+//The result is cached in an mttx file next to the image, or in the temp
+//directory if that is not writable, so opening the scene again only maps
+//the cache
+class TextureLoader
+{
+public:
+    typedef std::shared_future<TextureImagePtr> Future;
+
+    //images that are loading or still in use are shared, null if the
+    //image could not be read. done is called once the image is there, on
+    //the thread that loaded it, or right away if it is there already
+    static Future request(std::string filename, std::function<void()> done=nullptr);
+
+    //loads on the calling thread
+    static TextureImagePtr load(std::string filename);
+
+    static std::string cachePath(std::string filename);
+    static std::string tempCachePath(std::string filename);
+};
+
+}
+}
+
+#endif
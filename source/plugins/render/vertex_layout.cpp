@@ -0,0 +1,188 @@
+#include "algorithm"
+#include "cctype"
+#include "cstring"
+#include "regex"
+#include "sstream"
+#include "glm/gtc/packing.hpp"
+
+#include "glwrapper.h"
+#include "vertex_layout.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+namespace {
+    const char *octahedralDecode =
+        "vec3 mt_decodeOctahedral(vec2 e)\n"
+        "{\n"
+        "    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+        "    float t = max(-n.z, 0.0);\n"
+        "    n.x += n.x >= 0.0 ? -t : t;\n"
+        "    n.y += n.y >= 0.0 ? -t : t;\n"
+        "    return normalize(n);\n"
+        "}\n";
+
+    glm::vec2 encodeOctahedral(glm::vec3 n)
+    {
+        float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if(sum == 0) return glm::vec2(0, 0);
+        n /= sum;
+
+        //the lower hemisphere is folded over the diagonals
+        glm::vec2 e(n.x, n.y);
+        if(n.z < 0)
+            e = glm::vec2((1 - std::abs(n.y)) * (n.x >= 0 ? 1 : -1),
+                          (1 - std::abs(n.x)) * (n.y >= 0 ? 1 : -1));
+        return e;
+    }
+}
+
+VertexLayout::VertexLayout() :
+    _stride(0)
+{
+}
+
+VertexLayout::Format VertexLayout::getFormat(const std::string &name)
+{
+    if(name == "N") return OCT16;
+    if(name == "C") return RGBA8;
+    if(name == "UV" || name == "st") return HALF2;
+    return FLOAT3;
+}
+
+size_t VertexLayout::getSize(Format format)
+{
+    switch(format) {
+        case FLOAT3:
+            return 3 * sizeof(float);
+        case OCT16:
+        case RGBA8:
+        case HALF2:
+            return 4;
+    }
+    return 0;
+}
+
+std::string VertexLayout::getInputName(const std::string &name)
+{
+    if(getFormat(name) == OCT16) return name + "_oct";
+    return name;
+}
+
+std::string VertexLayout::expandDeclarations(const std::string &source)
+{
+    static const std::regex pragma("#pragma vertex_layout\\(([^)]*)\\)");
+
+    std::string result;
+    auto begin = std::sregex_iterator(source.begin(), source.end(), pragma);
+    auto end = std::sregex_iterator();
+    size_t position = 0;
+    bool decoderAdded = false;
+    for(auto it = begin; it != end; ++it) {
+        const auto &match = *it;
+        result += source.substr(position, match.position() - position);
+        position = match.position() + match.length();
+
+        std::stringstream names(match[1].str());
+        std::string name;
+        std::string declarations;
+        while(std::getline(names, name, ',')) {
+            name.erase(std::remove_if(name.begin(), name.end(), ::isspace), name.end());
+            if(name.empty()) continue;
+
+            switch(getFormat(name)) {
+                case FLOAT3:
+                case RGBA8:
+                    declarations += "in vec3 " + name + ";\n";
+                    break;
+                case HALF2:
+                    declarations += "in vec2 " + name + ";\n";
+                    break;
+                case OCT16:
+                    if(!decoderAdded) {
+                        declarations += octahedralDecode;
+                        decoderAdded = true;
+                    }
+                    declarations += "in vec2 " + getInputName(name) + ";\n"
+                        + "#define " + name + " mt_decodeOctahedral(" + getInputName(name) + ")\n";
+                    break;
+            }
+        }
+        result += declarations;
+    }
+    result += source.substr(position);
+    return result;
+}
+
+void VertexLayout::addAttribute(const std::string &name)
+{
+    Format format = getFormat(name);
+    _attributes.push_back({name, format, _stride});
+    _stride += getSize(format);
+}
+
+const std::vector<VertexLayout::Attribute>& VertexLayout::getAttributes() const
+{
+    return _attributes;
+}
+
+size_t VertexLayout::getStride() const
+{
+    return _stride;
+}
+
+std::vector<unsigned char> VertexLayout::pack(const std::vector<const VertexList*> &streams,
+                                              const std::vector<uint> *remap) const
+{
+    size_t count = streams.empty() ? 0 : streams[0]->size();
+    std::vector<unsigned char> buffer(count * _stride);
+
+    for(size_t a = 0; a < _attributes.size(); ++a) {
+        const auto &attribute = _attributes[a];
+        const VertexList &stream = *streams[a];
+        for(size_t i = 0; i < count; ++i) {
+            size_t vertex = remap ? (*remap)[i] : i;
+            unsigned char *dst = &buffer[vertex * _stride + attribute.offset];
+            const glm::vec3 &value = stream[i];
+            uint32_t packed = 0;
+            switch(attribute.format) {
+                case FLOAT3:
+                    std::memcpy(dst, &value, sizeof(glm::vec3));
+                    continue;
+                case OCT16:
+                    packed = glm::packSnorm2x16(encodeOctahedral(value));
+                    break;
+                case RGBA8:
+                    packed = glm::packUnorm4x8(glm::vec4(value, 1));
+                    break;
+                case HALF2:
+                    packed = glm::packHalf2x16(glm::vec2(value));
+                    break;
+            }
+            std::memcpy(dst, &packed, sizeof(packed));
+        }
+    }
+    return buffer;
+}
+
+void VertexLayout::setPointer(const Attribute &attribute, GLuint index) const
+{
+    const GLvoid *offset = reinterpret_cast<const GLvoid*>(attribute.offset);
+    glEnableVertexAttribArray(index);
+    MTGLERROR;
+    switch(attribute.format) {
+        case FLOAT3:
+            glVertexAttribPointer(index, 3, GL_FLOAT, GL_FALSE, _stride, offset);
+            break;
+        case OCT16:
+            glVertexAttribPointer(index, 2, GL_SHORT, GL_TRUE, _stride, offset);
+            break;
+        case RGBA8:
+            glVertexAttribPointer(index, 4, GL_UNSIGNED_BYTE, GL_TRUE, _stride, offset);
+            break;
+        case HALF2:
+            glVertexAttribPointer(index, 2, GL_HALF_FLOAT, GL_FALSE, _stride, offset);
+            break;
+    }
+    MTGLERROR;
+}
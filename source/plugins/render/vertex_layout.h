@@ -0,0 +1,65 @@
+#ifndef MT_GL_VERTEX_LAYOUT_H
+#define MT_GL_VERTEX_LAYOUT_H
+
+#include "string"
+#include "vector"
+#include "GL/glew.h"
+#include "../datatypes/Object/object.h"
+
+namespace MindTree {
+namespace GL {
+
+//interleaves the per vertex attributes of a mesh into one buffer. Every
+//attribute name has a fixed format, so shaders shared between meshes can
+//decode them the same way
+class VertexLayout
+{
+public:
+    enum Format {
+        FLOAT3,
+        //octahedral 2x16 bit snorm, for unit vectors
+        OCT16,
+        //rgba 8 bit unorm, alpha is always 1
+        RGBA8,
+        HALF2
+    };
+
+    struct Attribute {
+        std::string name;
+        Format format;
+        size_t offset;
+    };
+
+    VertexLayout();
+
+    static Format getFormat(const std::string &name);
+    static size_t getSize(Format format);
+
+    //name of the vertex shader input that receives the attribute
+    static std::string getInputName(const std::string &name);
+
+    //replaces every "#pragma vertex_layout(P, N, ...)" line of a vertex
+    //shader with input declarations that decode the attributes
+    static std::string expandDeclarations(const std::string &source);
+
+    void addAttribute(const std::string &name);
+    const std::vector<Attribute>& getAttributes() const;
+    size_t getStride() const;
+
+    //one stream per attribute in the order they were added, all of them
+    //with the same length. Vertex i goes to remap[i] if a remap is given
+    std::vector<unsigned char> pack(const std::vector<const VertexList*> &streams,
+                                    const std::vector<uint> *remap=nullptr) const;
+
+    //needs the interleaved buffer to be bound
+    void setPointer(const Attribute &attribute, GLuint index) const;
+
+private:
+    std::vector<Attribute> _attributes;
+    size_t _stride;
+};
+
+}
+}
+
+#endif
@@ -58,7 +58,8 @@ Viewport::Viewport(ViewportWidget *widget) :
     selectionMode(false),
     _showGrid(true),
     transformMode(0),
-    _viewportWidget(widget)
+    _viewportWidget(widget),
+    _centerRequestFrames(0)
 {
     _viewports.push_back(this);
 
@@ -70,11 +71,18 @@ Viewport::Viewport(ViewportWidget *widget) :
     _widgetManager = std::make_shared<MindTree::Widget3DManager>();
     _renderConfigurator = std::make_unique<GL::DeferredRenderer>(defaultCamera,
                                                                  _widgetManager.get());
+
+    //changes to the render tree can come from any thread, qt merges the
+    //queued updates into one paint per refresh
+    _renderConfigurator->getTree()->setDamageCallback([this] {
+        QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+    });
 }
 
 Viewport::~Viewport()
 {
     //_renderThread.removeTree(_renderConfigurator->getTree());
+    _renderConfigurator->getTree()->setDamageCallback(nullptr);
     _viewports.erase(std::find(begin(_viewports), end(_viewports), this));
 }
 
@@ -260,6 +268,34 @@ void Viewport::resizeGL(int w, int h)
 void Viewport::paintGL()
 {
 	_renderConfigurator->getTree()->draw();
+    applyCenterRequest();
+}
+
+void Viewport::requestCenter(glm::ivec2 pos)
+{
+    _centerRequest = _renderConfigurator->requestPositions({pos});
+    _centerRequestFrames = 0;
+}
+
+void Viewport::applyCenterRequest()
+{
+    if(!_centerRequest.valid()) return;
+
+    if(_centerRequest.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        //the readback finishes within the next frames, give up if the
+        //geometry pass stopped rendering
+        if(++_centerRequestFrames < MAX_CENTER_REQUEST_FRAMES)
+            update();
+        else
+            _centerRequest = std::future<std::vector<glm::vec4>>();
+        return;
+    }
+
+    glm::vec4 center = _centerRequest.get()[0];
+    if(center.a > 0) {
+        activeCamera->setCenter(center.xyz());
+        _renderConfigurator->setProperty("GL:camera:center", center.xyz());
+    }
 }
 
 void Viewport::mousePressEvent(QMouseEvent *event)
@@ -275,16 +311,7 @@ void Viewport::mousePressEvent(QMouseEvent *event)
     _renderConfigurator->setProperty("GL:camera:showcenter", true);
 
     lastpos = event->screenPos();
-	glm::vec4 center;
-    {
-		GL::QtContext ctx(context());
-		GL::ContextBinder binder(ctx);
-		center = _renderConfigurator->getPosition(pos);
-	}
-    if(center.a > 0) {
-        activeCamera->setCenter(center.xyz());
-        _renderConfigurator->setProperty("GL:camera:center", center.xyz());
-    }
+    requestCenter(pos);
 
     if(event->modifiers() & Qt::ControlModifier)
         zoom = true;
@@ -336,17 +363,7 @@ void Viewport::mouseMoveEvent(QMouseEvent *event)
     else if(zoom)
         zoomView(xdist, ydist);
 	else {
-		glm::vec4 center;
-		{
-			GL::QtContext ctx(context());
-			GL::ContextBinder binder(ctx);
-			center = _renderConfigurator->getPosition(pos);
-		}
-		//dbout(glm::to_string(center));
-		if(center.a > 0) {
-			activeCamera->setCenter(center.xyz());
-			_renderConfigurator->setProperty("GL:camera:center", center.xyz());
-		}
+		requestCenter(pos);
 		_renderConfigurator->setProperty("GL:camera:showcenter", false);
 		_widgetManager->mouseMoveEvent(activeCamera, pos);
 	}
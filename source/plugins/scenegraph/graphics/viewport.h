@@ -24,6 +24,8 @@
 #include "QTimer"
 #include "QThread"
 
+#include "future"
+
 #include "source/plugins/datatypes/Object/object.h"
 #include "data/nodes/nodetype.h"
 #include "../../render/glwrapper.h"
@@ -95,6 +97,11 @@ protected:
     void mouseToWorld();
     void drawFps();
 
+    //the center under the mouse is read back asynchronously and applied
+    //once the readback is done
+    void requestCenter(glm::ivec2 pos);
+    void applyCenterRequest();
+
 private:
     friend class ViewportWidget;
     std::shared_ptr<Camera> activeCamera, defaultCamera;
@@ -118,6 +125,10 @@ private:
     unsigned short transformMode;
 
     ViewportWidget *_viewportWidget;
+
+    static const int MAX_CENTER_REQUEST_FRAMES = 4;
+    std::future<std::vector<glm::vec4>> _centerRequest;
+    int _centerRequestFrames;
 };
 
 #endif /* end of include guard: VIEWPORT */
@@ -60,6 +60,8 @@ void ViewportViewer::setupSettingsNode()
 
     s = new DinSocket("defaultLighting", "BOOLEAN", node.get());
     s->setProperty(true);
+    s = new DinSocket("clusteredLighting", "BOOLEAN", node.get());
+    s->setProperty(true);
     s = new DinSocket("showpoints", "BOOLEAN", node.get());
     s->setProperty(true);
     s = new DinSocket("showedges", "BOOLEAN", node.get());
@@ -21,8 +21,10 @@
 #include "data/windowfactory.h"
 #include "boost/python.hpp"
 #include "pluginentry.h"
+#include "shader_precompiler.h"
 
-#include <QCoreApplication>
+#include <QGuiApplication>
+#include <QTimer>
 
 namespace BPy = boost::python;
 
@@ -33,6 +35,22 @@ MindTree::Viewer* addViewport(MindTree::DoutSocket *socket)
     return new ViewportViewer(socket);
 }
 
+namespace {
+    //plugins are imported before the application is created, this runs
+    //from its constructor. Only once the event loop runs is it known to be
+    //a gui application, which the precompilers context needs
+    void startShaderPrecompiler()
+    {
+        QTimer::singleShot(0, QCoreApplication::instance(), [] {
+            if(qobject_cast<QGuiApplication*>(QCoreApplication::instance()))
+                MindTree::GL::ShaderPrecompiler::launch(QCoreApplication::instance());
+        });
+    }
+}
+
+//warm up the shader cache while the ui is still starting
+Q_COREAPP_STARTUP_FUNCTION(startShaderPrecompiler)
+
 BOOST_PYTHON_MODULE(scenegraph){
     ViewerList::instance()
         ->addViewer(new MindTree::ViewerFactory("&Viewport", 
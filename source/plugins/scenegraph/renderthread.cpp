@@ -1,4 +1,6 @@
 #include <QThread>
+#include <QScreen>
+#include <thread>
 #include "../render/glwrapper.h"
 #include "qtcontext.h"
 #include "../render/rendertree.h"
@@ -11,27 +13,36 @@ using namespace MindTree::GL;
 
 void RenderThread::addTree(RenderTree* tree, QOpenGLContext *context)
 {
-    std::unique_lock<std::mutex> lock(_renderingLock, std::defer_lock);
-    auto it = std::find(begin(_renderQueue), end(_renderQueue), tree);
-    if(it == end(_renderQueue))
-        _renderQueue.push_back(tree);
+    {
+        std::lock_guard<std::mutex> lock(_renderingLock);
+        auto it = std::find(begin(_renderQueue), end(_renderQueue), tree);
+        if(it == end(_renderQueue))
+            _renderQueue.push_back(tree);
+    }
+    tree->setDamageCallback([this] { update(); });
 
     if(!isRendering()) {
+        ctx_ = context;
 		moveToThread(&_renderThread);
 		context->moveToThread(&_renderThread);
 		connect(&_renderThread, &QThread::started, this, &RenderThread::render);
 		_renderThread.start();
 	}
-    _update = true;
+    update();
 }
 
 void RenderThread::removeTree(RenderTree *tree)
 {
-    std::unique_lock<std::mutex> lock(_renderingLock, std::defer_lock);
-    auto it = std::find(begin(_renderQueue), end(_renderQueue), tree);
-    if(it != end(_renderQueue))
-        _renderQueue.erase(it);
-    if(_renderQueue.empty()) stop();
+    tree->setDamageCallback(nullptr);
+    bool empty;
+    {
+        std::lock_guard<std::mutex> lock(_renderingLock);
+        auto it = std::find(begin(_renderQueue), end(_renderQueue), tree);
+        if(it != end(_renderQueue))
+            _renderQueue.erase(it);
+        empty = _renderQueue.empty();
+    }
+    if(empty) stop();
 }
 
 bool RenderThread::isRendering()
@@ -41,17 +52,15 @@ bool RenderThread::isRendering()
 
 void RenderThread::updateOnce()
 {
-    _update = true;
-    _renderNotifier.notify_all();
-    _update = false;
+    update();
 }
 
 void RenderThread::update()
 {
-    //noop if already updating
-    if(_update) return;
+    //noop if a frame is already scheduled
+    if(_update.exchange(true)) return;
 
-    _update = true;
+    std::lock_guard<std::mutex> lock(_renderingLock);
     _renderNotifier.notify_all();
 }
 
@@ -60,19 +69,47 @@ void RenderThread::pause()
     _update = false;
 }
 
+std::chrono::microseconds RenderThread::getFrameInterval() const
+{
+    qreal refreshRate = 60;
+    if(ctx_ && ctx_->screen() && ctx_->screen()->refreshRate() > 0)
+        refreshRate = ctx_->screen()->refreshRate();
+    return std::chrono::microseconds(static_cast<long long>(1000000 / refreshRate));
+}
+
 void RenderThread::render()
 {
     if(isRendering()) stop();
-	std::unique_lock<std::mutex> lock(_renderingLock, std::defer_lock);
     _rendering = true;
 	QtContext ctx(ctx_);
 	ContextBinder binder(ctx);
+
+    auto frameInterval = getFrameInterval();
+    auto lastFrame = std::chrono::steady_clock::now() - frameInterval;
 	while(isRendering()) {
-		if(!_update) _renderNotifier.wait(lock);
-		for(auto *tree : _renderQueue) {
+        std::vector<RenderTree*> queue;
+        {
+            std::unique_lock<std::mutex> lock(_renderingLock);
+            _renderNotifier.wait(lock, [this] { return _update || !isRendering(); });
+            queue = _renderQueue;
+        }
+        if(!isRendering()) break;
+
+        //several changes within one refresh interval end up in one frame
+        std::this_thread::sleep_until(lastFrame + frameInterval);
+        lastFrame = std::chrono::steady_clock::now();
+        _update = false;
+
+        bool damaged = false;
+		for(auto *tree : queue) {
+            if(!tree->isDamaged()) continue;
 			tree->draw();
 			ctx.swapBuffers();
+            //pending readbacks and changes made while drawing need
+            //another frame
+            damaged = damaged || tree->isDamaged();
 		}
+        if(damaged) _update = true;
 	}
 }
 
@@ -81,7 +118,10 @@ void RenderThread::stop()
     std::cout << "stop rendering" << std::endl;
     _rendering = false;
     _update = false;
-    _renderNotifier.notify_all();
+    {
+        std::lock_guard<std::mutex> lock(_renderingLock);
+        _renderNotifier.notify_all();
+    }
 	_renderThread.quit();
 	_renderThread.wait();
 }
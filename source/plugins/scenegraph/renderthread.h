@@ -3,6 +3,8 @@
 
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <QOpenGLContext>
 #include <QObject>
@@ -14,12 +16,15 @@ namespace GL
 {
 class RenderTree;
 
+//draws its render trees only when they are damaged, frames are paced to
+//the refresh rate of the screen and an idle thread just sleeps
 class RenderThread : public QObject
 {
 	Q_OBJECT
 public:
     void addTree(RenderTree *tree, QOpenGLContext *context);
     void removeTree(RenderTree *tree);
+    //schedules a frame, the trees decide themselves what needs a redraw
     void update();
     void updateOnce();
     void pause();
@@ -29,13 +34,14 @@ public:
 private:
     void stop();
     bool isRendering();
+    std::chrono::microseconds getFrameInterval() const;
 
     std::atomic_bool _rendering{false};
     std::atomic_bool _update{false};
     std::condition_variable _renderNotifier;
     std::mutex _renderingLock;
     QThread _renderThread;
-	QOpenGLContext *ctx_;
+	QOpenGLContext *ctx_{nullptr};
     std::vector<RenderTree*> _renderQueue;
 };
 
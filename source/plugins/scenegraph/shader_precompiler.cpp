@@ -0,0 +1,60 @@
+#include <iostream>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QCoreApplication>
+#include "GL/glew.h"
+#include "../render/shader_library.h"
+#include "qtcontext.h"
+
+#include "shader_precompiler.h"
+
+using namespace MindTree;
+using namespace MindTree::GL;
+
+ShaderPrecompiler::ShaderPrecompiler(QObject *parent) :
+    QThread(parent),
+    _context(new QOpenGLContext()),
+    _surface(new QOffscreenSurface())
+{
+    //program binaries only depend on the driver, no need to share objects
+    _surface->setFormat(QtContext::format());
+    _surface->create();
+    _context->setFormat(QtContext::format());
+    _context->create();
+    _context->moveToThread(this);
+}
+
+ShaderPrecompiler::~ShaderPrecompiler()
+{
+    wait();
+    delete _context;
+    delete _surface;
+}
+
+void ShaderPrecompiler::launch(QObject *parent)
+{
+    auto *precompiler = new ShaderPrecompiler(parent);
+    connect(precompiler, &QThread::finished, precompiler, &QObject::deleteLater);
+    precompiler->start(QThread::LowPriority);
+}
+
+void ShaderPrecompiler::run()
+{
+    if(!_context->isValid() || !_context->makeCurrent(_surface)) {
+        std::cout << "could not create context for shader precompilation" << std::endl;
+        return;
+    }
+
+    glewExperimental = GL_TRUE;
+    if(glewInit() != GLEW_OK) {
+        std::cout << "could not initialize glew for shader precompilation" << std::endl;
+    }
+    else {
+        //glewInit may leave an error behind
+        glGetError();
+        ShaderLibrary::instance()->precompile();
+    }
+    _context->doneCurrent();
+    //deleted on the gui thread
+    _context->moveToThread(QCoreApplication::instance()->thread());
+}
@@ -0,0 +1,37 @@
+#ifndef MT_SHADER_PRECOMPILER_H
+#define MT_SHADER_PRECOMPILER_H
+
+#include <QThread>
+
+class QOpenGLContext;
+class QOffscreenSurface;
+
+namespace MindTree
+{
+namespace GL
+{
+
+//compiles the shader programs known from earlier sessions on its own
+//context, so the first frames of a viewport find them in the ShaderLibrary
+class ShaderPrecompiler : public QThread
+{
+	Q_OBJECT
+public:
+    //has to be created on the gui thread
+    ShaderPrecompiler(QObject *parent=nullptr);
+    ~ShaderPrecompiler();
+
+    static void launch(QObject *parent);
+
+protected:
+    void run() override;
+
+private:
+    QOpenGLContext *_context;
+    QOffscreenSurface *_surface;
+};
+
+}
+}
+
+#endif // MT_SHADER_PRECOMPILER_H
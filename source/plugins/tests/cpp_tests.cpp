@@ -5,6 +5,19 @@
 #include "data/cache_main.h"
 #include "data/raytracing/ray.h"
 #include "data/io.h"
+#include "data/async_loader.h"
+#include "data/autosave.h"
+#include "../datatypes/Object/mesh_simplification.h"
+#include "../datatypes/Object/mesh_clusters.h"
+#include "../mtio/obj.h"
+#include "../mtio/pointcloud.h"
+#include "../mtio/mesh_export.h"
+#include "thread"
+#include "cstdio"
+#include "cstring"
+#include "fstream"
+#include "set"
+#include "algorithm"
 
 namespace BPy = boost::python;
 using namespace MindTree;
@@ -150,6 +163,119 @@ bool testSaveLoadProperties()
     return newProp.getData<int>() == prop.getData<int>();
 }
 
+bool testSaveLoadMeshProperties()
+{
+    auto vertices = std::make_shared<VertexList>();
+    for(int i = 0; i < 100000; ++i)
+        vertices->push_back(glm::vec3(i % 10, i / 10 % 10, i / 100));
+    auto polygons = std::make_shared<PolygonList>();
+    for(uint i = 0; i + 3 < vertices->size(); i += 3)
+        polygons->push_back(i % 2 ? Polygon{i, i + 1, i + 2} : Polygon{i, i + 1, i + 2, i + 3});
+
+    Property vertexProp{vertices};
+    Property polygonProp{polygons};
+    {
+        IO::OutStream str("testSaveLoadMeshProperties.mt");
+        str.beginBlock("Properties");
+        str << vertexProp << polygonProp;
+        str.endBlock("Properties");
+    }
+
+    Property newVertexProp, newPolygonProp;
+    {
+        IO::InStream str("testSaveLoadMeshProperties.mt");
+        str.beginBlock("Properties");
+        str >> newVertexProp >> newPolygonProp;
+        str.endBlock("Properties");
+    }
+
+    auto newVertices = newVertexProp.getData<VertexListPtr>();
+    if(!newVertices || *newVertices != *vertices) {
+        std::cout << "vertices did not survive saving" << std::endl;
+        return false;
+    }
+
+    auto newPolygons = newPolygonProp.getData<PolygonListPtr>();
+    if(!newPolygons || *newPolygons != *polygons) {
+        std::cout << "polygons did not survive saving" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool testSaveLoadListProperties()
+{
+    //int and uint8_t lists are both LIST:INTEGER, float and double lists
+    //are both LIST:FLOAT
+    std::vector<int> ints{-3, 0, 7, 1 << 20};
+    std::vector<uint8_t> bytes{0, 128, 255};
+    auto floats = std::make_shared<std::vector<float>>(std::vector<float>{.5f, -2.f});
+    std::vector<double> doubles{.25, 1e10};
+
+    Property intProp{ints}, byteProp{bytes}, floatProp{floats}, doubleProp{doubles};
+    {
+        IO::OutStream str("testSaveLoadListProperties.mt");
+        str.beginBlock("Properties");
+        str << intProp << byteProp << floatProp << doubleProp;
+        str.endBlock("Properties");
+    }
+
+    Property newIntProp, newByteProp, newFloatProp, newDoubleProp;
+    {
+        IO::InStream str("testSaveLoadListProperties.mt");
+        str.beginBlock("Properties");
+        str >> newIntProp >> newByteProp >> newFloatProp >> newDoubleProp;
+        str.endBlock("Properties");
+    }
+
+    if(newIntProp.getType() != "LIST:INTEGER"
+       || newIntProp.getData<std::vector<int>>() != ints) {
+        std::cout << "int list did not survive saving" << std::endl;
+        return false;
+    }
+
+    if(newByteProp.getData<std::vector<uint8_t>>() != bytes) {
+        std::cout << "byte list did not survive saving" << std::endl;
+        return false;
+    }
+
+    auto newFloats = newFloatProp.getData<std::shared_ptr<std::vector<float>>>();
+    if(!newFloats || *newFloats != *floats) {
+        std::cout << "float list did not survive saving" << std::endl;
+        return false;
+    }
+
+    if(newDoubleProp.getData<std::vector<double>>() != doubles) {
+        std::cout << "double list did not survive saving" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool testAsyncLoader()
+{
+    NodePtr node = NodeDataBase::createNode("Values.Float Value");
+    auto load = [] (int value) {
+        return [value] (const AsyncLoader::Progress &progress) {
+            progress(.5);
+            return Property(value);
+        };
+    };
+
+    if(AsyncLoader::request(node.get(), "first", load(1))) {
+        std::cout << "data was there before it was loaded" << std::endl;
+        return false;
+    }
+    //a new key replaces the running load
+    AsyncLoader::request(node.get(), "second", load(2));
+    while(AsyncLoader::pending())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    Property loaded = AsyncLoader::request(node.get(), "second", load(3));
+    std::cout << "loaded " << (loaded ? loaded.getData<int>() : -1) << std::endl;
+    return loaded && loaded.getData<int>() == 2;
+}
+
 bool testCreateList()
 {
     NodePtr createListNode = NodeDataBase::createNode("General.Create List");
@@ -188,6 +314,64 @@ bool testCreateList()
     return true;
 }
 
+bool testAutosaveRecovery()
+{
+    Autosave::start();
+    DNSpace *space = Project::instance()->getRootSpace();
+
+    NodePtr createListNode = NodeDataBase::createNode("General.Create List");
+    NodePtr floatValueNode = NodeDataBase::createNode("Values.Float Value");
+    NodePtr intValueNode = NodeDataBase::createNode("Values.Int Value");
+    space->addNode(createListNode);
+    space->addNode(floatValueNode);
+    space->addNode(intValueNode);
+
+    floatValueNode->getInSockets()[0]->setProperty(5.0);
+    createListNode->getInSockets()[0]->setCntdSocket(floatValueNode->getOutSockets()[0]);
+
+    //the rest of the edits are replayed on top of the snapshot
+    Autosave::compact();
+    intValueNode->getInSockets()[0]->setProperty(10);
+    createListNode->getInSockets()[1]->setCntdSocket(intValueNode->getOutSockets()[0]);
+    createListNode->getInSockets()[0]->setCntdSocket(nullptr);
+    space->removeNode(floatValueNode.get());
+    Autosave::flush();
+
+    std::unique_ptr<DNSpace> recovered(Autosave::recover(Project::instance()->getFilename()));
+
+    //the next session would find the journal and offer to recover it
+    Autosave::stop();
+    std::string journal = Autosave::journalPath(Project::instance()->getFilename());
+    std::remove(journal.c_str());
+    std::remove((journal + ".snapshot0").c_str());
+    std::remove((journal + ".snapshot1").c_str());
+
+    if(!recovered) {
+        std::cout << "nothing was recovered" << std::endl;
+        return false;
+    }
+
+    if(recovered->getNodeCnt() != space->getNodeCnt()) {
+        std::cout << "recovered " << recovered->getNodeCnt() << " nodes instead of "
+            << space->getNodeCnt() << std::endl;
+        return false;
+    }
+
+    //other tests might have left nodes in the project before these
+    NodeList nodes = recovered->getNodes();
+    NodePtr list = nodes[nodes.size() - 2];
+    NodePtr intValue = nodes[nodes.size() - 1];
+    if(list->getInSockets()[0]->getCntdSocket()
+       || list->getInSockets()[1]->getCntdSocket() != intValue->getOutSockets()[0]) {
+        std::cout << "links were not recovered" << std::endl;
+        return false;
+    }
+
+    Property value = intValue->getInSockets()[0]->getProperty();
+    std::cout << "recovered value: " << (value ? value.getData<int>() : -1) << std::endl;
+    return value && value.getData<int>() == 10;
+}
+
 bool testDCEL()
 {
     double pi = std::acos(-1);
@@ -236,6 +420,284 @@ bool testDCEL()
     return true;
 }
 
+bool testObjChunks()
+{
+    //large enough to be split into chunks on machines with several cores.
+    //All faces come after the vertices, so faces of later chunks reach back
+    //into earlier ones with their negative indices
+    const int FACES = 50000;
+    const int VERTICES = 3 * FACES;
+    {
+        std::ofstream file("testObjChunks.obj");
+        file << "o first\n";
+        for(int i = 0; i < VERTICES; ++i)
+            file << "v " << i << " 0 0\n";
+        for(int f = 0; f < FACES; ++f) {
+            if(f == FACES / 2) file << "o second\n";
+            int a = 3 * f;
+            if(f % 2)
+                file << "f " << a - VERTICES << " " << a + 1 - VERTICES << " " << a + 2 - VERTICES << "\n";
+            else
+                file << "f " << a + 1 << " " << a + 2 << " " << a + 3 << "\n";
+        }
+    }
+
+    ObjImporter importer("testObjChunks.obj");
+    std::remove("testObjChunks.obj");
+    auto members = importer.getGroup()->getMembers();
+    if(members.size() != 2) {
+        std::cout << "imported " << members.size() << " objects instead of 2" << std::endl;
+        return false;
+    }
+
+    int face = 0;
+    for(const auto &member : members) {
+        auto obj = std::static_pointer_cast<GeoObject>(member);
+        auto mesh = std::static_pointer_cast<MeshData>(obj->getData());
+        auto P = mesh->getProperty("P").getData<VertexListPtr>();
+        auto polygons = mesh->getProperty("polygon").getData<PolygonListPtr>();
+        for(const auto &polygon : *polygons) {
+            for(int i = 0; i < 3; ++i) {
+                if((*P)[polygon[i]].x != 3 * face + i) {
+                    std::cout << obj->getName() << ": face " << face << " uses vertex "
+                        << (*P)[polygon[i]].x << " instead of " << 3 * face + i << std::endl;
+                    return false;
+                }
+            }
+            ++face;
+        }
+    }
+    std::cout << "imported " << face << " faces" << std::endl;
+    return face == FACES;
+}
+
+namespace {
+    //swaps the bytes of value into big endian order, whatever the machine is
+    template<typename T>
+    void writeBigEndian(std::ofstream &file, T value)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        const uint16_t one = 1;
+        if(*reinterpret_cast<const char*>(&one) == 1)
+            std::reverse(bytes, bytes + sizeof(T));
+        file.write(bytes, sizeof(T));
+    }
+
+    bool checkPoints(const MeshDataPtr &mesh, const std::vector<glm::vec3> &points,
+                     const std::vector<glm::vec3> &colors)
+    {
+        if(!mesh) {
+            std::cout << "nothing was imported" << std::endl;
+            return false;
+        }
+        auto P = mesh->getProperty("P").getData<VertexListPtr>();
+        auto C = mesh->getProperty("C").getData<VertexListPtr>();
+        if(!P || !C || P->size() != points.size() || C->size() != colors.size()) {
+            std::cout << "wrong number of points" << std::endl;
+            return false;
+        }
+        for(size_t i = 0; i < points.size(); ++i) {
+            if((*P)[i] != points[i] || glm::length((*C)[i] - colors[i]) > 1e-5) {
+                std::cout << "point " << i << " was not read back" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool testPlyFormats()
+{
+    std::vector<glm::vec3> points{{1, 2, 3}, {-4.5, 0, 6.25}, {7, -8, 9}};
+    std::vector<glm::vec3> colors{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    auto writeHeader = [&points](std::ofstream &file, std::string format) {
+        file << "ply\nformat " << format << " 1.0\n"
+            << "element vertex " << points.size() << "\n"
+            << "property float x\nproperty float y\nproperty float z\n"
+            << "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+            << "end_header\n";
+    };
+
+    {
+        std::ofstream file("testPlyAscii.ply");
+        writeHeader(file, "ascii");
+        for(size_t i = 0; i < points.size(); ++i)
+            file << points[i].x << " " << points[i].y << " " << points[i].z << " "
+                << int(colors[i].x * 255) << " " << int(colors[i].y * 255) << " "
+                << int(colors[i].z * 255) << "\n";
+    }
+    {
+        std::ofstream file("testPlyBigEndian.ply", std::ios::binary);
+        writeHeader(file, "binary_big_endian");
+        for(size_t i = 0; i < points.size(); ++i) {
+            for(int k = 0; k < 3; ++k) writeBigEndian(file, points[i][k]);
+            for(int k = 0; k < 3; ++k) writeBigEndian(file, uint8_t(colors[i][k] * 255));
+        }
+    }
+
+    auto ascii = PointCloudImporter("testPlyAscii.ply", PointCloudImporter::Options()).import();
+    auto bigEndian = PointCloudImporter("testPlyBigEndian.ply", PointCloudImporter::Options()).import();
+    std::remove("testPlyAscii.ply");
+    std::remove("testPlyBigEndian.ply");
+    return checkPoints(ascii, points, colors) && checkPoints(bigEndian, points, colors);
+}
+
+bool testMeshExportRoundTrip()
+{
+    auto points = std::make_shared<VertexList>();
+    auto colors = std::make_shared<VertexList>();
+    auto polygons = std::make_shared<PolygonList>();
+    for(int i = 0; i < 1000; ++i) {
+        points->push_back(glm::vec3(i % 10, i / 10 % 10, i / 100));
+        //exact in 8 bit
+        colors->push_back(glm::vec3(i % 2, i % 3 == 0, 1));
+    }
+    for(uint i = 0; i + 2 < points->size(); i += 3)
+        polygons->push_back(Polygon{i, i + 1, i + 2});
+
+    auto mesh = std::make_shared<MeshData>();
+    mesh->setProperty("P", points);
+    mesh->setProperty("C", colors);
+    mesh->setProperty("polygon", polygons);
+    auto obj = std::make_shared<GeoObject>();
+    obj->setData(mesh);
+
+    if(!MeshExporter("testMeshExportRoundTrip.ply").exportObject(obj)) {
+        std::cout << "export failed" << std::endl;
+        return false;
+    }
+    auto imported = PointCloudImporter("testMeshExportRoundTrip.ply",
+                                       PointCloudImporter::Options()).import();
+    std::remove("testMeshExportRoundTrip.ply");
+    return checkPoints(imported, *points, *colors);
+}
+
+namespace {
+    //flat grid of size x size quads. The vertices of the middle column are
+    //duplicated for the quads right of it, like an attribute seam
+    MeshDataPtr makeGrid(uint size, bool seam, uint *seamStart=nullptr)
+    {
+        auto points = std::make_shared<VertexList>();
+        auto polygons = std::make_shared<PolygonList>();
+        for(uint y = 0; y <= size; ++y)
+            for(uint x = 0; x <= size; ++x)
+                points->push_back(glm::vec3(x, y, 0));
+
+        uint middle = size / 2;
+        uint twins = points->size();
+        if(seamStart) *seamStart = twins;
+        if(seam)
+            for(uint y = 0; y <= size; ++y)
+                points->push_back(glm::vec3(middle, y, 0));
+
+        auto index = [&](uint x, uint y, bool right) {
+            return seam && right && x == middle ? twins + y : y * (size + 1) + x;
+        };
+        for(uint y = 0; y < size; ++y) {
+            for(uint x = 0; x < size; ++x) {
+                bool right = x >= middle;
+                polygons->push_back(Polygon{index(x, y, right), index(x + 1, y, right),
+                                            index(x + 1, y + 1, right), index(x, y + 1, right)});
+            }
+        }
+
+        auto mesh = std::make_shared<MeshData>();
+        mesh->setProperty("P", points);
+        mesh->setProperty("polygon", polygons);
+        return mesh;
+    }
+}
+
+bool testMeshSimplification()
+{
+    const uint SIZE = 16;
+    uint seamStart;
+    auto mesh = makeGrid(SIZE, true, &seamStart);
+    auto points = mesh->getProperty("P").getData<VertexListPtr>();
+    auto polygons = mesh->getProperty("polygon").getData<PolygonListPtr>();
+
+    auto triangles = MeshSimplification::triangulate(*polygons);
+    const size_t target = triangles.size() / 3 / 4;
+    auto simplified = MeshSimplification::simplify(*points, triangles, target);
+    size_t count = simplified.size() / 3;
+    std::cout << "simplified " << triangles.size() / 3 << " to " << count << " triangles" << std::endl;
+    if(count == 0 || count > target) {
+        std::cout << "expected at most " << target << " triangles" << std::endl;
+        return false;
+    }
+
+    //vertices right of the seam are those of columns past the middle and
+    //the twins, triangles never mix both sides. Both sides have to keep the
+    //same vertices along the seam, otherwise it would crack open
+    auto isRight = [&](uint v) {
+        return v >= seamStart || (*points)[v].x > SIZE / 2;
+    };
+    std::set<float> left, right;
+    for(size_t i = 0; i < simplified.size(); i += 3) {
+        bool side = isRight(simplified[i]);
+        for(int k = 0; k < 3; ++k) {
+            uint v = simplified[i + k];
+            if(isRight(v) != side) {
+                std::cout << "triangle " << i / 3 << " crosses the seam" << std::endl;
+                return false;
+            }
+            if((*points)[v].x == SIZE / 2)
+                (side ? right : left).insert((*points)[v].y);
+        }
+    }
+    if(left != right) {
+        std::cout << "the seam vertices differ on both sides" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool testMeshClusters()
+{
+    auto mesh = makeGrid(64, false);
+    auto points = mesh->getProperty("P").getData<VertexListPtr>();
+    auto polygons = mesh->getProperty("polygon").getData<PolygonListPtr>();
+    auto triangles = MeshSimplification::triangulate(*polygons);
+    MeshData::Clusters clusters = MeshClusters::build(*points, triangles);
+
+    //every triangle ends up in exactly one cluster
+    if(clusters.triangles.size() != triangles.size()) {
+        std::cout << "clusters have " << clusters.triangles.size() / 3
+            << " triangles instead of " << triangles.size() / 3 << std::endl;
+        return false;
+    }
+    std::multiset<std::vector<uint>> before, after;
+    for(size_t i = 0; i < triangles.size(); i += 3) {
+        before.insert({triangles[i], triangles[i + 1], triangles[i + 2]});
+        after.insert({clusters.triangles[i], clusters.triangles[i + 1], clusters.triangles[i + 2]});
+    }
+    if(before != after) {
+        std::cout << "clusters do not hold the triangles of the mesh" << std::endl;
+        return false;
+    }
+
+    uint next = 0;
+    for(const auto &cluster : clusters.clusters) {
+        if(cluster.firstTriangle != next
+           || cluster.triangleCount == 0
+           || cluster.triangleCount > MeshClusters::MAX_TRIANGLES) {
+            std::cout << "cluster at " << cluster.firstTriangle << " with "
+                << cluster.triangleCount << " triangles" << std::endl;
+            return false;
+        }
+        for(uint i = 3 * cluster.firstTriangle; i < 3 * (next + cluster.triangleCount); ++i) {
+            if(glm::length((*points)[clusters.triangles[i]] - cluster.center) > cluster.radius * 1.001f) {
+                std::cout << "cluster bounds miss a vertex" << std::endl;
+                return false;
+            }
+        }
+        next += cluster.triangleCount;
+    }
+    std::cout << clusters.clusters.size() << " clusters" << std::endl;
+    return next == triangles.size() / 3;
+}
+
 BOOST_PYTHON_MODULE(cpp_tests)
 {
     BPy::def("testSocketPropertiesCPP", testSocketProperties);    
@@ -245,6 +707,15 @@ BOOST_PYTHON_MODULE(cpp_tests)
     BPy::def("testPropertyConversionCPP", testPropertyConversion);
     BPy::def("testRaycastingCPP", testRaycasting);
     BPy::def("testSaveLoadPropertiesCPP", testSaveLoadProperties);
+    BPy::def("testSaveLoadMeshPropertiesCPP", testSaveLoadMeshProperties);
+    BPy::def("testSaveLoadListPropertiesCPP", testSaveLoadListProperties);
+    BPy::def("testAsyncLoaderCPP", testAsyncLoader);
     BPy::def("testCreateListCPP", testCreateList);
     BPy::def("testDCELCPP", testDCEL);
+    BPy::def("testAutosaveRecoveryCPP", testAutosaveRecovery);
+    BPy::def("testObjChunksCPP", testObjChunks);
+    BPy::def("testPlyFormatsCPP", testPlyFormats);
+    BPy::def("testMeshExportRoundTripCPP", testMeshExportRoundTrip);
+    BPy::def("testMeshSimplificationCPP", testMeshSimplification);
+    BPy::def("testMeshClustersCPP", testMeshClusters);
 }
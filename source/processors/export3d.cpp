@@ -1,6 +1,7 @@
 #include "data/debuglog.h"
 #include "../plugins/datatypes/Object/object.h"
 #include "data/reloadable_plugin.h"
+#include "../plugins/mtio/mesh_export.h"
 
 #include <assimp/Exporter.hpp>
 #include <assimp/scene.h>
@@ -92,11 +93,12 @@ public:
             auto verts = mesh->getProperty("P").getData<VertexListPtr>();
             aim->mNumVertices = verts->size();
             aim->mVertices = new aiVector3D[verts->size()];
-            aim->mNormals = new aiVector3D[verts->size()];
-            auto normals = mesh->getProperty("N").getData<VertexListPtr>();
-            for(int i = 0; i < verts->size(); ++i) {
-                aim->mVertices[i] = convert((*verts)[i]);
-                aim->mNormals[i] = convert((*normals)[i]);
+            //aiVector3D and glm::vec3 are both three floats
+            std::copy_n(reinterpret_cast<const aiVector3D*>(verts->data()), verts->size(), aim->mVertices);
+            auto normals = mesh->hasProperty("N") ? mesh->getProperty("N").getData<VertexListPtr>() : nullptr;
+            if(normals && normals->size() == verts->size()) {
+                aim->mNormals = new aiVector3D[verts->size()];
+                std::copy_n(reinterpret_cast<const aiVector3D*>(normals->data()), verts->size(), aim->mNormals);
             }
 
             auto polygons = mesh->getProperty("polygon").getData<PolygonListPtr>();
@@ -164,6 +166,12 @@ void export3d(DataCache* cache)
     auto data = cache->getData(1).getData<AbstractTransformablePtr>();
     auto filename = cache->getData(0).getData<std::string>();
 
+    if(MeshExporter::canExport(filename)) {
+        MeshExporter(filename).exportObject(data);
+        return;
+    }
+
+    //interchange formats go through assimp
     AssimpExporter exporter(filename);
     exporter.exportObject(data);
 }
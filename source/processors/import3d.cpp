@@ -1,6 +1,7 @@
 #include "data/debuglog.h"
 #include "../plugins/datatypes/Object/object.h"
 #include "data/reloadable_plugin.h"
+#include "data/async_loader.h"
 #include "../plugins/mtio/assimp.h"
 
 using namespace MindTree;
@@ -13,9 +14,20 @@ void import(DataCache* cache)
     if(file.empty())
         return;
 
-    AssimpImporter importer(file);
+    //the file is read on an I/O thread, an empty stands in until it is done
+    auto loaded = AsyncLoader::request(cache->getNode(), file,
+                                       [file] (const AsyncLoader::Progress &progress) {
+        return Property(AssimpImporter(file, progress).import());
+    });
 
-    auto ret = importer.import();
+    //the loaded scene is shared by every cook, each one transforms a copy
+    //of it, which shares the meshes
+    AbstractTransformablePtr ret;
+    if(loaded) {
+        auto scene = loaded.getData<AbstractTransformablePtr>();
+        if(scene) ret = scene->clone();
+    }
+    if(!ret) ret = std::make_shared<Empty>();
     ret->setTransformation(trans);
     cache->pushData(ret);
 }